@@ -0,0 +1,79 @@
+#define __BENCHMARK_BITSHUFFLE_SCHEME_IMPL_CPP__
+
+#include <thread>
+
+#include "encoders/bitshuffle_scheme_impl.hpp"
+#include "benchmark_fixtures.hpp"
+
+typedef sqeazy::benchmark::static_synthetic_data<> static_default_fixture;
+
+/*
+  encode and decode are registered with the same thread counts (given as argument) so that their scaling can be
+  compared side by side, e.g. with --benchmark_filter=static_default_fixture/.*code/
+*/
+
+static void thread_counts(benchmark::internal::Benchmark* _bench){
+
+  const int max_threads = (std::max)(1u,std::thread::hardware_concurrency());
+
+  for(int nthreads = 1;nthreads < max_threads;nthreads *= 2)
+    _bench->Arg(nthreads);
+
+  _bench->Arg(max_threads);
+}
+
+BENCHMARK_DEFINE_F(static_default_fixture, encode)(benchmark::State& state) {
+
+  sqeazy::bitshuffle_scheme<std::uint16_t> local;
+  local.set_n_threads(state.range(0));
+
+  //heat the caches
+  local.encode(sin_data.data(),
+               output_data.data(),
+               size);
+
+  while (state.KeepRunning()) {
+
+    local.encode(sin_data.data(),
+                 output_data.data(),
+                 size);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(sin_data.size())*sizeof(sin_data.front()));
+}
+
+BENCHMARK_REGISTER_F(static_default_fixture, encode)->Apply(thread_counts)->UseRealTime();
+
+BENCHMARK_DEFINE_F(static_default_fixture, decode)(benchmark::State& state) {
+
+  sqeazy::bitshuffle_scheme<std::uint16_t> local;
+  local.set_n_threads(state.range(0));
+
+  sqeazy::vec_32algn_t<std::uint16_t> encoded(sin_data.size(),0);
+  local.encode(sin_data.data(),
+               encoded.data(),
+               size);
+
+  //heat the caches
+  local.decode(encoded.data(),
+               output_data.data(),
+               size);
+
+  while (state.KeepRunning()) {
+
+    local.decode(encoded.data(),
+                 output_data.data(),
+                 size);
+  }
+
+  if(!std::equal(sin_data.begin(), sin_data.end(), output_data.begin()))
+    state.SkipWithError("bitshuffle decode does not reproduce the input");
+
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(sin_data.size())*sizeof(sin_data.front()));
+}
+
+BENCHMARK_REGISTER_F(static_default_fixture, decode)->Apply(thread_counts)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,441 @@
+#define __BENCHMARK_PIPELINE_STRINGS_CPP__
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "boost/program_options.hpp"
+
+#include "benchmark_fixtures.hpp"
+#include "sqeazy_pipelines.hpp"
+#include "string_parsers.hpp"
+
+#ifdef SQY_BENCH_WITH_TIFF
+#include "tiff_utils.hpp"
+#endif
+
+/*
+  benchmark driver for arbitrary pipeline strings, e.g.
+
+  $ benchmark_pipeline_strings -p "bitswap1->lz4" -p "rmestbkrd->bitswap1->lz4(n_chunks_of_input=8)" \
+      -d noisy_embryo -s 128,512,512 -j 1,4 --benchmark_format=json --benchmark_out=pipelines.json
+
+  every combination of pipeline, dataset and thread count yields one encode and one decode benchmark;
+  the throughput, compression ratio, peak resident set size and the time spent in each stage of the
+  pipeline are reported as counters, i.e. --benchmark_format=json emits them as google/benchmark JSON;
+  peak_rss_MB is the high-water mark of the whole process at the end of a benchmark, i.e. it includes
+  all benchmarks run before and only grows over a run (run a single benchmark via --benchmark_filter
+  to measure it in isolation)
+*/
+
+namespace opts = boost::program_options;
+
+namespace sqeazy {
+
+  namespace benchmark {
+
+    /**
+       \brief peak resident set size of the process in MB (0 if not available on this platform),
+       this covers everything the process has done so far and not a single benchmark
+    */
+    static double peak_rss_mb(){
+#ifndef _WIN32
+      struct rusage usage;
+      if(getrusage(RUSAGE_SELF, &usage) == 0){
+#ifdef __APPLE__
+        return usage.ru_maxrss/double(1 << 20);
+#else
+        return usage.ru_maxrss/double(1 << 10);
+#endif
+      }
+#endif
+      return 0;
+    }
+
+    /**
+       \brief input data of one benchmark, either synthetic or loaded from disk
+    */
+    template <typename T>
+    struct pipeline_dataset {
+
+      std::string name;
+      std::vector<std::size_t> shape;
+      sqeazy::vec_32algn_t<T> data;
+
+      std::size_t size_in_bytes() const {
+        return data.size()*sizeof(T);
+      }
+    };
+
+    /**
+       \brief create dataset _name of _shape, _name is one of the synthetic datasets (sinus, embryo, noisy_embryo)
+       or the path of a raw file (or tif file if compiled with libtiff) to load
+
+       \return 0 on success, 1 otherwise
+    */
+    template <typename T>
+    int make_dataset(const std::string& _name,
+                     const std::vector<std::size_t>& _shape,
+                     pipeline_dataset<T>& _dataset){
+
+      _dataset.name = _name;
+      _dataset.shape = _shape;
+
+      if(_name == "sinus" || _name == "embryo" || _name == "noisy_embryo"){
+
+        dynamic_synthetic_data<T> fixture;
+        fixture.setup(_shape);
+
+        if(_name == "sinus")
+          _dataset.data.swap(fixture.sinus_);
+        else if(_name == "embryo")
+          _dataset.data.swap(fixture.embryo_);
+        else
+          _dataset.data.swap(fixture.noisy_embryo_);
+
+        return 0;
+      }
+
+      _dataset.name = _name.substr(_name.find_last_of("/\\") + 1);
+
+#ifdef SQY_BENCH_WITH_TIFF
+      const std::string extension = _name.substr(_name.find_last_of('.') + 1);
+      if(extension == "tif" || extension == "tiff"){
+
+        sqeazy::tiff_facet input(_name);
+        if(input.empty() || input.bits_per_sample() != int(sizeof(T)*CHAR_BIT)){
+          std::cerr << "[benchmark_pipeline_strings] unable to load " << _name << " with " << sizeof(T)*CHAR_BIT << " bits per sample\n";
+          return 1;
+        }
+
+        input.dimensions(_dataset.shape);
+        _dataset.data.resize(input.size());
+        const T* begin = reinterpret_cast<const T*>(input.data());
+        std::copy(begin, begin + input.size(), _dataset.data.begin());
+        return 0;
+      }
+#endif
+
+      //raw file, the shape must be given
+      std::ifstream input(_name, std::ios::binary | std::ios::ate);
+      if(!input.is_open()){
+        std::cerr << "[benchmark_pipeline_strings] unable to open " << _name << "\n";
+        return 1;
+      }
+
+      const std::size_t n_items = std::accumulate(_shape.begin(), _shape.end(), std::size_t(1), std::multiplies<std::size_t>());
+      const std::size_t file_bytes = input.tellg();
+      if(file_bytes < n_items*sizeof(T)){
+        std::cerr << "[benchmark_pipeline_strings] " << _name << " holds " << file_bytes
+                  << " bytes, shape requires " << n_items*sizeof(T) << "\n";
+        return 1;
+      }
+
+      _dataset.data.resize(n_items);
+      input.seekg(0);
+      input.read(reinterpret_cast<char*>(_dataset.data.data()), n_items*sizeof(T));
+      return input ? 0 : 1;
+    }
+
+    /**
+       \brief run _encode once to warm up, then _repeats times
+
+       \return average seconds per call
+    */
+    template <typename function_t>
+    double seconds_per_call(function_t _encode, int _repeats){
+
+      typedef std::chrono::high_resolution_clock clock_t;
+
+      ::benchmark::DoNotOptimize(_encode());
+
+      auto start = clock_t::now();
+      for(int r = 0;r<_repeats;++r)
+        ::benchmark::DoNotOptimize(_encode());
+      std::chrono::duration<double> elapsed = clock_t::now() - start;
+
+      return elapsed.count()/_repeats;
+    }
+
+    /**
+       \brief time in seconds spent in each stage of _pipe (head filters, sink, tail filters), every stage is timed
+       on its own with the output of the stage before it as input (each averaged over _repeats runs), the header
+       is not part of any stage
+
+       \return name and seconds per stage, empty if a stage fails
+    */
+    template <typename pipeline_t, typename T>
+    std::vector<std::pair<std::string,double> > stage_seconds(pipeline_t& _pipe,
+                                                              const pipeline_dataset<T>& _dataset,
+                                                              int _repeats = 3){
+
+      typedef typename pipeline_t::outgoing_t out_t;
+
+      std::vector<std::pair<std::string,double> > value;
+
+      //head filters keep type and size
+      sqeazy::vec_32algn_t<T> head_in(_dataset.data.begin(), _dataset.data.end());
+      sqeazy::vec_32algn_t<T> head_out(head_in.size());
+
+      for(auto& step : _pipe.head_filters_){
+        T* end = nullptr;
+        const double seconds = seconds_per_call([&](){ return end = step->encode(head_in.data(), head_out.data(), _dataset.shape); },
+                                                _repeats);
+        if(end == nullptr)
+          return {};
+
+        value.emplace_back(step->name(), seconds);
+        head_in.swap(head_out);
+      }
+
+      if(!_pipe.sink_)
+        return value;
+
+      std::vector<out_t> tail_in(_pipe.sink_->max_encoded_size(_dataset.size_in_bytes())/sizeof(out_t) + 1);
+      out_t* end = nullptr;
+      value.emplace_back(_pipe.sink_->name(),
+                         seconds_per_call([&](){ return end = _pipe.sink_->encode(head_in.data(), tail_in.data(), _dataset.shape); },
+                                          _repeats));
+      if(end == nullptr)
+        return {};
+
+      //tail filters see the encoded bytes as one row, see dynamic_pipeline::detail_encode
+      std::size_t encoded_len = std::distance(tail_in.data(), end);
+      std::vector<out_t> tail_out;
+
+      for(auto& step : _pipe.tail_filters_){
+
+        std::vector<std::size_t> encoded_shape(_dataset.shape.size(), 1);
+        encoded_shape.back() = encoded_len;
+
+        tail_out.resize((std::max)(std::size_t(step->max_encoded_size(encoded_len*sizeof(out_t))), encoded_len*sizeof(out_t))/sizeof(out_t) + 1);
+        const double seconds = seconds_per_call([&](){ return end = step->encode(tail_in.data(), tail_out.data(), encoded_shape); },
+                                                _repeats);
+        if(end == nullptr)
+          return {};
+
+        value.emplace_back(step->name(), seconds);
+        encoded_len = std::distance(tail_out.data(), end);
+        tail_in.swap(tail_out);
+      }
+
+      return value;
+    }
+
+    template <typename pipeline_t, typename T>
+    void encode_pipeline(::benchmark::State& state,
+                         const std::string& _pipeline,
+                         const pipeline_dataset<T>* _dataset,
+                         int _n_threads,
+                         bool _with_stages){
+
+      typedef typename pipeline_t::outgoing_t out_t;
+
+      auto pipe = pipeline_t::from_string(_pipeline);
+      pipe.set_n_threads(_n_threads);
+
+      std::vector<out_t> output(pipe.max_encoded_size(_dataset->size_in_bytes())/sizeof(out_t) + 1);
+      out_t* end = pipe.encode(_dataset->data.data(), output.data(), _dataset->shape);
+      if(!end){
+        state.SkipWithError("encoding failed");
+        return;
+      }
+
+      for (auto _ : state)
+        ::benchmark::DoNotOptimize(end = pipe.encode(_dataset->data.data(), output.data(), _dataset->shape));
+
+      const double encoded_bytes = std::distance(output.data(), end)*sizeof(out_t);
+
+      state.SetBytesProcessed(int64_t(state.iterations())*_dataset->size_in_bytes());
+      state.counters["encode_MBps"] = ::benchmark::Counter(state.iterations()*_dataset->size_in_bytes()/1e6,
+                                                           ::benchmark::Counter::kIsRate);
+      state.counters["ratio"] = _dataset->size_in_bytes()/encoded_bytes;
+
+      if(_with_stages){
+        const std::vector<std::pair<std::string,double> > seconds = stage_seconds(pipe, *_dataset);
+        if(seconds.empty())
+          std::cerr << "[benchmark_pipeline_strings] unable to time the stages of " << _pipeline << "\n";
+
+        for(std::size_t i = 0;i<seconds.size();++i){
+          std::ostringstream key;
+          key << "stage" << i << "_" << seconds[i].first << "_ms";
+          state.counters[key.str()] = seconds[i].second*1e3;
+        }
+      }
+
+      state.counters["peak_rss_MB"] = peak_rss_mb();
+    }
+
+    template <typename pipeline_t, typename T>
+    void decode_pipeline(::benchmark::State& state,
+                         const std::string& _pipeline,
+                         const pipeline_dataset<T>* _dataset,
+                         int _n_threads){
+
+      typedef typename pipeline_t::outgoing_t out_t;
+
+      auto pipe = pipeline_t::from_string(_pipeline);
+      pipe.set_n_threads(_n_threads);
+
+      std::vector<out_t> encoded(pipe.max_encoded_size(_dataset->size_in_bytes())/sizeof(out_t) + 1);
+      out_t* end = pipe.encode(_dataset->data.data(), encoded.data(), _dataset->shape);
+      if(!end){
+        state.SkipWithError("encoding failed");
+        return;
+      }
+
+      const std::size_t encoded_len = std::distance(encoded.data(), end);
+      sqeazy::vec_32algn_t<T> decoded(_dataset->data.size());
+      int err = 0;
+
+      for (auto _ : state){
+        err = pipe.decode(encoded.data(), decoded.data(), encoded_len);
+        ::benchmark::DoNotOptimize(decoded.data());
+      }
+
+      if(err){
+        state.SkipWithError("decoding failed");
+        return;
+      }
+
+      state.SetBytesProcessed(int64_t(state.iterations())*_dataset->size_in_bytes());
+      state.counters["decode_MBps"] = ::benchmark::Counter(state.iterations()*_dataset->size_in_bytes()/1e6,
+                                                           ::benchmark::Counter::kIsRate);
+      state.counters["ratio"] = _dataset->size_in_bytes()/double(encoded_len*sizeof(out_t));
+      state.counters["peak_rss_MB"] = peak_rss_mb();
+    }
+
+    /**
+       \brief register encode and decode benchmarks for all combinations of _pipelines, _datasets and _threads
+
+       \return number of pipelines that could not be built
+    */
+    template <typename pipeline_t, typename T>
+    int register_pipelines(const std::string& _dtype,
+                           const std::vector<std::string>& _pipelines,
+                           const std::vector<pipeline_dataset<T> >& _datasets,
+                           const std::vector<int>& _threads,
+                           bool _with_stages){
+
+      int value = 0;
+
+      for(const std::string& pipeline : _pipelines){
+
+        if(!pipeline_t::can_be_built_from(pipeline)){
+          std::cerr << "[benchmark_pipeline_strings] unable to build " << _dtype << " pipeline from " << pipeline << "\n";
+          value += 1;
+          continue;
+        }
+
+        for(const pipeline_dataset<T>& dataset : _datasets){
+          for(int n_threads : _threads){
+
+            std::ostringstream name;
+            name << pipeline << "/" << dataset.name << "/" << _dtype << "/threads:" << n_threads;
+
+            const pipeline_dataset<T>* data = &dataset;
+            ::benchmark::RegisterBenchmark(("encode/" + name.str()).c_str(),
+                                           [=](::benchmark::State& st){ encode_pipeline<pipeline_t>(st, pipeline, data, n_threads, _with_stages); })
+              ->UseRealTime()->Unit(::benchmark::kMillisecond);
+
+            ::benchmark::RegisterBenchmark(("decode/" + name.str()).c_str(),
+                                           [=](::benchmark::State& st){ decode_pipeline<pipeline_t>(st, pipeline, data, n_threads); })
+              ->UseRealTime()->Unit(::benchmark::kMillisecond);
+          }
+        }
+      }
+
+      return value;
+    }
+
+    template <typename pipeline_t, typename T>
+    int run_pipelines(const std::string& _dtype,
+                      const std::vector<std::string>& _pipelines,
+                      const std::vector<std::string>& _datasets,
+                      const std::vector<std::size_t>& _shape,
+                      const std::vector<int>& _threads,
+                      bool _with_stages){
+
+      std::vector<pipeline_dataset<T> > datasets(_datasets.size());
+      for(std::size_t i = 0;i<_datasets.size();++i){
+        if(make_dataset(_datasets[i], _shape, datasets[i]))
+          return 1;
+      }
+
+      if(register_pipelines<pipeline_t>(_dtype, _pipelines, datasets, _threads, _with_stages))
+        return 1;
+
+      ::benchmark::RunSpecifiedBenchmarks();
+      return 0;
+    }
+
+  }
+
+}
+
+template <typename T>
+static std::vector<T> split_to(const std::string& _csv){
+
+  std::vector<T> value;
+  for(const std::string& item : sqeazy::split_string_by(_csv, ","))
+    value.push_back(static_cast<T>(std::stoll(item)));
+
+  return value;
+}
+
+int main(int argc, char ** argv)
+{
+  //strips all --benchmark_* flags from argv
+  ::benchmark::Initialize(&argc, argv);
+
+  opts::options_description po("benchmark_pipeline_strings [--benchmark_* flags of google/benchmark] options");
+  po.add_options()
+    ("help,h", "produce help message")
+    ("pipeline,p", opts::value<std::vector<std::string> >()->composing(), "pipeline string to benchmark (can be given multiple times), e.g. 'rmestbkrd->bitswap1->lz4(n_chunks_of_input=8)'")
+    ("dataset,d", opts::value<std::vector<std::string> >()->composing(), "dataset to use (can be given multiple times): sinus, embryo, noisy_embryo (default) or the path of a raw or tif file")
+    ("shape,s", opts::value<std::string>()->default_value("64,512,512"), "comma-separated shape (z,y,x) of synthetic and raw datasets")
+    ("dtype,t", opts::value<std::string>()->default_value("uint16"), "data type to use (uint16 or uint8)")
+    ("threads,j", opts::value<std::string>()->default_value("1"), "comma-separated list of thread counts to benchmark")
+    ("stages", "report the time spent in each stage of the pipeline")
+    ;
+
+  opts::variables_map po_vm;
+  opts::store(opts::command_line_parser(argc, argv).options(po).run(), po_vm);
+  opts::notify(po_vm);
+
+  if(po_vm.count("help") || !po_vm.count("pipeline")) {
+    std::cout << po << '\n';
+    return po_vm.count("help") ? 0 : 1;
+  }
+
+  const std::vector<std::string> pipelines = po_vm["pipeline"].as<std::vector<std::string> >();
+  const std::vector<std::string> datasets = po_vm.count("dataset") ? po_vm["dataset"].as<std::vector<std::string> >() : std::vector<std::string>(1,"noisy_embryo");
+  const std::vector<std::size_t> shape = split_to<std::size_t>(po_vm["shape"].as<std::string>());
+  const std::vector<int> threads = split_to<int>(po_vm["threads"].as<std::string>());
+  const std::string dtype = po_vm["dtype"].as<std::string>();
+  const bool with_stages = po_vm.count("stages");
+
+  if(shape.empty() || threads.empty()){
+    std::cerr << "[benchmark_pipeline_strings] shape and thread counts must not be empty\n";
+    return 1;
+  }
+
+  if(dtype == "uint16")
+    return sqeazy::benchmark::run_pipelines<sqeazy::dypeline<std::uint16_t>, std::uint16_t>(dtype, pipelines, datasets, shape, threads, with_stages);
+
+  if(dtype == "uint8")
+    return sqeazy::benchmark::run_pipelines<sqeazy::dypeline_from_uint8, std::uint8_t>(dtype, pipelines, datasets, shape, threads, with_stages);
+
+  std::cerr << "[benchmark_pipeline_strings] unknown dtype " << dtype << " (expected uint16 or uint8)\n";
+  return 1;
+}
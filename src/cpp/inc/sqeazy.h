@@ -80,6 +80,20 @@ SQY_FUNCTION_PREFIX int SQY_Decompressed_Sizeof(const char* src, long* Sizeof);
 */
 SQY_FUNCTION_PREFIX int SQY_Version_Triple(int* version);
 
+/*
+	SQY_SIMD_Path - store the name of the instruction set the kernels use (scalar, sse4, avx2 or avx512bw)
+	into name, the path is chosen once per process from the host CPU and can be capped by the
+	environment variable SQY_SIMD
+
+	name					: char buffer that receives the name (null-terminated)
+	length					: in: number of chars available in name, out: length of the name (without
+						  the terminating null)
+
+	Returns 0 if success, 1 if name was too small (length then holds the required length), 2 if length is null
+
+*/
+SQY_FUNCTION_PREFIX int SQY_SIMD_Path(char* name, long* length);
+
 ///////////////////////////////////////////////////////////////////////////////////
 // SQY pipelines
 
@@ -145,6 +159,55 @@ SQY_FUNCTION_PREFIX int SQY_PipelineEncode_UI16(const char* pipeline,
                                                 long* dstlength,
                                                 int nthreads);
 
+/*
+	SQY_PipelineEncodeBatch - Compress many independent buffers using Pipeline in one call.
+
+	With at least nthreads items, the items are distributed over nthreads threads (every thread builds
+	the pipeline once), with fewer items they are compressed one after another using nthreads threads
+	each; no nested OpenMP regions are opened and the OpenMP settings of the process are not changed.
+	Each output buffer is a complete sqy buffer that can be decoded with SQY_Decode_UI8/SQY_Decode_UI16.
+	Meant for many small arrays (e.g. 2D frames) where one SQY_PipelineEncode call per array
+	cannot occupy all cores.
+
+	pipeline				: pipeline name
+	n_items					: number of buffers to compress
+	src 					: n_items pointers to contiguous arrays of voxels (externally allocated)
+	shapes					: n_items pointers to the shape of the respective src item (in units of pixels)
+	shape_sizes				: n_items numbers of items in the respective shape
+	dst 					: n_items pointers to compressed buffers (already allocated)
+	dstlengths				: n_items lengths, in: length in bytes of the respective dst buffer
+							  (see SQY_Pipeline_Max_Compressed_Length_3D_*), out: effective compressed
+							  length of all items that succeeded
+	status					: n_items codes (out), 0 if the item was compressed, otherwise
+
+			error 1 -  destination buffer is not large enough
+			error 2 -  pipeline cannot be built or compression failed (including internal errors)
+
+    nthreads                : set the number of threads allowed for the entire batch.
+
+	Returns 0 if all items were compressed, otherwise the number of items that failed
+
+*/
+SQY_FUNCTION_PREFIX int SQY_PipelineEncodeBatch_UI8(const char* pipeline,
+                                                    int n_items,
+                                                    const char** src,
+                                                    long** shapes,
+                                                    unsigned* shape_sizes,
+                                                    char** dst,
+                                                    long* dstlengths,
+                                                    int* status,
+                                                    int nthreads);
+
+SQY_FUNCTION_PREFIX int SQY_PipelineEncodeBatch_UI16(const char* pipeline,
+                                                     int n_items,
+                                                     const char** src,
+                                                     long** shapes,
+                                                     unsigned* shape_sizes,
+                                                     char** dst,
+                                                     long* dstlengths,
+                                                     int* status,
+                                                     int nthreads);
+
 
 /*
 	SQY_Pipeline_Max_Compressed_Length - Calculates the maximum size of the output buffer from Pipeline compression
@@ -298,6 +361,100 @@ SQY_FUNCTION_PREFIX int SQY_Decode_UI8(const char* src,
                                         char* dst,
                                         int nthreads);
 
+///////////////////////////////////////////////////////////////////////////////////
+// SQY pipeline handles
+//
+// the functions above build the pipeline from its string on every call, a handle
+// keeps the built pipeline (and its temporary buffers) alive between calls;
+// a handle must not be used by several threads at the same time
+
+typedef struct SQY_Pipeline SQY_Pipeline;
+
+/*
+	SQY_Pipeline_Create - build a pipeline once for repeated encode/decode calls
+
+	pipeline				: pipeline name (null-terminated, '->' delimited)
+	sizeofpixel				: sizeof pixel type, grayscale 16-bit = 2 bytes, grayscale 8-bit = 1 byte
+    nthreads                : number of threads allowed for the entire pipeline
+
+	Returns a handle to be released with SQY_Pipeline_Destroy, 0 (null) if the pipeline cannot be built
+
+*/
+SQY_FUNCTION_PREFIX SQY_Pipeline* SQY_Pipeline_Create(const char* pipeline,
+                                                      int sizeofpixel,
+                                                      int nthreads);
+
+/*
+	SQY_Pipeline_Encode - Compress using the pipeline of handle, see SQY_PipelineEncode_UI16 for the arguments
+
+	handle					: pipeline handle obtained from SQY_Pipeline_Create
+	src 					: contiguous array of voxels of the sizeofpixel given to SQY_Pipeline_Create
+	shape     				: shape of the nD construct given as src (in units of pixels)
+	shape_size     				: number of items in shape
+	dst 					: Pipeline compressed buffer (already allocated, see SQY_Pipeline_MaxCompressedLength)
+	dstlength 				: out: effective compressed buffer length in bytes
+
+	Returns 0 if success, 1 if there was an error
+
+*/
+SQY_FUNCTION_PREFIX int SQY_Pipeline_Encode(SQY_Pipeline* handle,
+                                            const char* src,
+                                            long* shape,
+                                            unsigned shape_size,
+                                            char* dst,
+                                            long* dstlength);
+
+/*
+	SQY_Pipeline_Decode - Decompress a buffer as output by SQY_Pipeline_Encode or SQY_PipelineEncode_*
+
+	The pipeline described in the header of src is used, the stages are only rebuilt if it differs
+	from the one of the previous call with handle.
+
+	handle					: pipeline handle obtained from SQY_Pipeline_Create
+	src 					: Pipeline compressed buffer (externally allocated)
+	srclength 				: length in bytes of compressed buffer
+	dst 					: contiguous array of voxels of the sizeofpixel given to SQY_Pipeline_Create
+							  (externally allocated, length from SQY_Decompressed_Length)
+
+	Returns 0 if success, 2 if src holds pixels of another size than the sizeofpixel of handle
+	(dst is left untouched), another code if there was an error
+
+*/
+SQY_FUNCTION_PREFIX int SQY_Pipeline_Decode(SQY_Pipeline* handle,
+                                            const char* src,
+                                            long srclength,
+                                            char* dst);
+
+/*
+	SQY_Pipeline_MaxCompressedLength - maximum size of the output buffer of SQY_Pipeline_Encode
+
+	handle					: pipeline handle obtained from SQY_Pipeline_Create
+	shape					: (in) shape of the incoming nD dataset
+	shape_size				: (in) number of items in shape
+	length 					: (out) maximum length in bytes of compressed buffer
+
+	Returns 0 if success, another code if there was an error
+*/
+SQY_FUNCTION_PREFIX int SQY_Pipeline_MaxCompressedLength(SQY_Pipeline* handle,
+                                                         long* shape,
+                                                         unsigned shape_size,
+                                                         long* length);
+
+/*
+	SQY_Pipeline_SetThreads - change the number of threads the pipeline of handle may use
+
+	Returns 0 if success, 1 if handle is null
+*/
+SQY_FUNCTION_PREFIX int SQY_Pipeline_SetThreads(SQY_Pipeline* handle,
+                                                int nthreads);
+
+/*
+	SQY_Pipeline_Destroy - release handle and all buffers it holds, handle must not be used afterwards
+
+	Returns 0 (destroying a null handle is a no-op)
+*/
+SQY_FUNCTION_PREFIX int SQY_Pipeline_Destroy(SQY_Pipeline* handle);
+
 ///////////////////////////////////////////////////////////////////////////////////
 // HDF5 filter definition
 //
@@ -389,6 +546,47 @@ SQY_FUNCTION_PREFIX int SQY_h5_query_shape(const char* fname,
 SQY_FUNCTION_PREFIX int SQY_h5_read_UI16(const char* fname,
                                          const char* dname,
                                          unsigned short* data);
+
+/*
+	SQY_h5_read_parallel_UI16 - load contents of hdf5 file into data, if the dataset is compressed by sqeazy
+	only, the compressed chunks are fetched from the file and decoded by nthreads threads concurrently
+
+	fname 					: hdf5 file to load data from
+	dname 					: dataset name inside hdf5 file
+	data					: data buffer (externally allocated)
+	nthreads				: number of threads decoding chunks
+
+	Returns 0 if success, another code if there was an error
+
+*/
+SQY_FUNCTION_PREFIX int SQY_h5_read_parallel_UI16(const char* fname,
+                                                  const char* dname,
+                                                  unsigned short* data,
+                                                  int nthreads);
+
+/*
+	SQY_h5_read_region_UI16 - load the box [lo,hi) of a dataset in an hdf5 file into data, if the dataset
+	is compressed by sqeazy only, just the chunks intersecting the box are fetched and decoded by nthreads
+	threads concurrently
+
+	fname 					: hdf5 file to load data from
+	dname 					: dataset name inside hdf5 file
+	shape_size				: number of dimensions of the dataset
+	lo					: first index of the box in every dimension (shape_size items)
+	hi					: one past the last index of the box in every dimension (shape_size items)
+	data					: data buffer of shape hi - lo (externally allocated)
+	nthreads				: number of threads decoding chunks
+
+	Returns 0 if success, another code if there was an error (e.g. the box exceeds the dataset)
+
+*/
+SQY_FUNCTION_PREFIX int SQY_h5_read_region_UI16(const char* fname,
+                                                const char* dname,
+                                                unsigned shape_size,
+                                                const unsigned* lo,
+                                                const unsigned* hi,
+                                                unsigned short* data,
+                                                int nthreads);
 /*
 	SQY_h5_write_UI16 - store unsigned 16-bit int buffer in hdf5 file (no compression is applied).
 
@@ -411,6 +609,33 @@ SQY_FUNCTION_PREFIX int SQY_h5_write_UI16(const char* fname,
 					  const unsigned* shape,
 					  const char* filter);
 
+/*
+	SQY_h5_write_parallel_UI16 - store unsigned 16-bit int buffer compressed by filter in hdf5 file,
+	the chunks of the dataset are compressed concurrently and written pre-compressed (the dataset
+	can be read back like any other sqy compressed dataset, e.g. with SQY_h5_read_UI16)
+
+	fname 					: hdf5 file to store data in
+	dname 					: dataset name inside hdf5 file
+	data					: unsigned 16-bit data to compress and store
+	shape_size				: number of dimensions in data
+	shape					: dimension of data
+	filter					: filter to use (no compression is applied if empty)
+	chunk_shape				: shape_size extents of one hdf5 chunk, if null the chunks span all but
+						  the slowest dimension and give every thread at least one chunk
+	nthreads				: number of threads compressing chunks
+
+	Returns 0 if success, another code if there was an error
+
+*/
+SQY_FUNCTION_PREFIX int SQY_h5_write_parallel_UI16(const char* fname,
+						   const char* dname,
+						   const unsigned short* data,
+						   unsigned shape_size,
+						   const unsigned* shape,
+						   const char* filter,
+						   const unsigned* chunk_shape,
+						   int nthreads);
+
 /*
 	SQY_h5_write - store compressed data into file.
 
@@ -20,10 +20,54 @@ VLDDisable();
 
 #include "sqeazy_definitions.h"
 #include "sqeazy_pipelines.hpp"
+#include "dynamic_pipeline_cache.hpp"
 
 
 namespace sqy = sqeazy;
-  
+
+namespace sqeazy {
+
+  namespace h5_detail {
+
+    /**
+       \brief encode the first _nbytes of _buf with _pipe, the result goes straight into _buf if its _buf_size
+       bytes can hold the worst case of the encoded output (the input is then staged in a buffer that each thread
+       reuses across chunks), otherwise into a newly allocated _outbuf of _outbuflen bytes
+
+       \return pointer past the last encoded byte (in _buf or _outbuf) or nullptr on failure
+    */
+    template <typename raw_t, typename pipeline_t>
+    char* encode_chunk(pipeline_t& _pipe,
+                       char* _buf,
+                       size_t _buf_size,
+                       size_t _nbytes,
+                       const std::vector<size_t>& _shape,
+                       char*& _outbuf,
+                       size_t& _outbuflen){
+
+      const size_t max_encoded = _pipe.max_encoded_size(_nbytes);
+
+      if(max_encoded <= _buf_size){
+        static thread_local std::vector<char> staged;
+        staged.assign(_buf, _buf + _nbytes);
+
+        return _pipe.encode(reinterpret_cast<const raw_t*>(staged.data()),
+                            _buf,
+                            _shape);
+      }
+
+      _outbuflen = max_encoded;
+      _outbuf = new char[_outbuflen];
+
+      return _pipe.encode(reinterpret_cast<const raw_t*>(_buf),
+                          _outbuf,
+                          _shape);
+    }
+
+  }
+
+}
+
 /* declare a hdf5 filter function */
 SQY_FUNCTION_PREFIX size_t H5Z_filter_sqy(unsigned _flags,
 					  size_t _cd_nelmts,
@@ -32,10 +76,14 @@ SQY_FUNCTION_PREFIX size_t H5Z_filter_sqy(unsigned _flags,
 					  size_t *_buf_size,
 					  void** _buf){
   char *outbuf = NULL;
-  size_t outbuflen = 0; //in byte
+  size_t outbuflen = 0; //allocated size of outbuf in byte
+  size_t outbytes = 0; //valid bytes in outbuf (or in *_buf if it is kept)
   int ret = 1;
   size_t value = 0;
 
+  //pipelines are built once per pipeline string and reused (including their scratch buffers) across chunks
+  typedef sqy::pipeline_cache<sqy::dypeline<std::uint16_t> > cache16_t;
+  typedef sqy::pipeline_cache<sqy::dypeline_from_uint8> cache8_t;
 
   const char* c_input = reinterpret_cast<char*>(*_buf);
 
@@ -44,12 +92,9 @@ SQY_FUNCTION_PREFIX size_t H5Z_filter_sqy(unsigned _flags,
 
     /** Decompress data.
      **
-     ** This process is troublesome since the size of uncompressed data
-     ** is unknown, so the low-level interface must be used.
-     ** Data is decompressed to the output buffer (which is sized
-     ** for the average case); if it gets full, its size is doubled
-     ** and decompression continues.  This avoids repeatedly trying to
-     ** decompress the whole block, which could be really inefficient.
+     ** The size of the uncompressed data is known from the sqy header
+     ** in front of the payload, so the chunk is decoded in one go
+     ** straight into the output buffer.
      **/
     
     /* extract the header from the payload */
@@ -67,35 +112,34 @@ SQY_FUNCTION_PREFIX size_t H5Z_filter_sqy(unsigned _flags,
       
       /* setup output data */
       outbuflen = hdr.raw_size_byte();
+      outbytes = outbuflen;
       outbuf = new char[outbuflen];
 
       /* Start decompression. */
       if(found_num_bits == 16){
-	if(!sqy::dypeline<std::uint16_t>::can_be_built_from(hdr.pipeline())){
+	auto pipe = cache16_t::instance().acquire(hdr.pipeline());
+	if(!pipe){
 	  std::cerr << "unable to build pipeline from " << hdr.pipeline() << "\n";
 	}
 	else{
-	  auto pipe = sqy::dypeline<std::uint16_t>::from_string(hdr.pipeline());
-      
-	  ret = pipe.decode(c_input,
-			    reinterpret_cast<std::uint16_t*>(outbuf),
-			    in_shape,
-			    out_shape
-			    );
+	  ret = pipe->decode(c_input,
+			     reinterpret_cast<std::uint16_t*>(outbuf),
+			     in_shape,
+			     out_shape
+			     );
 	}
       }
 
       if(found_num_bits == 8){
-	if(!sqy::dypeline_from_uint8::can_be_built_from(hdr.pipeline())){
+	auto pipe = cache8_t::instance().acquire(hdr.pipeline());
+	if(!pipe){
 	  std::cerr << "unable to build pipeline from " << hdr.pipeline() << "\n";
 	}
 	else{
-	  auto pipe = sqy::dypeline_from_uint8::from_string(hdr.pipeline());
-      
-	  ret = pipe.decode(c_input,
-			    reinterpret_cast<std::uint8_t*>(outbuf),
-			    in_shape,
-			    out_shape);
+	  ret = pipe->decode(c_input,
+			     reinterpret_cast<std::uint8_t*>(outbuf),
+			     in_shape,
+			     out_shape);
 	}
       }
     }
@@ -106,8 +150,9 @@ SQY_FUNCTION_PREFIX size_t H5Z_filter_sqy(unsigned _flags,
      **
      ** This is quite simple, since the size of compressed data in the worst
      ** case is known and it is not much bigger than the size of uncompressed
-     ** data.  This allows us to use the simplified one-shot interface to
-     ** compression.
+     ** data.  If the buffer provided by HDF5 is large enough, the
+     ** encoded chunk is written straight into it, otherwise a buffer
+     ** of worst-case size replaces it.
      **/
     
     /* extract header from cd_values */
@@ -128,71 +173,60 @@ SQY_FUNCTION_PREFIX size_t H5Z_filter_sqy(unsigned _flags,
 	ret = 1;
       }
 
-      outbuflen = hdr.size() + hdr.compressed_size_byte();
-      outbuf = new char[outbuflen];
-      std::copy(c_input,c_input + outbuflen, outbuf);
+      //the input buffer is handed back as is
+      outbytes = hdr.size() + hdr.compressed_size_byte();
       ret = 0;
     }
     else{
 
       //data must be compressed
-      bool pipe_possible = sqy::dypeline<std::uint16_t>::can_be_built_from(cd_val_hdr.pipeline());
       size_t found_num_bits = cd_val_hdr.sizeof_header_type()*CHAR_BIT;
-      
-      if(!pipe_possible){
-	ret = 1 ;
-      }
-      else{
-
-	std::vector<size_t> shape(cd_val_hdr.shape()->begin(), cd_val_hdr.shape()->end());
-	// unsigned header_size_byte = hdr.size();
-	std::vector<char> payload;
-	char* encoded_end = nullptr;
-
-	if(found_num_bits == 16){
-	  auto pipe = sqy::dypeline<std::uint16_t>::from_string(cd_val_hdr.pipeline());
-	  outbuflen = pipe.max_encoded_size(_nbytes);
-	  payload.resize(outbuflen);
-	  
-	  encoded_end = pipe.encode(reinterpret_cast<const std::uint16_t*>(c_input),
-				    payload.data(),
-				    shape);
-	}
+      std::vector<size_t> shape(cd_val_hdr.shape()->begin(), cd_val_hdr.shape()->end());
+      char* encoded_end = nullptr;
 
-	
-	if(found_num_bits == 8){
-	  auto pipe = sqy::dypeline_from_uint8::from_string(cd_val_hdr.pipeline());
-	  outbuflen = pipe.max_encoded_size(_nbytes);
-	  payload.resize(outbuflen);
-	  
-	  encoded_end = pipe.encode(reinterpret_cast<const std::uint8_t*>(c_input),
-				    payload.data(),
-				    shape);
+      if(found_num_bits == 16){
+	auto pipe = cache16_t::instance().acquire(cd_val_hdr.pipeline());
+	if(pipe){
+	  encoded_end = sqy::h5_detail::encode_chunk<std::uint16_t>(*pipe,
+								     reinterpret_cast<char*>(*_buf), *_buf_size,
+								     _nbytes, shape,
+								     outbuf, outbuflen);
 	}
+      }
+
 	
-	if(encoded_end!=nullptr){
-	  outbuflen = encoded_end - payload.data();
-	  outbuf = new char[outbuflen];
-	  std::copy(payload.data(), payload.data()+outbuflen, outbuf);
-	  ret = 0;//success
-	} else {
-	  ret = 1; // failure
+      if(found_num_bits == 8){
+	auto pipe = cache8_t::instance().acquire(cd_val_hdr.pipeline());
+	if(pipe){
+	  encoded_end = sqy::h5_detail::encode_chunk<std::uint8_t>(*pipe,
+								     reinterpret_cast<char*>(*_buf), *_buf_size,
+								     _nbytes, shape,
+								     outbuf, outbuflen);
 	}
-	  
+      }
 	
+      if(encoded_end!=nullptr){
+	outbytes = encoded_end - (outbuf ? outbuf : c_input);
+	ret = 0;//success
+      } else {
+	ret = 1; // failure
       }
+
     }
   }
 
-  /* Always replace the input buffer with the output buffer. */
+  /* Replace the input buffer with the output buffer (if there is one). */
   if(!ret)//success!
     {
-    
-      delete [] *(char**)_buf;//do we know the size of _buf?
 
-      *_buf = outbuf;
-      *_buf_size = outbuflen;
-      value = outbuflen;
+      if(outbuf){
+	delete [] *(char**)_buf;//do we know the size of _buf?
+
+	*_buf = outbuf;
+	*_buf_size = outbuflen;
+      }
+
+      value = outbytes;
 
     }
   else{
@@ -0,0 +1,108 @@
+#ifndef _BOUNDED_QUEUE_H_
+#define _BOUNDED_QUEUE_H_
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+namespace sqeazy {
+
+  /**
+     \brief blocking FIFO of at most capacity items to connect the stages of a producer/consumer pipeline
+
+     push blocks while the queue is full, pop blocks while it is empty; once close was called, push fails and pop
+     drains the remaining items before it fails
+  */
+  template <typename T>
+  class bounded_queue {
+
+    std::deque<T> items_;
+    std::size_t capacity_;
+    bool closed_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+
+  public:
+
+    bounded_queue(std::size_t _capacity = 1):
+      items_(),
+      capacity_(_capacity ? _capacity : 1),
+      closed_(false),
+      mutex_(),
+      not_empty_(),
+      not_full_()
+    {}
+
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    /**
+       \brief append _item, blocks while the queue is full
+
+       \return false if the queue was closed (_item is dropped)
+    */
+    bool push(T _item){
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_full_.wait(lock, [this](){ return closed_ || items_.size() < capacity_; });
+
+      if(closed_)
+        return false;
+
+      items_.push_back(std::move(_item));
+      lock.unlock();
+      not_empty_.notify_one();
+      return true;
+    }
+
+    /**
+       \brief take the oldest item, blocks while the queue is empty and open
+
+       \return false if the queue is closed and drained (_item is untouched)
+    */
+    bool pop(T& _item){
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [this](){ return closed_ || !items_.empty(); });
+
+      if(items_.empty())
+        return false;
+
+      _item = std::move(items_.front());
+      items_.pop_front();
+      lock.unlock();
+      not_full_.notify_one();
+      return true;
+    }
+
+    /**
+       \brief no more items will be pushed, wakes up all waiting threads
+    */
+    void close(){
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+      }
+
+      not_empty_.notify_all();
+      not_full_.notify_all();
+    }
+
+    std::size_t size() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return items_.size();
+    }
+
+    std::size_t capacity() const {
+      return capacity_;
+    }
+
+  };
+
+}
+
+#endif /* _BOUNDED_QUEUE_H_ */
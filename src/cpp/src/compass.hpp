@@ -305,6 +305,7 @@ namespace compass {
 
         struct avx {};
         struct avx2 {};
+        struct avx512bw {};
 
 
     };
@@ -1088,6 +1089,37 @@ namespace compass {
 
       using bitview = compass::utility::bit_view<std::uint32_t>;
 
+      /**
+         \brief extended control register XCR0, tells which register states the OS saves on context switches
+         (0 if the OS did not enable XGETBV, i.e. no AVX state is usable)
+      */
+      static std::uint64_t xcr0() {
+
+        auto regs = rt::cpuid(1);
+
+        //OSXSAVE
+        if(!bitview(regs[ct::ecx]).test(27))
+          return 0;
+
+#ifdef COMPASS_CT_COMP_MSVC
+        return _xgetbv(0);
+#else
+        std::uint32_t eax = 0, edx = 0;
+        __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (std::uint64_t(edx) << 32) | eax;
+#endif
+      }
+
+      //XMM and YMM state
+      static bool os_saves_avx_state() {
+        return (xcr0() & 0x6) == 0x6;
+      }
+
+      //XMM, YMM, opmask and both halves of the ZMM state
+      static bool os_saves_avx512_state() {
+        return (xcr0() & 0xe6) == 0xe6;
+      }
+
       static bool works(ct::x86_tag) {
 
         auto regs = rt::cpuid(0);
@@ -1178,7 +1210,7 @@ namespace compass {
           std::cerr << "unsupported cpuid level detected\n";
         }
 
-        bool value = bitview(regs[ct::ecx]).test(28);
+        bool value = bitview(regs[ct::ecx]).test(28) && os_saves_avx_state();
 
         return value;
       }
@@ -1187,7 +1219,19 @@ namespace compass {
 
         auto regs = rt::cpuid(7,0,0,0);
 
-        bool value = bitview(regs[ct::ebx]).test(5);
+        bool value = bitview(regs[ct::ebx]).test(5) && os_saves_avx_state();
+
+        return value;
+      }
+
+      static bool has(feature::avx512bw , ct::x86_tag){
+
+        auto regs = rt::cpuid(7,0,0,0);
+
+        //AVX512BW (bit 30) is only usable together with AVX512F (bit 16) and if the OS enabled the opmask/ZMM state
+        bool value = bitview(regs[ct::ebx]).test(16) &&
+          bitview(regs[ct::ebx]).test(30) &&
+          os_saves_avx512_state();
 
         return value;
       }
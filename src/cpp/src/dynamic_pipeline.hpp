@@ -7,6 +7,7 @@
 #include "dynamic_stage.hpp"
 #include "dynamic_stage_chain.hpp"
 #include "dynamic_stage_factory.hpp"
+#include "scratch_arena.hpp"
 
 #include "sqeazy_header.hpp"
 #include "sqeazy_algorithms.hpp"
@@ -18,6 +19,7 @@
 #include <string>
 #include <initializer_list>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 #include <type_traits>
 #include <future>
@@ -76,6 +78,7 @@ namespace sqeazy
     sink_ptr_t sink_;
 
     std::uint32_t n_threads_;
+    sqeazy::header::layout header_layout_;
 
     /**
        \brief given a buffer that contains a valid header, this static method can fill the filter_holder and set the sink
@@ -248,6 +251,8 @@ namespace sqeazy
       std::swap(_lhs.head_filters_, _rhs.head_filters_);
       std::swap(_lhs.tail_filters_, _rhs.tail_filters_);
       std::swap(_lhs.sink_, _rhs.sink_);
+      std::swap(_lhs.header_layout_, _rhs.header_layout_);
+      swap(_lhs.scratch_, _rhs.scratch_);
       //_lhs.set_n_threads(_rhs.n_threads());
 
     }
@@ -265,7 +270,9 @@ namespace sqeazy
       head_filters_(),
       tail_filters_(),
       sink_(nullptr),
-      n_threads_(1)
+      n_threads_(1),
+      header_layout_(sqeazy::header::process_default),
+      scratch_()
     {};
 
     /**
@@ -283,7 +290,9 @@ namespace sqeazy
       head_filters_(_stages),
       tail_filters_(),
       sink_(nullptr),
-      n_threads_(1)
+      n_threads_(1),
+      header_layout_(sqeazy::header::process_default),
+      scratch_()
     {
 
 
@@ -303,7 +312,9 @@ namespace sqeazy
       head_filters_(_rhs.head_filters_),
       tail_filters_(_rhs.tail_filters_),
       sink_        (_rhs.sink_        ),
-      n_threads_   (_rhs.n_threads_   )
+      n_threads_   (_rhs.n_threads_   ),
+      header_layout_(_rhs.header_layout_),
+      scratch_     (_rhs.scratch_     )
     {
       set_n_threads(_rhs.n_threads_);
     }
@@ -516,7 +527,8 @@ namespace sqeazy
       sqeazy::header hdr(incoming_t(),
                                _in_shape,
                                name(),
-                               len*sizeof(incoming_t));
+                               len*sizeof(incoming_t),
+                               header_layout_);
 
       std::string value(hdr.begin(),hdr.end());
 
@@ -566,17 +578,16 @@ namespace sqeazy
       const std::size_t max_available_output_size = max_encoded_size(len*sizeof(incoming_t));
       const size_t scratchpad_bytes = (std::max)(max_available_output_size,len*sizeof(incoming_t));
 
-      //create scratchpad here asynchronously as the allocation it consumes quite a long time the larger the data gets
-      std::future<unique_array<incoming_t>> scratchpad = std::async(make_aligned<incoming_t>,
-                                                                    std::size_t(32),
-                                                                    scratchpad_bytes);
+      //the scratchpad is retained across calls, i.e. it is only allocated if a larger input is encountered
+      incoming_t* scratchpad = scratch_.template get<incoming_t>(scratchpad_bytes);
 
       ////////////////////// HEADER RELATED //////////////////
       //insert header
       sqeazy::header hdr(incoming_t(),
                                _in_shape,
                                name(),
-                               len*sizeof(incoming_t));
+                               len*sizeof(incoming_t),
+                               header_layout_);
 
       const std::intmax_t hdr_shift = hdr.size();
       char* output_buffer = reinterpret_cast<char*>(_out);
@@ -595,15 +606,16 @@ namespace sqeazy
                             scratchpad);
 
       ////////////////////// HEADER RELATED //////////////////
-      //update header as the encoding could have changed it
+      //update header as the encoding could have changed it, binary headers take the side blocks of the stages
       std::size_t compressed_bytes = std::distance(first_output,value);
+      if(sqeazy::header::is_binary(hdr.begin(), hdr.end()))
+        hdr.set_side_section<incoming_t>(collect_side_blocks());
       hdr.set_compressed_size_byte<incoming_t>(compressed_bytes*sizeof(outgoing_t));
       hdr.set_pipeline<incoming_t>(name());
 
       if(hdr.size()!=(std::size_t)hdr_shift){
-        std::copy(first_output, first_output + compressed_bytes,
-                  output_buffer+hdr.size()
-                  );
+        //source and destination overlap
+        std::memmove(output_buffer+hdr.size(), first_output, compressed_bytes*sizeof(outgoing_t));
         first_output = reinterpret_cast<outgoing_t*>(output_buffer+hdr.size());
       }
 
@@ -615,22 +627,62 @@ namespace sqeazy
 
     }
 
-    template <typename future_t>
+    /**
+       \brief concatenate the side blocks of all stages (see stage::side_block) in the order of name(), each stage
+       is told the offset of its block and refers to it in its config from now on
+
+       \return side section for a binary header
+    */
+    std::string collect_side_blocks() {
+
+      std::string value;
+
+      auto collect = [&value](auto& _stage){
+        const std::string block = _stage->side_block();
+        if(block.empty())
+          return;
+        _stage->side_block_at(value.size());
+        value += block;
+      };
+
+      for(auto& step : head_filters_)
+        collect(step);
+
+      if(sink_)
+        collect(sink_);
+
+      for(auto& step : tail_filters_)
+        collect(step);
+
+      return value;
+    }
+
+    /**
+       \brief encode _in to _out without writing a header, the head filters alternate between _scratchpad and _out
+       (the input is never copied)
+
+       \param[in] _in input buffer
+       \param[out] _out output buffer (must hold at least available_output_bytes)
+       \param[in] _shape shape of the input buffer
+       \param[in] available_output_bytes number of bytes available in _out
+       \param[in] _scratchpad temporary buffer of at least max(max_encoded_size, input bytes) bytes
+
+       \return pointer to one past the last item written to _out, nullptr on failure
+    */
     outgoing_t* detail_encode(const incoming_t *_in,
                               outgoing_t *_out,
                               std::vector<std::size_t> _shape,
                               std::size_t available_output_bytes,
-                              std::future<future_t>& scratchpad)  {
+                              incoming_t* _scratchpad)  {
 
       std::size_t len = std::accumulate(_shape.begin(), _shape.end(),1,std::multiplies<std::size_t>());
 
-      auto temp = scratchpad.get();
       incoming_t* head_filters_end = nullptr;
       incoming_t* head_results = nullptr;
 
       if(head_filters_.size()){
         head_filters_end = head_filters_.encode(_in,
-                                                temp.get(),
+                                                _scratchpad,
                                                 _shape,
                                                 reinterpret_cast<incoming_t*>(_out)
                                                 );
@@ -640,7 +692,7 @@ namespace sqeazy
           return nullptr;
         }
 
-        head_results = temp.get();
+        head_results = _scratchpad;
       }
 
       outgoing_t* encoded_end = head_filters_end ? reinterpret_cast<outgoing_t*>(head_filters_end) : nullptr;
@@ -657,7 +709,7 @@ namespace sqeazy
         std::size_t compressed_size = std::distance(_out,encoded_end);
         if(tail_filters_.size()){
 
-          outgoing_t* casted_temp = reinterpret_cast<outgoing_t*>(temp.get());
+          outgoing_t* casted_temp = reinterpret_cast<outgoing_t*>(_scratchpad);
 
 
           std::vector<std::size_t> sinked_shape(_shape);
@@ -667,9 +719,16 @@ namespace sqeazy
             sinked_shape[row_major::x] = compressed_size;
           }
 
+          outgoing_t* tail_scratchpad = nullptr;
+          if(tail_filters_.size() > 1)
+            tail_scratchpad = scratch_.template get<outgoing_t>((std::max)(std::size_t(tail_filters_.max_encoded_size(compressed_size*sizeof(outgoing_t))),
+                                                                           compressed_size*sizeof(outgoing_t)),
+                                                                1);
+
           encoded_end = tail_filters_.encode(_out,
                                              casted_temp,
-                                             sinked_shape);
+                                             sinked_shape,
+                                             tail_scratchpad);
           if(!encoded_end){
             std::cerr << "[dynamic_pipeline::detail_encode] unable to process data with tail_filters\n";
             return nullptr;
@@ -752,15 +811,29 @@ namespace sqeazy
       //FIXME: works only if len is greater than hdr.size()
       const char* _in_char_end = _in_char_begin + (len*sizeof(outgoing_t));
 
-      sqeazy::header hdr(_in_char_begin,_in_char_end);
-      std::vector<std::size_t> output_shape(hdr.shape()->begin(),
-                                            hdr.shape()->end());
+      //binary headers are read in place, JSON headers need to be parsed into a header
+      std::vector<std::size_t> output_shape;
+      std::size_t hdr_size = 0;
+      sqeazy::header::view in_place;
+
+      if(in_place.parse(_in_char_begin, _in_char_end - _in_char_begin) == 0){
+        in_place.shape(output_shape);
+        hdr_size = in_place.size();
+      }
+      else{
+        sqeazy::header hdr(_in_char_begin,_in_char_end);
+        output_shape.assign(hdr.shape()->begin(), hdr.shape()->end());
+        hdr_size = hdr.size();
+      }
+
+      if(attach_side_section(in_place.side_section().data(), in_place.side_section().size()))
+        return 1;
 
       if(_outshape.empty())
         _outshape = output_shape;
 
-      const outgoing_t* payload_begin = reinterpret_cast<const outgoing_t*>(_in_char_begin + hdr.size());
-      size_t in_size_bytes = (len*sizeof(outgoing_t)) - hdr.size();
+      const outgoing_t* payload_begin = reinterpret_cast<const outgoing_t*>(_in_char_begin + hdr_size);
+      size_t in_size_bytes = (len*sizeof(outgoing_t)) - hdr_size;
 
       int value = detail_decode(payload_begin, _out,
                                 in_size_bytes,
@@ -769,6 +842,50 @@ namespace sqeazy
       return value;
     }
 
+    /**
+       \brief hand the side section of the header of the buffer to decode to all stages (_len is 0 for headers
+       without one), stages whose config refers to a side block read it from there (see stage::attach_side_section);
+       the stages are updated although decode is const, just like their scratch buffers
+
+       \return 0 on success, 1 if a stage could not find or read its block
+    */
+    int attach_side_section(const char* _begin, std::size_t _len) const {
+
+      int value = 0;
+
+      if(sink_)
+        value |= sink_->attach_side_section(_begin, _len);
+
+      for(const auto& step : head_filters_)
+        value |= step->attach_side_section(_begin, _len);
+
+      for(const auto& step : tail_filters_)
+        value |= step->attach_side_section(_begin, _len);
+
+      return value;
+    }
+
+    /**
+       \brief decode the payload _in (header already stripped) into _out
+
+       the sink (or the plain copy for non-compressing pipelines) writes directly into _out if there are no head filters;
+       otherwise the head filters ping-pong between _out and one scratch buffer, the buffer the sink writes to is chosen
+       such that the last head filter writes into _out
+
+       peak memory used in addition to _in and _out (taken from scratch_ and retained across calls):
+       - no head filters, no tail filters: 0
+       - head filters: output bytes
+       - tail filters: output bytes (1 tail filter) or 2x output bytes (more than 1 tail filter)
+
+       \param[in] _in payload buffer
+       \param[out] _out output buffer of at least prod(out_shape) items
+       \param[in] in_size_bytes size of _in in bytes
+       \param[in] out_shape shape of the decoded stack
+
+       \return error code as in decode
+       \retval
+
+    */
     int detail_decode(const outgoing_t *_in, incoming_t *_out,
                       std::size_t in_size_bytes,
                       std::vector<std::size_t> out_shape) const {
@@ -781,8 +898,15 @@ namespace sqeazy
                                                1,
                                                std::multiplies<std::size_t>());
 
+      //the head filters alternate between _out and head_scratch, see stage_chain::decode
+      incoming_t* head_scratch = nullptr;
+      incoming_t* sink_out = _out;
+      if(!head_filters_.empty()){
+        head_scratch = scratch_.template get<incoming_t>(output_len*sizeof(incoming_t), 0);
+        if(head_filters_.size() % 2 != 0)
+          sink_out = head_scratch;
+      }
 
-      std::vector<incoming_t> temp(output_len,0);
       std::vector<std::size_t> in_shape(out_shape.size(),1);
       if(!in_shape.empty())
         in_shape.back() = input_len;
@@ -791,53 +915,52 @@ namespace sqeazy
         typedef typename sink_t::out_type sink_out_t;
 
         const sink_out_t* compressor_begin = reinterpret_cast<const sink_out_t*>(_in);
-        std::vector<outgoing_t> sink_in;
 
         if(tail_filters_.size()){
           const outgoing_t* tail_in = reinterpret_cast<const outgoing_t*>(_in);
 
           //FIXME: filters may change the size of the buffer!
-          sink_in.resize(output_len*sizeof(*_out)/*/sizeof(*_in)*/);
-          std::fill(sink_in.begin(), sink_in.end(),0);
-
-          outgoing_t* tail_out = reinterpret_cast<outgoing_t*>(sink_in.data());
+          const std::size_t sink_in_len = output_len*sizeof(*_out)/*/sizeof(*_in)*/;
+          outgoing_t* tail_out = scratch_.template get<outgoing_t>(sink_in_len*sizeof(outgoing_t), 1);
+          outgoing_t* tail_scratchpad = tail_filters_.size() > 1 ? scratch_.template get<outgoing_t>(sink_in_len*sizeof(outgoing_t), 2) : nullptr;
 
           err_code = tail_filters_.decode(tail_in,
                                           tail_out,
                                           in_shape,
-                                          out_shape);
+                                          out_shape,
+                                          tail_scratchpad);
           value += err_code ;
 
           //preparing for the sink
-          compressor_begin = reinterpret_cast<const outgoing_t*>(sink_in.data());
-          input_len    = sink_in.size();
+          compressor_begin = reinterpret_cast<const outgoing_t*>(tail_out);
+          input_len    = sink_in_len;
           in_shape     = out_shape;
         }
 
         //FIXME: provide shape vectors?
         err_code = sink_->decode(compressor_begin,
-                                 temp.data(),
+                                 sink_out,
                                  input_len,
-                                 temp.size());
+                                 output_len);
         value += err_code ? err_code+10 : 0 ;
         if(!err_code){
           std::fill(in_shape.begin(), in_shape.end(),1);
-          in_shape.back() = temp.size();
+          in_shape.back() = output_len;
         }
       }
       else{
         std::copy(_in,
                   _in+input_len,
-                  reinterpret_cast<outgoing_t*>(temp.data()));
+                  reinterpret_cast<outgoing_t*>(sink_out));
       }
 
-      if(head_filters_.empty()){
-        std::copy(temp.begin(),temp.begin()+output_len,_out);
-      }
-      else{
+      if(!head_filters_.empty()){
 
-        err_code = head_filters_.decode(reinterpret_cast<const incoming_t*>(temp.data()),
-                                        _out,out_shape);
+        err_code = head_filters_.decode(reinterpret_cast<const incoming_t*>(sink_out),
+                                        _out,
+                                        out_shape,
+                                        out_shape,
+                                        head_scratch);
         value += err_code ? err_code+100 : 0 ;
 
       }
@@ -948,6 +1071,63 @@ namespace sqeazy
 
     }
 
+    sqeazy::header::layout header_layout() const {
+      return header_layout_;
+    }
+
+    /**
+       \brief layout of the headers encode writes, process_default follows sqeazy::header::writes_binary()
+    */
+    void set_header_layout(sqeazy::header::layout _layout){
+      header_layout_ = _layout;
+    }
+
+    /**
+       \brief back the scratch buffers by (transparent) hugepages, buffers held so far are released
+    */
+    void set_use_hugepages(bool _flag){
+      scratch_.set_use_hugepages(_flag);
+    }
+
+    bool use_hugepages() const {
+      return scratch_.use_hugepages();
+    }
+
+    /**
+       \brief scratch buffers retained from previous calls to encode/decode (read-only)
+    */
+    const scratch_arena& scratch() const {
+      return scratch_;
+    }
+
+    /**
+       \brief free the scratch buffers retained from previous calls, the next call allocates them again
+    */
+    void release_scratch() const {
+      scratch_.release();
+    }
+
+    /**
+       \brief free the scratch buffers if they hold more than _max_bytes in total
+
+       \return true if the buffers were released
+    */
+    bool shrink_scratch(std::size_t _max_bytes) const {
+
+      if(scratch_.size_in_bytes() <= _max_bytes)
+        return false;
+
+      scratch_.release();
+      return true;
+    }
+
+  private:
+
+    template <typename, template<typename> class, typename, typename>
+    friend struct dynamic_pipeline;
+
+    //temporary buffers retained across calls to encode/decode (makes encode/decode of one pipeline object non-reentrant)
+    mutable scratch_arena scratch_;
 
   };
 }
@@ -0,0 +1,283 @@
+#ifndef _DYNAMIC_PIPELINE_CACHE_H_
+#define _DYNAMIC_PIPELINE_CACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sqeazy {
+
+  /**
+     \brief thread-safe pool of pipelines built from a pipeline string, the pool is keyed by the pipeline string
+     (the data type is given by pipeline_t, i.e. there is one cache per data type)
+
+     a pipeline is handed out to one caller at a time (dynamic_pipeline keeps scratch buffers and is not reentrant),
+     when the lease goes out of scope, the pipeline returns to the pool together with its scratch buffers;
+     concurrent callers asking for the same pipeline string each obtain their own instance
+
+     pipeline strings that carry a decode map (tile_shuffle, frame_shuffle, i.e. a non-empty reorder_map parameter)
+     are unique per chunk, so pipelines built from them are handed out but never kept (see cacheable); maps stored in
+     the side section of a binary header are only referred to (reorder_map_at) and read on every decode, such
+     pipelines are kept;
+     at most max_keys() pipeline strings are kept, the least recently used one is dropped if a new one arrives;
+     a pipeline that returns with more than max_idle_scratch_bytes() of scratch buffers releases them first, so that
+     idle pipelines do not hold on to the peak memory of the largest input they have seen
+
+     usage:
+     \code
+     auto pipe = pipeline_cache<sqeazy::dypeline<std::uint16_t> >::instance().acquire("bitswap1->lz4");
+     if(pipe)
+       pipe->encode(input, output, shape);
+     \endcode
+  */
+  template <typename pipeline_t>
+  struct pipeline_cache {
+
+    typedef std::unique_ptr<pipeline_t> pipeline_ptr_t;
+
+    struct pool_t {
+      std::vector<pipeline_ptr_t> idle;
+      std::uint64_t last_used;
+
+      pool_t():
+        idle(),
+        last_used(0)
+      {}
+    };
+
+    /**
+       \brief a pipeline on loan from the cache, returned to the cache on destruction
+    */
+    struct lease {
+
+      pipeline_cache* cache_;
+      std::string key_;
+      pipeline_ptr_t pipeline_;
+
+      lease():
+        cache_(nullptr),
+        key_(),
+        pipeline_()
+      {}
+
+      lease(pipeline_cache* _cache, const std::string& _key, pipeline_ptr_t _pipeline):
+        cache_(_cache),
+        key_(_key),
+        pipeline_(std::move(_pipeline))
+      {}
+
+      lease(lease&& _rhs):
+        cache_(_rhs.cache_),
+        key_(std::move(_rhs.key_)),
+        pipeline_(std::move(_rhs.pipeline_))
+      {}
+
+      lease& operator=(lease&& _rhs){
+        give_back();
+        cache_ = _rhs.cache_;
+        key_ = std::move(_rhs.key_);
+        pipeline_ = std::move(_rhs.pipeline_);
+        return *this;
+      }
+
+      lease(const lease&) = delete;
+      lease& operator=(const lease&) = delete;
+
+      ~lease(){
+        give_back();
+      }
+
+      explicit operator bool() const { return pipeline_ != nullptr; }
+
+      pipeline_t* operator->() const { return pipeline_.get(); }
+      pipeline_t& operator*() const { return *pipeline_; }
+      pipeline_t* get() const { return pipeline_.get(); }
+
+    private:
+
+      void give_back(){
+        if(cache_ && pipeline_)
+          cache_->release(key_, std::move(pipeline_));
+        pipeline_.reset();
+      }
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, pool_t> pools_;
+    std::size_t max_keys_;
+    std::uint64_t clock_;
+    std::uint64_t built_;
+    std::size_t max_idle_scratch_bytes_;
+
+    pipeline_cache(std::size_t _max_keys = 16,
+                   std::size_t _max_idle_scratch_bytes = std::size_t(64) << 20):
+      mutex_(),
+      pools_(),
+      max_keys_(_max_keys ? _max_keys : 1),
+      clock_(0),
+      built_(0),
+      max_idle_scratch_bytes_(_max_idle_scratch_bytes)
+    {}
+
+    pipeline_cache(const pipeline_cache&) = delete;
+    pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+    /**
+       \brief process-wide cache for pipeline_t
+    */
+    static pipeline_cache& instance(){
+      static pipeline_cache value;
+      return value;
+    }
+
+    /**
+       \brief obtain a pipeline built from _pipeline_string, an idle one is reused if available, otherwise a new one is built
+       (outside of the lock)
+
+       \return lease that evaluates to false if no pipeline can be built from _pipeline_string
+    */
+    lease acquire(const std::string& _pipeline_string){
+
+      if(!cacheable(_pipeline_string))
+        return build(nullptr, _pipeline_string);
+
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto found = pools_.find(_pipeline_string);
+        if(found != pools_.end()){
+          found->second.last_used = ++clock_;
+          if(!found->second.idle.empty()){
+            pipeline_ptr_t value = std::move(found->second.idle.back());
+            found->second.idle.pop_back();
+            return lease(this, _pipeline_string, std::move(value));
+          }
+        }
+      }
+
+      return build(this, _pipeline_string);
+    }
+
+    /**
+       \brief true if pipelines built from _pipeline_string are worth keeping, i.e. the string does not contain
+       a non-empty reorder_map (a decode map is specific to one chunk and would flood the cache with single-use keys)
+    */
+    static bool cacheable(const std::string& _pipeline_string){
+
+      static const std::string map_key = "reorder_map=";
+
+      std::size_t pos = _pipeline_string.find(map_key);
+      while(pos != std::string::npos){
+        const std::size_t value = pos + map_key.size();
+        if(value < _pipeline_string.size() &&
+           _pipeline_string[value] != ',' &&
+           _pipeline_string[value] != ')')
+          return false;
+        pos = _pipeline_string.find(map_key, value);
+      }
+
+      return true;
+    }
+
+    /**
+       \brief number of pipelines built since construction (or clear)
+    */
+    std::uint64_t built() {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return built_;
+    }
+
+    /**
+       \brief number of pipelines that currently wait in the cache
+    */
+    std::size_t idle() {
+      std::lock_guard<std::mutex> guard(mutex_);
+      std::size_t value = 0;
+      for(const auto& pool : pools_)
+        value += pool.second.idle.size();
+      return value;
+    }
+
+    std::size_t max_keys() const { return max_keys_; }
+
+    std::size_t max_idle_scratch_bytes() {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return max_idle_scratch_bytes_;
+    }
+
+    void set_max_idle_scratch_bytes(std::size_t _nbytes) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      max_idle_scratch_bytes_ = _nbytes;
+    }
+
+    /**
+       \brief free the scratch buffers of all idle pipelines (the pipelines themselves are kept)
+    */
+    void trim(){
+      std::lock_guard<std::mutex> guard(mutex_);
+      for(auto& pool : pools_)
+        for(pipeline_ptr_t& pipe : pool.second.idle)
+          pipe->release_scratch();
+    }
+
+    /**
+       \brief drop all idle pipelines (pipelines on loan return to the cache as usual)
+    */
+    void clear(){
+      std::lock_guard<std::mutex> guard(mutex_);
+      pools_.clear();
+      built_ = 0;
+    }
+
+  private:
+
+    lease build(pipeline_cache* _owner, const std::string& _pipeline_string){
+
+      if(!pipeline_t::can_be_built_from(_pipeline_string))
+        return lease();
+
+      pipeline_ptr_t value(new pipeline_t(pipeline_t::from_string(_pipeline_string)));
+      if(value->empty())
+        return lease();
+
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ++built_;
+      }
+
+      return lease(_owner, _pipeline_string, std::move(value));
+    }
+
+    void release(const std::string& _key, pipeline_ptr_t _pipeline){
+
+      std::lock_guard<std::mutex> guard(mutex_);
+
+      _pipeline->shrink_scratch(max_idle_scratch_bytes_);
+
+      auto found = pools_.find(_key);
+      if(found == pools_.end()){
+
+        if(pools_.size() >= max_keys_){
+          auto oldest = pools_.begin();
+          for(auto it = pools_.begin();it != pools_.end();++it){
+            if(it->second.last_used < oldest->second.last_used)
+              oldest = it;
+          }
+          pools_.erase(oldest);
+        }
+
+        found = pools_.insert(std::make_pair(_key, pool_t())).first;
+      }
+
+      found->second.last_used = ++clock_;
+      found->second.idle.push_back(std::move(_pipeline));
+    }
+
+  };
+
+}
+
+#endif /* _DYNAMIC_PIPELINE_CACHE_H_ */
@@ -0,0 +1,708 @@
+#ifndef _DYNAMIC_PIPELINE_CHUNKED_H_
+#define _DYNAMIC_PIPELINE_CHUNKED_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "sqeazy_common.hpp"
+#include "sqeazy_header.hpp"
+
+namespace sqeazy {
+
+  /**
+     \brief layout of a chunked sqy container as produced by chunked_pipeline::encode
+
+     <magic "SQYCHNK1">
+     <rank (uint64 le)>
+     <shape of the stack, rank x uint64 le>
+     <shape of one chunk, rank x uint64 le>
+     <number of chunks (uint64 le)>
+     <offset of every chunk in bytes from the start of the container, (number of chunks + 1) x uint64 le>
+     <chunk 0: sqy header + payload as produced by dynamic_pipeline::encode>
+     ... (chunks in row-major order of the chunk grid)
+
+     the last offset marks the end of the container; every chunk is a self-contained sqy buffer,
+     chunks at the upper borders of the stack are cut to the stack shape; the chunk headers are written
+     in the binary layout (sqeazy::header::binary_magic), JSON chunk headers are read as well
+  */
+  struct chunked_format {
+
+    static const std::string& magic() {
+      static const std::string value("SQYCHNK1");
+      return value;
+    }
+
+    static void put_u64(char* _dst, std::uint64_t _value){
+      for(int i = 0;i<8;++i)
+        _dst[i] = static_cast<char>((_value >> (8*i)) & 0xff);
+    }
+
+    static std::uint64_t get_u64(const char* _src){
+      std::uint64_t value = 0;
+      for(int i = 0;i<8;++i)
+        value |= std::uint64_t(static_cast<unsigned char>(_src[i])) << (8*i);
+      return value;
+    }
+
+    static std::size_t table_bytes(std::size_t _rank, std::size_t _n_chunks){
+      return magic().size() + sizeof(std::uint64_t)*(1 + 2*_rank + 1 + _n_chunks + 1);
+    }
+
+    /**
+       \brief check if the buffer from _begin to _end starts with a chunked container
+    */
+    static bool contained(const char* _begin, const char* _end){
+      const std::size_t len = std::distance(_begin,_end);
+      return len >= magic().size() && std::equal(magic().begin(), magic().end(), _begin);
+    }
+
+  };
+
+  /**
+     \brief geometry of the chunk grid plus the offset table of a chunked container
+  */
+  struct chunk_table {
+
+    std::vector<std::size_t> shape_;
+    std::vector<std::size_t> chunk_shape_;
+    std::vector<std::uint64_t> offsets_;
+
+    chunk_table():
+      shape_(),
+      chunk_shape_(),
+      offsets_()
+    {}
+
+    /**
+       \brief set up the grid of chunks of _chunk_shape that covers _shape, chunk extents are clamped to [1,_shape];
+       if the ranks do not match, the complete stack ends up in one chunk
+    */
+    chunk_table(const std::vector<std::size_t>& _shape,
+                const std::vector<std::size_t>& _chunk_shape):
+      shape_(_shape),
+      chunk_shape_(_chunk_shape),
+      offsets_()
+    {
+
+      if(chunk_shape_.size() != shape_.size()){
+        std::cerr << "[sqeazy::chunk_table] chunk shape of rank " << chunk_shape_.size()
+                  << " does not match stack of rank " << shape_.size() << ", using 1 chunk\n";
+        chunk_shape_ = shape_;
+      }
+
+      for(std::size_t d = 0;d<rank();++d)
+        chunk_shape_[d] = (std::max)(std::size_t(1),(std::min)(chunk_shape_[d],shape_[d]));
+
+      offsets_.resize(n_chunks()+1,0);
+    }
+
+    std::size_t rank() const { return shape_.size(); }
+
+    std::vector<std::size_t> grid_shape() const {
+
+      std::vector<std::size_t> value(rank(),0);
+      for(std::size_t d = 0;d<rank();++d)
+        value[d] = (shape_[d] + chunk_shape_[d] - 1)/chunk_shape_[d];
+
+      return value;
+    }
+
+    std::size_t n_chunks() const {
+
+      if(shape_.empty())
+        return 0;
+
+      const std::vector<std::size_t> grid = grid_shape();
+      return std::accumulate(grid.begin(), grid.end(), std::size_t(1), std::multiplies<std::size_t>());
+    }
+
+    std::size_t size_in_bytes() const {
+      return chunked_format::table_bytes(rank(), n_chunks());
+    }
+
+    /**
+       \brief origin (_lo) and extent of chunk _index (row-major index into the chunk grid)
+    */
+    void chunk_box(std::size_t _index,
+                   std::vector<std::size_t>& _lo,
+                   std::vector<std::size_t>& _extent) const {
+
+      const std::vector<std::size_t> grid = grid_shape();
+      _lo.resize(rank());
+      _extent.resize(rank());
+
+      for(std::size_t d = rank();d>0;--d){
+        const std::size_t pos = _index % grid[d-1];
+        _index /= grid[d-1];
+
+        _lo[d-1] = pos*chunk_shape_[d-1];
+        _extent[d-1] = (std::min)(chunk_shape_[d-1], shape_[d-1] - _lo[d-1]);
+      }
+    }
+
+    /**
+       \brief _lo (inclusive) and _hi (exclusive) describe a non-empty box inside the stack
+    */
+    bool valid_region(const std::vector<std::size_t>& _lo,
+                      const std::vector<std::size_t>& _hi) const {
+
+      if(_lo.size() != rank() || _hi.size() != rank())
+        return false;
+
+      for(std::size_t d = 0;d<rank();++d){
+        if(!(_lo[d] < _hi[d] && _hi[d] <= shape_[d]))
+          return false;
+      }
+
+      return true;
+    }
+
+    /**
+       \brief row-major indices of all chunks that intersect the box [_lo,_hi)
+    */
+    std::vector<std::size_t> chunks_in_region(const std::vector<std::size_t>& _lo,
+                                              const std::vector<std::size_t>& _hi) const {
+
+      std::vector<std::size_t> value;
+      if(!valid_region(_lo,_hi))
+        return value;
+
+      const std::vector<std::size_t> grid = grid_shape();
+      std::vector<std::size_t> first(rank()), last(rank());
+      for(std::size_t d = 0;d<rank();++d){
+        first[d] = _lo[d]/chunk_shape_[d];
+        last[d] = (_hi[d] - 1)/chunk_shape_[d];
+      }
+
+      std::vector<std::size_t> pos(first);
+      while(true){
+
+        std::size_t index = 0;
+        for(std::size_t d = 0;d<rank();++d)
+          index = index*grid[d] + pos[d];
+        value.push_back(index);
+
+        std::size_t d = rank();
+        for(;d>0;--d){
+          if(++pos[d-1] <= last[d-1])
+            break;
+          pos[d-1] = first[d-1];
+        }
+
+        if(!d)
+          break;
+      }
+
+      return value;
+    }
+
+    /**
+       \brief serialize the table to _dst (which must hold size_in_bytes())
+
+       \return pointer past the last byte written
+    */
+    char* write(char* _dst) const {
+
+      _dst = std::copy(chunked_format::magic().begin(), chunked_format::magic().end(), _dst);
+
+      chunked_format::put_u64(_dst, rank()); _dst += 8;
+      for(std::size_t d : shape_){ chunked_format::put_u64(_dst, d); _dst += 8; }
+      for(std::size_t d : chunk_shape_){ chunked_format::put_u64(_dst, d); _dst += 8; }
+
+      chunked_format::put_u64(_dst, n_chunks()); _dst += 8;
+      for(std::uint64_t o : offsets_){ chunked_format::put_u64(_dst, o); _dst += 8; }
+
+      return _dst;
+    }
+
+    /**
+       \brief deserialize the table from the start of the container found in [_begin,_end)
+
+       \return 0 on success, 1 if the buffer does not hold a (complete) table
+    */
+    int read(const char* _begin, const char* _end){
+
+      const std::size_t len = std::distance(_begin,_end);
+      if(!chunked_format::contained(_begin,_end) || len < chunked_format::table_bytes(0,0))
+        return 1;
+
+      const char* src = _begin + chunked_format::magic().size();
+      const std::uint64_t rank = chunked_format::get_u64(src); src += 8;
+
+      if(len < chunked_format::table_bytes(rank,0))
+        return 1;
+
+      shape_.resize(rank);
+      chunk_shape_.resize(rank);
+      for(std::size_t& d : shape_){ d = chunked_format::get_u64(src); src += 8; }
+      for(std::size_t& d : chunk_shape_){ d = chunked_format::get_u64(src); src += 8; }
+
+      if(std::count(chunk_shape_.begin(), chunk_shape_.end(), std::size_t(0)))
+        return 1;
+
+      const std::uint64_t count = chunked_format::get_u64(src); src += 8;
+      if(count != n_chunks() || len < chunked_format::table_bytes(rank,count)){
+        std::cerr << "[sqeazy::chunk_table] offset table is incomplete or inconsistent with the chunk grid\n";
+        return 1;
+      }
+
+      offsets_.resize(count+1);
+      for(std::uint64_t& o : offsets_){ o = chunked_format::get_u64(src); src += 8; }
+
+      return std::is_sorted(offsets_.begin(), offsets_.end()) ? 0 : 1;
+    }
+
+    /**
+       \brief deserialize the table from the current position of _in, only the table is consumed from _in
+
+       \return 0 on success, 1 otherwise
+    */
+    int read(std::istream& _in){
+
+      std::vector<char> buffer(chunked_format::table_bytes(0,0));
+      if(!_in.read(buffer.data(), buffer.size()) || !chunked_format::contained(buffer.data(), buffer.data() + buffer.size()))
+        return 1;
+
+      const std::uint64_t rank = chunked_format::get_u64(buffer.data() + chunked_format::magic().size());
+      std::size_t missing = chunked_format::table_bytes(rank,0) - buffer.size();
+      buffer.resize(buffer.size() + missing);
+      if(!_in.read(buffer.data() + buffer.size() - missing, missing))
+        return 1;
+
+      const std::uint64_t count = chunked_format::get_u64(buffer.data() + buffer.size() - 16);
+      missing = chunked_format::table_bytes(rank,count) - buffer.size();
+      buffer.resize(buffer.size() + missing);
+      if(!_in.read(buffer.data() + buffer.size() - missing, missing))
+        return 1;
+
+      return read(buffer.data(), buffer.data() + buffer.size());
+    }
+
+  };
+
+  namespace detail {
+
+    /**
+       \brief copy the box of shape _extent at _src_lo inside the row-major array _src (of _src_shape)
+       to _dst_lo inside the row-major array _dst (of _dst_shape)
+    */
+    template <typename T>
+    void copy_box(const T* _src,
+                  const std::vector<std::size_t>& _src_shape,
+                  const std::vector<std::size_t>& _src_lo,
+                  T* _dst,
+                  const std::vector<std::size_t>& _dst_shape,
+                  const std::vector<std::size_t>& _dst_lo,
+                  const std::vector<std::size_t>& _extent){
+
+      const std::size_t rank = _extent.size();
+      if(!rank)
+        return;
+
+      const std::size_t row = _extent.back();
+      const std::size_t n_rows = std::accumulate(_extent.begin(), _extent.end() - 1,
+                                                 std::size_t(1), std::multiplies<std::size_t>());
+      if(!row || !n_rows)
+        return;
+
+      std::vector<std::size_t> pos(rank,0);
+      for(std::size_t r = 0;r<n_rows;++r){
+
+        std::size_t src_offset = 0;
+        std::size_t dst_offset = 0;
+        for(std::size_t d = 0;d<rank;++d){
+          src_offset = src_offset*_src_shape[d] + _src_lo[d] + pos[d];
+          dst_offset = dst_offset*_dst_shape[d] + _dst_lo[d] + pos[d];
+        }
+
+        std::copy(_src + src_offset, _src + src_offset + row, _dst + dst_offset);
+
+        for(std::size_t d = rank-1;d>0;--d){
+          if(++pos[d-1] < _extent[d-1])
+            break;
+          pos[d-1] = 0;
+        }
+      }
+    }
+
+  }
+
+  /**
+     \brief chunked sqy container on top of a dynamic_pipeline: the stack is cut into bricks of _chunk_shape,
+     every brick is encoded independently through the complete pipeline and the offset of every brick is stored
+     in a table in front of the bricks, see chunked_format
+
+     decode_region only reads and decodes the bricks that intersect the requested box, so browsing single
+     planes or small ROIs of large stacks does not require to decompress the entire stack
+
+     NOTE: every brick carries its own sqy header, filters that rely on statistics of the whole stack
+     (e.g. quantisers) only see one brick at a time
+
+     usage:
+     \code
+     chunked_pipeline<sqeazy::dypeline<std::uint16_t> > chunked(pipe, {16, 256, 256});
+     std::vector<char> encoded(chunked.max_encoded_size(shape));
+     char* end = chunked.encode(stack.data(), encoded.data(), shape);
+
+     //decode planes 42 to 43 only
+     std::vector<std::size_t> lo = {42, 0, 0}, hi = {44, shape[1], shape[2]};
+     chunked.decode_region(encoded.data(), end, lo, hi, planes.data());
+     \endcode
+  */
+  template <typename pipeline_t>
+  struct chunked_pipeline {
+
+    typedef typename pipeline_t::incoming_t raw_t;
+    typedef typename pipeline_t::outgoing_t compressed_t;
+
+    pipeline_t pipeline_;
+    std::vector<std::size_t> chunk_shape_;
+    int n_threads_;
+
+    /**
+       \brief _pipeline and _chunk_shape are only used for encoding, decoding builds the pipeline from the
+       sqy header of every chunk
+
+       \param[in] _pipeline pipeline to encode every chunk with
+       \param[in] _chunk_shape extent of one chunk, must be of the same rank as the stacks to encode
+       \param[in] _n_threads threads used across chunks (decode) or inside the pipeline (encode)
+    */
+    chunked_pipeline(const pipeline_t& _pipeline = pipeline_t(),
+                     const std::vector<std::size_t>& _chunk_shape = std::vector<std::size_t>(),
+                     int _n_threads = 1):
+      pipeline_(_pipeline),
+      chunk_shape_(_chunk_shape),
+      n_threads_((std::max)(_n_threads,1))
+    {
+      pipeline_.set_n_threads(n_threads_);
+      //only versions that know the container can read the chunks, so their headers need not be JSON
+      pipeline_.set_header_layout(sqeazy::header::binary);
+    }
+
+    /**
+       \brief upper bound of the container size in bytes for a stack of _shape
+    */
+    std::intmax_t max_encoded_size(const std::vector<std::size_t>& _shape) const {
+
+      chunk_table table(_shape, chunk_shape_);
+      if(!table.n_chunks())
+        return table.size_in_bytes();
+
+      //the first chunk is never cut by the stack borders
+      std::vector<std::size_t> lo, extent;
+      table.chunk_box(0, lo, extent);
+      const std::size_t chunk_bytes = std::accumulate(extent.begin(), extent.end(),
+                                                      sizeof(raw_t), std::multiplies<std::size_t>());
+
+      return table.size_in_bytes() + table.n_chunks()*pipeline_.max_encoded_size(chunk_bytes);
+    }
+
+    /**
+       \brief encode the row-major stack _in of _shape into a chunked container at _out
+
+       \param[in] _in input stack
+       \param[out] _out output buffer, must hold at least max_encoded_size(_shape) bytes
+       \param[in] _shape shape of _in
+
+       \return pointer past the end of the container, nullptr on failure
+    */
+    compressed_t* encode(const raw_t* _in,
+                         compressed_t* _out,
+                         const std::vector<std::size_t>& _shape){
+
+      chunk_table table(_shape, chunk_shape_);
+      if(!table.n_chunks())
+        return nullptr;
+
+      char* container_begin = reinterpret_cast<char*>(_out);
+      char* dst = container_begin + table.size_in_bytes();
+
+      std::vector<std::size_t> lo, extent;
+      table.chunk_box(0, lo, extent);
+      const std::vector<std::size_t> origin(table.rank(),0);
+
+      vec_32algn_t<raw_t> brick(std::accumulate(extent.begin(), extent.end(),
+                                                std::size_t(1), std::multiplies<std::size_t>()));
+
+      for(std::size_t c = 0;c<table.n_chunks();++c){
+
+        table.chunk_box(c, lo, extent);
+        detail::copy_box(_in, _shape, lo,
+                         brick.data(), extent, origin,
+                         extent);
+
+        compressed_t* chunk_end = pipeline_.encode(brick.data(), reinterpret_cast<compressed_t*>(dst), extent);
+        if(!chunk_end){
+          std::cerr << "[sqeazy::chunked_pipeline] failed to encode chunk " << c << " with " << pipeline_.name() << "\n";
+          return nullptr;
+        }
+
+        table.offsets_[c] = std::distance(container_begin, dst);
+        dst = reinterpret_cast<char*>(chunk_end);
+      }
+
+      table.offsets_.back() = std::distance(container_begin, dst);
+      table.write(container_begin);
+
+      return reinterpret_cast<compressed_t*>(dst);
+    }
+
+    /**
+       \brief obtain the shape of the stack stored in the container from _begin to _end (empty if there is none)
+    */
+    static std::vector<std::size_t> decoded_shape(const compressed_t* _begin, const compressed_t* _end){
+
+      chunk_table table;
+      if(table.read(reinterpret_cast<const char*>(_begin), reinterpret_cast<const char*>(_end)))
+        return std::vector<std::size_t>();
+
+      return table.shape_;
+    }
+
+    /**
+       \brief decode the complete stack of the container _in of _len items into _out
+
+       \return 0 on success, 1 otherwise
+    */
+    int decode(const compressed_t* _in, raw_t* _out, std::size_t _len) const {
+
+      const std::vector<std::size_t> shape = decoded_shape(_in, _in + _len);
+      if(shape.empty())
+        return 1;
+
+      return decode_region(_in, _in + _len,
+                           std::vector<std::size_t>(shape.size(),0), shape,
+                           _out);
+    }
+
+    /**
+       \brief decode the box [_lo,_hi) of the stack stored in the container from _begin to _end,
+       only the chunks intersecting the box are decoded
+
+       \param[in] _begin begin of the container
+       \param[in] _end end of the container
+       \param[in] _lo first index of the box in every dimension
+       \param[in] _hi one past the last index of the box in every dimension
+       \param[out] _out row-major output of shape _hi - _lo
+
+       \return 0 on success, 1 otherwise
+    */
+    int decode_region(const compressed_t* _begin, const compressed_t* _end,
+                      const std::vector<std::size_t>& _lo,
+                      const std::vector<std::size_t>& _hi,
+                      raw_t* _out) const {
+
+      const char* container_begin = reinterpret_cast<const char*>(_begin);
+      const char* container_end = reinterpret_cast<const char*>(_end);
+
+      chunk_table table;
+      if(table.read(container_begin, container_end)){
+        std::cerr << "[sqeazy::chunked_pipeline] input is not a chunked sqy container\n";
+        return 1;
+      }
+
+      const std::vector<std::size_t> chunks = table.chunks_in_region(_lo,_hi);
+      if(chunks.empty()){
+        std::cerr << "[sqeazy::chunked_pipeline] region to decode is empty or exceeds the stack\n";
+        return 1;
+      }
+
+      if(table.offsets_.back() > std::uint64_t(std::distance(container_begin, container_end))){
+        std::cerr << "[sqeazy::chunked_pipeline] container is truncated\n";
+        return 1;
+      }
+
+      std::vector<const char*> chunk_begins(chunks.size());
+      std::vector<std::size_t> chunk_bytes(chunks.size());
+      for(std::size_t i = 0;i<chunks.size();++i){
+        chunk_begins[i] = container_begin + table.offsets_[chunks[i]];
+        chunk_bytes[i] = table.offsets_[chunks[i]+1] - table.offsets_[chunks[i]];
+      }
+
+      return decode_chunks(table, chunks, chunk_begins, chunk_bytes, _lo, _hi, _out);
+    }
+
+    /**
+       \brief decode the box [_lo,_hi) of the stack stored in the container that starts at the current position
+       of _in, only the offset table and the chunks intersecting the box are read from _in (using seekg)
+
+       \return 0 on success, 1 otherwise
+    */
+    int decode_region(std::istream& _in,
+                      const std::vector<std::size_t>& _lo,
+                      const std::vector<std::size_t>& _hi,
+                      raw_t* _out) const {
+
+      const std::istream::pos_type container_begin = _in.tellg();
+
+      chunk_table table;
+      if(table.read(_in)){
+        std::cerr << "[sqeazy::chunked_pipeline] input is not a chunked sqy container\n";
+        return 1;
+      }
+
+      const std::vector<std::size_t> chunks = table.chunks_in_region(_lo,_hi);
+      if(chunks.empty()){
+        std::cerr << "[sqeazy::chunked_pipeline] region to decode is empty or exceeds the stack\n";
+        return 1;
+      }
+
+      std::vector<std::size_t> chunk_bytes(chunks.size());
+      for(std::size_t i = 0;i<chunks.size();++i)
+        chunk_bytes[i] = table.offsets_[chunks[i]+1] - table.offsets_[chunks[i]];
+
+      std::vector<char> storage(std::accumulate(chunk_bytes.begin(), chunk_bytes.end(), std::size_t(0)));
+      std::vector<const char*> chunk_begins(chunks.size());
+
+      char* dst = storage.data();
+      for(std::size_t i = 0;i<chunks.size();++i){
+
+        _in.seekg(container_begin + std::streamoff(table.offsets_[chunks[i]]));
+        if(!_in.read(dst, chunk_bytes[i])){
+          std::cerr << "[sqeazy::chunked_pipeline] container is truncated, unable to read chunk " << chunks[i] << "\n";
+          return 1;
+        }
+
+        chunk_begins[i] = dst;
+        dst += chunk_bytes[i];
+      }
+
+      return decode_chunks(table, chunks, chunk_begins, chunk_bytes, _lo, _hi, _out);
+    }
+
+    /**
+       \brief decode _chunks (_chunk_bytes each, starting at _chunk_begins) and
+       copy their intersection with [_lo,_hi) to _out
+
+       chunks are distributed across n_threads_ threads, every thread builds its own pipeline from the sqy
+       header of the chunks it decodes; a chunk is either stored with its extent inside the stack or, as HDF5 does
+       at the upper borders, padded to the full chunk shape of _table
+    */
+    int decode_chunks(const chunk_table& _table,
+                      const std::vector<std::size_t>& _chunks,
+                      const std::vector<const char*>& _chunk_begins,
+                      const std::vector<std::size_t>& _chunk_bytes,
+                      const std::vector<std::size_t>& _lo,
+                      const std::vector<std::size_t>& _hi,
+                      raw_t* _out) const {
+
+      const std::size_t rank = _table.rank();
+      std::vector<std::size_t> region_shape(rank);
+      for(std::size_t d = 0;d<rank;++d)
+        region_shape[d] = _hi[d] - _lo[d];
+
+      const omp_size_type n_chunks = _chunks.size();
+      const int outer_threads = (std::max)(1,(std::min)(n_threads_, int(n_chunks)));
+      const int inner_threads = (std::max)(1,n_threads_/outer_threads);
+
+      //the pipelines only get their inner threads if nested parallel regions are active
+      const nested_parallelism nesting(inner_threads);
+
+      int value = 0;
+
+#pragma omp parallel num_threads(outer_threads) shared(value)
+      {
+        pipeline_t pipe;
+        std::string pipe_string;
+        vec_32algn_t<raw_t> brick;
+        sqeazy::header::view in_place;
+        std::vector<std::size_t> stored_shape;
+        std::vector<std::size_t> chunk_lo, chunk_extent;
+        std::vector<std::size_t> src_lo(rank), dst_lo(rank), box(rank);
+
+#pragma omp for schedule(dynamic) reduction(+:value)
+        for(omp_size_type i = 0;i<n_chunks;++i){
+
+          const std::size_t c = _chunks[i];
+
+          //a corrupt chunk makes the header or the pipeline throw, which must not leave the parallel region
+          try{
+            const char* chunk_begin = _chunk_begins[i];
+            const std::size_t chunk_bytes = _chunk_bytes[i];
+
+            //chunks carry binary headers which are read in place, JSON ones (older containers) are parsed
+            std::string pipe_name;
+            if(in_place.parse(chunk_begin, chunk_bytes) == 0){
+              in_place.shape(stored_shape);
+              if(in_place.pipeline() != boost::string_ref(pipe_string))
+                pipe_name = in_place.pipeline().to_string();
+            }
+            else{
+              sqeazy::header hdr(chunk_begin, chunk_begin + chunk_bytes);
+              stored_shape.assign(hdr.shape()->begin(), hdr.shape()->end());
+              if(hdr.pipeline() != pipe_string)
+                pipe_name = hdr.pipeline();
+            }
+
+            _table.chunk_box(c, chunk_lo, chunk_extent);
+
+            if(stored_shape != chunk_extent && stored_shape != _table.chunk_shape_){
+              std::cerr << "[sqeazy::chunked_pipeline] chunk " << c << " does not match the chunk grid\n";
+              value += 1;
+              continue;
+            }
+
+            if(!pipe_name.empty()){
+              pipe = pipeline_t::from_string(pipe_name);
+              if(pipe.empty()){
+                std::cerr << "[sqeazy::chunked_pipeline] unable to build pipeline " << pipe_name << "\n";
+                pipe_string.clear();
+                value += 1;
+                continue;
+              }
+              pipe.set_n_threads(inner_threads);
+              pipe_string = pipe_name;
+            }
+
+            const std::size_t chunk_size = std::accumulate(stored_shape.begin(), stored_shape.end(),
+                                                           std::size_t(1), std::multiplies<std::size_t>());
+            if(brick.size() < chunk_size)
+              brick.resize(chunk_size);
+
+            int err = pipe.decode(reinterpret_cast<const compressed_t*>(chunk_begin), brick.data(),
+                                  chunk_bytes/sizeof(compressed_t));
+            if(err){
+              std::cerr << "[sqeazy::chunked_pipeline] failed to decode chunk " << c << " with " << pipe_string << " (error " << err << ")\n";
+              value += 1;
+              continue;
+            }
+
+            for(std::size_t d = 0;d<rank;++d){
+              const std::size_t first = (std::max)(chunk_lo[d], _lo[d]);
+              const std::size_t last = (std::min)(chunk_lo[d] + chunk_extent[d], _hi[d]);
+              src_lo[d] = first - chunk_lo[d];
+              dst_lo[d] = first - _lo[d];
+              box[d] = last - first;
+            }
+
+            detail::copy_box(brick.data(), stored_shape, src_lo,
+                             _out, region_shape, dst_lo,
+                             box);
+          }
+          catch(const std::exception& _exc){
+            std::cerr << "[sqeazy::chunked_pipeline] failed to decode chunk " << c << ": " << _exc.what() << "\n";
+            pipe_string.clear();
+            value += 1;
+          }
+          catch(...){
+            std::cerr << "[sqeazy::chunked_pipeline] failed to decode chunk " << c << "\n";
+            pipe_string.clear();
+            value += 1;
+          }
+        }
+      }
+
+      return value ? 1 : 0;
+    }
+
+  };
+
+}
+
+#endif /* _DYNAMIC_PIPELINE_CHUNKED_H_ */
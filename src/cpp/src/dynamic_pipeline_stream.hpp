@@ -0,0 +1,498 @@
+#ifndef _DYNAMIC_PIPELINE_STREAM_H_
+#define _DYNAMIC_PIPELINE_STREAM_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sqeazy_common.hpp"
+#include "sqeazy_header.hpp"
+
+namespace sqeazy {
+
+  /**
+     \brief layout of the byte stream produced by encode_stream and consumed by decode_stream
+
+     <magic "SQYSTRM1">
+     <slab_bytes (uint64 le)><slab: sqy header + payload as produced by dynamic_pipeline::encode>
+     ... (one entry per slab of consecutive z-planes)
+     <0 (uint64 le)><total number of planes (uint64 le)><number of slabs (uint64 le)>
+
+     every slab is a self-contained sqy buffer, i.e. it can be decoded with dynamic_pipeline::decode on its own;
+     the slab headers are written in the binary layout (sqeazy::header::binary_magic), JSON slab headers are read as well;
+     streams stored as .sqy files are decoded by sqy decompress
+  */
+  struct stream_format {
+
+    static const std::string& magic() {
+      static const std::string value("SQYSTRM1");
+      return value;
+    }
+
+    static void write_u64(std::ostream& _out, std::uint64_t _value){
+      char bytes[8];
+      for(int i = 0;i<8;++i)
+        bytes[i] = static_cast<char>((_value >> (8*i)) & 0xff);
+      _out.write(bytes, 8);
+    }
+
+    /**
+       \brief check if the buffer from _begin to _end starts with a stream
+    */
+    static bool contained(const char* _begin, const char* _end){
+      const std::size_t len = std::distance(_begin,_end);
+      return len >= magic().size() && std::equal(magic().begin(), magic().end(), _begin);
+    }
+
+    /**
+       \brief read the counts stored at the end of the complete stream from _begin to _end
+
+       \return true if the stream ends with a valid trailer
+    */
+    static bool read_trailer(const char* _begin, const char* _end,
+                             std::uint64_t& _n_planes, std::uint64_t& _n_slabs){
+
+      const std::size_t trailer_bytes = 3*sizeof(std::uint64_t);
+      if(std::size_t(std::distance(_begin,_end)) < magic().size() + trailer_bytes)
+        return false;
+
+      std::istringstream trailer(std::string(_end - trailer_bytes, _end));
+      std::uint64_t end_marker = 1;
+      return read_u64(trailer, end_marker) && end_marker == 0 &&
+        read_u64(trailer, _n_planes) && read_u64(trailer, _n_slabs);
+    }
+
+    static bool read_u64(std::istream& _in, std::uint64_t& _value){
+      unsigned char bytes[8];
+      if(!_in.read(reinterpret_cast<char*>(bytes), 8))
+        return false;
+
+      _value = 0;
+      for(int i = 0;i<8;++i)
+        _value |= std::uint64_t(bytes[i]) << (8*i);
+      return true;
+    }
+
+  };
+
+  /**
+     \brief incremental encoder on top of a dynamic_pipeline: z-planes are collected into slabs of
+     _planes_per_slab planes, every full slab is encoded through the complete pipeline (head filters, sink, tail filters)
+     and appended to the output stream right away
+
+     peak memory is O(slab): the slab being filled, the slab being encoded (if overlapping) and its encoded buffer;
+     with overlap enabled, encoding and writing of a slab runs asynchronously while the next slab is filled
+
+     NOTE: filters that rely on statistics of the whole stack (e.g. quantisers) only see one slab at a time
+
+     usage:
+     \code
+     encode_stream<sqeazy::dypeline<std::uint16_t> > stream(pipe, {height, width}, 16);
+     stream.begin(ofile);
+     while(acquiring)
+       stream.push_planes(plane_ptr, 1);
+     stream.finish();
+     \endcode
+  */
+  template <typename pipeline_t>
+  struct encode_stream {
+
+    typedef typename pipeline_t::incoming_t raw_t;
+    typedef typename pipeline_t::outgoing_t compressed_t;
+
+    pipeline_t pipeline_;
+    std::vector<std::size_t> plane_shape_;
+    std::size_t plane_size_;
+    std::size_t planes_per_slab_;
+    bool overlap_;
+
+    std::ostream* out_;
+
+    vec_32algn_t<raw_t> filling_;
+    vec_32algn_t<raw_t> in_flight_;
+    std::vector<compressed_t> encoded_;
+    std::size_t filled_planes_;
+
+    std::future<int> pending_;
+
+    std::uint64_t planes_pushed_;
+    std::uint64_t slabs_written_;
+    std::uint64_t bytes_written_;
+
+    encode_stream(const pipeline_t& _pipeline,
+                  const std::vector<std::size_t>& _plane_shape,
+                  std::size_t _planes_per_slab = 16,
+                  bool _overlap = true):
+      pipeline_(_pipeline),
+      plane_shape_(_plane_shape),
+      plane_size_(std::accumulate(_plane_shape.begin(), _plane_shape.end(), std::size_t(1), std::multiplies<std::size_t>())),
+      planes_per_slab_((std::max)(_planes_per_slab, std::size_t(1))),
+      overlap_(_overlap),
+      out_(nullptr),
+      filling_(),
+      in_flight_(),
+      encoded_(),
+      filled_planes_(0),
+      pending_(),
+      planes_pushed_(0),
+      slabs_written_(0),
+      bytes_written_(0)
+    {
+      //only versions that know the stream can read the slabs, so their headers need not be JSON
+      pipeline_.set_header_layout(sqeazy::header::binary);
+    }
+
+    //the asynchronous slab encoding refers to this object
+    encode_stream(const encode_stream&) = delete;
+    encode_stream& operator=(const encode_stream&) = delete;
+
+    ~encode_stream(){
+      if(pending_.valid())
+        pending_.wait();
+    }
+
+    /**
+       \brief start a new stream written to _out
+
+       \return 0 on success, 1 if the stream could not be written to
+    */
+    int begin(std::ostream& _out){
+
+      if(pending_.valid())
+        pending_.wait();
+
+      out_ = &_out;
+      filled_planes_ = 0;
+      planes_pushed_ = 0;
+      slabs_written_ = 0;
+      bytes_written_ = 0;
+
+      filling_.resize(planes_per_slab_*plane_size_);
+      if(overlap_)
+        in_flight_.resize(planes_per_slab_*plane_size_);
+
+      out_->write(stream_format::magic().data(), stream_format::magic().size());
+      bytes_written_ += stream_format::magic().size();
+
+      return out_->good() ? 0 : 1;
+    }
+
+    /**
+       \brief append _n_planes z-planes (each of plane_shape) stored contiguously at _planes to the stream,
+       _planes can be reused by the caller as soon as the call returns
+
+       \return 0 on success, 1 if begin was not called, a slab could not be encoded or written
+    */
+    int push_planes(const raw_t* _planes, std::size_t _n_planes){
+
+      if(!out_)
+        return 1;
+
+      int value = 0;
+      while(_n_planes && !value){
+
+        const std::size_t n = (std::min)(_n_planes, planes_per_slab_ - filled_planes_);
+        std::copy(_planes, _planes + n*plane_size_,
+                  filling_.data() + filled_planes_*plane_size_);
+
+        filled_planes_ += n;
+        planes_pushed_ += n;
+        _planes += n*plane_size_;
+        _n_planes -= n;
+
+        if(filled_planes_ == planes_per_slab_)
+          value = flush_slab();
+      }
+
+      return value;
+    }
+
+    /**
+       \brief encode the remaining planes, write the end of the stream and detach from the output stream
+
+       \return 0 on success, 1 otherwise
+    */
+    int finish(){
+
+      if(!out_)
+        return 1;
+
+      int value = 0;
+      if(filled_planes_)
+        value = flush_slab();
+
+      value += wait_pending();
+
+      stream_format::write_u64(*out_, 0);
+      stream_format::write_u64(*out_, planes_pushed_);
+      stream_format::write_u64(*out_, slabs_written_);
+      bytes_written_ += 3*sizeof(std::uint64_t);
+
+      value += out_->good() ? 0 : 1;
+      out_->flush();
+      out_ = nullptr;
+
+      return value ? 1 : 0;
+    }
+
+    std::uint64_t planes_pushed() const { return planes_pushed_; }
+    std::uint64_t slabs_written() const { return slabs_written_; }
+    std::uint64_t bytes_written() const { return bytes_written_; }
+
+  private:
+
+    int wait_pending(){
+      return pending_.valid() ? pending_.get() : 0;
+    }
+
+    int flush_slab(){
+
+      const std::size_t n_planes = filled_planes_;
+      filled_planes_ = 0;
+
+      //the previous slab must be written before in_flight_ can be reused
+      int value = wait_pending();
+      if(value)
+        return value;
+
+      if(!overlap_)
+        return write_slab(filling_, n_planes);
+
+      std::swap(filling_, in_flight_);
+      pending_ = std::async(std::launch::async,
+                            [this, n_planes](){ return write_slab(in_flight_, n_planes); });
+
+      return 0;
+    }
+
+    int write_slab(const vec_32algn_t<raw_t>& _slab, std::size_t _n_planes){
+
+      std::vector<std::size_t> shape(1, _n_planes);
+      shape.insert(shape.end(), plane_shape_.begin(), plane_shape_.end());
+
+      const std::size_t max_bytes = pipeline_.max_encoded_size(_n_planes*plane_size_*sizeof(raw_t));
+      const std::size_t max_items = (max_bytes + sizeof(compressed_t) - 1)/sizeof(compressed_t);
+      if(encoded_.size() < max_items)
+        encoded_.resize(max_items);
+
+      compressed_t* encoded_end = pipeline_.encode(_slab.data(), encoded_.data(), shape);
+      if(!encoded_end){
+        std::cerr << "[sqeazy::encode_stream] failed to encode slab " << slabs_written_ << " with " << pipeline_.name() << "\n";
+        return 1;
+      }
+
+      const std::uint64_t slab_bytes = std::distance(encoded_.data(), encoded_end)*sizeof(compressed_t);
+      stream_format::write_u64(*out_, slab_bytes);
+      out_->write(reinterpret_cast<const char*>(encoded_.data()), slab_bytes);
+
+      bytes_written_ += sizeof(std::uint64_t) + slab_bytes;
+      slabs_written_ += 1;
+
+      return out_->good() ? 0 : 1;
+    }
+
+  };
+
+  /**
+     \brief incremental decoder for streams written by encode_stream: slabs are read and decoded one at a time,
+     peak memory is O(slab)
+
+     the pipeline to decode a slab is built from the pipeline string stored in the header of that slab
+  */
+  template <typename pipeline_t>
+  struct decode_stream {
+
+    typedef typename pipeline_t::incoming_t raw_t;
+    typedef typename pipeline_t::outgoing_t compressed_t;
+
+    pipeline_t pipeline_;
+    std::string pipeline_string_;
+    int n_threads_;
+
+    std::istream* in_;
+
+    std::vector<compressed_t> encoded_;
+    vec_32algn_t<raw_t> slab_;
+    std::vector<std::size_t> plane_shape_;
+    std::size_t plane_size_;
+    std::size_t slab_planes_;
+    std::size_t consumed_planes_;
+    bool at_end_;
+
+    std::uint64_t planes_pulled_;
+    std::uint64_t slabs_read_;
+    std::uint64_t expected_planes_;
+    std::uint64_t expected_slabs_;
+
+    decode_stream(int _n_threads = 1):
+      pipeline_(),
+      pipeline_string_(),
+      n_threads_(_n_threads),
+      in_(nullptr),
+      encoded_(),
+      slab_(),
+      plane_shape_(),
+      plane_size_(0),
+      slab_planes_(0),
+      consumed_planes_(0),
+      at_end_(false),
+      planes_pulled_(0),
+      slabs_read_(0),
+      expected_planes_(0),
+      expected_slabs_(0)
+    {}
+
+    /**
+       \brief start reading the stream _in, the first slab is decoded immediately so that plane_shape() is known
+
+       \return 0 on success, 1 if _in does not contain a stream or the first slab could not be decoded
+    */
+    int begin(std::istream& _in){
+
+      in_ = &_in;
+      at_end_ = false;
+      slab_planes_ = consumed_planes_ = 0;
+      planes_pulled_ = slabs_read_ = expected_planes_ = expected_slabs_ = 0;
+
+      std::string found(stream_format::magic().size(), ' ');
+      if(!in_->read(&found[0], found.size()) || found != stream_format::magic()){
+        std::cerr << "[sqeazy::decode_stream] input is not a sqeazy stream\n";
+        in_ = nullptr;
+        return 1;
+      }
+
+      return read_slab();
+    }
+
+    /**
+       \brief shape of one z-plane as found in the stream (available after begin)
+    */
+    const std::vector<std::size_t>& plane_shape() const {
+      return plane_shape_;
+    }
+
+    /**
+       \brief copy up to _max_planes decoded z-planes to _out
+
+       \return number of planes written to _out, 0 once the stream is exhausted (or on error)
+    */
+    std::size_t pull_planes(raw_t* _out, std::size_t _max_planes){
+
+      std::size_t value = 0;
+
+      while(in_ && value < _max_planes){
+
+        if(consumed_planes_ == slab_planes_){
+          if(at_end_ || read_slab())
+            break;
+          continue;
+        }
+
+        const std::size_t n = (std::min)(_max_planes - value, slab_planes_ - consumed_planes_);
+        std::copy(slab_.data() + consumed_planes_*plane_size_,
+                  slab_.data() + (consumed_planes_ + n)*plane_size_,
+                  _out + value*plane_size_);
+
+        consumed_planes_ += n;
+        value += n;
+      }
+
+      planes_pulled_ += value;
+      return value;
+    }
+
+    /**
+       \brief detach from the input stream
+
+       \return 0 if the complete stream was consumed and matches the counts stored at its end, 1 otherwise
+    */
+    int finish(){
+
+      //the last plane may have been pulled without reaching the end of the stream yet
+      if(in_ && !at_end_ && consumed_planes_ == slab_planes_)
+        read_slab();
+
+      const bool complete = at_end_ &&
+        consumed_planes_ == slab_planes_ &&
+        expected_planes_ == planes_pulled_ &&
+        expected_slabs_ == slabs_read_;
+
+      in_ = nullptr;
+      return complete ? 0 : 1;
+    }
+
+    std::uint64_t planes_pulled() const { return planes_pulled_; }
+    std::uint64_t slabs_read() const { return slabs_read_; }
+
+  private:
+
+    int read_slab(){
+
+      std::uint64_t slab_bytes = 0;
+      if(!stream_format::read_u64(*in_, slab_bytes))
+        return 1;
+
+      slab_planes_ = consumed_planes_ = 0;
+
+      if(!slab_bytes){
+        at_end_ = true;
+        bool trailer_ok = stream_format::read_u64(*in_, expected_planes_) &&
+          stream_format::read_u64(*in_, expected_slabs_);
+        return trailer_ok ? 0 : 1;
+      }
+
+      const std::size_t slab_items = (slab_bytes + sizeof(compressed_t) - 1)/sizeof(compressed_t);
+      if(encoded_.size() < slab_items)
+        encoded_.resize(slab_items);
+
+      if(!in_->read(reinterpret_cast<char*>(encoded_.data()), slab_bytes)){
+        std::cerr << "[sqeazy::decode_stream] stream ended within slab " << slabs_read_ << "\n";
+        return 1;
+      }
+
+      const char* slab_begin = reinterpret_cast<const char*>(encoded_.data());
+      sqeazy::header hdr(slab_begin, slab_begin + slab_bytes);
+      if(hdr.shape()->empty())
+        return 1;
+
+      if(hdr.pipeline() != pipeline_string_){
+        pipeline_ = pipeline_t::from_string(hdr.pipeline());
+        if(pipeline_.empty()){
+          std::cerr << "[sqeazy::decode_stream] unable to build pipeline " << hdr.pipeline() << "\n";
+          return 1;
+        }
+        pipeline_.set_n_threads(n_threads_);
+        pipeline_string_ = hdr.pipeline();
+      }
+
+      const std::vector<std::size_t>& slab_shape = *hdr.shape();
+      plane_shape_.assign(slab_shape.begin() + 1, slab_shape.end());
+      plane_size_ = std::accumulate(plane_shape_.begin(), plane_shape_.end(), std::size_t(1), std::multiplies<std::size_t>());
+
+      const std::size_t n_planes = slab_shape.front();
+      if(slab_.size() < n_planes*plane_size_)
+        slab_.resize(n_planes*plane_size_);
+
+      int err = pipeline_.decode(encoded_.data(), slab_.data(), slab_items);
+      if(err){
+        std::cerr << "[sqeazy::decode_stream] failed to decode slab " << slabs_read_ << " with " << pipeline_string_ << " (error " << err << ")\n";
+        return 1;
+      }
+
+      slab_planes_ = n_planes;
+      slabs_read_ += 1;
+
+      return 0;
+    }
+
+  };
+
+}
+
+#endif /* _DYNAMIC_PIPELINE_STREAM_H_ */
@@ -44,6 +44,30 @@ namespace sqeazy{
       n_threads_ = _number;
     }
 
+    /**
+       \brief binary data of the last encode that the stage would rather not carry in its config (e.g. a decode
+       map), a pipeline writing a binary header stores it in the side section of the header (see side_block_at)
+    */
+    virtual std::string side_block() const {
+      return std::string();
+    }
+
+    /**
+       \brief the pipeline stored side_block at _offset of the side section, config refers to it from now on
+       instead of carrying the data
+    */
+    virtual void side_block_at(std::size_t _offset) {}
+
+    /**
+       \brief read the data config refers to from the side section of the header of the buffer to decode
+       (_len is 0 if the header has none); the section is read in place and is not kept
+
+       \return 0 on success, 1 if a referenced block is missing or corrupt
+    */
+    virtual int attach_side_section(const char* _begin, std::size_t _len) {
+      return 0;
+    }
+
   };
 
   /**
@@ -220,51 +220,15 @@ namespace sqeazy {
         outgoing_t* encode(const incoming_t *_in,
                            outgoing_t *_out,
                            const std::vector<std::size_t>& _shape) /*override final*/ {
-            outgoing_t* value = nullptr;
             const std::size_t len = std::accumulate(_shape.begin(), _shape.end(),1,std::multiplies<std::size_t>());
             const std::size_t bytes = len*sizeof(incoming_t);
 
-            const std::intmax_t max_output_bytes = this->max_encoded_size(bytes);
-
-            //TODO: Ouch, this can be a quite large allocation
-            //(may cost a lot of cycles, more than 50% of the cycles consumed by this method with 400MB of input)
-            sqeazy::vec_32algn_t<incoming_t> temp_in(std::ceil(float(max_output_bytes)/sizeof(incoming_t)));
-            std::copy(_in, _in+len,temp_in.data());
-
-            outgoing_t * out_ptr = _out;
-            incoming_t * in_ptr = temp_in.data();
-
-            std::size_t compressed_items = 0;
-
-            for( std::size_t fidx = 0;fidx<chain_.size();++fidx )
-            {
-
-                value = chain_[fidx]->encode( in_ptr,
-                                              out_ptr,
-                                              _shape);
-
-                if(value)
-                    compressed_items = std::distance(out_ptr,value);
-                else
-                    compressed_items = 0;
-
-                if(compressed_items>temp_in.size() || compressed_items == 0){
-                    std::ostringstream msg;
-                    msg << __FILE__ << ":" << __LINE__ << "\t encode wrote past the end of temporary buffers\n";
-                    throw std::runtime_error(msg.str());
-                }
-
-                // std::copy(temp_out.data(),value,temp_in.begin());
-                std::swap(in_ptr,out_ptr);
-            }
-
-            if(chain_.size() % 2 == 0){
-                value = std::copy(reinterpret_cast<outgoing_t*>(temp_in.data()),
-                                  value,
-                                  _out);
-            }
+            //the input is not copied, the filters alternate between _out and an uninitialized scratchpad
+            unique_array<outgoing_t> scratchpad;
+            if(chain_.size() > 1)
+                scratchpad = make_aligned<outgoing_t>(32,(std::max)(std::size_t(this->max_encoded_size(bytes)),bytes));
 
-            return value;
+            return encode(_in, _out, _shape, scratchpad.get());
 
         }
 
@@ -363,8 +327,52 @@ namespace sqeazy {
 
             std::size_t len = std::accumulate(_ishape.begin(), _ishape.end(),1,std::multiplies<std::size_t>());
 
-            //TODO: Ouch, this can be a quite large allocation
-            sqeazy::vec_32algn_t<incoming_t> temp(_in,_in+len);
+            unique_array<incoming_t> scratchpad;
+            if(chain_.size() > 1)
+                scratchpad = make_aligned<incoming_t>(32,len*sizeof(incoming_t));
+
+            return decode(_in, _out, _ishape, _oshape, scratchpad.get());
+
+        }
+
+        /**
+           \brief decode one-dimensional array _in and write results to _out without copying _in,
+           the filters alternate between _out and _scratchpad so that the last filter writes to _out
+
+           _in may alias _out if the chain holds an even number of filters or _scratchpad if it holds an odd number,
+           i.e. the caller can place the input in whichever of the two buffers is not written by the first filter
+
+           \param[in] _in input buffer
+           \param[out] _out output buffer
+           \param[in] _ishape of input buffer size in units of its type, aka outgoing_t
+           \param[in] _oshape of output buffer size in units of its type, aka incoming_t
+           \param[in] _scratchpad temporary memory of at least the size of _in (can be nullptr if the chain holds only one filter)
+
+           \return
+           \retval
+
+        */
+        int decode(const outgoing_t *_in,
+                   incoming_t *_out,
+                   const std::vector<std::size_t>& _ishape,
+                   std::vector<std::size_t> _oshape,
+                   incoming_t *_scratchpad) const {
+
+            int value = 0;
+            int err_code = 0;
+            if(_oshape.empty())
+                _oshape = _ishape;
+
+            if(chain_.size() > 1 && !_scratchpad){
+                std::ostringstream msg;
+                msg << __FILE__ << ":" << __LINE__ << "\t decode requires a scratchpad for more than 1 filter\n";
+                throw std::runtime_error(msg.str());
+            }
+
+            //chose the first destination such that the last filter writes to _out
+            const incoming_t* src = _in;
+            incoming_t* dst = (chain_.size() % 2 == 0) ? _scratchpad : _out;
+            incoming_t* other = (dst == _out) ? _scratchpad : _out;
 
             auto rev_begin = chain_.rbegin();
             auto rev_end   = chain_.rend();
@@ -373,14 +381,14 @@ namespace sqeazy {
             for(;rev_begin!=rev_end;++rev_begin,++fidx)
             {
 
-                err_code = (*rev_begin)->decode(temp.data(),
-                                                _out,
+                err_code = (*rev_begin)->decode(src,
+                                                dst,
                                                 _ishape,
                                                 _oshape);
                 value += err_code ? (10*(fidx+1))+err_code : 0;
-                std::copy(_out,
-                          _out+len,
-                          temp.data());
+
+                src = dst;
+                std::swap(dst,other);
             }
 
             return value;
@@ -0,0 +1,549 @@
+#ifndef _BITPLANE_REORDER_AVX_H_
+#define _BITPLANE_REORDER_AVX_H_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "compass.hpp"
+#include "sqeazy_common.hpp"
+#include "simd_dispatch.hpp"
+#include "bitplane_reorder_scalar.hpp"
+
+/*
+  the kernels in this file are compiled for AVX2/AVX512BW through function attributes, i.e. they don't require
+  -mavx2 or -march=native for the rest of the library; the kernel to use is chosen at runtime
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SQY_HAS_AVX_BITPLANE_KERNELS 1
+#include <immintrin.h>
+#define SQY_TARGET_AVX2 __attribute__((target("avx2")))
+#define SQY_TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
+#else
+#define SQY_HAS_AVX_BITPLANE_KERNELS 0
+#define SQY_TARGET_AVX2
+#define SQY_TARGET_AVX512BW
+#endif
+
+namespace sqeazy {
+
+  namespace detail {
+
+#if SQY_HAS_AVX_BITPLANE_KERNELS
+    /**
+       \brief _lane repeated in all 4 lanes of a 512-bit register
+
+       _mm512_broadcast_i32x4 passes an undefined register as the merge source, which gcc reports as
+       maybe-uninitialized under -Wall; the masked variant with an all-ones mask gives the same result
+    */
+    SQY_TARGET_AVX512BW
+    static inline __m512i avx512_broadcast_lane(__m128i _lane){
+      return _mm512_mask_broadcast_i32x4(_mm512_setzero_si512(), __mmask16(0xffff), _lane);
+    }
+#endif
+
+    /**
+       \brief AVX2/AVX512BW bitplane reorder kernels for one block of input items (1 bit per plane)
+
+       the layout produced is identical to scalar_bitplane_reorder_encode: bitplane segment s holds bit (type_width-1-s)
+       of every input item, the bits of num_planes consecutive input items (a sweep) fill one item of the segment,
+       the first input item of the sweep populating the most significant bit
+
+       the bits are collected with _mm256_movemask_epi8/_mm512_test_epi8_mask after the bytes of the input items have
+       been shuffled such that the byte order matches the bit order of the output items; decoding expands the bits of
+       each plane back into bytes and undoes the shuffle
+
+       the primary template flags all types for which no kernel exists
+    */
+    template <std::size_t nbytes>
+    struct avx_bitplane_kernel {
+
+      static const bool supported = false;
+      typedef char word_type;
+
+      static const std::size_t avx2_block_items = 0;
+      static const std::size_t avx512_block_items = 0;
+
+      static void avx2_encode_block(const word_type*, word_type*, std::size_t){}
+      static void avx2_decode_block(const word_type*, word_type*, std::size_t){}
+      static void avx512_encode_block(const word_type*, word_type*, std::size_t){}
+      static void avx512_decode_block(const word_type*, word_type*, std::size_t){}
+
+    };
+
+#if SQY_HAS_AVX_BITPLANE_KERNELS
+
+    template <>
+    struct avx_bitplane_kernel<1> {
+
+      static const bool supported = true;
+      typedef std::uint8_t word_type;
+
+      static const std::size_t avx2_block_items = 64;
+      static const std::size_t avx512_block_items = 64;
+
+      /**
+         \brief reorder 64 items starting at _input, _output points to the item in segment 0 that corresponds to the first sweep of the block
+      */
+      SQY_TARGET_AVX2
+      static void avx2_encode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        //reverse the items of each sweep (8 bytes), so that the first item ends up as most significant bit
+        const __m256i reverse_sweep = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                                                       7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+
+        __m256i first = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(_input)), reverse_sweep);
+        __m256i second = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(_input + 32)), reverse_sweep);
+
+        //two registers per plane, so that every segment receives a 64-bit store
+        for(std::size_t s = 0;s<8;++s){
+          const std::uint64_t plane = std::uint32_t(_mm256_movemask_epi8(first)) |
+            (std::uint64_t(std::uint32_t(_mm256_movemask_epi8(second))) << 32);
+          std::memcpy(_output + s*_segment_length, &plane, sizeof(plane));
+          first = _mm256_add_epi8(first,first);
+          second = _mm256_add_epi8(second,second);
+        }
+      }
+
+      SQY_TARGET_AVX2
+      static void avx2_decode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        const __m256i reverse_sweep = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                                                       7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+        const __m256i spread = _mm256_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
+                                                2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+        const __m256i select = _mm256_set1_epi64x(0x8040201008040201ll);
+
+        __m256i first = _mm256_setzero_si256();
+        __m256i second = _mm256_setzero_si256();
+
+        for(std::size_t s = 0;s<8;++s){
+          std::uint64_t plane = 0;
+          std::memcpy(&plane, _input + s*_segment_length, sizeof(plane));
+          const __m256i bit = _mm256_set1_epi8(char(0x80 >> s));
+
+          //byte k is set to 0xff if bit k of plane is set
+          __m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32(std::uint32_t(plane)), spread);
+          bits = _mm256_cmpeq_epi8(_mm256_and_si256(bits, select), select);
+          first = _mm256_or_si256(first, _mm256_and_si256(bits, bit));
+
+          bits = _mm256_shuffle_epi8(_mm256_set1_epi32(std::uint32_t(plane >> 32)), spread);
+          bits = _mm256_cmpeq_epi8(_mm256_and_si256(bits, select), select);
+          second = _mm256_or_si256(second, _mm256_and_si256(bits, bit));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output), _mm256_shuffle_epi8(first, reverse_sweep));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output + 32), _mm256_shuffle_epi8(second, reverse_sweep));
+      }
+
+      SQY_TARGET_AVX512BW
+      static void avx512_encode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        const __m512i reverse_sweep = avx512_broadcast_lane(_mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8));
+
+        const __m512i block = _mm512_shuffle_epi8(_mm512_loadu_si512(_input), reverse_sweep);
+
+        for(std::size_t s = 0;s<8;++s){
+          const std::uint64_t plane = _mm512_test_epi8_mask(block, _mm512_set1_epi8(char(0x80 >> s)));
+          std::memcpy(_output + s*_segment_length, &plane, sizeof(plane));
+        }
+      }
+
+      SQY_TARGET_AVX512BW
+      static void avx512_decode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        const __m512i reverse_sweep = avx512_broadcast_lane(_mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8));
+
+        __m512i block = _mm512_setzero_si512();
+
+        for(std::size_t s = 0;s<8;++s){
+          std::uint64_t plane = 0;
+          std::memcpy(&plane, _input + s*_segment_length, sizeof(plane));
+          block = _mm512_or_si512(block, _mm512_maskz_mov_epi8(plane, _mm512_set1_epi8(char(0x80 >> s))));
+        }
+
+        _mm512_storeu_si512(_output, _mm512_shuffle_epi8(block, reverse_sweep));
+      }
+
+    };
+
+    template <>
+    struct avx_bitplane_kernel<2> {
+
+      static const bool supported = true;
+      typedef std::uint16_t word_type;
+
+      static const std::size_t avx2_block_items = 64;
+      static const std::size_t avx512_block_items = 64;
+
+      /**
+         \brief reorder 64 items starting at _input, _output points to the item in segment 0 that corresponds to the first sweep of the block
+      */
+      SQY_TARGET_AVX2
+      static void avx2_encode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        __m256i hi[2];
+        __m256i lo[2];
+        split_sweeps(_input, hi[0], lo[0]);
+        split_sweeps(_input + 32, hi[1], lo[1]);
+
+        //two registers per plane, so that every segment receives a 64-bit store
+        for(std::size_t s = 0;s<8;++s){
+          const std::uint64_t plane = std::uint32_t(_mm256_movemask_epi8(hi[0])) |
+            (std::uint64_t(std::uint32_t(_mm256_movemask_epi8(hi[1]))) << 32);
+          std::memcpy(_output + s*_segment_length, &plane, sizeof(plane));
+          hi[0] = _mm256_add_epi8(hi[0],hi[0]);
+          hi[1] = _mm256_add_epi8(hi[1],hi[1]);
+        }
+
+        for(std::size_t s = 8;s<16;++s){
+          const std::uint64_t plane = std::uint32_t(_mm256_movemask_epi8(lo[0])) |
+            (std::uint64_t(std::uint32_t(_mm256_movemask_epi8(lo[1]))) << 32);
+          std::memcpy(_output + s*_segment_length, &plane, sizeof(plane));
+          lo[0] = _mm256_add_epi8(lo[0],lo[0]);
+          lo[1] = _mm256_add_epi8(lo[1],lo[1]);
+        }
+      }
+
+      /**
+         \brief gather the high and low bytes of 32 items (2 sweeps) such that lane l of _hi/_lo holds the bytes of sweep l in reverse order
+      */
+      SQY_TARGET_AVX2
+      static void split_sweeps(const word_type* _input, __m256i& _hi, __m256i& _lo){
+
+        //per 128-bit lane: low bytes of the 8 items in reverse order, followed by the high bytes in reverse order
+        const __m256i split_bytes = _mm256_setr_epi8(14,12,10,8,6,4,2,0,15,13,11,9,7,5,3,1,
+                                                     14,12,10,8,6,4,2,0,15,13,11,9,7,5,3,1);
+
+        //lane 0 = low bytes of one sweep, lane 1 = high bytes of the same sweep
+        const __m256i first = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(_input)),
+                                                                           split_bytes),
+                                                       0x72);
+        const __m256i second = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(_input + 16)),
+                                                                            split_bytes),
+                                                        0x72);
+
+        _hi = _mm256_permute2x128_si256(first, second, 0x31);
+        _lo = _mm256_permute2x128_si256(first, second, 0x20);
+      }
+
+      SQY_TARGET_AVX2
+      static void avx2_decode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        const __m256i spread = _mm256_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
+                                                2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+        const __m256i select = _mm256_set1_epi64x(0x8040201008040201ll);
+
+        __m256i hi[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+        __m256i lo[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+
+        for(std::size_t s = 0;s<16;++s){
+          std::uint64_t plane = 0;
+          std::memcpy(&plane, _input + s*_segment_length, sizeof(plane));
+
+          const __m256i bit = _mm256_set1_epi8(char(0x80 >> (s % 8)));
+          __m256i* target = s < 8 ? hi : lo;
+
+          for(std::size_t half = 0;half<2;++half){
+            //byte k is set to 0xff if bit k of plane is set
+            __m256i bits = _mm256_shuffle_epi8(_mm256_set1_epi32(std::uint32_t(plane >> (32*half))), spread);
+            bits = _mm256_cmpeq_epi8(_mm256_and_si256(bits, select), select);
+            target[half] = _mm256_or_si256(target[half], _mm256_and_si256(bits, bit));
+          }
+        }
+
+        merge_sweeps(hi[0], lo[0], _output);
+        merge_sweeps(hi[1], lo[1], _output + 32);
+      }
+
+      /**
+         \brief inverse of split_sweeps, byte i of lane l in _hi/_lo belongs to item 16*l+15-i
+      */
+      SQY_TARGET_AVX2
+      static void merge_sweeps(const __m256i& _hi, const __m256i& _lo, word_type* _output){
+
+        const __m256i reverse_items = _mm256_setr_epi8(14,15,12,13,10,11,8,9,6,7,4,5,2,3,0,1,
+                                                       14,15,12,13,10,11,8,9,6,7,4,5,2,3,0,1);
+
+        const __m256i first = _mm256_shuffle_epi8(_mm256_unpackhi_epi8(_lo, _hi), reverse_items);
+        const __m256i second = _mm256_shuffle_epi8(_mm256_unpacklo_epi8(_lo, _hi), reverse_items);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output + 16), _mm256_permute2x128_si256(first, second, 0x31));
+      }
+
+      SQY_TARGET_AVX512BW
+      static void avx512_encode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        const __m512i split_bytes = avx512_broadcast_lane(_mm_setr_epi8(14,12,10,8,6,4,2,0,15,13,11,9,7,5,3,1));
+        const __m512i lo_index = _mm512_setr_epi64(2,0,6,4,10,8,14,12);
+        const __m512i hi_index = _mm512_setr_epi64(3,1,7,5,11,9,15,13);
+
+        const __m512i first = _mm512_shuffle_epi8(_mm512_loadu_si512(_input), split_bytes);
+        const __m512i second = _mm512_shuffle_epi8(_mm512_loadu_si512(_input + 32), split_bytes);
+
+        //lane l holds the bytes of sweep l in reverse order
+        const __m512i hi = _mm512_permutex2var_epi64(first, hi_index, second);
+        const __m512i lo = _mm512_permutex2var_epi64(first, lo_index, second);
+
+        for(std::size_t s = 0;s<8;++s){
+          const std::uint64_t plane = _mm512_test_epi8_mask(hi, _mm512_set1_epi8(char(0x80 >> s)));
+          std::memcpy(_output + s*_segment_length, &plane, sizeof(plane));
+        }
+
+        for(std::size_t s = 8;s<16;++s){
+          const std::uint64_t plane = _mm512_test_epi8_mask(lo, _mm512_set1_epi8(char(0x80 >> (s-8))));
+          std::memcpy(_output + s*_segment_length, &plane, sizeof(plane));
+        }
+      }
+
+      SQY_TARGET_AVX512BW
+      static void avx512_decode_block(const word_type* _input, word_type* _output, std::size_t _segment_length){
+
+        const __m512i reverse_items = avx512_broadcast_lane(_mm_setr_epi8(14,15,12,13,10,11,8,9,6,7,4,5,2,3,0,1));
+        const __m512i first_index = _mm512_setr_epi64(0,1,8,9,2,3,10,11);
+        const __m512i second_index = _mm512_setr_epi64(4,5,12,13,6,7,14,15);
+
+        __m512i hi = _mm512_setzero_si512();
+        __m512i lo = _mm512_setzero_si512();
+
+        for(std::size_t s = 0;s<8;++s){
+          std::uint64_t plane = 0;
+          std::memcpy(&plane, _input + s*_segment_length, sizeof(plane));
+          hi = _mm512_or_si512(hi, _mm512_maskz_mov_epi8(plane, _mm512_set1_epi8(char(0x80 >> s))));
+        }
+
+        for(std::size_t s = 8;s<16;++s){
+          std::uint64_t plane = 0;
+          std::memcpy(&plane, _input + s*_segment_length, sizeof(plane));
+          lo = _mm512_or_si512(lo, _mm512_maskz_mov_epi8(plane, _mm512_set1_epi8(char(0x80 >> (s-8)))));
+        }
+
+        //byte i of lane l belongs to item 16*l+15-i
+        const __m512i upper = _mm512_shuffle_epi8(_mm512_unpackhi_epi8(lo, hi), reverse_items);
+        const __m512i lower = _mm512_shuffle_epi8(_mm512_unpacklo_epi8(lo, hi), reverse_items);
+
+        _mm512_storeu_si512(_output, _mm512_permutex2var_epi64(upper, first_index, lower));
+        _mm512_storeu_si512(_output + 32, _mm512_permutex2var_epi64(upper, second_index, lower));
+      }
+
+    };
+
+#endif
+
+    template <typename raw_type>
+    static bool avx2_bitplane_reorder_available(){
+
+      static const bool value = SQY_HAS_AVX_BITPLANE_KERNELS &&
+        std::is_integral<raw_type>::value &&
+        avx_bitplane_kernel<sizeof(raw_type)>::supported &&
+        compass::runtime::has(compass::feature::avx2());
+
+      return value && simd::allows(simd::avx2);
+    }
+
+    template <typename raw_type>
+    static bool avx512_bitplane_reorder_available(){
+
+      static const bool value = SQY_HAS_AVX_BITPLANE_KERNELS &&
+        std::is_integral<raw_type>::value &&
+        avx_bitplane_kernel<sizeof(raw_type)>::supported &&
+        compass::runtime::has(compass::feature::avx512bw());
+
+      return value && simd::allows(simd::avx512bw);
+    }
+
+    /**
+       \brief AVX2 bitplane reordering (1 bit per plane) of the sweeps [_sweep_begin, _sweep_end), sweeps that do not fill a
+       complete block are handled by scalar_bitplane_reorder_encode_sweeps
+
+       \param[in] _input begin of the complete input buffer
+       \param[out] _output begin of the complete output buffer
+       \param[in] _segment_length number of items per bitplane segment (input length / num_planes)
+       \param[in] _sweep_begin first sweep to process
+       \param[in] _sweep_end one past the last sweep to process
+
+    */
+    template <typename raw_type>
+    SQY_TARGET_AVX2
+    static void avx2_bitplane_reorder_encode_sweeps(const raw_type* _input,
+                                                    raw_type* _output,
+                                                    std::size_t _segment_length,
+                                                    std::size_t _sweep_begin,
+                                                    std::size_t _sweep_end){
+
+      typedef avx_bitplane_kernel<sizeof(raw_type)> kernel;
+      typedef typename kernel::word_type word_type;
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+      static const std::size_t sweeps_per_block = kernel::avx2_block_items/num_planes;
+
+      const word_type* input = reinterpret_cast<const word_type*>(_input);
+      word_type* output = reinterpret_cast<word_type*>(_output);
+
+      std::size_t sweep = _sweep_begin;
+      for(;kernel::supported && sweep + sweeps_per_block <= _sweep_end;sweep += sweeps_per_block)
+        kernel::avx2_encode_block(input + sweep*num_planes, output + sweep, _segment_length);
+
+      scalar_bitplane_reorder_encode_sweeps<1>(_input, _output, _segment_length, sweep, _sweep_end);
+    }
+
+    template <typename raw_type>
+    SQY_TARGET_AVX2
+    static void avx2_bitplane_reorder_decode_sweeps(const raw_type* _input,
+                                                    raw_type* _output,
+                                                    std::size_t _segment_length,
+                                                    std::size_t _sweep_begin,
+                                                    std::size_t _sweep_end){
+
+      typedef avx_bitplane_kernel<sizeof(raw_type)> kernel;
+      typedef typename kernel::word_type word_type;
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+      static const std::size_t sweeps_per_block = kernel::avx2_block_items/num_planes;
+
+      const word_type* input = reinterpret_cast<const word_type*>(_input);
+      word_type* output = reinterpret_cast<word_type*>(_output);
+
+      std::size_t sweep = _sweep_begin;
+      for(;kernel::supported && sweep + sweeps_per_block <= _sweep_end;sweep += sweeps_per_block)
+        kernel::avx2_decode_block(input + sweep, output + sweep*num_planes, _segment_length);
+
+      scalar_bitplane_reorder_decode_sweeps<1>(_input, _output, _segment_length, sweep, _sweep_end);
+    }
+
+    template <typename raw_type>
+    SQY_TARGET_AVX512BW
+    static void avx512_bitplane_reorder_encode_sweeps(const raw_type* _input,
+                                                      raw_type* _output,
+                                                      std::size_t _segment_length,
+                                                      std::size_t _sweep_begin,
+                                                      std::size_t _sweep_end){
+
+      typedef avx_bitplane_kernel<sizeof(raw_type)> kernel;
+      typedef typename kernel::word_type word_type;
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+      static const std::size_t sweeps_per_block = kernel::avx512_block_items/num_planes;
+
+      const word_type* input = reinterpret_cast<const word_type*>(_input);
+      word_type* output = reinterpret_cast<word_type*>(_output);
+
+      std::size_t sweep = _sweep_begin;
+      for(;kernel::supported && sweep + sweeps_per_block <= _sweep_end;sweep += sweeps_per_block)
+        kernel::avx512_encode_block(input + sweep*num_planes, output + sweep, _segment_length);
+
+      scalar_bitplane_reorder_encode_sweeps<1>(_input, _output, _segment_length, sweep, _sweep_end);
+    }
+
+    template <typename raw_type>
+    SQY_TARGET_AVX512BW
+    static void avx512_bitplane_reorder_decode_sweeps(const raw_type* _input,
+                                                      raw_type* _output,
+                                                      std::size_t _segment_length,
+                                                      std::size_t _sweep_begin,
+                                                      std::size_t _sweep_end){
+
+      typedef avx_bitplane_kernel<sizeof(raw_type)> kernel;
+      typedef typename kernel::word_type word_type;
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+      static const std::size_t sweeps_per_block = kernel::avx512_block_items/num_planes;
+
+      const word_type* input = reinterpret_cast<const word_type*>(_input);
+      word_type* output = reinterpret_cast<word_type*>(_output);
+
+      std::size_t sweep = _sweep_begin;
+      for(;kernel::supported && sweep + sweeps_per_block <= _sweep_end;sweep += sweeps_per_block)
+        kernel::avx512_decode_block(input + sweep, output + sweep*num_planes, _segment_length);
+
+      scalar_bitplane_reorder_decode_sweeps<1>(_input, _output, _segment_length, sweep, _sweep_end);
+    }
+
+    /**
+       \brief AVX2 bitplane reordering with 1 bit per plane, _length must be a multiple of the number of bits of raw_type;
+       the sweeps are distributed over _nthreads threads, the output does not depend on _nthreads
+
+       \return SUCCESS or FAILURE if no kernel is available for raw_type or _length
+    */
+    template <typename raw_type>
+    static const error_code avx2_bitplane_reorder_encode(const raw_type* _input,
+                                                         raw_type* _output,
+                                                         std::size_t _length,
+                                                         int _nthreads = 1){
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+
+      if(!avx_bitplane_kernel<sizeof(raw_type)>::supported || _length % num_planes != 0)
+        return FAILURE;
+
+      const std::size_t n_sweeps = _length/num_planes;
+      parallel_sweeps(n_sweeps, avx_bitplane_kernel<sizeof(raw_type)>::avx2_block_items/num_planes, _nthreads,
+                      [=](std::size_t _begin, std::size_t _end){
+                        avx2_bitplane_reorder_encode_sweeps(_input, _output, n_sweeps, _begin, _end);
+                      });
+      return SUCCESS;
+    }
+
+    template <typename raw_type>
+    static const error_code avx2_bitplane_reorder_decode(const raw_type* _input,
+                                                         raw_type* _output,
+                                                         std::size_t _length,
+                                                         int _nthreads = 1){
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+
+      if(!avx_bitplane_kernel<sizeof(raw_type)>::supported || _length % num_planes != 0)
+        return FAILURE;
+
+      const std::size_t n_sweeps = _length/num_planes;
+      parallel_sweeps(n_sweeps, avx_bitplane_kernel<sizeof(raw_type)>::avx2_block_items/num_planes, _nthreads,
+                      [=](std::size_t _begin, std::size_t _end){
+                        avx2_bitplane_reorder_decode_sweeps(_input, _output, n_sweeps, _begin, _end);
+                      });
+      return SUCCESS;
+    }
+
+    template <typename raw_type>
+    static const error_code avx512_bitplane_reorder_encode(const raw_type* _input,
+                                                           raw_type* _output,
+                                                           std::size_t _length,
+                                                           int _nthreads = 1){
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+
+      if(!avx_bitplane_kernel<sizeof(raw_type)>::supported || _length % num_planes != 0)
+        return FAILURE;
+
+      const std::size_t n_sweeps = _length/num_planes;
+      parallel_sweeps(n_sweeps, avx_bitplane_kernel<sizeof(raw_type)>::avx512_block_items/num_planes, _nthreads,
+                      [=](std::size_t _begin, std::size_t _end){
+                        avx512_bitplane_reorder_encode_sweeps(_input, _output, n_sweeps, _begin, _end);
+                      });
+      return SUCCESS;
+    }
+
+    template <typename raw_type>
+    static const error_code avx512_bitplane_reorder_decode(const raw_type* _input,
+                                                           raw_type* _output,
+                                                           std::size_t _length,
+                                                           int _nthreads = 1){
+
+      static const std::size_t num_planes = sizeof(raw_type)*CHAR_BIT;
+
+      if(!avx_bitplane_kernel<sizeof(raw_type)>::supported || _length % num_planes != 0)
+        return FAILURE;
+
+      const std::size_t n_sweeps = _length/num_planes;
+      parallel_sweeps(n_sweeps, avx_bitplane_kernel<sizeof(raw_type)>::avx512_block_items/num_planes, _nthreads,
+                      [=](std::size_t _begin, std::size_t _end){
+                        avx512_bitplane_reorder_decode_sweeps(_input, _output, n_sweeps, _begin, _end);
+                      });
+      return SUCCESS;
+    }
+
+  }//namespace detail
+
+}//namespace sqeazy
+
+#endif /* _BITPLANE_REORDER_AVX_H_ */
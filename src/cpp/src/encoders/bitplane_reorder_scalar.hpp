@@ -1,6 +1,9 @@
 #ifndef _BITSWAP_SCHEME_SCALAR_H_
 #define _BITSWAP_SCHEME_SCALAR_H_
 #include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
 #include <climits>
 #include <iostream>
 
@@ -115,6 +118,135 @@ namespace sqeazy {
       return SUCCESS;
     }
 
+    /**
+       \brief scalar bitplane reordering of the sweeps [_sweep_begin, _sweep_end), a sweep being the
+       num_planes consecutive input items whose bits end up in one item of every bitplane segment
+
+       produces the same layout as scalar_bitplane_reorder_encode, but does not read the output
+       and writes every output item exactly once, so that disjoint sweep ranges can be processed
+       concurrently; also serves as the remainder handler of the SIMD kernels
+
+       \param[in] _input begin of the complete input buffer
+       \param[out] _output begin of the complete output buffer
+       \param[in] _segment_length number of items per bitplane segment (input length / num_planes)
+       \param[in] _sweep_begin first sweep to process
+       \param[in] _sweep_end one past the last sweep to process
+
+    */
+    template <const unsigned num_bits_per_plane,
+              typename raw_type>
+    static void scalar_bitplane_reorder_encode_sweeps(const raw_type* _input,
+                                                      raw_type* _output,
+                                                      std::size_t _segment_length,
+                                                      std::size_t _sweep_begin,
+                                                      std::size_t _sweep_end){
+
+      typedef typename std::make_unsigned<raw_type>::type uraw_type;
+
+      static const unsigned type_width = CHAR_BIT*sizeof(raw_type);
+      static const unsigned num_planes = type_width/num_bits_per_plane;
+      static const std::uint64_t mask = (std::uint64_t(1) << num_bits_per_plane) - 1;
+
+      for(std::size_t sweep = _sweep_begin; sweep < _sweep_end; ++sweep) {
+
+        const raw_type* items = _input + sweep*num_planes;
+
+        for(unsigned plane_index = 0; plane_index<num_planes; ++plane_index) {
+
+          std::uint64_t collected = 0;
+          for(unsigned item = 0; item<num_planes; ++item){
+            std::uint64_t extracted_bits = (std::uint64_t(uraw_type(items[item])) >> (plane_index*num_bits_per_plane)) & mask;
+            collected |= extracted_bits << ((type_width - num_bits_per_plane) - item*num_bits_per_plane);
+          }
+
+          _output[(num_planes-1-plane_index)*_segment_length + sweep] = static_cast<raw_type>(collected);
+        }
+      }
+
+    }
+
+    /**
+       \brief inverse of scalar_bitplane_reorder_encode_sweeps, restores the input items of the sweeps [_sweep_begin, _sweep_end)
+    */
+    template <const unsigned num_bits_per_plane,
+              typename raw_type>
+    static void scalar_bitplane_reorder_decode_sweeps(const raw_type* _input,
+                                                      raw_type* _output,
+                                                      std::size_t _segment_length,
+                                                      std::size_t _sweep_begin,
+                                                      std::size_t _sweep_end){
+
+      typedef typename std::make_unsigned<raw_type>::type uraw_type;
+
+      static const unsigned type_width = CHAR_BIT*sizeof(raw_type);
+      static const unsigned num_planes = type_width/num_bits_per_plane;
+      static const std::uint64_t mask = (std::uint64_t(1) << num_bits_per_plane) - 1;
+
+      for(std::size_t sweep = _sweep_begin; sweep < _sweep_end; ++sweep) {
+
+        raw_type* items = _output + sweep*num_planes;
+
+        for(unsigned item = 0; item<num_planes; ++item){
+
+          std::uint64_t restored = 0;
+          for(unsigned plane_index = 0; plane_index<num_planes; ++plane_index) {
+            std::uint64_t plane_item = uraw_type(_input[(num_planes-1-plane_index)*_segment_length + sweep]);
+            std::uint64_t extracted_bits = (plane_item >> ((type_width - num_bits_per_plane) - item*num_bits_per_plane)) & mask;
+            restored |= extracted_bits << (plane_index*num_bits_per_plane);
+          }
+
+          items[item] = static_cast<raw_type>(restored);
+        }
+      }
+
+    }
+
+    /**
+       \brief split the _n_sweeps sweeps of a bitplane reordering into contiguous ranges, one per thread, and
+       call _functor(begin, end) for each of them concurrently
+
+       as every sweep writes to distinct output items, the result does not depend on _nthreads
+
+       \param[in] _n_sweeps total number of sweeps (input length / num_planes)
+       \param[in] _granularity ranges are multiples of this many sweeps (except the last), e.g. the sweeps per SIMD block
+       \param[in] _nthreads number of threads to use
+       \param[in] _functor callable with signature void(std::size_t begin, std::size_t end)
+
+    */
+    template <typename functor_t>
+    static void parallel_sweeps(std::size_t _n_sweeps,
+                                std::size_t _granularity,
+                                int _nthreads,
+                                functor_t _functor){
+
+      typedef typename std::make_signed<std::size_t>::type omp_size_type;//boiler plate required for MS VS 14 2015 OpenMP implementation
+
+      if(_granularity < 1)
+        _granularity = 1;
+
+      if(_nthreads < 2 || _n_sweeps < 2*_granularity){
+        _functor(std::size_t(0), _n_sweeps);
+        return;
+      }
+
+      std::size_t sweeps_per_range = (_n_sweeps + _nthreads - 1)/_nthreads;
+      sweeps_per_range = ((sweeps_per_range + _granularity - 1)/_granularity)*_granularity;
+
+      const omp_size_type n_ranges = (_n_sweeps + sweeps_per_range - 1)/sweeps_per_range;
+
+#pragma omp parallel for                        \
+  shared(_functor)                              \
+  firstprivate(sweeps_per_range, _n_sweeps)     \
+  num_threads(_nthreads)
+      for(omp_size_type r = 0; r < n_ranges; ++r){
+        const std::size_t begin = r*sweeps_per_range;
+        const std::size_t end = (std::min)(begin + sweeps_per_range, _n_sweeps);
+        _functor(begin, end);
+      }
+
+    }
+
+
 
 
   };
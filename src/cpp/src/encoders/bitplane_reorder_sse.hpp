@@ -7,8 +7,23 @@
 #endif
 
 #include "sqeazy_common.hpp"
+#include "simd_dispatch.hpp"
 #include "sse_utils.hpp"
 
+/*
+  the 128-bit kernels of sse_utils.hpp are instantiated twice below: once for the SSE4 baseline the library is
+  compiled with and once with AVX2 enabled through a function attribute, flatten inlines the whole kernel into each
+  variant so that the latter is VEX encoded (no SSE/AVX transition penalties next to the AVX kernels, 3-operand forms);
+  the variant to call is chosen from simd::active()
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SQY_SSE_VARIANT_SSE4 __attribute__((flatten))
+#define SQY_SSE_VARIANT_AVX2 __attribute__((target("avx2"), flatten))
+#else
+#define SQY_SSE_VARIANT_SSE4
+#define SQY_SSE_VARIANT_AVX2
+#endif
+
 
 namespace sqeazy {
 
@@ -249,6 +264,26 @@ namespace sqeazy {
       return SUCCESS;
     }
 
+    /**
+       \brief simd_collect_single_bitplane built for the SSE4 baseline
+    */
+    template <typename raw_type>
+    SQY_SSE_VARIANT_SSE4
+    static void sse4_collect_single_bitplane(const raw_type* _begin, const raw_type* _end,
+                                             raw_type* _dst, int _bitplane_offset_from_msb){
+      simd_collect_single_bitplane(_begin, _end, _dst, _bitplane_offset_from_msb);
+    }
+
+    /**
+       \brief simd_collect_single_bitplane built with AVX2 enabled, only to be called if simd::allows(simd::avx2)
+    */
+    template <typename raw_type>
+    SQY_SSE_VARIANT_AVX2
+    static void avx2_collect_single_bitplane(const raw_type* _begin, const raw_type* _end,
+                                             raw_type* _dst, int _bitplane_offset_from_msb){
+      simd_collect_single_bitplane(_begin, _end, _dst, _bitplane_offset_from_msb);
+    }
+
     template <const unsigned nbits_per_plane,
               typename raw_type>
     static const bool sse_valid_length(const std::size_t& _len)
@@ -301,10 +336,15 @@ namespace sqeazy {
         return FAILURE;
       }
 
+      void (*collect)(const raw_type*, const raw_type*, raw_type*, int) = sse4_collect_single_bitplane<raw_type>;
+      if(simd::allows(simd::avx2))
+        collect = avx2_collect_single_bitplane<raw_type>;
+
       sqeazy::detail::simd_segment_broadcast(_input,
                                              _input + _length,
                                              _output,
-                                             _nthreads);
+                                             _nthreads,
+                                             collect);
 
       return SUCCESS;
 
@@ -120,22 +120,26 @@ namespace sqeazy {
       if(_oshape.empty())
         _oshape = _ishape;
 
-      typedef typename sqeazy::twice_as_wide<std::size_t>::type size_type;
-      size_type _length = std::accumulate(_ishape.begin(),
-                                          _ishape.end(),
-                                          1,
-                                          std::multiplies<std::size_t>());
-      // size_type max_size = _length - (_length % num_planes);
-      // if(max_size < _length)
-      //   std::copy(_input+max_size,_input+_length,_output+max_size);
-      std::size_t decoded = bshuf_bitunshuffle(_input, _output, _length, sizeof(in_type), block_size);
-
-      if(decoded)
-        return 0;
-      else
-        return 1;
+      std::size_t _length = std::accumulate(_ishape.begin(),
+                                            _ishape.end(),
+                                            1,
+                                            std::multiplies<std::size_t>());
+
+      return decode(_input,_output,_length);
+    }
+
+    /**
+       \brief number of items that bitshuffle transposes as one block, blocks are independent of each other
+    */
+    std::size_t items_per_block() const {
+
+      return block_size ? block_size : bshuf_default_block_size(sizeof(in_type));
     }
 
+    /**
+       \brief the input is split into one range of whole blocks per thread, every range is unshuffled on its own;
+       the last range also holds the incomplete block and the trailing items bitshuffle leaves untouched
+    */
     int decode( const compressed_type* _input,
                 raw_type* _output,
                 std::size_t _length,
@@ -145,17 +149,35 @@ namespace sqeazy {
         if(!_olength)
           _olength = _length;
 
-        // typedef typename sqeazy::twice_as_wide<std::size_t>::type size_type;
-        // size_type max_size = _length - (_length % num_planes);
-        // if(max_size < _length)
-        //   std::copy(_input+max_size,_input+_length,_output+max_size);
+        const std::size_t block = items_per_block();
+        const std::size_t n_blocks = _length/block;
+        const int nthreads = this->n_threads();
+
+        if(nthreads < 2 || n_blocks < 2){
+          const std::int64_t decoded = bshuf_bitunshuffle(_input, _output, _length, sizeof(in_type), block);
+          return decoded > 0 ? 0 : 1;
+        }
+
+        const std::size_t chunk = ((n_blocks + nthreads - 1)/nthreads)*block;
+        const omp_size_type n_chunks = (_length + chunk - 1)/chunk;
 
-        std::size_t decoded = bshuf_bitunshuffle(_input, _output, _length, sizeof(in_type), block_size);
+        int failed = 0;
+
+#pragma omp parallel for                        \
+  shared(_output)                               \
+  firstprivate(_input, _length, chunk, block)   \
+  reduction(+:failed)                           \
+  num_threads(nthreads)
+        for(omp_size_type c = 0;c<n_chunks;++c){
+
+          const std::size_t first = c*chunk;
+          const std::size_t len = (std::min)(chunk, _length - first);
+
+          const std::int64_t decoded = bshuf_bitunshuffle(_input + first, _output + first, len, sizeof(in_type), block);
+          failed += decoded > 0 ? 0 : 1;
+        }
 
-        if(decoded)
-          return 0;
-        else
-          return 1;
+        return failed ? 1 : 0;
       }
 
 
@@ -4,6 +4,7 @@
 #include "compass.hpp"
 #include "neighborhood_utils.hpp"
 #include "sqeazy_common.hpp"
+#include "simd_dispatch.hpp"
 #include "traits.hpp"
 
 #include "dynamic_stage.hpp"
@@ -19,6 +20,7 @@
 #endif
 
 #include "bitplane_reorder_scalar.hpp"
+#include "bitplane_reorder_avx.hpp"
 
 namespace sqeazy {
 
@@ -34,7 +36,7 @@ namespace sqeazy {
     std::uint32_t num_planes;
 
     static_assert(std::is_arithmetic<raw_type>::value==true,"[bitswap_scheme] input type is non-arithmetic");
-    static const std::string description() { return std::string("rewrite bitplanes of item as chunks of buffer, use <num_bits_per_plane|default = 1> to control how many bits each plane has"); };
+    static const std::string description() { return std::string("rewrite bitplanes of item as chunks of buffer, use <num_bits_per_plane|default = 1> to control how many bits each plane has (AVX512BW/AVX2/SSE4 kernels are used for 1 bit per plane if the CPU supports them)"); };
 
     //TODO: check syntax of lz4 configuration at runtime
     bitswap_scheme(const std::string& _payload=""):
@@ -103,8 +105,27 @@ namespace sqeazy {
         std::copy(_input+max_size,_input+_length,_output+max_size);
 
       int err = 0;
-      if(sqeazy::platform::use_vectorisation::value &&
-         compass::runtime::has(compass::feature::sse4()) &&
+      if(num_bits_per_plane==1 && sqeazy::detail::avx512_bitplane_reorder_available<raw_type>())
+      {
+#ifdef _SQY_VERBOSE_
+        std::cout << "[bitswap_scheme::encode]\tusing avx512bw method\n";
+#endif
+        err = sqeazy::detail::avx512_bitplane_reorder_encode(_input,
+                                                             _output,
+                                                             max_size,
+                                                             this->n_threads());
+      }
+      else if(num_bits_per_plane==1 && sqeazy::detail::avx2_bitplane_reorder_available<raw_type>())
+      {
+#ifdef _SQY_VERBOSE_
+        std::cout << "[bitswap_scheme::encode]\tusing avx2 method\n";
+#endif
+        err = sqeazy::detail::avx2_bitplane_reorder_encode(_input,
+                                                           _output,
+                                                           max_size,
+                                                           this->n_threads());
+      }
+      else if(sqeazy::simd::allows(sqeazy::simd::sse4) &&
          num_bits_per_plane==1 &&
          sizeof(raw_type)>1 &&
          sqeazy::detail::sse_valid_length<static_num_bits_per_plane,raw_type>(_length)
@@ -123,18 +144,21 @@ namespace sqeazy {
       else{
 #ifdef _SQY_VERBOSE_
         std::cout << "[bitswap_scheme::encode]\tusing scalar method, why ? "
-                  << "sqeazy::platform::use_vectorisation::value = "<< sqeazy::platform::use_vectorisation::value << ", "
-                  << "compass::runtime::has(compass::feature::sse4()) = " << compass::runtime::has(compass::feature::sse4())<< ","
+                  << "sqeazy::simd::active_name() = "<< sqeazy::simd::active_name() << ", "
                   << "num_bits_per_plane==1 " << num_bits_per_plane << " ==1 ,"
                   << "sizeof(raw_type)=" << sizeof(raw_type) << ">1, "
                   << "sqeazy::detail::sse_valid_length<static_num_bits_per_plane,raw_type>(_length) " <<
                   sqeazy::detail::sse_valid_length << static_num_bits_per_plane,raw_type>(_length)
                   << "\n";
 #endif
-        err = sqeazy::detail::scalar_bitplane_reorder_encode<static_num_bits_per_plane>(_input,
-                                                                                        _output,
-                                                                                        max_size,
-                                                                                        this->n_threads());
+        //sweep-wise so that threads never write to the same output item
+        const std::size_t n_sweeps = max_size/num_planes;
+        sqeazy::detail::parallel_sweeps(n_sweeps, 1, this->n_threads(),
+                                        [=](std::size_t _begin, std::size_t _end){
+                                          sqeazy::detail::scalar_bitplane_reorder_encode_sweeps<static_num_bits_per_plane>(_input, _output,
+                                                                                                                           n_sweeps,
+                                                                                                                           _begin, _end);
+                                        });
       }
 
       if(!err)
@@ -165,17 +189,11 @@ namespace sqeazy {
       if(_oshape.empty())
         _oshape = _ishape;
 
-      typedef typename sqeazy::twice_as_wide<std::size_t>::type size_type;
-      size_type _length = std::accumulate(_ishape.begin(),
-                                          _ishape.end(),
-                                          1,
-                                          std::multiplies<std::size_t>());
-      size_type max_size = _length - (_length % num_planes);
-      if(max_size < _length)
-        std::copy(_input+max_size,_input+_length,_output+max_size);
-      return sqeazy::detail::scalar_bitplane_reorder_decode<static_num_bits_per_plane>(_input,
-                                                                                       _output,
-                                                                                       max_size);
+      std::size_t _length = std::accumulate(_ishape.begin(),
+                                            _ishape.end(),
+                                            1,
+                                            std::multiplies<std::size_t>());
+      return decode(_input, _output, _length);
     }
 
     int decode( const compressed_type* _input,
@@ -191,9 +209,27 @@ namespace sqeazy {
         size_type max_size = _length - (_length % num_planes);
         if(max_size < _length)
           std::copy(_input+max_size,_input+_length,_output+max_size);
-        return sqeazy::detail::scalar_bitplane_reorder_decode<static_num_bits_per_plane>(_input,
-                                                                                         _output,
-                                                                                         max_size);
+
+        if(num_bits_per_plane==1 && sqeazy::detail::avx512_bitplane_reorder_available<raw_type>())
+          return sqeazy::detail::avx512_bitplane_reorder_decode(_input,
+                                                                _output,
+                                                                max_size,
+                                                                this->n_threads());
+
+        if(num_bits_per_plane==1 && sqeazy::detail::avx2_bitplane_reorder_available<raw_type>())
+          return sqeazy::detail::avx2_bitplane_reorder_decode(_input,
+                                                              _output,
+                                                              max_size,
+                                                              this->n_threads());
+
+        const std::size_t n_sweeps = max_size/num_planes;
+        sqeazy::detail::parallel_sweeps(n_sweeps, 1, this->n_threads(),
+                                        [=](std::size_t _begin, std::size_t _end){
+                                          sqeazy::detail::scalar_bitplane_reorder_decode_sweeps<static_num_bits_per_plane>(_input, _output,
+                                                                                                                           n_sweeps,
+                                                                                                                           _begin, _end);
+                                        });
+        return SUCCESS;
       }
 
 
@@ -4,8 +4,10 @@
 #include "neighborhood_utils.hpp"
 #include "sqeazy_common.hpp"
 #include "traits.hpp"
+#include "stencil_utils.hpp"
 #include "diff_scheme_utils.hpp"
 #include "dynamic_stage.hpp"
+#include "string_parsers.hpp"
 
 
 
@@ -21,15 +23,36 @@ namespace sqeazy {
     typedef filter<in_type> base_type;
     typedef in_type raw_type;
     typedef typename base_type::out_type compressed_type;
-    typedef typename add_unsigned<typename twice_as_wide<in_type>::type >::type sum_type;
+    typedef typename twice_as_wide<in_type>::type wide_type;
+    typedef typename std::conditional<std::is_signed<in_type>::value,
+                                      wide_type,
+                                      typename add_unsigned<wide_type>::type>::type sum_type;
+    typedef typename add_unsigned<wide_type>::type legacy_sum_type;
+
+    //version 1: sums wrapped in raw_type, halo with swapped axes (streams without v=... in the config)
+    //version 2: sums in sum_type, halo from stencil::region
+    static const int current_version = 2;
+
+    int version;
 
     static_assert(std::is_arithmetic<raw_type>::value==true,"[diff_scheme] input type is non-arithmetic");
     static const std::string description() { return std::string("store difference to mean of neighboring items"); };
 
-    //TODO: check syntax of lz4 configuration at runtime
-    diff_scheme(const std::string& _payload="")
+    /**
+       \brief the payload may carry v=<version> of the arithmetic that produced a stream, without it
+       the stream is taken as version 1 (written before the version tag existed); encode always writes the
+       current version and sets it
+    */
+    diff_scheme(const std::string& _payload=""):
+      version(1)
       {
 
+        pipeline_parser p;auto config_map = p.minors(_payload.begin(),_payload.end());
+
+        auto f_itr = config_map.find("v");
+        if(f_itr!=config_map.end())
+          version = std::stoi(f_itr->second);
+
       }
 
 
@@ -55,7 +78,10 @@ namespace sqeazy {
     */
     std::string config() const override {
 
-      return "";
+      if(version < 2)
+        return "";
+
+      return "v=" + std::to_string(version);
 
     }
 
@@ -79,74 +105,80 @@ namespace sqeazy {
                              compressed_type* _compressed,
                              const std::vector<std::size_t>& _shape) override final {
 
-      typedef std::size_t size_type;
-
       if(_shape.size()!=3){
         std::cerr << "[diff_scheme] unable to process input data that is not 3D\n";
         return _compressed;
       }
 
+      version = current_version;
+
       std::size_t length = std::accumulate(_shape.begin(), _shape.end(),1,std::multiplies<std::size_t>());
       std::copy(_raw, _raw + length, _compressed);//crossing fingers due to possible type mismatch
 
-      std::vector<size_type> offsets;
-      sqeazy::halo<Neighborhood, size_type> geometry(_shape[row_major::w],
-                                                     _shape[row_major::h],
-                                                     _shape[row_major::d]);
-      geometry.compute_offsets_in_x(offsets);
+      const sum_type n_traversed_pixels = sqeazy::num_traversed_pixels<Neighborhood>();
+      out_type* signed_compressed = reinterpret_cast<out_type*>(_compressed);
 
+      stencil::for_each_box_sum<Neighborhood, sum_type>(_raw, _shape,
+                                                        [](raw_type _value){ return sum_type(_value); },
+                                                        [=](std::size_t _index, sum_type _sum, std::size_t){
+                                                          signed_compressed[_index] = _raw[_index] - _sum/n_traversed_pixels;
+                                                        },
+                                                        this->n_threads());
 
-      size_type halo_size_x = geometry.non_halo_end(0)-geometry.non_halo_begin(0);
-      if(offsets.size()==1)//no offsets in other dimensions than x
-      {
-        halo_size_x = length - offsets.front();
-      }
+      return _compressed+length;
 
+    }
 
-      const auto n_traversed_pixels = sqeazy::num_traversed_pixels<Neighborhood>();
 
-      out_type* signed_compressed = reinterpret_cast<out_type*>(_compressed);
+    /**
+       \brief decoding needs the reconstructed neighborhood of a pixel, if the Neighborhood only reaches into
+       preceding planes, the volume is decoded plane by plane (in parallel inside a plane), otherwise pixel by
+       pixel in memory order; streams of version 1 are decoded with the arithmetic they were written with
+    */
+    int decode( const compressed_type* _in, raw_type* _out,
+                const std::vector<std::size_t>& _shape,
+                std::vector<std::size_t> _out_shape = std::vector<std::size_t>()) const override final {
 
-      auto offsets_begin = offsets.begin();
-      const omp_size_type offset_size = offsets.size();
-      const int nthreads = this->n_threads();
-      //auto shape_begin = _shape.data();
-	  const auto pshape = _shape.data();
+      if(_out_shape.empty())
+        _out_shape = _shape;
 
-#pragma omp parallel for                        \
-  shared(signed_compressed)                            \
-  firstprivate( offset_size, halo_size_x, offsets_begin, _raw, pshape,n_traversed_pixels) \
-  num_threads(nthreads)
-      for(omp_size_type offset = 0; offset < offset_size; ++offset) {
+      if(version < 2)
+        return decode_v1(_in, _out, _shape);
 
-        for(std::size_t index = 0; index < (std::size_t)halo_size_x; ++index) {
+      unsigned long length = std::accumulate(_shape.begin(), _shape.end(),1,std::multiplies<std::size_t>());
+      std::copy(_in,_in + length, _out);
 
-          auto     local_index = index + *(offsets_begin + offset);
-          sum_type local_sum = naive_sum<Neighborhood>(_raw,local_index,
-                                                       pshape[row_major::w],
-                                                       pshape[row_major::h],
-                                                       pshape[row_major::d]
-            );
+      const sum_type n_traversed_pixels = sqeazy::num_traversed_pixels<Neighborhood>();
+      const out_type* signed_in = reinterpret_cast<const out_type*>(_in);
 
-          *(signed_compressed + local_index) = _raw[local_index] - local_sum/n_traversed_pixels;
+      auto as_sum = [](raw_type _value){ return sum_type(_value); };
+      auto restore = [=](std::size_t _index, sum_type _sum, std::size_t){
+        _out[_index] = signed_in[_index] + _sum/n_traversed_pixels;
+      };
 
-        }
+      if(Neighborhood::z_offset_end <= 0){
+        const stencil::region<Neighborhood> geometry(_shape);
 
+        for(std::size_t z = geometry.first[row_major::z];z<geometry.last[row_major::z];++z)
+          stencil::for_each_box_sum<Neighborhood, sum_type>(_out, _shape, as_sum, restore,
+                                                            this->n_threads(), stencil::skip_halo, z, z + 1);
       }
+      else
+        stencil::for_each_box_sum_in_order<Neighborhood, sum_type>(_out, _shape, as_sum, restore);
 
-      return _compressed+length;
+      return SUCCESS;
 
     }
 
-
-
-    int decode( const compressed_type* _in, raw_type* _out,
-                const std::vector<std::size_t>& _shape,
-                std::vector<std::size_t> _out_shape = std::vector<std::size_t>()) const override final {
+    /**
+       \brief inverse of the encoding before version 2: the neighborhood sum wraps in raw_type (naive_sum) and
+       the pixels are visited as given by halo::compute_offsets_in_x; the Neighborhood only reaches items
+       that precede a pixel in memory, so they are restored in memory order
+    */
+    int decode_v1( const compressed_type* _in, raw_type* _out,
+                   const std::vector<std::size_t>& _shape) const {
 
       typedef std::size_t size_type;
-      if(_out_shape.empty())
-        _out_shape = _shape;
 
       unsigned long length = std::accumulate(_shape.begin(), _shape.end(),1,std::multiplies<std::size_t>());
       std::copy(_in,_in + length, _out);
@@ -159,31 +191,20 @@ namespace sqeazy {
 
       size_type halo_size_x = geometry.non_halo_end(0)-geometry.non_halo_begin(0);
       if(offsets.size()==1)//no offsets in other dimensions than x
-      {
         halo_size_x = length - offsets.front();
-      }
 
-      const sum_type n_traversed_pixels = sqeazy::num_traversed_pixels<Neighborhood>();
+      const legacy_sum_type n_traversed_pixels = sqeazy::num_traversed_pixels<Neighborhood>();
       const out_type* signed_in = reinterpret_cast<const out_type*>(_in);
-      const int nthreads = this->n_threads();
-      const omp_size_type offset_size = offsets.size();
-      auto offsets_begin = offsets.begin();
-      auto shape_begin   = _shape.data();
-
-#pragma omp parallel for                               \
-  shared(_out)                            \
-  firstprivate( offsets_begin, offset_size, n_traversed_pixels, signed_in, shape_begin ) \
-  num_threads(nthreads)
-      for(omp_size_type offset=0; offset<offset_size; ++offset) {
-
-        for(std::size_t index = 0; index < (std::size_t)halo_size_x; ++index) {
-
-          const size_type local_index = index + *(offsets_begin + offset);
-          sum_type  local_sum = naive_sum<Neighborhood>(_out,
-                                                        local_index,
-                                                        *(shape_begin + row_major::w),
-                                                        *(shape_begin + row_major::h),
-                                                        *(shape_begin + row_major::d));
+
+      for(const size_type offset : offsets) {
+        for(size_type index = 0; index < halo_size_x; ++index) {
+
+          const size_type local_index = index + offset;
+          legacy_sum_type local_sum = naive_sum<Neighborhood>(_out,
+                                                              local_index,
+                                                              _shape[row_major::w],
+                                                              _shape[row_major::h],
+                                                              _shape[row_major::d]);
           _out[local_index] = signed_in[local_index] + local_sum/n_traversed_pixels;
 
         }
@@ -194,7 +215,6 @@ namespace sqeazy {
     }
 
 
-
     ~diff_scheme(){};
 
     std::string output_type() const final override {
@@ -9,7 +9,7 @@
 #include "traits.hpp"
 #include "dynamic_stage.hpp"
 #include "string_parsers.hpp"
-#include "background_scheme_utils.hpp"
+#include "stencil_utils.hpp"
 
 namespace sqeazy {
 
@@ -91,63 +91,37 @@ namespace sqeazy {
                              compressed_type* _output,
                              const std::vector<std::size_t>& _shape) override final {
 
-      typedef std::size_t size_type;
-      unsigned long length = std::accumulate(_shape.begin(), _shape.end(), 1, std::multiplies<size_type>());
-
-      std::vector<size_type> offsets;
-      sqeazy::halo<Neighborhood, size_type> geometry(_shape.begin(), _shape.end());
-      geometry.compute_offsets_in_x(offsets);
-
-      size_type halo_size_x = length - offsets[row_major::x];
-
-      //no offsets in other dimensions than x
-      if(offsets.size()!=1)
-      {
-        halo_size_x = geometry.non_halo_end(row_major::x) - geometry.non_halo_begin(row_major::x) + 1;
-      }
-
-
-      unsigned n_neighbors_below_threshold = 0;
-
-      const float cut_fraction = fraction*(size<Neighborhood>()-1);
+      std::size_t length = std::accumulate(_shape.begin(), _shape.end(), 1, std::multiplies<std::size_t>());
 
+      //pixels below threshold are passed through
       const int nthreads = this->n_threads();
-      const omp_size_type offset_size = offsets.size();
-      auto offsets_begin = offsets.begin();
-	  auto local_shape = _shape;
-	  const auto local_threshold = threshold;
-
-#pragma omp parallel for                  \
-  shared(_output)                                                          \
-  firstprivate( _input, offsets_begin, offset_size, local_threshold, local_shape , n_neighbors_below_threshold, cut_fraction) \
-  num_threads(nthreads)
-      for(omp_size_type offset=0; offset<offset_size; ++offset) {
-
-        for(std::size_t index = 0; index < (std::size_t)halo_size_x; ++index) {
+      const omp_size_type len = length;
 
-          const size_type local_index = index + *(offsets_begin + offset);
-
-          //skip pixels that are below threshold
-          if(*(_input + local_index)<local_threshold)
-            continue;
-
-          n_neighbors_below_threshold = count_neighbors_if<Neighborhood>(_input + local_index,
-                                                                         local_shape,
-                                                                         // std::bind2nd(std::less<raw_type>(), threshold)
-                                                                         [&](raw_type element){
-                                                                           return element < local_threshold;
-                                                                         }
-            );
-
-          if(n_neighbors_below_threshold>cut_fraction){
-            _output[local_index] = 0;
-          }
-          else
-            _output[local_index] = _input[local_index];
-
-        }
+#pragma omp parallel for                        \
+  shared(_output)                               \
+  firstprivate( _input )                        \
+  num_threads(nthreads)
+      for(omp_size_type i = 0;i<len;++i){
+        _output[i] = _input[i];
       }
 
+      const float local_fraction = fraction;
+      const auto local_threshold = threshold;
+
+      //at the border of the volume, only the part of the neighborhood inside the volume is considered;
+      //the central pixel is only looked at if it is not below threshold, so it never contributes to the count
+      stencil::for_each_box_sum<Neighborhood, std::uint32_t>(_input, _shape,
+                                                             [=](raw_type _value){
+                                                               return std::uint32_t(_value < local_threshold);
+                                                             },
+                                                             [=](std::size_t _index, std::uint32_t _n_below, std::size_t _n_pixels){
+                                                               if(_n_below > local_fraction*(_n_pixels-1) &&
+                                                                  !(_input[_index] < local_threshold))
+                                                                 _output[_index] = 0;
+                                                             },
+                                                             nthreads,
+                                                             stencil::clip_to_volume);
+
 
       return _output+length;
 
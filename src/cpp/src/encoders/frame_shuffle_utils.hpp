@@ -3,10 +3,12 @@
 
 #include <cstdint>
 #include <iterator>
+#include <utility>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include "traits.hpp"
 #include "sqeazy_common.hpp"
+#include "sqeazy_algorithms.hpp"
 
 
 namespace sqeazy {
@@ -23,7 +25,7 @@ namespace sqeazy {
 	  frame_shuffle(std::size_t _fsize = 1,
 					std::vector<std::size_t> _map = std::vector<std::size_t>()):
 		frame_chunk_size(_fsize),
-		decode_map(_map)
+		decode_map(std::move(_map))
       {
 
       }
@@ -133,32 +135,21 @@ namespace sqeazy {
 		}
 
 		// PERFORM SHUFFLE /////////////////////////////////////////////////////////////////////////////////////////////////////
+		// decode_map[i] is the original index of the frame chunk with the i-th smallest metric (ties keep their original order)
 		decode_map.resize(n_chunks);
-
-		auto sorted_metric = metric;
-
-		//TODO: we need a parallel sort here!
-		//TODO: what if there are frame_chunks with the same value? (highly unlikely with float32_t)
-		std::sort(sorted_metric.begin(), sorted_metric.end());
+		argsort(metric.begin(), metric.end(), decode_map.begin(), nthreads);
 
 		auto decode_map_itr = decode_map.data();
-		auto metric_begin = metric.data();
-		auto metric_end = metric_begin + metric.size();
-		auto sorted_metric_begin = sorted_metric.data();
 		const omp_size_type loop_count = metric.size();
 
 #pragma omp parallel for								\
   shared(_out)							\
-  firstprivate(decode_map_itr,metric_begin,metric_end,sorted_metric_begin,_begin) \
+  firstprivate(decode_map_itr,_begin) \
   num_threads(nthreads)
 		for(omp_size_type i =0;i<loop_count;++i){
 		  auto dst = _out + i*n_elements_per_frame_chunk;
 
-		  auto item = *(sorted_metric_begin + i);
-		  auto unsorted_itr = std::find(metric_begin, metric_end,
-										item);
-		  std::size_t original_index = std::distance(metric_begin,unsorted_itr);
-		  *(decode_map_itr + i) = original_index;
+		  const std::size_t original_index = *(decode_map_itr + i);
 		  auto src_start = _begin + original_index*n_elements_per_frame_chunk;
 
 		  std::copy(src_start,
@@ -233,31 +224,19 @@ namespace sqeazy {
 		}
 
 		// PERFORM SHUFFLE /////////////////////////////////////////////////////////////////////////////////////////////////////
+		// decode_map[i] is the original index of the frame chunk with the i-th smallest metric (ties keep their original order)
 		decode_map.resize(metric.size());
-
-		auto sorted_metric = metric;
-
-//TODO: we need a parallel sort here!
-		//TODO: what if there are frame_chunks with the same value? (highly unlikely with float32_t)
-		std::sort(sorted_metric.begin(), sorted_metric.end());
+		argsort(metric.begin(), metric.end(), decode_map.begin(), nthreads);
 
 		auto decode_map_itr = decode_map.data();
-		auto metric_begin = metric.data();
-		auto metric_end = metric_begin + metric.size();
-		auto sorted_metric_begin = sorted_metric.data();
-
 
 		#pragma omp parallel for															\
 		  shared(_out)																		\
-		  firstprivate(decode_map_itr,metric_begin,metric_end,sorted_metric_begin,_begin)	\
+		  firstprivate(decode_map_itr,_begin)	\
 		  num_threads(nthreads)
 		for(omp_size_type i =0;i<loop_count;++i){
 
-		  auto item = *(sorted_metric_begin + i);
-		  auto unsorted_itr = std::find(metric_begin, metric_end,
-										item);
-		  std::size_t original_index = std::distance(metric_begin,unsorted_itr);
-		  *(decode_map_itr + i) = original_index;
+		  const std::size_t original_index = *(decode_map_itr + i);
 		  auto src_start = _begin + original_index*n_elements_per_frame_chunk;
 
 		  auto dst = _out + i*n_elements_per_frame_chunk;
@@ -6,6 +6,12 @@
 #include <iterator>
 #include <numeric>
 #include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(__SSE2_MATH__)
+#include <emmintrin.h>
+#endif
 
 #include "sqeazy_common.hpp"
 
@@ -25,8 +31,153 @@ namespace sqeazy {
 
         };
 
+        /**
+         *  \brief bins that live in one contiguous block of std::uint32_t, only those are filled with the banked kernel
+         */
+        template <typename bin_iter_type>
+        struct contiguous_bins : std::integral_constant<bool,
+                                                        std::is_same<bin_iter_type, std::uint32_t*>::value ||
+                                                        std::is_same<bin_iter_type, std::vector<std::uint32_t>::iterator>::value>
+        {};
+
+        /**
+         *  \brief _dst[i] += _src[i] for i in [0,_n), 4 bins at a time if SSE2 is available
+         */
+        static inline void add_bins(std::uint32_t* _dst, const std::uint32_t* _src, std::size_t _n){
+
+            std::size_t i = 0;
+#if defined(__SSE2__) || defined(__SSE2_MATH__)
+            const std::size_t n_vectorised = _n - (_n % 8);
+            for(;i < n_vectorised;i += 8){
+                __m128i lo = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_dst + i)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(_src + i)));
+                __m128i hi = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_dst + i + 4)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(_src + i + 4)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(_dst + i), lo);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(_dst + i + 4), hi);
+            }
+#endif
+            for(;i<_n;++i)
+                _dst[i] += _src[i];
+        }
+
         namespace serial {
 
+        //number of sub-histograms the banked kernel spreads consecutive samples over
+        static const int n_banks = 4;
+
+        /**
+         *  \brief count every _stride-th value of [_begin,_end) into _bins using n_banks sub-histograms: consecutive
+         *  samples go to different banks, so runs of equal values (e.g. background) do not stall on the
+         *  load-increment-store of the previous sample to the same bin; the banks are added to _bins at the end
+         *
+         *  \param _bins contiguous bins of the histogram
+         *  \return number of samples counted
+         */
+        template <typename iter_type>
+        std::size_t fill_banked_histogram(iter_type _begin,
+                                          iter_type _end,
+                                          std::uint32_t* _bins,
+                                          std::size_t _stride = 1)
+        {
+            using value_t = typename std::iterator_traits<iter_type>::value_type;
+            using index_t = typename std::make_unsigned<value_t>::type;
+
+            const std::size_t n_bins = dense_histo<value_t>::size;
+            const std::size_t len = std::distance(_begin,_end);
+            const std::size_t n_samples = (len + _stride - 1)/_stride;
+
+            std::vector<std::uint32_t> banks((n_banks - 1)*n_bins, 0);
+            std::uint32_t* bank1 = banks.data();
+            std::uint32_t* bank2 = bank1 + n_bins;
+            std::uint32_t* bank3 = bank2 + n_bins;
+
+            const std::size_t step = n_banks*_stride;
+            std::size_t sample = 0;
+            iter_type itr = _begin;
+
+            for(;sample + n_banks <= n_samples;sample += n_banks, itr += step){
+                _bins[index_t(*itr)]++;
+                bank1[index_t(*(itr + _stride))]++;
+                bank2[index_t(*(itr + 2*_stride))]++;
+                bank3[index_t(*(itr + 3*_stride))]++;
+            }
+
+            for(;sample < n_samples;++sample, itr += _stride)
+                _bins[index_t(*itr)]++;
+
+            for(int bank = 0;bank < n_banks - 1;++bank)
+                add_bins(_bins, banks.data() + bank*n_bins, n_bins);
+
+            return n_samples;
+        }
+
+        /**
+         *  \brief count every _stride-th value of [_begin,_end) into _histo (generic fallback)
+         *
+         *  \return number of samples counted
+         */
+        template <typename iter_type,
+                  typename histo_iter_type>
+        std::size_t fill_strided_histogram(iter_type _begin,
+                                           iter_type _end,
+                                           histo_iter_type _histo,
+                                           std::size_t _stride,
+                                           std::false_type)
+        {
+            const std::size_t len = std::distance(_begin,_end);
+            std::size_t n_samples = 0;
+
+            for(std::size_t i = 0;i < len;i += _stride, ++n_samples)
+                *(_histo+*(_begin + i)) +=1;
+
+            return n_samples;
+        }
+
+        template <typename iter_type,
+                  typename histo_iter_type>
+        std::size_t fill_strided_histogram(iter_type _begin,
+                                           iter_type _end,
+                                           histo_iter_type _histo,
+                                           std::size_t _stride,
+                                           std::true_type)
+        {
+            using value_t = typename std::iterator_traits<iter_type>::value_type;
+            const std::size_t n_samples = (std::size_t(std::distance(_begin,_end)) + _stride - 1)/_stride;
+
+            //the banks only pay off if they are filled considerably
+            if(n_samples < n_banks*dense_histo<value_t>::size)
+                return fill_strided_histogram(_begin, _end, _histo, _stride, std::false_type());
+
+            return fill_banked_histogram(_begin, _end, &*_histo, _stride);
+        }
+
+        /**
+         *  \brief add the value counts of every _stride-th value of [_begin,_end) to the histogram _bins, meant for
+         *  estimates where not every voxel needs to be looked at
+         *
+         *  \param _stride distance between two samples (1 counts every value)
+         *  \return number of samples counted
+         */
+        template <typename iter_type,
+                  typename histo_iter_type>
+        std::size_t sample_histogram(iter_type _begin,
+                                     iter_type _end,
+                                     histo_iter_type _histo,
+                                     std::size_t _stride = 1)
+        {
+            using value_t = typename std::iterator_traits<iter_type>::value_type;
+            using use_banks = std::integral_constant<bool,
+                                                     contiguous_bins<histo_iter_type>::value &&
+                                                     std::is_integral<value_t>::value && sizeof(value_t) <= 2 &&
+                                                     std::is_base_of<std::random_access_iterator_tag,
+                                                                     typename std::iterator_traits<iter_type>::iterator_category>::value>;
+
+            if(_stride < 1)
+                _stride = 1;
+
+            return fill_strided_histogram(_begin, _end, _histo, _stride, use_banks());
+        }
 
 /**
          *  \brief fill the histogram represented by _bins sequentially with the value counts/frequency observed in [_begin,_end); it is assumed that _bins yields a linear range of range(0,max_value(*_begin))
@@ -47,9 +198,7 @@ namespace sqeazy {
             using value_t = typename std::iterator_traits<iter_type>::value_type;
             auto len = dense_histo< value_t >::size;
 
-            for(;_begin!=_end;++_begin){
-                *(_histo+*_begin) +=1;
-            }
+            sample_histogram(_begin, _end, _histo);
 
             return _histo + len;
         }
@@ -85,71 +234,117 @@ namespace sqeazy {
 
 
 
+            template <typename bin_iter_type>
+            static void add_clone(bin_iter_type _bins, const std::uint32_t* _clone, std::size_t _n, std::true_type){
+                add_bins(&*_bins, _clone, _n);
+            }
+
+            template <typename bin_iter_type>
+            static void add_clone(bin_iter_type _bins, const std::uint32_t* _clone, std::size_t _n, std::false_type){
+                for(std::size_t i = 0;i<_n;++i)
+                    *(_bins + i) += _clone[i];
+            }
+
             /**
-             *  \brief fill the histogram represented by _bins concurrently with the value counts/frequency observed in [_begin,_end); it is assumed that _bins yields a linear range of range(0,max_value(*_begin))
+             *  \brief add the value counts of every _stride-th value of [_begin,_end) to the histogram _bins
+             *  concurrently: every thread fills a zeroed clone with the banked kernel, the clones are added to _bins
+             *  bin-block-wise in parallel (with SIMD adds if _bins is contiguous)
              *
-             *  \param _begin input iterator pointing to element 0 of the values to histogram (const iterators allowed)
-             *  \param _end input iterator pointing to the last+1 element of the values to histogram (const iterators allowed)
-             *  \param _bins input iterator of the histogram bins (assumed to yield a linear range of range(0,max_value(*_begin)))
+             *  \param _stride distance between two samples (1 counts every value)
              *  \param nthreads number of threads to use
-             *  \return void
+             *  \return number of samples counted
              */
             template <typename iter_type, typename bin_iter_type>
-            bin_iter_type fill_histogram(iter_type _begin,
-                                iter_type _end,
-                                bin_iter_type _bins,
-                                int nthreads = 1
+            std::size_t sample_histogram(iter_type _begin,
+                                         iter_type _end,
+                                         bin_iter_type _bins,
+                                         std::size_t _stride = 1,
+                                         int nthreads = 1
                 )
             {
 
-                if(nthreads == 1)
-                    return serial::fill_histogram(_begin, _end, _bins);
+                if(_stride < 1)
+                    _stride = 1;
 
                 if(nthreads <= 0)
                     nthreads = std::thread::hardware_concurrency();
 
                 typedef typename std::iterator_traits<iter_type>::value_type value_type;
 
-                using histo_t = typename dense_histo<value_type>::type;
-                histo_t histo(_bins,_bins + dense_histo<value_type>::size);
+                const std::size_t histo_size = dense_histo<value_type>::size;
+                const std::size_t len = std::distance(_begin,_end);
+                const std::size_t n_samples = (len + _stride - 1)/_stride;
+
+                //below one histogram worth of samples per thread, the merge costs more than the threads save
+                if(nthreads == 1 || n_samples < std::size_t(nthreads)*histo_size)
+                    return serial::sample_histogram(_begin, _end, _bins, _stride);
 
-                std::vector<histo_t> histo_clones(nthreads, histo);
-                auto histo_clones_itr = histo_clones.data();
-                const auto len = std::distance(_begin,_end);
-                const omp_size_type chunk_size = (len + nthreads - 1)/nthreads;
+                std::vector<std::uint32_t> histo_clones(nthreads*histo_size, 0);
+                std::uint32_t* histo_clones_itr = histo_clones.data();
+                const omp_size_type chunk_size = (n_samples + nthreads - 1)/nthreads;
 
 
                 //mapping the partitions of [_begin, _end) to histo_clones
 #pragma omp parallel                            \
     shared( histo_clones_itr )                  \
-    firstprivate( _begin, _end, chunk_size )    \
+    firstprivate( _begin, _stride, chunk_size ) \
     num_threads(nthreads)
                 {
-                    auto tid            = omp_get_thread_num();
-                    auto chunk_begin    = _begin + tid*chunk_size;
-                    auto chunk_end      = chunk_begin + chunk_size >= _end ? _end : chunk_begin + chunk_size;
-                    auto my_histo_itr   = &(*(histo_clones_itr+tid))[0];
+                    const std::size_t tid         = omp_get_thread_num();
+                    const std::size_t first       = (std::min)(tid*chunk_size, n_samples);
+                    const std::size_t last        = (std::min)(first + chunk_size, n_samples);
 
-                    for(;chunk_begin!=chunk_end;++chunk_begin)
-                        my_histo_itr[(std::uint32_t)*chunk_begin]++;
+                    if(first < last)
+                        serial::fill_banked_histogram(_begin + first*_stride,
+                                                      _begin + ((last - 1)*_stride + 1),
+                                                      histo_clones_itr + tid*histo_size,
+                                                      _stride);
 
                 }
 
-                const omp_size_type histo_len = histo.size();
-                const omp_size_type n_clones = histo_clones.size();
+                const std::size_t block_size = 4096;
+                const omp_size_type n_blocks = (histo_size + block_size - 1)/block_size;
+                const std::size_t n_clones = nthreads;
 
 #pragma omp parallel for                        \
     shared( _bins )                             \
-    firstprivate( histo_clones_itr, n_clones )  \
+    firstprivate( histo_clones_itr )            \
     num_threads(nthreads)
-            for(omp_size_type idx = 0;idx<histo_len;idx++){
-                for(omp_size_type clone = 0;clone<n_clones;++clone){
-                    *(_bins + idx) += (histo_clones_itr+clone)->data()[idx];
+                for(omp_size_type block = 0;block<n_blocks;block++){
+
+                    const std::size_t first = block*block_size;
+                    const std::size_t count = (std::min)(block_size, histo_size - first);
+
+                    for(std::size_t clone = 0;clone<n_clones;++clone)
+                        add_clone(_bins + first, histo_clones_itr + clone*histo_size + first, count,
+                                  contiguous_bins<bin_iter_type>());
                 }
 
+                return n_samples;
             }
 
-            return _bins + histo.size();
+            /**
+             *  \brief fill the histogram represented by _bins concurrently with the value counts/frequency observed in [_begin,_end); it is assumed that _bins yields a linear range of range(0,max_value(*_begin))
+             *
+             *  \param _begin input iterator pointing to element 0 of the values to histogram (const iterators allowed)
+             *  \param _end input iterator pointing to the last+1 element of the values to histogram (const iterators allowed)
+             *  \param _bins input iterator of the histogram bins (assumed to yield a linear range of range(0,max_value(*_begin)))
+             *  \param nthreads number of threads to use
+             *  \return void
+             */
+            template <typename iter_type, typename bin_iter_type>
+            bin_iter_type fill_histogram(iter_type _begin,
+                                iter_type _end,
+                                bin_iter_type _bins,
+                                int nthreads = 1
+                )
+            {
+
+                typedef typename std::iterator_traits<iter_type>::value_type value_type;
+
+                sample_histogram(_begin, _end, _bins, 1, nthreads);
+
+                return _bins + dense_histo<value_type>::size;
 
         }
 
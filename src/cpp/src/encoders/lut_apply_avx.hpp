@@ -0,0 +1,273 @@
+#ifndef _LUT_APPLY_AVX_H_
+#define _LUT_APPLY_AVX_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iostream>
+#include <climits>
+#include <vector>
+#include <type_traits>
+
+#include "compass.hpp"
+#include "sqeazy_common.hpp"
+#include "simd_dispatch.hpp"
+
+/*
+  the kernels in this file are compiled for AVX2 through function attributes, i.e. they don't require
+  -mavx2 or -march=native for the rest of the library; the kernel to use is chosen at runtime
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SQY_HAS_AVX_LUT_KERNELS 1
+#include <immintrin.h>
+#define SQY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SQY_HAS_AVX_LUT_KERNELS 0
+#define SQY_TARGET_AVX2
+#endif
+
+namespace sqeazy {
+
+  namespace detail {
+
+    /**
+       \brief kernels exist for 16-bit to 8-bit tables (quantiser encode) and 8-bit to 16-bit tables (quantiser
+       decode), the table must cover the full range of the input type; input items are used as unsigned indices,
+       so the signedness of from_type (e.g. char as the default quantiser output) does not matter
+    */
+    template <typename from_type, typename to_type>
+    struct lut_kernel_traits {
+
+      static const bool is_encode = sizeof(from_type) == 2 && sizeof(to_type) == 1;
+      static const bool is_decode = sizeof(from_type) == 1 && sizeof(to_type) == 2;
+      static const std::size_t lut_size = std::size_t(1) << (sizeof(from_type)*CHAR_BIT);
+
+    };
+
+    template <typename from_type, typename to_type>
+    static void scalar_apply_lut(const from_type* _input,
+                                 std::size_t _len,
+                                 to_type* _output,
+                                 const to_type* _lut){
+
+      typedef typename std::make_unsigned<from_type>::type index_type;
+
+      for(std::size_t i = 0;i<_len;++i)
+        _output[i] = _lut[static_cast<index_type>(_input[i])];
+    }
+
+#if SQY_HAS_AVX_LUT_KERNELS
+
+    /**
+       \brief look up 8 items of a table of _item_bytes wide items with one gather
+
+       a 32-bit gather at _lut + _index*_item_bytes reads up to 3 bytes beyond the item, so the last items of the
+       table are fetched from (_last_index) and shifted into place instead of reading past the end
+    */
+    template <int item_bytes>
+    SQY_TARGET_AVX2
+    static inline __m256i avx2_gather_lut_items(const void* _lut, __m256i _index, __m256i _last_index){
+
+      const __m256i mask = _mm256_set1_epi32(item_bytes == 1 ? 0xff : 0xffff);
+
+      const __m256i base = _mm256_min_epu32(_index, _last_index);
+      const __m256i shift = _mm256_slli_epi32(_mm256_sub_epi32(_index, base), item_bytes == 1 ? 3 : 4);
+      const __m256i items = _mm256_i32gather_epi32(static_cast<const int*>(_lut), base, item_bytes);
+
+      return _mm256_and_si256(_mm256_srlv_epi32(items, shift), mask);
+    }
+
+    /**
+       \brief 16-bit to 8-bit table (65536 items), 16 items per iteration with 2 gathers
+    */
+    SQY_TARGET_AVX2
+    static void avx2_apply_lut_16to8(const std::uint16_t* _input,
+                                     std::size_t _len,
+                                     std::uint8_t* _output,
+                                     const std::uint8_t* _lut){
+
+      const __m256i last_index = _mm256_set1_epi32((1 << 16) - 4);
+
+      std::size_t i = 0;
+      for(;i + 16 <= _len;i += 16){
+
+        const __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_input + i));
+
+        const __m256i lo = avx2_gather_lut_items<1>(_lut, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(raw)), last_index);
+        const __m256i hi = avx2_gather_lut_items<1>(_lut, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(raw,1)), last_index);
+
+        //[lo0-3 hi0-3 | lo4-7 hi4-7] -> [lo0-7 | hi0-7]
+        const __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+        const __m256i bytes = _mm256_packus_epi16(words, words);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(_output + i),
+                         _mm_unpacklo_epi64(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes,1)));
+      }
+
+      scalar_apply_lut(_input + i, _len - i, _output + i, _lut);
+    }
+
+    /**
+       \brief 8-bit to 16-bit table (256 items), 32 items per iteration
+
+       if all 32 input items are below 16 (i.e. the quantiser only used the first 16 levels), the lower and upper bytes
+       of the output are looked up with pshufb from 2 registers, otherwise 4 gathers are issued
+    */
+    SQY_TARGET_AVX2
+    static void avx2_apply_lut_8to16(const std::uint8_t* _input,
+                                     std::size_t _len,
+                                     std::uint16_t* _output,
+                                     const std::uint16_t* _lut){
+
+      const __m256i last_index = _mm256_set1_epi32(256 - 2);
+      const __m256i small_max = _mm256_set1_epi8(15);
+
+      alignas(32) std::uint8_t split[32];
+      for(int l = 0;l<16;++l){
+        split[l] = split[l+16] = _lut[l] & 0xff;
+      }
+      const __m256i lower_table = _mm256_load_si256(reinterpret_cast<const __m256i*>(split));
+      for(int l = 0;l<16;++l){
+        split[l] = split[l+16] = _lut[l] >> 8;
+      }
+      const __m256i upper_table = _mm256_load_si256(reinterpret_cast<const __m256i*>(split));
+
+      std::size_t i = 0;
+      for(;i + 32 <= _len;i += 32){
+
+        const __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_input + i));
+        __m256i first, second;
+
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(raw, small_max), small_max)) == -1){
+
+          const __m256i lower = _mm256_shuffle_epi8(lower_table, raw);
+          const __m256i upper = _mm256_shuffle_epi8(upper_table, raw);
+
+          //[0-7 | 16-23] and [8-15 | 24-31]
+          const __m256i a = _mm256_unpacklo_epi8(lower, upper);
+          const __m256i b = _mm256_unpackhi_epi8(lower, upper);
+
+          first = _mm256_permute2x128_si256(a, b, 0x20);
+          second = _mm256_permute2x128_si256(a, b, 0x31);
+        }
+        else{
+
+          const __m128i raw_lo = _mm256_castsi256_si128(raw);
+          const __m128i raw_hi = _mm256_extracti128_si256(raw,1);
+
+          const __m256i i0 = avx2_gather_lut_items<2>(_lut, _mm256_cvtepu8_epi32(raw_lo), last_index);
+          const __m256i i1 = avx2_gather_lut_items<2>(_lut, _mm256_cvtepu8_epi32(_mm_srli_si128(raw_lo,8)), last_index);
+          const __m256i i2 = avx2_gather_lut_items<2>(_lut, _mm256_cvtepu8_epi32(raw_hi), last_index);
+          const __m256i i3 = avx2_gather_lut_items<2>(_lut, _mm256_cvtepu8_epi32(_mm_srli_si128(raw_hi,8)), last_index);
+
+          first = _mm256_permute4x64_epi64(_mm256_packus_epi32(i0, i1), 0xD8);
+          second = _mm256_permute4x64_epi64(_mm256_packus_epi32(i2, i3), 0xD8);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output + i), first);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output + i + 16), second);
+      }
+
+      scalar_apply_lut(_input + i, _len - i, _output + i, _lut);
+    }
+
+#endif
+
+    template <typename from_type, typename to_type>
+    static bool avx2_apply_lut_available(){
+
+      typedef lut_kernel_traits<from_type, to_type> traits;
+
+      static const bool value = SQY_HAS_AVX_LUT_KERNELS &&
+        (traits::is_encode || traits::is_decode) &&
+        compass::runtime::has(compass::feature::avx2());
+
+      return value && simd::allows(simd::avx2);
+    }
+
+    /**
+       \brief name of the kernel apply_lut uses for from_type to to_type tables on this machine (for logging)
+    */
+    template <typename from_type, typename to_type>
+    static const char* apply_lut_kernel_name(){
+
+      return avx2_apply_lut_available<from_type, to_type>() ? "avx2" : "scalar";
+    }
+
+    template <typename from_type, typename to_type>
+    static void apply_lut_serial(const from_type* _input,
+                                 std::size_t _len,
+                                 to_type* _output,
+                                 const to_type* _lut){
+
+      typedef lut_kernel_traits<from_type, to_type> traits;
+
+#if SQY_HAS_AVX_LUT_KERNELS
+      if(avx2_apply_lut_available<from_type, to_type>()){
+        if(traits::is_encode){
+          avx2_apply_lut_16to8(reinterpret_cast<const std::uint16_t*>(_input), _len,
+                               reinterpret_cast<std::uint8_t*>(_output),
+                               reinterpret_cast<const std::uint8_t*>(_lut));
+          return;
+        }
+
+        if(traits::is_decode){
+          avx2_apply_lut_8to16(reinterpret_cast<const std::uint8_t*>(_input), _len,
+                               reinterpret_cast<std::uint16_t*>(_output),
+                               reinterpret_cast<const std::uint16_t*>(_lut));
+          return;
+        }
+      }
+#endif
+
+      scalar_apply_lut(_input, _len, _output, _lut);
+    }
+
+    /**
+       \brief _output[i] = _lut[_input[i]] for i in [0,_len), the input is split into one contiguous chunk per thread
+       and each chunk is handed to the fastest kernel available at runtime
+
+       \param[in] _lut table covering the full range of from_type
+    */
+    template <typename from_type, typename to_type>
+    static void apply_lut(const from_type* _input,
+                          std::size_t _len,
+                          to_type* _output,
+                          const std::vector<to_type>& _lut,
+                          int _nthreads = 1){
+
+      if(_lut.size() < lut_kernel_traits<from_type, to_type>::lut_size){
+        std::cerr << "[sqeazy::detail::apply_lut] received table with " << _lut.size() << " items, expected "
+                  << lut_kernel_traits<from_type, to_type>::lut_size << "\n";
+        return;
+      }
+
+      //keep chunks at a multiple of a cache line to avoid false sharing on _output
+      static const std::size_t granularity = 64;
+      const std::size_t n_chunks = (std::max)(1, _nthreads);
+      const std::size_t chunk = ((_len + n_chunks - 1)/n_chunks + granularity - 1)/granularity*granularity;
+
+      if(n_chunks == 1 || _len <= chunk){
+        apply_lut_serial(_input, _len, _output, _lut.data());
+        return;
+      }
+
+      const omp_size_type len = n_chunks;
+      const to_type* lut = _lut.data();
+
+#pragma omp parallel for                        \
+  shared(_output )                              \
+  firstprivate( len, _input, lut, chunk )       \
+  num_threads(_nthreads)
+      for(omp_size_type c = 0;c<len;c++){
+        const std::size_t first = c*chunk;
+        if(first < _len)
+          apply_lut_serial(_input + first, (std::min)(chunk, _len - first), _output + first, lut);
+      }
+    }
+
+  }
+
+}
+
+#endif /* _LUT_APPLY_AVX_H_ */
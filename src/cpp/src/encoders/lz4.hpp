@@ -14,10 +14,8 @@
 #include "header_utils.hpp"
 
 // TODO: what if lz4 is not available??
-#ifndef LZ4_VERSION_MAJOR
 #include "lz4_utils.hpp"
 #include "lz4frame.h"
-#endif
 
 
 namespace sqeazy
@@ -43,7 +41,8 @@ namespace sqeazy
     static const std::string description()
       {
         return std::string("compress input with lz4, <accel|default = 1> improves compression speed at the price of compression ratio, <blocksize_kb|default = 256> ... the lz4 blocksize in kByte (possible values: 64/265/1024/4048), <framestep_kb|default = 256 > ... the atomic amount of input data to submit to lz4 "
-                           "compression (required to be a multiple of the blocksize), <n_chunks_of_input|default = 0 > ... divide input data into n_encode_chunks partitions (consider each parition independent of the other for encoding; this overrides framestep_kb)");
+                           "compression (required to be a multiple of the blocksize), <n_chunks_of_input|default = 0 > ... divide input data into n_encode_chunks partitions (consider each parition independent of the other for encoding; this overrides framestep_kb); "
+                           "if encoded with more than 1 thread, the independent frames are indexed and decoded in parallel");
       };
 
     std::string lz4_config;
@@ -182,6 +181,7 @@ namespace sqeazy
           std::size_t maxoutbytes_per_thread = nchunks_per_thread * (LZ4F_compressBound(nbytes_per_chunk, &lz4_prefs) + LZ4F_HEADER_SIZE_MAX);
 
           value = maxoutbytes_per_thread * this->n_threads();
+          value += lz4::frame_index::size_in_bytes(nchunks);
         }
 
         return value;
@@ -235,7 +235,25 @@ namespace sqeazy
         }
         else
         {
-          value = lz4::encode_parallel(input, input_end, _out, _out_end, framestep_byte, lz4_prefs, nthreads);
+          // the frames are preceded by an index that allows to decode them concurrently
+          const std::size_t nframes = (bytes + framestep_byte - 1) / framestep_byte;
+          compressed_type *frames_begin = _out + (nframes > 1 ? lz4::frame_index::size_in_bytes(nframes) : 0);
+          std::vector<std::size_t> frame_bytes;
+
+          value = lz4::encode_parallel(input, input_end, frames_begin, _out_end, framestep_byte, lz4_prefs, nthreads, &frame_bytes);
+
+          if(value && nframes > 1)
+          {
+            lz4::frame_index index;
+            index.offsets.resize(frame_bytes.size(), 0);
+            index.decoded_bytes.resize(frame_bytes.size(), framestep_byte);
+            index.decoded_bytes.back() = bytes - (frame_bytes.size() - 1) * framestep_byte;
+
+            for(std::size_t f = 1; f < frame_bytes.size(); ++f)
+              index.offsets[f] = index.offsets[f - 1] + frame_bytes[f - 1];
+
+            index.write(_out);
+          }
         }
 
         return value;
@@ -257,8 +275,6 @@ namespace sqeazy
     int decode(const compressed_type *_in, raw_type *_out, std::size_t _inlen, std::size_t _outlen = 0) const override final
       {
 
-        int value = 1;  // failing
-
         if(!_outlen)
           _outlen = _inlen;
 
@@ -270,68 +286,17 @@ namespace sqeazy
 
         const std::size_t expected_bytes_decoded = _outlen * sizeof(raw_type);
 
-        // if(this->n_threads()==1){
-        LZ4F_dctx *dctx = nullptr;
-        LZ4F_frameInfo_t info;
-
-        std::size_t dstSize = std::distance(dst, dstEnd);
-        std::size_t srcSize = std::distance(src, srcEnd);
-        std::size_t ret = 1;
-        while(src < srcEnd)
-        {
-          /* INVARIANT: Any data left in dst has already been written */
-          dstSize = std::distance(dst, dstEnd);
-
-          if(dctx == nullptr)
-          {
-            ret = LZ4F_createDecompressionContext(&dctx, 100);
-            if(LZ4F_isError(ret))
-            {
-              std::cerr << "[sqy::lz4::decode] LZ4F_dctx creation error: " << LZ4F_getErrorName(ret) << "\n";
-              return value;
-            }
-          }
-
-          ret = LZ4F_getFrameInfo(dctx, &info, src, &srcSize);
-          if(LZ4F_isError(ret))
-          {
-            break;
-          }
-
-          src += srcSize;
-          srcSize = std::distance(src, srcEnd);
-
-          if(std::ptrdiff_t(info.contentSize) > std::distance(dst, dstEnd))
-          {
-            std::cerr << "[sqy::lz4::decode] decompressed input yields " << info.contentSize << " Bytes, only " << std::distance(dst, dstEnd) << " Bytes left in destination\n";
-            dst = reinterpret_cast<compressed_type *>(_out);
-            break;
-          }
-
-          ret = LZ4F_decompress(dctx, dst, &dstSize, src, &srcSize,
-                                /* LZ4F_decompressOptions_t */ NULL);
-          if(LZ4F_isError(ret))
-          {
-            std::cerr << "[sqy::lz4::decode] Decompression error: " << LZ4F_getErrorName(ret) << "\n";
-            dst = reinterpret_cast<compressed_type *>(_out);
-            break;
-          }
-
-          src += srcSize;
-          srcSize = std::distance(src, srcEnd);
-          dst += dstSize;
+        // payloads produced by encode_parallel carry an index of their frames
+        lz4::frame_index index;
+        const compressed_type *frames_begin = index.read(src, srcEnd);
 
-          // lz4 frame API thinks the decompression is over
-          if(ret == 0)
-          {
-            LZ4F_freeDecompressionContext(dctx);
-            dctx = nullptr;
-          }
-        }
-
-        //}
+        compressed_type *decoded_end = nullptr;
+        if(index.empty())
+          decoded_end = lz4::decode_serial(src, srcEnd, dst, dstEnd);
+        else
+          decoded_end = lz4::decode_parallel(frames_begin, srcEnd, index, dst, dstEnd, this->n_threads());
 
-        std::size_t num_bytes_decoded = std::distance(reinterpret_cast<compressed_type *>(_out), dst) * sizeof(compressed_type);
+        std::size_t num_bytes_decoded = std::distance(dst, decoded_end) * sizeof(compressed_type);
         if(num_bytes_decoded > 0 && num_bytes_decoded <= expected_bytes_decoded)
           return 0;
         else
@@ -4,9 +4,7 @@
 #include "sqeazy_common.hpp"
 #include "traits.hpp"
 
-#ifndef LZ4_VERSION_MAJOR
 #include "lz4frame.h"
-#endif
 
 #include <vector>
 #include <array>
@@ -197,7 +195,8 @@ namespace sqeazy {
                                          compressed_type* _out_end,
                                          std::size_t _nbytes_inputchunk,
                                          LZ4F_preferences_t& _lz4prefs,
-                                         int nthreads)  {
+                                         int nthreads,
+                                         std::vector<std::size_t>* _frame_bytes = nullptr)  {
 
             const std::size_t len = std::distance(_in,_in_end);
             const std::size_t bytes = len*sizeof(compressed_type);
@@ -206,12 +205,16 @@ namespace sqeazy {
 
             if(nchunks==1){
 
-                return encode_serial(_in,_in_end,
-                                     _out,_out_end,
-                                     _nbytes_inputchunk,
-                                     _lz4prefs
+                compressed_type* value = encode_serial(_in,_in_end,
+                                                       _out,_out_end,
+                                                       _nbytes_inputchunk,
+                                                       _lz4prefs
                     );
 
+                if(_frame_bytes)
+                    _frame_bytes->assign(1, value ? std::distance(_out,value) : 0);
+
+                return value;
             }
 
             std::vector<std::size_t> nbytes_written(nchunks,0);
@@ -270,10 +273,289 @@ namespace sqeazy {
 
             compressed_type* value = remove_blanks(_out,nbytes_written,maxbytes_encoded_chunk);
 
+            if(_frame_bytes)
+                _frame_bytes->swap(nbytes_written);
+
             return (value == (_out+total_bytes_written)) ? value : nullptr;
         }
 
 
+        /**
+           \brief index of the independent lz4 frames produced by encode_parallel
+
+           the index is stored as a lz4 skippable frame in front of the encoded frames, i.e. any lz4 frame decoder
+           that is unaware of it, will simply skip it; the layout is (all fields little endian):
+
+           [skippable magic:4][user data size:4][sqy tag:4][n_frames:4][n_frames x (offset:8, decoded bytes:8)]
+
+           offset is given in bytes relative to the end of the index, decoded bytes is the size of the frame after decompression
+        */
+        struct frame_index {
+
+            static constexpr std::uint32_t magic = 0x184D2A5AU;//LZ4F_MAGIC_SKIPPABLE_START + 0xA, see lz4 frame format
+            static constexpr std::uint32_t tag = 0x46595153U;//"SQYF"
+            static constexpr std::size_t head_bytes = 16;
+            static constexpr std::size_t entry_bytes = 16;
+
+            std::vector<std::uint64_t> offsets;
+            std::vector<std::uint64_t> decoded_bytes;
+
+            static std::size_t size_in_bytes(std::size_t _n_frames){
+                return head_bytes + _n_frames*entry_bytes;
+            }
+
+            std::size_t size() const { return offsets.size(); }
+            bool empty() const { return offsets.empty(); }
+
+            std::size_t size_in_bytes() const {
+                return size_in_bytes(offsets.size());
+            }
+
+            /**
+               \brief serialize index to _out, _out must be able to hold size_in_bytes() bytes
+
+               \return pointer to one past the last byte written
+            */
+            template <typename compressed_type>
+            compressed_type* write(compressed_type* _out) const {
+
+                static_assert(sizeof(compressed_type)==1, "[lz4::frame_index::write] received non-byte-size output");
+
+                std::uint8_t* dst = reinterpret_cast<std::uint8_t*>(_out);
+
+                dst = store(magic, dst);
+                dst = store(std::uint32_t(size_in_bytes() - 8), dst);
+                dst = store(tag, dst);
+                dst = store(std::uint32_t(offsets.size()), dst);
+
+                for(std::size_t i = 0;i<offsets.size();++i){
+                    dst = store(offsets[i], dst);
+                    dst = store(decoded_bytes[i], dst);
+                }
+
+                return reinterpret_cast<compressed_type*>(dst);
+            }
+
+            /**
+               \brief deserialize index from [_in, _in_end), the index is left empty if none is found
+
+               \return pointer to the first byte after the index (_in if no index was found)
+            */
+            template <typename compressed_type>
+            const compressed_type* read(const compressed_type* _in, const compressed_type* _in_end) {
+
+                static_assert(sizeof(compressed_type)==1, "[lz4::frame_index::read] received non-byte-size input");
+
+                offsets.clear();
+                decoded_bytes.clear();
+
+                const std::uint8_t* src = reinterpret_cast<const std::uint8_t*>(_in);
+                const std::size_t len = std::distance(_in, _in_end);
+
+                if(len < head_bytes || load<std::uint32_t>(src) != magic || load<std::uint32_t>(src+8) != tag)
+                    return _in;
+
+                const std::size_t n_frames = load<std::uint32_t>(src+12);
+                if(load<std::uint32_t>(src+4) != (size_in_bytes(n_frames) - 8) || len < size_in_bytes(n_frames))
+                    return _in;
+
+                offsets.resize(n_frames);
+                decoded_bytes.resize(n_frames);
+                src += head_bytes;
+
+                for(std::size_t i = 0;i<n_frames;++i,src+=entry_bytes){
+                    offsets[i] = load<std::uint64_t>(src);
+                    decoded_bytes[i] = load<std::uint64_t>(src+8);
+                }
+
+                return _in + size_in_bytes(n_frames);
+            }
+
+        private:
+
+            template <typename T>
+            static std::uint8_t* store(T _value, std::uint8_t* _dst){
+                for(std::size_t b = 0;b<sizeof(T);++b)
+                    *(_dst++) = std::uint8_t(_value >> (8*b));
+                return _dst;
+            }
+
+            template <typename T>
+            static T load(const std::uint8_t* _src){
+                T value = 0;
+                for(std::size_t b = 0;b<sizeof(T);++b)
+                    value |= T(_src[b]) << (8*b);
+                return value;
+            }
+
+        };
+
+        /**
+           \brief decompress all lz4 frames found in [_in, _in_end) one after another to _out
+
+           \return pointer to one past the last byte written to _out, _out if an error occurred
+        */
+        template <typename compressed_type>
+        compressed_type* decode_serial(const compressed_type* _in,
+                                       const compressed_type* _in_end,
+                                       compressed_type* _out,
+                                       compressed_type* _out_end)  {
+
+            compressed_type* dst = _out;
+            const compressed_type* src = _in;
+
+            LZ4F_dctx *dctx = nullptr;
+            LZ4F_frameInfo_t info;
+
+            std::size_t dstSize = std::distance(dst, _out_end);
+            std::size_t srcSize = std::distance(src, _in_end);
+            std::size_t ret = 1;
+            while(src < _in_end)
+            {
+                /* INVARIANT: Any data left in dst has already been written */
+                dstSize = std::distance(dst, _out_end);
+
+                if(dctx == nullptr)
+                {
+                    ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+                    if(LZ4F_isError(ret))
+                    {
+                        std::cerr << "[sqy::lz4::decode_serial] LZ4F_dctx creation error: " << LZ4F_getErrorName(ret) << "\n";
+                        return _out;
+                    }
+                }
+
+                ret = LZ4F_getFrameInfo(dctx, &info, src, &srcSize);
+                if(LZ4F_isError(ret))
+                {
+                    break;
+                }
+
+                src += srcSize;
+                srcSize = std::distance(src, _in_end);
+
+                if(std::ptrdiff_t(info.contentSize) > std::distance(dst, _out_end))
+                {
+                    std::cerr << "[sqy::lz4::decode_serial] decompressed input yields " << info.contentSize << " Bytes, only " << std::distance(dst, _out_end) << " Bytes left in destination\n";
+                    dst = _out;
+                    break;
+                }
+
+                ret = LZ4F_decompress(dctx, dst, &dstSize, src, &srcSize,
+                                      /* LZ4F_decompressOptions_t */ NULL);
+                if(LZ4F_isError(ret))
+                {
+                    std::cerr << "[sqy::lz4::decode_serial] Decompression error: " << LZ4F_getErrorName(ret) << "\n";
+                    dst = _out;
+                    break;
+                }
+
+                src += srcSize;
+                srcSize = std::distance(src, _in_end);
+                dst += dstSize;
+
+                // lz4 frame API thinks the decompression is over
+                if(ret == 0)
+                {
+                    LZ4F_freeDecompressionContext(dctx);
+                    dctx = nullptr;
+                }
+            }
+
+            if(dctx != nullptr)
+                LZ4F_freeDecompressionContext(dctx);
+
+            return dst;
+        }
+
+        /**
+           \brief decompress the frames listed in _index concurrently, each frame is decoded straight
+           to its final position inside _out
+
+           \param[in] _in first byte after the index (offsets in _index are relative to it)
+           \param[in] _in_end end of the encoded payload
+           \param[in] _index frame index that was extracted from the payload
+           \param[out] _out output buffer
+           \param[in] _out_end end of output buffer
+           \param[in] nthreads number of threads to use
+
+           \return pointer to one past the last byte written to _out, _out if an error occurred
+        */
+        template <typename compressed_type>
+        compressed_type* decode_parallel(const compressed_type* _in,
+                                         const compressed_type* _in_end,
+                                         const frame_index& _index,
+                                         compressed_type* _out,
+                                         compressed_type* _out_end,
+                                         int nthreads)  {
+
+            const omp_size_type n_frames = _index.size();
+            const std::size_t in_bytes = std::distance(_in, _in_end);
+            const std::size_t out_bytes = std::distance(_out, _out_end);
+
+            std::vector<std::size_t> dst_offsets(n_frames+1,0);
+            for(omp_size_type f = 0;f<n_frames;++f){
+
+                dst_offsets[f+1] = dst_offsets[f] + _index.decoded_bytes[f];
+
+                const std::uint64_t frame_end = (f+1) < n_frames ? _index.offsets[f+1] : in_bytes;
+                if(_index.offsets[f] >= frame_end || frame_end > in_bytes){
+                    std::cerr << "[sqy::lz4::decode_parallel] frame " << f << " exceeds the encoded input\n";
+                    return _out;
+                }
+            }
+
+            if(dst_offsets.back() > out_bytes){
+                std::cerr << "[sqy::lz4::decode_parallel] decompressed input yields " << dst_offsets.back() << " Bytes, only " << out_bytes << " Bytes available in destination\n";
+                return _out;
+            }
+
+            if(nthreads > n_frames)
+                nthreads = n_frames;
+
+            int n_failed = 0;
+            auto dst_offsets_ptr = dst_offsets.data();
+
+#pragma omp parallel for                        \
+  shared(_index)                                \
+  firstprivate(_in, _out, in_bytes, dst_offsets_ptr, n_frames) \
+  reduction(+:n_failed)                         \
+  schedule(dynamic)                             \
+  num_threads(nthreads)
+            for(omp_size_type f = 0;f<n_frames;++f){
+
+                LZ4F_dctx *dctx = nullptr;
+                std::size_t ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+                if(LZ4F_isError(ret)){
+                    n_failed++;
+                    continue;
+                }
+
+                const std::size_t frame_end = (f+1) < n_frames ? _index.offsets[f+1] : in_bytes;
+                std::size_t srcSize = frame_end - _index.offsets[f];
+                std::size_t dstSize = _index.decoded_bytes[f];
+
+                ret = LZ4F_decompress(dctx,
+                                      _out + dst_offsets_ptr[f], &dstSize,
+                                      _in + _index.offsets[f], &srcSize,
+                                      /* LZ4F_decompressOptions_t */ NULL);
+
+                if(LZ4F_isError(ret) || ret != 0 || dstSize != _index.decoded_bytes[f]){
+                    n_failed++;
+                }
+
+                LZ4F_freeDecompressionContext(dctx);
+            }
+
+            if(n_failed){
+                std::cerr << "[sqy::lz4::decode_parallel] unable to decompress " << n_failed << "/" << n_frames << " frames\n";
+                return _out;
+            }
+
+            return _out + dst_offsets.back();
+        }
+
+
     }  // lz4
 }
 
@@ -10,6 +10,7 @@
 #include <array>
 #include <utility>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <fstream>
 #include <iomanip>
@@ -62,14 +63,38 @@ namespace sqeazy {
     parsed_map_t  config_map;
 
     quantiser<raw_type, compressed_type> shrinker;
-    static const std::string description() { return std::string("scalar histogram-based quantisation for conversion uint16->uint8; <decode_lut_path> : the lut will be taken from there (for decoding) or written there (for encoding); <decode_lut_string> : decode LUT will be taken from the argument value (for decoding) or written there (for encoding); <weighting_function>=(none, power_of_<enumerator>_<denominator> : apply power-law pow(x,<enumerator>/<denominator>) to histogram weights, offset_power_of_<enumerator>_<denominator> : apply power-law pow(x,<enumerator>/<denominator>) to histogram weights starting at first non-zero bin index) ");
+
+    //LUT reuse across encode calls, disabled if negative
+    float lut_drift;
+    std::string encode_lut_path;
+    bool encode_lut_loaded;
+    std::size_t n_lut_builds;
+
+    //bits per encoded item, the output is bit-packed if this is less than the width of compressed_type
+    int n_bits;
+
+    //number of items quantised and (un)packed per block
+    static const std::size_t packing_block = 1 << 13;
+
+    //a bit-packed output starts with the number of items it holds (std::uint64_t), the padding bits of the
+    //last byte would make any count derived from the size of the packed data ambiguous
+    static const std::size_t packed_header_bytes = sizeof(std::uint64_t);
+
+    typedef typename std::make_unsigned<compressed_type>::type level_type;
+
+    static const std::string description() { return std::string("scalar histogram-based quantisation for conversion uint16->uint8; <decode_lut_path> : the lut will be taken from there (for decoding) or written there (for encoding); <decode_lut_string> : decode LUT will be taken from the argument value (for decoding) or written there (for encoding); <weighting_function>=(none, power_of_<enumerator>_<denominator> : apply power-law pow(x,<enumerator>/<denominator>) to histogram weights, offset_power_of_<enumerator>_<denominator> : apply power-law pow(x,<enumerator>/<denominator>) to histogram weights starting at first non-zero bin index); <lut_drift>=(0..1) : reuse the LUT of the previous encode call (or of encode_lut_path) as long as the level occupancy of a sample of the input deviates by at most this fraction (total variation distance); <encode_lut_path> : encode LUT shared across files, taken from there if present (and used as is unless lut_drift is given) and written there when rebuilt; <n_bits>=(1..8) : quantise to 2^n_bits levels and bit-pack the output ");
     };
 
     quantiser_scheme(const std::string &_payload = ""):
       quantiser_config(_payload),
       weighting_string("none"),
       config_map(),
-      shrinker()
+      shrinker(),
+      lut_drift(-1),
+      encode_lut_path(""),
+      encode_lut_loaded(false),
+      n_lut_builds(0),
+      n_bits(sizeof(compressed_type)*CHAR_BIT)
     {
 
       pipeline_parser p;
@@ -80,6 +105,30 @@ namespace sqeazy {
       if(fitr != config_map.end())
         weighting_string = fitr->second;
 
+      fitr = config_map.find("lut_drift");
+      if(fitr != config_map.end())
+        lut_drift = std::stof(fitr->second);
+
+      fitr = config_map.find("encode_lut_path");
+      if(fitr != config_map.end()){
+        encode_lut_path = fitr->second;
+        //a shared LUT is used as is, unless a drift limit was given
+        if(lut_drift < 0)
+          lut_drift = 1;
+      }
+
+      fitr = config_map.find("n_bits");
+      if(fitr != config_map.end()){
+        const int max_bits = sizeof(compressed_type)*CHAR_BIT;
+        n_bits = std::stoi(fitr->second);
+        if(n_bits < 1 || n_bits > max_bits){
+          std::cerr << "[quantiser_scheme] n_bits=" << fitr->second << " out of range [1," << max_bits
+                    << "], using " << max_bits << "\n";
+          n_bits = max_bits;
+        }
+        shrinker.set_n_bits(n_bits);
+      }
+
       fitr = config_map.find("decode_lut_path");
       if(fitr != config_map.end())
         shrinker.lut_from_file(fitr->second, shrinker.lut_decode_);
@@ -132,7 +181,8 @@ namespace sqeazy {
 
       std::intmax_t payload_size = _size_bytes*sizeof(raw_type)/sizeof(compressed_type);
       std::intmax_t lut_size = shrinker.lut_decode_.size()*sizeof(raw_type);
-      return payload_size+lut_size;
+      std::intmax_t header_size = is_packed() ? packed_header_bytes : 0;
+      return payload_size+lut_size+header_size;
 
     }
 
@@ -182,19 +232,34 @@ namespace sqeazy {
       const raw_type* in_begin = _in;
       const raw_type* in_end = _in + _length;
 
-      //TODO: this is atrocious, refactor this if-else-hell
-      if(weighting_string.find("none")!=std::string::npos)
-        shrinker.setup_com(in_begin, in_end);
-      else{
-        auto ratio = sqeazy::extract_ratio(weighting_string);
-        if(weighting_string.find("offset")!=std::string::npos){
-          sqeazy::weighters::offset_power_of w(ratio.first,ratio.second);
-          shrinker.setup_com(in_begin, in_end,w);
-        } else {
-          sqeazy::weighters::power_of w(ratio.first,ratio.second);
-          shrinker.setup_com(in_begin, in_end,w);
+      shrinker.set_n_threads(this->n_threads());
+
+      if(!reuse_lut(in_begin, in_end)){
+
+        shrinker.reset();
+
+        //TODO: this is atrocious, refactor this if-else-hell
+        if(weighting_string.find("none")!=std::string::npos)
+          shrinker.setup_com(in_begin, in_end);
+        else{
+          auto ratio = sqeazy::extract_ratio(weighting_string);
+          if(weighting_string.find("offset")!=std::string::npos){
+            sqeazy::weighters::offset_power_of w(ratio.first,ratio.second);
+            shrinker.setup_com(in_begin, in_end,w);
+          } else {
+            sqeazy::weighters::power_of w(ratio.first,ratio.second);
+            shrinker.setup_com(in_begin, in_end,w);
+          }
+
         }
 
+        ++n_lut_builds;
+
+        if(lut_drift >= 0){
+          shrinker.compute_reference_levels();
+          if(!encode_lut_path.empty())
+            shrinker.lut_state_to_file(encode_lut_path);
+        }
       }
 
       auto fitr = config_map.find("decode_lut_path");
@@ -203,28 +268,72 @@ namespace sqeazy {
       else
         config_map["decode_lut_string"] = shrinker.lut_to_string(shrinker.lut_decode_);
 
-      applyLUT<raw_type, compressed_type> lutApplyer(shrinker.lut_encode_);
-      compressed_type* out_end = nullptr;
+      if(!is_packed()){
+        detail::apply_lut(_in, _length, _out, shrinker.lut_encode_, this->n_threads());
+        return _out + _length;
+      }
+
+      //quantise a block into a buffer on the stack and pack it to its final position, blocks hold a multiple of
+      //8 items so that every block starts at a byte boundary
+      const std::uint64_t n_items = _length;
+      std::memcpy(_out, &n_items, packed_header_bytes);
 
-      if(this->n_threads()==1)
-        out_end = std::transform(_in,_in+_length,_out,lutApplyer);
-      else{
-        const omp_size_type len = _length;
-        const omp_size_type nthreads = this->n_threads();
+      std::uint8_t* packed = reinterpret_cast<std::uint8_t*>(_out) + packed_header_bytes;
+      const level_type* lut = reinterpret_cast<const level_type*>(shrinker.lut_encode_.data());
+      const int bits = n_bits;
+      const omp_size_type n_blocks = (_length + packing_block - 1)/packing_block;
+      const omp_size_type nthreads = this->n_threads();
 
 #pragma omp parallel for                        \
-  shared(_out )                              \
-  firstprivate( len, _in, lutApplyer )       \
+  shared(packed )                               \
+  firstprivate( n_blocks, _in, lut, bits )      \
   num_threads(nthreads)
-        for(omp_size_type idx = 0;idx<len;idx++){
-          _out[idx] = lutApplyer(_in[idx]);
-        }
-        out_end = _out + len;
+      for(omp_size_type b = 0;b<n_blocks;b++){
+        level_type levels[packing_block];
+        const std::size_t first = b*packing_block;
+        const std::size_t count = (std::min)(std::size_t(packing_block), _length - first);
+
+        detail::apply_lut_serial(_in + first, count, levels, lut);
+        detail::pack_levels(levels, count, bits, packed + first*bits/CHAR_BIT);
       }
 
-      return out_end;
+      return _out + (packed_header_bytes + packed_bytes(_length) + sizeof(compressed_type) - 1)/sizeof(compressed_type);
     }
 
+    bool is_packed() const {
+      return n_bits < int(sizeof(compressed_type)*CHAR_BIT);
+    }
+
+    /**
+       \brief number of bytes _n_items quantised items occupy in the output
+    */
+    std::size_t packed_bytes(std::size_t _n_items) const {
+      return (_n_items*n_bits + CHAR_BIT - 1)/CHAR_BIT;
+    }
+
+
+    /**
+       \brief check if the LUT of the last encode call (or the one stored at encode_lut_path) can be used for
+       [_begin,_end) again, this only samples the input
+
+       \return true if the LUT can be reused
+    */
+    bool reuse_lut(const raw_type* _begin, const raw_type* _end) {
+
+      if(lut_drift < 0)
+        return false;
+
+      if(!encode_lut_loaded && !encode_lut_path.empty()){
+        encode_lut_loaded = true;
+        if(shrinker.lut_state_from_file(encode_lut_path) != 0)
+          shrinker.reset();
+      }
+
+      if(shrinker.reference_levels_.empty())
+        return false;
+
+      return shrinker.level_drift(_begin, _end) <= lut_drift;
+    }
 
     int decode( const compressed_type* _in,
                 raw_type* _out,
@@ -247,6 +356,9 @@ namespace sqeazy {
                 std::size_t _outlength = 0) const override final {
 
 
+      if(is_packed())
+        return decode_packed(_in, _out, _inlength, _outlength);
+
       if(!_outlength)
         _outlength = _inlength;
 
@@ -255,30 +367,59 @@ namespace sqeazy {
         size = (std::min)(_outlength,_inlength);
       }
 
-      applyLUT<compressed_type, raw_type> lutApplyer(shrinker.lut_decode_);
-      auto begin = _in;
-      auto end   = _in+size;
-      raw_type* end_ptr = nullptr;
+      detail::apply_lut(_in, size, _out, shrinker.lut_decode_, this->n_threads());
+      return size - _outlength;
+    }
 
-      if(this->n_threads()==1)
-        end_ptr = std::transform(begin, end,
-                                      _out,
-                                      lutApplyer);
-      else{
-        const omp_size_type len = size;
-        const omp_size_type nthreads = this->n_threads();
+    /**
+       \brief decode bit-packed input, the number of items is taken from the front of _in; if _outlength is given,
+       it has to match that number
+    */
+    int decode_packed( const compressed_type* _in, raw_type* _out,
+                       std::size_t _inlength,
+                       std::size_t _outlength = 0) const {
+
+      const std::size_t in_bytes = _inlength*sizeof(compressed_type);
+      if(in_bytes < packed_header_bytes){
+        std::cerr << "[quantiser_scheme::decode] received " << in_bytes << " Bytes, too few to hold the item count\n";
+        return 1;
+      }
+
+      std::uint64_t n_items = 0;
+      std::memcpy(&n_items, _in, packed_header_bytes);
+
+      if(_outlength && _outlength != n_items){
+        std::cerr << "[quantiser_scheme::decode] input holds " << n_items << " items, expected " << _outlength << "\n";
+        return 1;
+      }
+      _outlength = n_items;
+
+      if(in_bytes - packed_header_bytes < packed_bytes(_outlength)){
+        std::cerr << "[quantiser_scheme::decode] received " << in_bytes - packed_header_bytes
+                  << " Bytes, expected " << packed_bytes(_outlength) << " Bytes of " << n_bits << "-bit items\n";
+        return 1;
+      }
+
+      const std::uint8_t* packed = reinterpret_cast<const std::uint8_t*>(_in) + packed_header_bytes;
+      const raw_type* lut = shrinker.lut_decode_.data();
+      const int bits = n_bits;
+      const omp_size_type n_blocks = (_outlength + packing_block - 1)/packing_block;
+      const omp_size_type nthreads = this->n_threads();
 
 #pragma omp parallel for                        \
-  shared(_out )                              \
-  firstprivate( len, _in, lutApplyer )       \
+  shared(_out )                                 \
+  firstprivate( n_blocks, packed, lut, bits )   \
   num_threads(nthreads)
-        for(omp_size_type idx = 0;idx<len;idx++){
-          _out[idx] = lutApplyer(_in[idx]);
-        }
-        end_ptr = _out + len;
+      for(omp_size_type b = 0;b<n_blocks;b++){
+        level_type levels[packing_block];
+        const std::size_t first = b*packing_block;
+        const std::size_t count = (std::min)(std::size_t(packing_block), _outlength - first);
+
+        detail::unpack_levels(packed + first*bits/CHAR_BIT, count, bits, levels);
+        detail::apply_lut_serial(levels, count, _out + first, lut);
       }
 
-      return (end_ptr - _out) - _outlength;
+      return 0;
     }
 
     void dump(const std::string& _fname){
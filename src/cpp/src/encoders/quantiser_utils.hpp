@@ -10,14 +10,18 @@
 #include <limits>
 #include <cstdint>
 #include <type_traits>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
+#include <random>
+#include <sstream>
 
 #include "traits.hpp"
 #include "string_parsers.hpp"
 #include "sqeazy_common.hpp"
 #include "header_utils.hpp"
 #include "histogram_utils.hpp"
+#include "lut_apply_avx.hpp"
 
 #include "quantiser_weighters.hpp"
 
@@ -41,6 +45,68 @@ namespace sqeazy {
 
   };
 
+  namespace detail {
+
+    /**
+       \brief pack the lower _n_bits of every item in [_input,_input+_len) into consecutive bits of _output,
+       LSB first; items must be smaller than 2^_n_bits
+
+       \return pointer to one past the last byte written, i.e. _output + ceil(_len*_n_bits/8)
+    */
+    template <typename level_type>
+    static std::uint8_t* pack_levels(const level_type* _input,
+                                     std::size_t _len,
+                                     int _n_bits,
+                                     std::uint8_t* _output){
+
+      std::uint64_t bits = 0;
+      int filled = 0;
+
+      for(std::size_t i = 0;i<_len;++i){
+        bits |= std::uint64_t(static_cast<typename std::make_unsigned<level_type>::type>(_input[i])) << filled;
+        filled += _n_bits;
+
+        for(;filled >= 8;filled -= 8){
+          *(_output++) = static_cast<std::uint8_t>(bits);
+          bits >>= 8;
+        }
+      }
+
+      if(filled)
+        *(_output++) = static_cast<std::uint8_t>(bits);
+
+      return _output;
+    }
+
+    /**
+       \brief inverse of pack_levels, reads ceil(_len*_n_bits/8) bytes from _input
+
+       \return pointer to one past the last byte read
+    */
+    template <typename level_type>
+    static const std::uint8_t* unpack_levels(const std::uint8_t* _input,
+                                             std::size_t _len,
+                                             int _n_bits,
+                                             level_type* _output){
+
+      const std::uint64_t mask = (std::uint64_t(1) << _n_bits) - 1;
+      std::uint64_t bits = 0;
+      int available = 0;
+
+      for(std::size_t i = 0;i<_len;++i){
+        for(;available < _n_bits;available += 8)
+          bits |= std::uint64_t(*(_input++)) << available;
+
+        _output[i] = static_cast<level_type>(bits & mask);
+        bits >>= _n_bits;
+        available -= _n_bits;
+      }
+
+      return _input;
+    }
+
+  }
+
   //all is public for now
   template<typename raw_type,typename compressed_type >
   struct quantiser
@@ -69,11 +135,19 @@ namespace sqeazy {
     typedef std::vector<raw_type> lut_decode_t; //max_compressed_
     typedef compressed_type compressed_t;
     typedef raw_type raw_t;
+    typedef typename std::make_unsigned<raw_type>::type raw_index_t;
+    typedef typename std::make_unsigned<compressed_type>::type level_index_t;
 
     lut_encode_t lut_encode_;
     lut_decode_t lut_decode_;
     int nthreads_;
 
+    //number of compressed levels the LUT may use (<= max_compressed_), lut_decode_ keeps max_compressed_ items
+    size_t n_levels_;
+
+    //fraction of pixels per compressed level in the data the LUT was built from (empty if there is none)
+    std::vector<float>           reference_levels_;// max_compressed_
+
     template <typename weight_functor_t = weighters::none>
     quantiser(const raw_type* _begin = 0,
               const raw_type* _end = 0,
@@ -86,7 +160,9 @@ namespace sqeazy {
       importance_(max_raw_,0.f),
       lut_encode_(max_raw_,compressed_type(0)),
       lut_decode_(max_compressed_,raw_type(0)),
-      nthreads_(_nt)
+      nthreads_(_nt),
+      n_levels_(max_compressed_),
+      reference_levels_()
       {
 
         reset();
@@ -105,6 +181,7 @@ namespace sqeazy {
       std::fill(importance_.begin(),importance_.end(),0.);
       std::fill(lut_encode_.begin(),lut_encode_.end(),0);
       std::fill(lut_decode_.begin(),lut_decode_.end(),0);
+      reference_levels_.clear();
 
     }
 
@@ -177,7 +254,7 @@ namespace sqeazy {
       else
         importanceSum = std::accumulate(importance_.begin(),importance_.end(),0.);
 
-      size_t levels_available = max_compressed_;//-1 one because we are assuming to use 0 already
+      size_t levels_available = n_levels_;//-1 one because we are assuming to use 0 already
       float bucketSize = importanceSum/levels_available;
 
       float importanceIntegral = importance_.front();
@@ -189,7 +266,7 @@ namespace sqeazy {
       for(uint32_t raw_idx = 1;raw_idx<quantiser::max_raw_;++raw_idx){
 
         //bucket overflow
-        if(quantile_sum >= bucketSize && comp_idx<(max_compressed_-1)){
+        if(quantile_sum >= bucketSize && comp_idx<(n_levels_-1)){
 
           //FIXME: using std::array::at is expected to harm performance
           lut_decode_.at(comp_idx) = static_cast<raw_type>(index_max_importance);
@@ -234,7 +311,7 @@ namespace sqeazy {
       else
         importanceSum = std::accumulate(importance_.begin(),importance_.end(),0.);
 
-      size_t levels_available = max_compressed_;//-1 one because we are assuming to use 0 already
+      size_t levels_available = n_levels_;//-1 one because we are assuming to use 0 already
       float bucketSize = importanceSum/levels_available;
 
       float importanceIntegral = importance_.front();
@@ -246,7 +323,7 @@ namespace sqeazy {
       for(uint32_t raw_idx = 1;raw_idx<quantiser::max_raw_;++raw_idx){
 
         //bucket overflow
-        if(quantile_sum >= bucketSize && (comp_idx<lut_decode_.size()-1)){
+        if(quantile_sum >= bucketSize && (comp_idx<n_levels_-1)){
 
           //FIXME: using std::array::at is expected to harm performance
           lut_decode_.at(comp_idx) = static_cast<raw_type>(index_weighted_mean_importance);
@@ -286,7 +363,7 @@ namespace sqeazy {
     void linear_mapping_quantisation(){
       uint32_t comp_idx = 0;
 
-      for(uint32_t raw_idx = 0;raw_idx < max_raw_ && comp_idx < lut_decode_.size();++raw_idx){
+      for(uint32_t raw_idx = 0;raw_idx < max_raw_ && comp_idx < n_levels_;++raw_idx){
 
         lut_encode_[raw_idx] = static_cast<compressed_type>(comp_idx);
         lut_decode_[comp_idx] = static_cast<raw_type>(raw_idx);
@@ -296,11 +373,11 @@ namespace sqeazy {
 
       }
 
-      if(comp_idx < lut_decode_.size() &&
+      if(comp_idx < n_levels_ &&
          comp_idx > 0 &&
          lut_decode_[comp_idx] == (std::numeric_limits<raw_type>::max)()
         ){
-        std::fill(lut_decode_.begin()+comp_idx, lut_decode_.end(),lut_decode_[comp_idx-1]);
+        std::fill(lut_decode_.begin()+comp_idx, lut_decode_.begin()+n_levels_,lut_decode_[comp_idx-1]);
       }
 
     }
@@ -336,7 +413,7 @@ namespace sqeazy {
                                          }
         );
 
-      if(n_levels <= max_compressed_)
+      if(n_levels <= n_levels_)
         linear_mapping_quantisation();
       else
         // adaptive_lloyd_max(importanceSum);
@@ -409,7 +486,7 @@ namespace sqeazy {
         );
 
       //compute the LUT
-      if(n_levels <= max_compressed_)
+      if(n_levels <= n_levels_)
         linear_mapping_quantisation();
       else
         adaptive_lloyd_com(importanceSum);
@@ -446,41 +523,13 @@ namespace sqeazy {
 
       setup_com(_input,_input + _in_nelems);
 
-      applyLUT<raw_type, compressed_type> lutApplyer(lut_encode_);
-
-      if(n_threads()==1)
-        std::transform(_input,_input+_in_nelems,_output,lutApplyer);
-      else{
-        const omp_size_type len = _in_nelems;
-
-#pragma omp parallel for                        \
-  shared(_output )                              \
-  firstprivate( len, _input, lutApplyer )       \
-  num_threads(nthreads_)
-        for(omp_size_type idx = 0;idx<len;idx++){
-          _output[idx] = lutApplyer(_input[idx]);
-        }
-      }
+      detail::apply_lut(_input, _in_nelems, _output, lut_encode_, nthreads_);
 
     }
 
     void decode(const compressed_type* _input, const size_t& _in_nelems, raw_type* _output){
 
-      applyLUT<compressed_type, raw_type> lutApplyer(lut_decode_);
-
-      if(n_threads()==1)
-        std::transform(_input,_input+_in_nelems,_output,lutApplyer);
-      else{
-        const omp_size_type len = _in_nelems;
-
-#pragma omp parallel for                        \
-  shared(_output )                       \
-  firstprivate( len, _input, lutApplyer )           \
-  num_threads(nthreads_)
-        for(omp_size_type idx = 0;idx<len;idx++){
-          _output[idx] = lutApplyer(_input[idx]);
-        }
-      }
+      detail::apply_lut(_input, _in_nelems, _output, lut_decode_, nthreads_);
 
 
     }
@@ -561,21 +610,7 @@ namespace sqeazy {
         return;
       }
 
-      applyLUT<compressed_type, raw_type> lutApplyer(loaded_lut_decode_);
-
-      if(n_threads()==1)
-        std::transform(_input,_input+_in_nelems,_output,lutApplyer);
-      else{
-        const omp_size_type len = _in_nelems;
-
-#pragma omp parallel for                        \
-  shared(_output )                              \
-  firstprivate( len, _input, lutApplyer )       \
-  num_threads(nthreads_)
-        for(omp_size_type idx = 0;idx<len;idx++){
-          _output[idx] = lutApplyer(_input[idx]);
-        }
-      }
+      detail::apply_lut(_input, _in_nelems, _output, loaded_lut_decode_, nthreads_);
       // std::transform(_input,_input+_in_nelems,_output,lutApplyer);
 
     }
@@ -604,27 +639,210 @@ namespace sqeazy {
         return;
       }
 
-      applyLUT<compressed_type, raw_type> lutApplyer(_lut_decode);
-      if(n_threads()==1)
-        std::transform(_input,_input+_in_nelems,_output,lutApplyer);
-      else{
-        const omp_size_type len = _in_nelems;
+      detail::apply_lut(_input, _in_nelems, _output, _lut_decode, nthreads_);
 
-#pragma omp parallel for                        \
-  shared(_output )                              \
-  firstprivate( len, _input, lutApplyer )       \
-  num_threads(nthreads_)
-        for(omp_size_type idx = 0;idx<len;idx++){
-          _output[idx] = lutApplyer(_input[idx]);
-        }
-      }// std::transform(_input,_input+_in_nelems,_output,lutApplyer);
+    }
+
+    /**
+       \brief remember how the histogram of the data the LUT was just built from distributes over the
+       compressed levels, this is the reference for level_drift
+    */
+    void compute_reference_levels(){
 
+      reference_levels_.assign(max_compressed_,0.f);
+      if(!sum_)
+        return;
+
+      for(std::size_t raw_idx = 0;raw_idx<max_raw_;++raw_idx)
+        reference_levels_[level_index_t(lut_encode_[raw_idx])] += histo_[raw_idx];
+
+      for(float& level : reference_levels_)
+        level /= sum_;
+    }
+
+    /**
+       \brief cheap estimate how much the data in [_begin,_end) has drifted from the data the current LUT was
+       built from: at most _max_samples equidistant pixels are mapped through the encode LUT and the total
+       variation distance of the resulting level occupancy to the reference is returned
+
+       \return value in [0,1], 0 if the levels are occupied exactly as in the reference, 1 if there is no
+       reference LUT
+    */
+    float level_drift(const raw_type* _begin, const raw_type* _end,
+                      std::size_t _max_samples = 1 << 16) const {
+
+      const std::size_t len = _end - _begin;
+      if(reference_levels_.size() != max_compressed_ || !len)
+        return 1.f;
+
+      const std::size_t stride = (len + _max_samples - 1)/_max_samples;
+      std::vector<std::uint32_t> counts(max_compressed_,0);
+      std::size_t n_samples = 0;
+
+      for(const raw_type* itr = _begin;itr < _end;itr += stride, ++n_samples)
+        counts[level_index_t(lut_encode_[raw_index_t(*itr)])]++;
+
+      float value = 0;
+      for(std::size_t level = 0;level<max_compressed_;++level)
+        value += std::abs(float(counts[level])/n_samples - reference_levels_[level]);
+
+      return value/2;
+    }
+
+    /**
+       \brief write everything needed to encode with the current LUT again (decode LUT, encode LUT as runs of
+       equal levels and the reference level occupancy) to _path
+
+       \return 0 on success, 1 otherwise
+    */
+    int lut_state_to_file(const std::string& _path) const {
+
+      //several encoders may share _path, so the LUT goes to a file of its own next to _path first
+      //which then replaces _path in one step, readers see either the old or the new LUT but never a partial one
+      std::ostringstream tmp_name;
+      tmp_name << _path << ".tmp" << std::hex << std::random_device()();
+      const std::string tmp_path = tmp_name.str();
+
+      std::ofstream lutf(tmp_path,std::ios::out|std::ios::trunc);
+      if(!lutf.good()){
+        std::cerr << "[sqeazy::quantiser] unable to open " << tmp_path << " for writing\n";
+        return 1;
+      }
+
+      lutf << "sqy_quantiser_lut " << sizeof(raw_type)*CHAR_BIT << " " << sizeof(compressed_type)*CHAR_BIT << "\n";
+
+      lutf << "decode " << lut_decode_.size() << "\n";
+      for(auto& el : lut_decode_)
+        lutf << +raw_index_t(el) << "\n";
+
+      lutf << "levels " << reference_levels_.size() << "\n";
+      lutf << std::setprecision(9);
+      for(auto& el : reference_levels_)
+        lutf << el << "\n";
+
+      std::vector<std::uint32_t> run_starts;
+      for(std::uint32_t raw_idx = 0;raw_idx<max_raw_;++raw_idx)
+        if(!raw_idx || lut_encode_[raw_idx] != lut_encode_[raw_idx-1])
+          run_starts.push_back(raw_idx);
+
+      lutf << "encode_runs " << run_starts.size() << "\n";
+      for(auto& start : run_starts)
+        lutf << start << " " << +level_index_t(lut_encode_[start]) << "\n";
+
+      lutf.close();
+      if(lutf.fail()){
+        std::cerr << "[sqeazy::quantiser] unable to write " << tmp_path << "\n";
+        std::remove(tmp_path.c_str());
+        return 1;
+      }
+
+#ifdef _WIN32
+      //rename does not replace an existing file on windows
+      std::remove(_path.c_str());
+#endif
+      if(std::rename(tmp_path.c_str(), _path.c_str()) != 0){
+        std::cerr << "[sqeazy::quantiser] unable to move " << tmp_path << " to " << _path << "\n";
+        std::remove(tmp_path.c_str());
+        return 1;
+      }
+
+      return 0;
+    }
+
+    /**
+       \brief load a LUT written by lut_state_to_file, the quantiser is left untouched if that fails
+
+       \return 0 on success, 1 otherwise
+    */
+    int lut_state_from_file(const std::string& _path){
+
+      std::ifstream lutf(_path,std::ios::in);
+      if(!lutf.good())
+        return 1;
+
+      std::string tag;
+      std::size_t raw_bits = 0, compressed_bits = 0, count = 0;
+
+      lutf >> tag >> raw_bits >> compressed_bits;
+      if(tag != "sqy_quantiser_lut" || raw_bits != sizeof(raw_type)*CHAR_BIT ||
+         compressed_bits != sizeof(compressed_type)*CHAR_BIT){
+        std::cerr << "[sqeazy::quantiser] " << _path << " does not contain a LUT for "
+                  << sizeof(raw_type)*CHAR_BIT << " -> " << sizeof(compressed_type)*CHAR_BIT << " bit\n";
+        return 1;
+      }
+
+      lut_decode_t decode(max_compressed_,0);
+      std::vector<float> levels(max_compressed_,0.f);
+      lut_encode_t encode(max_raw_,0);
+      std::uint64_t value = 0;
+
+      lutf >> tag >> count;
+      if(tag != "decode" || count != max_compressed_)
+        return 1;
+      for(auto& el : decode){
+        lutf >> value;
+        el = static_cast<raw_type>(value);
+      }
+
+      lutf >> tag >> count;
+      if(tag != "levels" || count != max_compressed_)
+        return 1;
+      for(auto& el : levels)
+        lutf >> el;
+
+      lutf >> tag >> count;
+      if(tag != "encode_runs" || count == 0 || count > max_raw_)
+        return 1;
+
+      std::uint64_t start = 0, level = 0, next_start = 0, next_level = 0;
+      lutf >> start >> level;
+      if(start != 0){
+        std::cerr << "[sqeazy::quantiser] " << _path << " does not cover the raw values below " << start << "\n";
+        return 1;
+      }
+      for(std::size_t run = 0;run<count && lutf.good();++run){
+
+        next_start = max_raw_;
+        if(run + 1 < count)
+          lutf >> next_start >> next_level;
+
+        if(start >= next_start || next_start > max_raw_ || level >= n_levels_)
+          return 1;
+
+        std::fill(encode.begin() + start, encode.begin() + next_start, static_cast<compressed_type>(level));
+        start = next_start;
+        level = next_level;
+      }
+
+      if(lutf.fail()){
+        std::cerr << "[sqeazy::quantiser] " << _path << " is truncated\n";
+        return 1;
+      }
+
+      lut_decode_.swap(decode);
+      lut_encode_.swap(encode);
+      reference_levels_.swap(levels);
+      return 0;
     }
 
     void set_n_threads(int nt) {
       nthreads_ = nt;
     }
 
+    /**
+       \brief limit the LUT to 2^_n_bits levels, _n_bits is clamped to [1,sizeof(compressed_type)*CHAR_BIT];
+       takes effect at the next setup
+    */
+    void set_n_bits(int _n_bits) {
+      const int max_bits = sizeof(compressed_type)*CHAR_BIT;
+      _n_bits = (std::max)(1,(std::min)(_n_bits,max_bits));
+      n_levels_ = size_t(1) << _n_bits;
+    }
+
+    const size_t n_levels() const {
+      return n_levels_;
+    }
+
     const int n_threads() const {
       return nthreads_;
     }
@@ -663,7 +881,7 @@ namespace sqeazy {
                 << sqeazy::header_utils::represent<compressed_type>::as_string();
 
       float importanceSum = std::accumulate(importance_.begin(),importance_.end(),0.);
-      float bucketSize = importanceSum/max_compressed_;
+      float bucketSize = importanceSum/n_levels_;
       quant_log << " (initial bucket size: " << bucketSize << ", sum(wei*int): "<< importanceSum<< ")\n";
 
       quant_log << std::setw(13) << "[begin,end]"
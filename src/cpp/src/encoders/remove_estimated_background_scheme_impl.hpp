@@ -90,17 +90,16 @@ namespace sqeazy {
 #endif
 
       if(_output) {
-        //TODO: removed flatten_to_neighborhood for now as it exposed critically bad cache behavior
-        //copies the input to output, skipping pixels that have a neighborhood complying criteria
-        // flatten_to_neighborhood_scheme<raw_type> flatten(reduce_by,.5);
-        // flatten.set_n_threads(this->n_threads());
-        // flatten.encode(_input, _output, _shape);
+        //copies the input to output, zeroing pixels whose neighborhood is mostly below reduce_by
+        flatten_to_neighborhood_scheme<raw_type> flatten(reduce_by,.5);
+        flatten.set_n_threads(this->n_threads());
+        flatten.encode(_input, _output, _shape);
 
         //set those pixels to 0 that fall below reduce_by
         remove_background_scheme<raw_type> reduce(reduce_by);
         reduce.set_n_threads(this->n_threads());
 
-        reduce.encode(_input, _output,  input_length);
+        reduce.encode(_output, _output,  input_length);
       }
       else {
         std::cerr << "WARNING ["<< name() <<"::encode]\t inplace operation not supported\n";
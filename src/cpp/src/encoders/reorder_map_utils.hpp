@@ -0,0 +1,390 @@
+#ifndef _REORDER_MAP_UTILS_H_
+#define _REORDER_MAP_UTILS_H_
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lz4.h"
+
+#include "string_parsers.hpp"
+
+namespace sqeazy {
+
+  /**
+     \brief compact binary representation of the decode maps (permutations) that tile_shuffle and frame_shuffle
+     store in their config
+
+     the map is stored as zigzag encoded deltas (map[i] - map[i-1] - 1, i.e. ascending runs cost 0 bits) that are
+     bit-packed in blocks of block_size items with one bit width per block; the packed block is lz4 compressed
+     if that pays off; all integers are little-endian and do not depend on sizeof(std::size_t)
+
+     layout:
+     \code
+     magic "SQYM" | version u8 | flags u8 | n_items u64 | [packed bytes u64 if lz4] | payload
+     payload: n_blocks x ( width u8 | ceil(width*items_in_block/8) bytes )
+     \endcode
+
+     a pipeline writing a binary header stores the packed block in the side section of the header and the stage
+     config only refers to it by offset and length (reorder_map_at, reorder_map_bytes), decoding reads it in place;
+     otherwise (JSON header, stage used on its own) the block travels base64 encoded inside the verbatim delimiters
+     of the stage config (reorder_map); maps written as plain std::size_t arrays by older versions are still read
+  */
+  namespace reorder_map {
+
+    static const std::string magic = "SQYM";
+    static const std::uint8_t format_version = 1;
+    static const std::uint8_t lz4_flag = 1;
+    static const std::size_t block_size = 128;
+    static const std::size_t fixed_bytes = 4 + 1 + 1 + 8;
+
+    static char* put_u64(char* _dst, std::uint64_t _value){
+      for(int b = 0;b<8;++b)
+        *(_dst++) = static_cast<char>((_value >> (8*b)) & 0xff);
+      return _dst;
+    }
+
+    static std::uint64_t get_u64(const char* _src){
+      std::uint64_t value = 0;
+      for(int b = 0;b<8;++b)
+        value |= std::uint64_t(static_cast<unsigned char>(_src[b])) << (8*b);
+      return value;
+    }
+
+    static std::uint64_t zigzag(std::int64_t _value){
+      return (std::uint64_t(_value) << 1) ^ std::uint64_t(_value >> 63);
+    }
+
+    static std::int64_t unzigzag(std::uint64_t _value){
+      return std::int64_t(_value >> 1) ^ -std::int64_t(_value & 1);
+    }
+
+    /**
+       \brief write the lower _width bits of _value to _dst starting at bit _bit (LSB first), _dst must be zeroed
+    */
+    static void put_bits(unsigned char* _dst, std::size_t _bit, std::uint64_t _value, int _width){
+      while(_width > 0){
+        const int shift = _bit % 8;
+        const int take = (std::min)(_width, 8 - shift);
+        _dst[_bit/8] |= static_cast<unsigned char>((_value & ((1u << take) - 1)) << shift);
+        _value >>= take;
+        _bit += take;
+        _width -= take;
+      }
+    }
+
+    static std::uint64_t get_bits(const unsigned char* _src, std::size_t _bit, int _width){
+      std::uint64_t value = 0;
+      for(int done = 0;done < _width;){
+        const int shift = _bit % 8;
+        const int take = (std::min)(_width - done, 8 - shift);
+        value |= std::uint64_t((_src[_bit/8] >> shift) & ((1u << take) - 1)) << done;
+        _bit += take;
+        done += take;
+      }
+      return value;
+    }
+
+    /**
+       \brief bit-pack the map [_begin,_end) and compress it with lz4 if the result shrinks
+
+       \return binary block as described above
+    */
+    template <typename iter_t>
+    static std::string pack(iter_t _begin, iter_t _end, bool _allow_lz4 = true){
+
+      const std::size_t n_items = std::distance(_begin,_end);
+
+      std::string payload;
+      payload.reserve(n_items + n_items/block_size + 1);
+
+      std::vector<std::uint64_t> deltas(block_size,0);
+      std::int64_t previous = -1;
+
+      for(std::size_t first = 0;first<n_items;first += block_size){
+
+        const std::size_t count = (std::min)(block_size, n_items - first);
+        std::uint64_t any_bits = 0;
+
+        for(std::size_t i = 0;i<count;++i){
+          const std::int64_t current = static_cast<std::int64_t>(*(_begin + first + i));
+          deltas[i] = zigzag(current - previous - 1);
+          any_bits |= deltas[i];
+          previous = current;
+        }
+
+        int width = 0;
+        while(width < 64 && (any_bits >> width))
+          ++width;
+
+        payload.push_back(static_cast<char>(width));
+
+        const std::size_t offset = payload.size();
+        payload.resize(offset + (width*count + 7)/8, 0);
+        unsigned char* dst = reinterpret_cast<unsigned char*>(&payload[offset]);
+
+        for(std::size_t i = 0;i<count;++i)
+          put_bits(dst, i*width, deltas[i], width);
+      }
+
+      std::string value(fixed_bytes,'\0');
+      char* dst = &value[0];
+      dst = std::copy(magic.begin(), magic.end(), dst);
+      *(dst++) = static_cast<char>(format_version);
+      char* flags = dst++;
+      put_u64(dst, n_items);
+
+      if(_allow_lz4 && payload.size() > 64 && payload.size() < std::size_t(LZ4_MAX_INPUT_SIZE)){
+
+        std::string compressed(LZ4_compressBound(payload.size()),'\0');
+        const int compressed_bytes = LZ4_compress_default(payload.data(), &compressed[0],
+                                                          payload.size(), compressed.size());
+
+        if(compressed_bytes > 0 && std::size_t(compressed_bytes) + 8 < payload.size()){
+          *flags = static_cast<char>(lz4_flag);
+          value.resize(fixed_bytes + 8);
+          put_u64(&value[fixed_bytes], payload.size());
+          value.append(compressed.data(), compressed_bytes);
+          return value;
+        }
+      }
+
+      *flags = 0;
+      value.append(payload);
+      return value;
+    }
+
+    static bool is_packed(const char* _begin, const char* _end){
+      return std::size_t(std::distance(_begin,_end)) >= fixed_bytes &&
+        std::equal(magic.begin(), magic.end(), _begin);
+    }
+
+    /**
+       \brief unpack a map written by pack into _map, every item is checked to be smaller than the number of items
+
+       \return 0 on success, 1 otherwise
+    */
+    static int unpack(const char* _begin, const char* _end, std::vector<std::size_t>& _map){
+
+      if(!is_packed(_begin,_end) || static_cast<std::uint8_t>(_begin[4]) != format_version){
+        std::cerr << "[sqeazy::reorder_map::unpack] unknown map format\n";
+        return 1;
+      }
+
+      const std::uint8_t flags = static_cast<std::uint8_t>(_begin[5]);
+      const std::uint64_t n_items = get_u64(_begin + 6);
+      const char* src = _begin + fixed_bytes;
+
+      std::string decompressed;
+      const char* payload = src;
+      const char* payload_end = _end;
+
+      if(flags & lz4_flag){
+        if(std::distance(src,_end) < 8)
+          return 1;
+
+        const std::uint64_t raw_bytes = get_u64(src);
+        src += 8;
+
+        //every block needs at least its width byte
+        if(raw_bytes > std::uint64_t(LZ4_MAX_INPUT_SIZE) || raw_bytes < (n_items + block_size - 1)/block_size){
+          std::cerr << "[sqeazy::reorder_map::unpack] corrupt lz4 block\n";
+          return 1;
+        }
+
+        decompressed.resize(raw_bytes);
+        const int decompressed_bytes = LZ4_decompress_safe(src, &decompressed[0],
+                                                           std::distance(src,_end), raw_bytes);
+        if(decompressed_bytes < 0 || std::uint64_t(decompressed_bytes) != raw_bytes){
+          std::cerr << "[sqeazy::reorder_map::unpack] unable to decompress lz4 block\n";
+          return 1;
+        }
+
+        payload = decompressed.data();
+        payload_end = payload + decompressed.size();
+      }
+
+      if(n_items > std::uint64_t(std::distance(payload,payload_end))*block_size){
+        std::cerr << "[sqeazy::reorder_map::unpack] truncated map\n";
+        return 1;
+      }
+
+      _map.resize(n_items);
+      std::int64_t previous = -1;
+
+      for(std::size_t first = 0;first<n_items;first += block_size){
+
+        const std::size_t count = (std::min)(std::size_t(n_items - first), block_size);
+        if(payload >= payload_end)
+          return 1;
+
+        const int width = static_cast<unsigned char>(*(payload++));
+        const std::size_t bytes = (width*count + 7)/8;
+        if(width > 64 || std::size_t(std::distance(payload,payload_end)) < bytes){
+          std::cerr << "[sqeazy::reorder_map::unpack] truncated map\n";
+          return 1;
+        }
+
+        const unsigned char* bits = reinterpret_cast<const unsigned char*>(payload);
+        for(std::size_t i = 0;i<count;++i){
+          const std::int64_t current = previous + 1 + unzigzag(get_bits(bits, i*width, width));
+          if(current < 0 || std::uint64_t(current) >= n_items){
+            std::cerr << "[sqeazy::reorder_map::unpack] map item out of range\n";
+            return 1;
+          }
+
+          _map[first + i] = current;
+          previous = current;
+        }
+
+        payload += bytes;
+      }
+
+      return 0;
+    }
+
+    /**
+       \brief pack _map and wrap it for use as value in a stage config
+    */
+    static std::string to_verbatim(const std::vector<std::size_t>& _map){
+
+      const std::string packed = pack(_map.begin(), _map.end());
+      return parsing::range_to_verbatim(packed.begin(), packed.end());
+    }
+
+    /**
+       \brief restore a map from the value of a stage config, written either by to_verbatim or as plain std::size_t
+       array by parsing::range_to_verbatim (legacy)
+
+       \return 0 on success, 1 otherwise
+    */
+    static int from_verbatim(const std::string& _verbatim, std::vector<std::size_t>& _map){
+
+      _map.clear();
+      if(_verbatim.empty())
+        return 0;
+
+      std::vector<char> bytes(parsing::verbatim_yields_n_items_of<char>(_verbatim),0);
+      auto bytes_end = parsing::verbatim_to_range(_verbatim, bytes.begin(), bytes.end());
+      bytes.resize(std::distance(bytes.begin(), bytes_end));
+
+      if(is_packed(bytes.data(), bytes.data() + bytes.size()))
+        return unpack(bytes.data(), bytes.data() + bytes.size(), _map);
+
+      //legacy: native std::size_t array
+      _map.resize(bytes.size()/sizeof(std::size_t));
+      std::memcpy(_map.data(), bytes.data(), _map.size()*sizeof(std::size_t));
+      return 0;
+    }
+
+    /**
+       \brief decode map of a shuffle stage, see stage::side_block for how a pipeline moves it out of the config
+    */
+    struct stage_map {
+
+      std::string packed;//written by the last encode
+      std::string verbatim;//reorder_map of the config the stage was built from
+      std::int64_t side_offset;//reorder_map_at of the config, -1 if the config carries the map
+      std::uint64_t side_bytes;
+      std::vector<std::size_t> attached;//read from the side section by attach
+
+      stage_map():
+        packed(),
+        verbatim(),
+        side_offset(-1),
+        side_bytes(0),
+        attached(){}
+
+      /**
+         \brief pick up the map related keys of a stage config
+      */
+      template <typename config_map_t>
+      void configure(const config_map_t& _config){
+
+        auto f_itr = _config.find("reorder_map");
+        if(f_itr!=_config.end())
+          verbatim = f_itr->second;
+
+        f_itr = _config.find("reorder_map_at");
+        if(f_itr!=_config.end())
+          side_offset = std::stoll(f_itr->second);
+
+        f_itr = _config.find("reorder_map_bytes");
+        if(f_itr!=_config.end())
+          side_bytes = std::stoull(f_itr->second);
+      }
+
+      void encoded(const std::vector<std::size_t>& _map){
+        packed = pack(_map.begin(), _map.end());
+        verbatim.clear();
+        side_offset = -1;
+        side_bytes = 0;
+      }
+
+      void stored_at(std::size_t _offset){
+        side_offset = _offset;
+        side_bytes = packed.size();
+      }
+
+      /**
+         \brief config value(s) that lead back to the map
+      */
+      std::string config() const {
+
+        if(side_offset >= 0)
+          return "reorder_map_at=" + std::to_string(side_offset) + ",reorder_map_bytes=" + std::to_string(side_bytes);
+
+        if(!packed.empty())
+          return "reorder_map=" + parsing::range_to_verbatim(packed.begin(), packed.end());
+
+        return "reorder_map=" + verbatim;
+      }
+
+      /**
+         \brief unpack the block the config refers to from the side section [_begin, _begin + _len)
+
+         \return 0 on success, 1 otherwise
+      */
+      int attach(const char* _begin, std::size_t _len){
+
+        if(side_offset < 0)
+          return 0;
+
+        if(std::uint64_t(side_offset) > _len || side_bytes > _len - side_offset){
+          std::cerr << "[sqeazy::reorder_map::stage_map] decode map not found in the side section of the header\n";
+          attached.clear();
+          return 1;
+        }
+
+        return unpack(_begin + side_offset, _begin + side_offset + side_bytes, attached);
+      }
+
+      /**
+         \brief the map to decode with: read from the side section, from the last encode or from the config
+
+         \return 0 on success, 1 otherwise
+      */
+      int get(std::vector<std::size_t>& _map) const {
+
+        if(side_offset >= 0){
+          if(attached.empty())
+            return 1;
+          _map = attached;
+          return 0;
+        }
+
+        if(!packed.empty())
+          return unpack(packed.data(), packed.data() + packed.size(), _map);
+
+        return from_verbatim(verbatim, _map);
+      }
+    };
+
+  }
+
+}
+
+#endif /* _REORDER_MAP_UTILS_H_ */
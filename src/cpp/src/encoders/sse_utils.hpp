@@ -1357,16 +1357,19 @@ namespace sqeazy {
        \param[in] _end   iterator/pointer to 1+ end of input array
        \param[inout] _dst   iterator/pointer to beginning of output array
        \param[in] _nthreads   number of threads to use
+       \param[in] _collect   callable (begin, end, dst, bitplane offset from msb) that extracts one bitplane,
+       e.g. a variant of simd_collect_single_bitplane compiled for a specific instruction set
 
        \return
        \retval iterator to 1+ the end element of the output array
 
     */
-    template <typename in_iterator_t, typename out_iterator_t>
+    template <typename in_iterator_t, typename out_iterator_t, typename collect_t>
     void simd_segment_broadcast(in_iterator_t _begin,
                                 in_iterator_t _end,
                                 out_iterator_t _dst,
-                                int _nthreads = 1){
+                                int _nthreads,
+                                collect_t _collect){
 
       typedef typename std::make_signed<std::size_t>::type omp_size_type;//boiler plate required for MS VS 14 2015 OpenMP implementation
 
@@ -1424,14 +1427,26 @@ namespace sqeazy {
 
         out_iterator_t output = _dst + seg*segment_offset;
 
-        simd_collect_single_bitplane(_begin, _end,
-                                     output,
-                                     seg);
+        _collect(_begin, _end,
+                 output,
+                 seg);
 
       } // s segments
 
     }
 
+    template <typename in_iterator_t, typename out_iterator_t>
+    void simd_segment_broadcast(in_iterator_t _begin,
+                                in_iterator_t _end,
+                                out_iterator_t _dst,
+                                int _nthreads = 1){
+
+      simd_segment_broadcast(_begin, _end, _dst, _nthreads,
+                             [](in_iterator_t _first, in_iterator_t _last, out_iterator_t _out, int _offset){
+                               simd_collect_single_bitplane(_first, _last, _out, _offset);
+                             });
+    }
+
   }//detail
 
 }//sqeazy
@@ -8,6 +8,7 @@
 #include "traits.hpp"
 #include "dynamic_stage.hpp"
 #include "string_parsers.hpp"
+#include "reorder_map_utils.hpp"
 
 #include "tile_shuffle_utils.hpp"
 
@@ -25,7 +26,7 @@ namespace sqeazy {
     static const std::size_t default_tile_size = 32;
 
     std::size_t tile_size;
-    std::string serialized_reorder_map;
+    reorder_map::stage_map stored_map;
 
     tile_shuffle_scheme(const std::string& _payload=""):
       tile_size(default_tile_size)
@@ -39,9 +40,7 @@ namespace sqeazy {
       	if(f_itr!=config_map.end())
       	  tile_size = std::stoi(f_itr->second);
 
-	f_itr = config_map.find("reorder_map");
-      	if(f_itr!=config_map.end())
-      	  serialized_reorder_map = f_itr->second;
+      	stored_map.configure(config_map);
 
       }
     }
@@ -60,7 +59,7 @@ namespace sqeazy {
       std::ostringstream msg;
       msg << "tile_size=" << std::to_string(tile_size);
       msg << ",";
-      msg << "reorder_map=" << serialized_reorder_map;
+      msg << stored_map.config();
       return msg.str();
 
     }
@@ -70,6 +69,21 @@ namespace sqeazy {
       return _size_bytes;
     }
 
+    std::string side_block() const override final {
+
+      return stored_map.packed;
+    }
+
+    void side_block_at(std::size_t _offset) override final {
+
+      stored_map.stored_at(_offset);
+    }
+
+    int attach_side_section(const char* _begin, std::size_t _len) override final {
+
+      return stored_map.attach(_begin, _len);
+    }
+
 
     compressed_type* encode( const raw_type* _input,
                              compressed_type* _output,
@@ -86,7 +100,7 @@ namespace sqeazy {
                                    this->n_threads());
 
 
-      serialized_reorder_map = parsing::range_to_verbatim(tiles_of.decode_map.begin(), tiles_of.decode_map.end());
+      stored_map.encoded(tiles_of.decode_map);
 
 
       return value;
@@ -99,13 +113,11 @@ namespace sqeazy {
 
       std::size_t length = std::accumulate(_ishape.begin(), _ishape.end(), 1, std::multiplies<std::size_t>());
 
-      std::vector<std::size_t> decode_map(parsing::verbatim_yields_n_items_of<std::size_t>(serialized_reorder_map),0);
-
-      // auto res =
-      parsing::verbatim_to_range(serialized_reorder_map,
-                                 decode_map.begin(), decode_map.end());
+      std::vector<std::size_t> decode_map;
+      if(stored_map.get(decode_map))
+        return FAILURE;
 
-      detail::tile_shuffle tiles_of(tile_size,decode_map);
+      detail::tile_shuffle tiles_of(tile_size,std::move(decode_map));
 
       auto value = tiles_of.decode(_input, _input+length,
                                    _output,
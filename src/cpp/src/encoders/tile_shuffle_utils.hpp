@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <iterator>
+#include <utility>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include "traits.hpp"
@@ -22,7 +23,7 @@ namespace sqeazy {
 	  tile_shuffle(std::size_t _tsize,
 				   std::vector<std::size_t> _map = std::vector<std::size_t>()):
 		tile_size(_tsize),
-		decode_map(_map)
+		decode_map(std::move(_map))
 		{
 
 		}
@@ -36,6 +37,87 @@ namespace sqeazy {
 		return rem;
 	  }
 
+	  /**
+		 \brief number of (full or partial) tiles along each dimension of _shape
+	  */
+	  template <typename shape_container_t>
+	  shape_container_t tiles_per_dim(const shape_container_t& _shape) const {
+		shape_container_t value = _shape;
+		for(auto & el : value)
+		  el = (el + tile_size - 1) / tile_size;
+
+		return value;
+	  }
+
+	  /**
+		 \brief origin and extent (row_major order) of tile _tile_id inside a stack of _shape,
+		 tiles are enumerated in row-major order as well
+	  */
+	  template <typename shape_container_t>
+	  void tile_box(std::size_t _tile_id,
+					const shape_container_t& _n_tiles,
+					const shape_container_t& _shape,
+					std::size_t* _origin,
+					std::size_t* _extent) const {
+
+		const std::size_t tile_xy = _n_tiles[row_major::y]*_n_tiles[row_major::x];
+		const std::size_t tile_index[3] = {_tile_id / tile_xy,
+										   (_tile_id % tile_xy) / _n_tiles[row_major::x],
+										   _tile_id % _n_tiles[row_major::x]};
+
+		for(int d = 0;d<3;++d){
+		  _origin[d] = tile_index[d]*tile_size;
+		  _extent[d] = (std::min)(tile_size, std::size_t(_shape[d]) - _origin[d]);
+		}
+	  }
+
+	  /**
+		 \brief call _functor(row_begin, row_length) for every row of tile _tile_id inside _stack,
+		 the rows are visited in the order they occupy inside the shuffled buffer
+	  */
+	  template <typename iterator_t, typename shape_container_t, typename functor_t>
+	  void for_each_tile_row(iterator_t _stack,
+							 std::size_t _tile_id,
+							 const shape_container_t& _n_tiles,
+							 const shape_container_t& _shape,
+							 functor_t&& _functor) const {
+
+		std::size_t origin[3];
+		std::size_t extent[3];
+		tile_box(_tile_id, _n_tiles, _shape, origin, extent);
+
+		const std::size_t frame = _shape[row_major::y]*_shape[row_major::x];
+
+		for(std::size_t z = origin[row_major::z];z<origin[row_major::z] + extent[row_major::z];++z){
+		  auto row = _stack + z*frame + origin[row_major::y]*_shape[row_major::x] + origin[row_major::x];
+
+		  for(std::size_t y = 0;y<extent[row_major::y];++y, row += _shape[row_major::x])
+			_functor(row, extent[row_major::x]);
+		}
+	  }
+
+	  /**
+		 \brief offset of the i-th tile of decode_map inside the shuffled buffer
+	  */
+	  template <typename shape_container_t>
+	  std::vector<std::size_t> shuffled_offsets(const shape_container_t& _n_tiles,
+												const shape_container_t& _shape,
+												int _nthreads = 1) const {
+
+		std::vector<std::size_t> value(decode_map.size(),0);
+
+		prefix_sum_of(decode_map.begin(), decode_map.end(), value.begin(),
+					  [&](const std::size_t& _tile_id){
+						std::size_t origin[3];
+						std::size_t extent[3];
+						tile_box(_tile_id, _n_tiles, _shape, origin, extent);
+						return extent[0]*extent[1]*extent[2];
+					  },
+					  _nthreads);
+
+		return value;
+	  }
+
 	  /**
 	   *  \brief perform a tile shuffle on the input
 	   *
@@ -44,8 +126,6 @@ namespace sqeazy {
 	   *  the input is rearranged so that small-median tiles are at the beginning of the output array
 	   *  large-median tiles are at the end of the output array
 	   *
-	   *  TODO: parallelize the sort if the compression ratio is enhanced
-	   *
 	   *  \param param
 	   *  \return return type
 	   */
@@ -93,7 +173,8 @@ namespace sqeazy {
 	  }
 
 	  /**
-		 \brief implementation where the input stack is assumed to yield only full tiles
+		 \brief implementation where the input stack is assumed to yield only full tiles,
+		 the arithmetic mean of a tile serves as metric
 
 		 \param[in]
 
@@ -111,110 +192,32 @@ namespace sqeazy {
 		typedef typename std::iterator_traits<in_iterator_t>::value_type in_value_type;
 		typedef typename std::remove_cv<in_value_type>::type in_value_t;
 
-		typedef typename std::iterator_traits<decltype(_shape.begin())>::value_type shape_value_type;
-		typedef typename std::remove_cv<shape_value_type>::type shape_value_t;
-
-		const shape_container_t rem = remainder(_shape);
-		const std::size_t n_elements          = std::distance(_begin,_end);
 		const std::size_t n_elements_per_tile = std::pow(tile_size,_shape.size());
-		const std::size_t n_elements_per_tile_frame = std::pow(tile_size,_shape.size()-1);
-
-		shape_container_t n_full_tiles = _shape;
-
-		for(shape_value_t & n_tiles : n_full_tiles )
-		  n_tiles = n_tiles / tile_size;
-
-		const shape_value_t len_tiles = std::accumulate(n_full_tiles.begin(), n_full_tiles.end(),1,std::multiplies<shape_value_t>());
-
-		// COLLECT TILE CONTENT /////////////////////////////////////////////////////////////////////////////////////////////////////
-
-		std::vector< std::vector<in_value_t> > tiles(len_tiles, std::vector<in_value_t>(n_elements_per_tile,0) );
-		auto ptiles = tiles.data();
-		auto pshape = _shape.data();
-		auto pn_full_tiles = n_full_tiles.data();
-
-#pragma omp parallel for												\
-  shared( _begin, ptiles)												\
-  firstprivate(pshape, pn_full_tiles)													\
-  num_threads(_nthreads)
-		for(omp_size_type z = 0;z<(omp_size_type)pshape[row_major::z];++z){
-		  std::size_t ztile = z / tile_size;
-		  std::size_t z_intile = z % tile_size;
-
-		  for(omp_size_type y = 0;y<(omp_size_type)pshape[row_major::y];++y){
-			std::size_t ytile = y / tile_size;
-			std::size_t y_intile = y % tile_size;
-
-			std::size_t linear_tile_id = ztile*pn_full_tiles[sqeazy::row_major::y]*pn_full_tiles[sqeazy::row_major::x]
-			  + ytile*pn_full_tiles[sqeazy::row_major::x]
-			  ;
-
-			auto acc_iter = _begin + z*pshape[row_major::y]*pshape[row_major::x] + y*pshape[row_major::x];
-
-			for(omp_size_type x = 0;x<(omp_size_type)pshape[row_major::x];x+=tile_size,++linear_tile_id,acc_iter+=tile_size){
-			  // xtile = x / tile_size;
-
-			  auto tiles_iter = tiles[linear_tile_id].begin();
-
-			  std::copy(acc_iter, acc_iter + tile_size,
-						tiles_iter + (z_intile*n_elements_per_tile_frame) + y_intile*tile_size);
-
-
-			}
-		  }
-		}
 
 		// COLLECT STATISTICS /////////////////////////////////////////////////////////////////////////////////////////////////////
 		// use arithmetic mean for now, only the sum would do as well as this should only be an indicator for the signal activity inside the tile here
 
-		std::vector<in_value_t> metric(len_tiles,0.);
-		auto pmetric = metric.data();
-
-#pragma omp parallel for												\
-  shared( pmetric)														\
-  firstprivate(ptiles)													\
-  num_threads(_nthreads)
-		for(omp_size_type i = 0;i<(omp_size_type)len_tiles;++i){
-
-
-		  float sum = std::accumulate(ptiles[i].cbegin(),
-									  ptiles[i].cend(),
-									  float(0),
-									  std::plus<float>());
-
-		  pmetric[i] = sum / n_elements_per_tile;
-		}
-
-		// PERFORM SHUFFLE /////////////////////////////////////////////////////////////////////////////////////////////////////
-		decode_map.resize(len_tiles);
-
-		auto sorted_metric = metric;
-		std::sort(sorted_metric.begin(), sorted_metric.end());
-
-		// WRITE TILES 2 OUTPUT ////////////////////////////////////////////////////////////////////////////////////////////////
-		// auto dst = _out;
-		auto pdecode_map = decode_map.data();
-		auto psorted_metric = sorted_metric.data();
-#pragma omp parallel for						\
-  shared( pdecode_map, _out)					\
-  firstprivate(ptiles,pmetric, psorted_metric)					\
-  num_threads(_nthreads)
-		for(omp_size_type i =0;i<(omp_size_type)metric.size();++i){
-		  auto original_index = std::find(pmetric, pmetric + len_tiles, psorted_metric[i]) - pmetric;
-
-		  pdecode_map[i] = original_index;
-		  std::copy(ptiles[original_index].begin(), ptiles[original_index].end(),
-					_out + i*n_elements_per_tile);
-		}
-
-
-		return _out + n_elements;
-
+		return shuffle_by_metric(_begin, _end, _out, _shape, _nthreads,
+								 [n_elements_per_tile](in_iterator_t _stack,
+													   std::size_t _tile_id,
+													   const shape_container_t& _n_tiles,
+													   const shape_container_t& _tshape,
+													   const tile_shuffle& _self){
+
+								   float sum = 0;
+								   _self.for_each_tile_row(_stack, _tile_id, _n_tiles, _tshape,
+														   [&sum](in_iterator_t _row, std::size_t _len){
+															 sum = std::accumulate(_row, _row + _len, sum, std::plus<float>());
+														   });
+
+								   return in_value_t(sum / n_elements_per_tile);
+								 });
 	  }
 
 
 	  /**
-		 \brief encode with the stack dimensions not fitting the tile shape in any way
+		 \brief encode with the stack dimensions not fitting the tile shape in any way,
+		 the median of a tile serves as metric
 
 		 \param[in]
 
@@ -233,162 +236,98 @@ namespace sqeazy {
 		typedef typename std::iterator_traits<in_iterator_t>::value_type in_value_type;
 		typedef typename std::remove_cv<in_value_type>::type in_value_t;
 
-		typedef typename std::iterator_traits<decltype(_shape.begin())>::value_type shape_value_type;
-		typedef typename std::remove_cv<shape_value_type>::type shape_value_t;
 		typedef typename bacc::accumulator_set<in_value_t,
 											   bacc::stats<bacc::tag::median>
 											   > median_acc_t ;
 		// 75% quantile?
 		// typedef typename boost::accumulators::accumulator_set<double, stats<boost::accumulators::tag::pot_quantile<boost::right>(.75)> > quantile_acc_t;
 
-		const shape_container_t rem = remainder(_shape);
-		const std::size_t n_elements_per_tile = std::pow(tile_size,_shape.size());
-		// const std::size_t n_elements_per_tile_frame = std::pow(tile_size,_shape.size()-1);
+		// COLLECT STATISTICS /////////////////////////////////////////////////////////////////////////////////////////////////////
+		// median plus stddev around median or take 75% quantile directly
 
-		shape_container_t n_full_tiles = _shape;
+		return shuffle_by_metric(_begin, _end, _out, _shape, _nthreads,
+								 [](in_iterator_t _stack,
+									std::size_t _tile_id,
+									const shape_container_t& _n_tiles,
+									const shape_container_t& _tshape,
+									const tile_shuffle& _self){
+
+								   median_acc_t acc;
+								   _self.for_each_tile_row(_stack, _tile_id, _n_tiles, _tshape,
+														   [&acc](in_iterator_t _row, std::size_t _len){
+															 for(std::size_t p = 0;p<_len;++p)
+															   acc(_row[p]);
+														   });
+
+								   return in_value_t(std::round(bacc::median(acc)));
+								 });
+	  }
 
-		for(shape_value_t & tile_dim : n_full_tiles )
-		  tile_dim = tile_dim / tile_size;
+	  /**
+		 \brief compute _metric for every tile, sort the tiles by it (ties keep their original order)
+		 and copy every tile from the input straight to its final position in _out
 
-		shape_container_t n_tiles = n_full_tiles;
-		for(int i =0;i<(int)rem.size();++i)
-		  n_tiles[i] += rem[i] ? 1 : 0;
+		 the input is read twice (metric and copy), no tile is staged in between
 
-		const shape_value_t len_tiles = std::accumulate(n_tiles.begin(), n_tiles.end(),1,std::multiplies<shape_value_t>());
+		 \param[in] _metric functor (stack, tile_id, n_tiles, shape, *this) that yields the metric of one tile
 
-		// SETUP TILE CONTENT /////////////////////////////////////////////////////////////////////////////////////////////////////
+		 \return iterator past the last element written to _out
+	  */
+	  template <typename in_iterator_t, typename out_iterator_t, typename shape_container_t, typename metric_t>
+	  out_iterator_t shuffle_by_metric(in_iterator_t _begin,
+									   in_iterator_t _end,
+									   out_iterator_t _out,
+									   const shape_container_t& _shape,
+									   int _nthreads,
+									   metric_t&& _metric) {
 
-		std::vector< std::vector<in_value_t> > tiles(len_tiles, std::vector<in_value_t>(n_elements_per_tile,0));
-		auto ptiles = tiles.data();
-		auto pshape = _shape.data();
-		auto pn_tiles = n_tiles.data();
+		typedef typename std::iterator_traits<in_iterator_t>::value_type in_value_type;
+		typedef typename std::remove_cv<in_value_type>::type in_value_t;
 
-		// COLLECT TILE CONTENT /////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma omp parallel for												\
-  shared( ptiles )														\
-  firstprivate(pshape, _begin,pn_tiles)									\
-  num_threads(_nthreads)
-		for(omp_size_type z = 0;z<(omp_size_type)pshape[row_major::z];++z){
-		  std::size_t ztile = z / tile_size;
-		  std::size_t z_intile = z % tile_size;
-		  std::size_t ztile_shape = (ztile+1)*tile_size > pshape[row_major::z] ? (pshape[row_major::z]-(ztile*tile_size)) : tile_size;
-
-		  for(omp_size_type y = 0;y<(omp_size_type)pshape[row_major::y];++y){
-			std::size_t ytile = y / tile_size;
-			std::size_t y_intile = y % tile_size;
-			std::size_t ytile_shape = (ytile+1)*tile_size > pshape[row_major::y] ? (pshape[row_major::y]-(ytile*tile_size)) : tile_size;
-			std::size_t tile_id = ztile*pn_tiles[sqeazy::row_major::y]*pn_tiles[sqeazy::row_major::x]
-			  + ytile*pn_tiles[sqeazy::row_major::x]
-			  ;
-
-			auto acc_iter = _begin + z*pshape[row_major::y]*pshape[row_major::x] + y*pshape[row_major::x];
-
-			for(omp_size_type x = 0;x<(omp_size_type)pshape[row_major::x];x+=tile_size, ++tile_id){
-			  std::size_t xtile = x / tile_size;
-			  std::size_t xtile_shape = (xtile+1)*tile_size > pshape[row_major::x] ? (pshape[row_major::x]-(xtile*tile_size)) : tile_size;
-			  #pragma omp critical
-			  {
-			  ptiles[tile_id].resize(ztile_shape*ytile_shape*xtile_shape);
-			  }
-
-			  auto tiles_iter = ptiles[tile_id].data();
-			  auto tiles_offset = (z_intile*xtile_shape*ytile_shape) + y_intile*xtile_shape;
-
-			  std::copy(acc_iter, acc_iter + xtile_shape,
-						tiles_iter + tiles_offset);
-
-			  acc_iter+=xtile_shape;
-
-			}
-		  }
-		}
+		const shape_container_t n_tiles = tiles_per_dim(_shape);
+		const omp_size_type len_tiles = std::accumulate(n_tiles.begin(), n_tiles.end(),1,std::multiplies<std::size_t>());
 
 		// COLLECT STATISTICS /////////////////////////////////////////////////////////////////////////////////////////////////////
-		// median plus stddev around median or take 75% quantile directly
-
-		std::vector<in_value_t> metric(len_tiles,0.);
+		std::vector<in_value_t> metric(len_tiles,0);
 		auto pmetric = metric.data();
 
 #pragma omp parallel for												\
   shared( pmetric)														\
-  firstprivate(ptiles)													\
+  firstprivate(_begin)													\
   num_threads(_nthreads)
-		for(omp_size_type i = 0;i<(omp_size_type)len_tiles;++i){
-		  median_acc_t acc;
-
-		  for(std::size_t p = 0;p<n_elements_per_tile;++p){
-			acc(ptiles[i][p]);
-		  }
-
-		  pmetric[i] = std::round(bacc::median(acc));
+		for(omp_size_type i = 0;i<len_tiles;++i){
+		  pmetric[i] = _metric(_begin, i, n_tiles, _shape, *this);
 		}
 
 		// PERFORM SHUFFLE /////////////////////////////////////////////////////////////////////////////////////////////////////
+		// decode_map[i] is the original index of the tile with the i-th smallest metric (ties keep their original order)
 		decode_map.resize(len_tiles);
+		argsort(metric.begin(), metric.end(), decode_map.begin(), _nthreads);
 
-		auto sorted_metric = metric;
-
-		//TODO: this sort is the bottleneck currently
-		std::sort(sorted_metric.begin(), sorted_metric.end());
-
-		// COMPUTE SHUFFLED-ORIGINAL INDEX MAP //////////////////////////////////////////////////////////////////////////////////
-		std::vector<char> tile_written(len_tiles,false);
-		auto ptile_written = tile_written.data();
-		auto psorted_metric = sorted_metric.data();
+		// WRITE TILES 2 OUTPUT ////////////////////////////////////////////////////////////////////////////////////////////////
+		const std::vector<std::size_t> offsets = shuffled_offsets(n_tiles, _shape, _nthreads);
+		auto poffsets = offsets.data();
 		auto pdecode_map = decode_map.data();
 
 #pragma omp parallel for												\
-  shared( ptile_written,pdecode_map)										\
-  firstprivate(pmetric, psorted_metric)												\
+  shared( _out)															\
+  firstprivate(_begin, poffsets, pdecode_map)							\
   num_threads(_nthreads)
-		for(omp_size_type i =0;i<(omp_size_type)metric.size();++i){
-		  auto original_index = std::find(pmetric, pmetric+len_tiles, psorted_metric[i]) - pmetric;
-
-		  #pragma omp critical
-		  {
-			while(ptile_written[original_index] == true)
-			  original_index++;
-
-			ptile_written[original_index] = true;
-		  }
-
-
-		  pdecode_map[i] = original_index;
+		for(omp_size_type i = 0;i<len_tiles;++i){
+		  auto dst = _out + poffsets[i];
 
+		  for_each_tile_row(_begin, pdecode_map[i], n_tiles, _shape,
+							[&dst](in_iterator_t _row, std::size_t _len){
+							  dst = std::copy(_row, _row + _len, dst);
+							});
 		}
 
-
-		// COMPUTE PREFIX SUM //////////////////////////////////////////////////////////////////////////////////
-		std::vector<std::size_t> prefix_sum(len_tiles,0);
-		prefix_sum_of(decode_map.begin(), decode_map.end(), prefix_sum.begin(),
-					  [&](const std::size_t& _index){ return ptiles[_index].size(); },
-					  _nthreads);
-
-		// STORE CONTENT TO OUTPUT //////////////////////////////////////////////////////////////////////////////////
-		auto pprefix_sum = prefix_sum.data();
-		auto len = std::distance(_begin,_end);
-		#pragma omp parallel for												\
-		  shared( _out)													\
-		  firstprivate(ptiles,pdecode_map,pprefix_sum)								\
-		  num_threads(_nthreads)
-		for(omp_size_type i =0;i<(omp_size_type)decode_map.size();++i){
-
-		  std::copy(ptiles[pdecode_map[i]].begin(),
-					ptiles[pdecode_map[i]].end(),
-					_out + pprefix_sum[i]
-			);
-
-		}
-
-
-		return _out + len;
+		return _out + std::distance(_begin,_end);
 	  }
 
 	  /**
 	   *  \brief decode a tile_shuffled stack into it's original form
 	   *
-	   *  TODO: parallelize this!
-	   *
 	   *  \param param
 	   *  \return return type
 	   */
@@ -421,13 +360,13 @@ namespace sqeazy {
 		  return _out;
 		}
 
-		const shape_container_t rem = remainder(_shape);
-		// const bool has_remainder = std::count_if(rem.begin(), rem.end(), [](shape_value_t el){ return el > 0;});
-
-		return decode_with_remainder(_begin, _end, _out,_shape);
+		return decode_with_remainder(_begin, _end, _out,_shape, _nthreads);
 
 	  }
 
+	  /**
+		 \brief copy every tile of the shuffled input straight back to its original position in _out
+	  */
 	  template <typename in_iterator_t, typename out_iterator_t, typename shape_container_t>
 	  out_iterator_t decode_with_remainder(in_iterator_t _begin,
 										   in_iterator_t _end,
@@ -435,128 +374,35 @@ namespace sqeazy {
 										   const shape_container_t& _shape,
 										   int _nthreads = 1) const {
 
+		const shape_container_t n_tiles = tiles_per_dim(_shape);
+		const omp_size_type len_tiles = std::accumulate(n_tiles.begin(), n_tiles.end(),1,std::multiplies<std::size_t>());
 
-
-		typedef typename std::iterator_traits<in_iterator_t>::value_type in_value_type;
-		typedef typename std::remove_cv<in_value_type>::type in_value_t;
-
-		// typedef typename std::iterator_traits<out_iterator_t>::value_type out_value_type;
-		// typedef typename std::remove_cv<out_value_type>::type out_value_t;
-
-		typedef typename std::iterator_traits<decltype(_shape.begin())>::value_type shape_value_type;
-		typedef typename std::remove_cv<shape_value_type>::type shape_value_t;
-
-		const shape_container_t rem = remainder(_shape);
-		const std::size_t n_elements_per_tile = std::pow(tile_size,_shape.size());
-
-		auto value = _out;
-		shape_container_t n_full_tiles = _shape;
-
-		for(shape_value_t & tile_dim : n_full_tiles )
-		  tile_dim = tile_dim / tile_size;
-
-		shape_container_t n_tiles = n_full_tiles;
-		for(int i =0;i<(int)rem.size();++i)
-		  n_tiles[i] += rem[i] ? 1 : 0;
-
-		const shape_value_t len_tiles = std::accumulate(n_tiles.begin(), n_tiles.end(),1,std::multiplies<shape_value_t>());
-
-		// SETUP TILE CONTENT /////////////////////////////////////////////////////////////////////////////////////////////////////
-
-		std::vector< std::vector<in_value_t> > tiles(len_tiles, std::vector<in_value_t>(n_elements_per_tile,0));
-
-		std::size_t ztile = 0;
-		std::size_t ytile = 0;
-		std::size_t xtile = 0;
-
-		std::size_t ztile_shape = 0;
-		std::size_t ytile_shape = 0;
-		std::size_t xtile_shape = 0;
-
-		std::size_t tile_id = 0;
-
-		for(shape_value_t z = 0;z<_shape[row_major::z];z+=tile_size){
-		  ztile = z / tile_size;
-		  ztile_shape = (ztile+1)*tile_size > _shape[row_major::z] ? (_shape[row_major::z]-(ztile*tile_size)) : tile_size;
-
-		  for(shape_value_t y = 0;y<_shape[row_major::y];y+=tile_size){
-			ytile = y / tile_size;
-			ytile_shape = (ytile+1)*tile_size > _shape[row_major::y] ? (_shape[row_major::y]-(ytile*tile_size)) : tile_size;
-
-			tile_id = ztile*n_tiles[sqeazy::row_major::y]*n_tiles[sqeazy::row_major::x]
-			  + ytile*n_tiles[sqeazy::row_major::x]
-			  ;
-
-			for(shape_value_t x = 0;x<_shape[row_major::x];x+=tile_size, ++tile_id){
-			  xtile = x / tile_size;
-			  xtile_shape = (xtile+1)*tile_size > _shape[row_major::x] ? (_shape[row_major::x]-(xtile*tile_size)) : tile_size;
-
-			  tiles[tile_id].resize(ztile_shape*ytile_shape*xtile_shape);
-			}
-		  }
-		}
-
-		auto input = _begin;
-		std::size_t target_tile_index = 0;
-		for(std::size_t i = 0;i<len_tiles;++i){
-		  target_tile_index = decode_map[i];
-
-		  std::copy(input,input+tiles[target_tile_index].size(),
-					tiles[target_tile_index].begin());
-
-		  input += tiles[target_tile_index].size();
-
+		if(decode_map.size() != std::size_t(len_tiles) ||
+		   std::any_of(decode_map.begin(), decode_map.end(), [len_tiles](std::size_t _id){ return _id >= std::size_t(len_tiles); })){
+		  std::cerr << "[sqeazy::detail::tile_shuffle::decode] decode map does not match the "
+					<< len_tiles << " tiles of the shape!\n";
+		  return _out;
 		}
 
-		// DUMP TILE CONTENT /////////////////////////////////////////////////////////////////////////////////////////////////////
-		ztile = 0;
-		ytile = 0;
-		xtile = 0;
-
-		ztile_shape = 0;
-		ytile_shape = 0;
-		xtile_shape = 0;
-
-		tile_id = 0;
-
-
-		std::size_t z_intile = 0;
-		std::size_t y_intile = 0;
-
-
-		auto tiles_iter = tiles[0].begin();
-
-		for(shape_value_t z = 0;z<_shape[row_major::z];++z){
-		  ztile = z / tile_size;
-		  z_intile = z % tile_size;
-
-		  ztile_shape = (ztile+1)*tile_size > _shape[row_major::z] ? (_shape[row_major::z]-(ztile*tile_size)) : tile_size;
-
-		  for(shape_value_t y = 0;y<_shape[row_major::y];++y){
-			ytile = y / tile_size;
-			y_intile = y % tile_size;
-			ytile_shape = (ytile+1)*tile_size > _shape[row_major::y] ? (_shape[row_major::y]-(ytile*tile_size)) : tile_size;
-
-			tile_id = ztile*n_tiles[sqeazy::row_major::y]*n_tiles[sqeazy::row_major::x]
-			  + ytile*n_tiles[sqeazy::row_major::x]
-			  ;
-
-			for(shape_value_t x = 0;x<_shape[row_major::x];x+=tile_size, ++tile_id){
-			  xtile = x / tile_size;
-			  xtile_shape = (xtile+1)*tile_size > _shape[row_major::x] ? (_shape[row_major::x]-(xtile*tile_size)) : tile_size;
-
-			  tiles_iter = tiles[tile_id].begin() + (z_intile*xtile_shape*ytile_shape) + y_intile*xtile_shape;
-			  std::copy(tiles_iter,
-						tiles_iter + xtile_shape,
-						value);
-
-			  value+=xtile_shape;
+		const std::vector<std::size_t> offsets = shuffled_offsets(n_tiles, _shape, _nthreads);
+		auto poffsets = offsets.data();
+		auto pdecode_map = decode_map.data();
 
-			}
-		  }
+#pragma omp parallel for												\
+  shared( _out)															\
+  firstprivate(_begin, poffsets, pdecode_map)							\
+  num_threads(_nthreads)
+		for(omp_size_type i = 0;i<len_tiles;++i){
+		  auto src = _begin + poffsets[i];
+
+		  for_each_tile_row(_out, pdecode_map[i], n_tiles, _shape,
+							[&src](out_iterator_t _row, std::size_t _len){
+							  std::copy(src, src + _len, _row);
+							  src += _len;
+							});
 		}
 
-		return value;
+		return _out + std::distance(_begin,_end);
 	  }
 
 
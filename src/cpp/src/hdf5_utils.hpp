@@ -8,6 +8,9 @@
 #include <cmath>
 #include <vector>
 #include <set>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
 #include "boost/filesystem.hpp"
 #include "boost/static_assert.hpp"
 
@@ -18,6 +21,7 @@ namespace bfs = boost::filesystem;
 #include "sqeazy_h5_filter.hpp"
 #include "sqeazy_hdf5_impl.hpp"
 #include "header_utils.hpp"
+#include "dynamic_pipeline_chunked.hpp"
 
 namespace H5{
   std::string get_ds_name(const H5::DataSet& _ds)
@@ -963,6 +967,412 @@ namespace sqeazy {
 
     }
 
+    /**
+       \brief chunk shape used by write_nd_dataset_parallel if none is given: the chunks cover the full extent of
+       all but the slowest dimension and at most max_chunk_bytes, so that there is at least one chunk per thread
+    */
+    template <typename T>
+    static std::vector<hsize_t> default_parallel_chunk_shape(const std::vector<hsize_t>& _dims, int _nthreads){
+
+      static const std::size_t max_chunk_bytes = std::size_t(1) << 24;
+
+      std::vector<hsize_t> value(_dims);
+      if(value.empty() || !value.front())
+        return value;
+
+      const std::size_t plane_bytes = std::accumulate(value.begin() + 1, value.end(),
+                                                      sizeof(T), std::multiplies<std::size_t>());
+      const hsize_t per_thread = (_dims.front() + (std::max)(_nthreads,1) - 1)/(std::max)(_nthreads,1);
+      const hsize_t fitting = (std::max)(std::size_t(1), max_chunk_bytes/plane_bytes);
+
+      value.front() = (std::max)(hsize_t(1), (std::min)(per_thread, fitting));
+      return value;
+    }
+
+    /**
+       \brief write given data set through sqy pipeline given by _filter_name string, chunks of _chunk_shape are
+       compressed concurrently by _nthreads threads and handed to HDF5 pre-compressed (H5Dwrite_chunk), i.e. the
+       HDF5 filter pipeline is bypassed on write
+
+       the dataset is declared with the sqy filter and every chunk is a complete sqy buffer (chunks at the upper
+       borders are padded to the full chunk shape like HDF5 does), so it is read back through H5Z_filter_sqy as usual;
+       chunks are compressed and written in rounds of 2*_nthreads chunks to bound the memory required
+
+       \param[in] _chunk_shape extent of one chunk, default_parallel_chunk_shape if empty
+
+       \return 0 on success, 1 otherwise
+    */
+    template <typename T, typename U>
+    int write_nd_dataset_parallel(const std::string& _dname,
+                                  const std::string& _filter_name,
+                                  const T* _payload,
+                                  U* _shape,
+                                  const unsigned _shape_size,
+                                  std::vector<hsize_t> _chunk_shape = std::vector<hsize_t>(),
+                                  int _nthreads = 1
+      ){
+
+      typedef typename std::conditional<sizeof(T) == 1,
+                                        sqy::dypeline_from_uint8,
+                                        sqy::dypeline<std::uint16_t> >::type pipeline_t;
+      typedef typename pipeline_t::incoming_t raw_t;
+
+      //the sqy filter only handles 8 and 16 bit integers
+      if(_filter_name.empty() || sizeof(T) != sizeof(raw_t) || !std::is_integral<T>::value)
+        return write_nd_dataset(_dname, _filter_name, _payload, _shape, _shape_size);
+
+#if H5_VERSION_GE(1,10,3)
+      if(!pipeline_t::can_be_built_from(_filter_name)){
+        std::cerr << "[sqeazy::h5_file] unable to build pipeline from " << _filter_name << "\n";
+        return 1;
+      }
+
+      _nthreads = (std::max)(_nthreads,1);
+
+      std::vector<hsize_t> dims(_shape, _shape + _shape_size);
+      if(_chunk_shape.empty())
+        _chunk_shape = default_parallel_chunk_shape<T>(dims, _nthreads);
+
+      const std::vector<std::size_t> shape(dims.begin(), dims.end());
+      const chunk_table table(shape, std::vector<std::size_t>(_chunk_shape.begin(), _chunk_shape.end()));
+      const std::vector<std::size_t>& chunk_shape = table.chunk_shape_;
+      const std::vector<hsize_t> h5_chunk_shape(chunk_shape.begin(), chunk_shape.end());
+      const std::size_t chunk_size = std::accumulate(chunk_shape.begin(), chunk_shape.end(),
+                                                     std::size_t(1), std::multiplies<std::size_t>());
+
+      H5::DataSpace dsp(dims.size(), &dims[0]);
+      H5::DSetCreatPropList  plist;
+      plist.setChunk(h5_chunk_shape.size(), &h5_chunk_shape[0]);
+
+      sqeazy::header hdr(T(),h5_chunk_shape, _filter_name);
+      std::string hdr_str = hdr.str();
+      size_t cd_values_size = std::ceil(float(hdr_str.size())/(sizeof(int)/sizeof(char)));
+      std::vector<unsigned> cd_values(cd_values_size,0);
+
+      std::copy(hdr_str.begin(), hdr_str.end(),(char*)&cd_values[0]);
+      plist.setFilter(H5Z_FILTER_SQY,
+                      H5Z_FLAG_MANDATORY,
+                      cd_values.size(),
+                      &cd_values[0]);
+
+      std::string grp_path = extract_group_path(_dname);
+      bool open_group = has_h5_item(grp_path) || (grp_path[0] == '/' && grp_path.size() == 1);
+      H5::Group grp(open_group ? file_->openGroup(grp_path.c_str()) : file_->createGroup(grp_path.c_str()));
+
+      H5::DataSet ds(grp.createDataSet( _dname.c_str(),
+                                        hdf5_compiletime_dtype<T>::instance(),
+                                        dsp,
+                                        plist) );
+
+      //pipelines share their stages when copied, so every thread builds its own
+      std::vector<pipeline_t> pipes(_nthreads);
+      for(pipeline_t& pipe : pipes){
+        pipe = pipeline_t::from_string(_filter_name);
+        pipe.set_n_threads(1);
+      }
+
+      const std::size_t max_chunk_bytes = pipes.front().max_encoded_size(chunk_size*sizeof(raw_t));
+      const std::size_t n_chunks = table.n_chunks();
+      const std::size_t round = 2*_nthreads;
+
+      std::vector<std::vector<char> > encoded(round);
+      std::vector<std::size_t> encoded_bytes(round,0);
+      const raw_t* input = reinterpret_cast<const raw_t*>(_payload);
+      int failed = 0;
+
+      for(std::size_t first = 0;first < n_chunks && !failed;first += round){
+
+        const omp_size_type n_round = (std::min)(round, n_chunks - first);
+
+#pragma omp parallel num_threads(_nthreads) shared(failed, encoded, encoded_bytes, pipes)
+        {
+          pipeline_t& pipe = pipes[omp_get_thread_num()];
+          vec_32algn_t<raw_t> brick(chunk_size);
+          std::vector<std::size_t> lo, extent;
+          const std::vector<std::size_t> origin(table.rank(),0);
+
+#pragma omp for schedule(dynamic) reduction(+:failed)
+          for(omp_size_type i = 0;i<n_round;++i){
+
+            table.chunk_box(first + i, lo, extent);
+            if(extent != chunk_shape)
+              std::fill(brick.begin(), brick.end(), 0);
+
+            detail::copy_box(input, shape, lo,
+                             brick.data(), chunk_shape, origin,
+                             extent);
+
+            encoded[i].resize(max_chunk_bytes);
+            char* encoded_end = pipe.encode(brick.data(), encoded[i].data(), chunk_shape);
+
+            if(!encoded_end){
+              std::cerr << "[sqeazy::h5_file] failed to encode chunk " << first + i << " with " << _filter_name << "\n";
+              failed += 1;
+              encoded_bytes[i] = 0;
+            }
+            else
+              encoded_bytes[i] = encoded_end - encoded[i].data();
+          }
+        }
+
+        //HDF5 is not thread-safe, chunks are stored from this thread only
+        std::vector<std::size_t> lo, extent;
+        for(omp_size_type i = 0;i<n_round && !failed;++i){
+
+          table.chunk_box(first + i, lo, extent);
+          const std::vector<hsize_t> offset(lo.begin(), lo.end());
+
+          if(H5Dwrite_chunk(ds.getId(), H5P_DEFAULT, 0, offset.data(),
+                            encoded_bytes[i], encoded[i].data()) < 0){
+            std::cerr << "[sqeazy::h5_file] failed to write chunk " << first + i << " to " << _dname << "\n";
+            failed += 1;
+          }
+        }
+      }
+
+      grp.close();
+      flush();//force disk write
+
+      return failed ? 1 : 0;
+#else
+      if(_nthreads > 1)
+        std::cerr << "[sqeazy::h5_file] HDF5 " << H5_VERS_INFO << " lacks H5Dwrite_chunk, compressing chunks serially\n";
+
+      return write_nd_dataset(_dname, _filter_name, _payload, _shape, _shape_size);
+#endif
+    }
+
+    /**
+       \brief read the complete dataset _dname into _payload, chunks compressed by sqy are decoded concurrently
+       by _nthreads threads (see read_nd_region)
+
+       \return 0 on success, 1 otherwise
+    */
+    template <typename T, typename U>
+    int read_nd_dataset_parallel(const std::string& _dname, T* _payload, std::vector<U>& _shape, int _nthreads = 1){
+
+      shape(_shape,_dname);
+      if(_shape.empty())
+        return 1;
+
+      const std::vector<U> lo(_shape.size(),0);
+      return read_nd_region(_dname, _payload, lo, _shape, _nthreads);
+    }
+
+    /**
+       \brief read the box [_lo,_hi) of dataset _dname into _payload (row-major, shape _hi - _lo)
+
+       if the dataset is chunked and compressed by the sqy filter only, the chunks intersecting the box are looked
+       up (H5Dget_chunk_info_by_coord) and fetched compressed (H5Dread_chunk) from this thread, then decoded by
+       _nthreads threads straight into _payload, i.e. the HDF5 filter pipeline is bypassed on read; any other
+       dataset (or HDF5 older than 1.10.5) is read as a hyperslab through HDF5
+
+       \return 0 on success, 1 otherwise
+    */
+    template <typename T, typename U>
+    int read_nd_region(const std::string& _dname,
+                       T* _payload,
+                       const std::vector<U>& _lo,
+                       const std::vector<U>& _hi,
+                       int _nthreads = 1){
+
+      H5::DataSet dataset;
+      if(ready())
+        dataset = load_h5_dataset( _dname );
+
+      if(!dataset.getId())
+        return 1;
+
+      if(!h5_read_type_matches<T>(dataset))
+        return 1;
+
+      std::vector<hsize_t> dims;
+      try{
+        H5::DataSpace dataspace(dataset.getSpace());
+        dims.resize(dataspace.getSimpleExtentNdims());
+        dataspace.getSimpleExtentDims(dims.data(), NULL);
+      }
+      catch(H5::DataSpaceIException & local_error)
+      {
+        error_ = local_error;
+        return 1;
+      }
+
+      const std::vector<std::size_t> shape(dims.begin(), dims.end());
+      const std::vector<std::size_t> lo(_lo.begin(), _lo.end());
+      const std::vector<std::size_t> hi(_hi.begin(), _hi.end());
+
+      if(!chunk_table(shape, shape).valid_region(lo, hi)){
+        std::cerr << "[sqeazy::h5_file] region to read is empty or exceeds " << _dname << "\n";
+        return 1;
+      }
+
+#if H5_VERSION_GE(1,10,5)
+      typedef typename std::conditional<sizeof(T) == 1,
+                                        sqy::dypeline_from_uint8,
+                                        sqy::dypeline<std::uint16_t> >::type pipeline_t;
+
+      //datasets stored as one chunk (chunk == dims, as written before chunked writes existed) gain nothing from
+      //decoding chunks in parallel, they go through the filter
+      std::vector<std::size_t> chunk_shape;
+      if(std::is_integral<T>::value && sizeof(T) <= 2 && sqy_chunks_only(dataset, chunk_shape) &&
+         chunk_table(shape, chunk_shape).n_chunks() > 1){
+
+        int rvalue = read_sqy_chunks<pipeline_t>(dataset, shape, chunk_shape, lo, hi,
+                                                 reinterpret_cast<typename pipeline_t::incoming_t*>(_payload),
+                                                 _nthreads);
+        if(rvalue >= 0)
+          return rvalue;
+        //some chunks were stored unfiltered, let HDF5 sort them out
+      }
+#else
+      if(_nthreads > 1)
+        std::cerr << "[sqeazy::h5_file] HDF5 " << H5_VERS_INFO << " lacks H5Dget_chunk_info_by_coord, decoding chunks serially\n";
+#endif
+
+      std::vector<hsize_t> offset(lo.begin(), lo.end());
+      std::vector<hsize_t> count(hi.size());
+      for(std::size_t d = 0;d<count.size();++d)
+        count[d] = hi[d] - lo[d];
+
+      try{
+        H5::DataSpace file_space(dataset.getSpace());
+        file_space.selectHyperslab(H5S_SELECT_SET, count.data(), offset.data());
+        H5::DataSpace mem_space(count.size(), count.data());
+
+        dataset.read(_payload, hdf5_compiletime_dtype<T>::instance(), mem_space, file_space);
+      }
+      catch(H5::Exception & local_error)
+      {
+        error_ = local_error;
+        return 1;
+      }
+
+      return 0;
+    }
+
+  private:
+
+    /**
+       \brief true if _dataset is chunked and the sqy filter is the only filter applied to it, _chunk_shape
+       receives the chunk dimensions then
+    */
+    bool sqy_chunks_only(const H5::DataSet& _dataset, std::vector<std::size_t>& _chunk_shape) const {
+
+      H5::DSetCreatPropList plist(_dataset.getCreatePlist());
+      if(plist.getLayout() != H5D_CHUNKED || plist.getNfilters() != 1)
+        return false;
+
+      char          filter_name[1];
+      size_t        filter_name_size = {1};
+      size_t        cd_values_size = {0};
+      unsigned      flags = 0;
+      unsigned      filter_info = 0;
+      unsigned      cd_values[1];
+
+      if(plist.getFilter(0, flags, cd_values_size, cd_values,
+                         filter_name_size, filter_name, filter_info) != H5Z_FILTER_SQY)
+        return false;
+
+      std::vector<hsize_t> chunk_dims(_dataset.getSpace().getSimpleExtentNdims());
+      plist.getChunk(chunk_dims.size(), chunk_dims.data());
+
+      _chunk_shape.assign(chunk_dims.begin(), chunk_dims.end());
+      return true;
+    }
+
+#if H5_VERSION_GE(1,10,5)
+    /**
+       \brief decode the chunks of _dataset intersecting [_lo,_hi) into _out, the compressed chunks are read
+       serially (HDF5 is not thread-safe) and decoded by chunked_pipeline::decode_chunks; chunks that were never
+       written are filled with the fill value of the dataset
+
+       \return 0 on success, 1 on failure, -1 if a chunk was stored without the sqy filter applied
+    */
+    template <typename pipeline_t>
+    int read_sqy_chunks(H5::DataSet& _dataset,
+                        const std::vector<std::size_t>& _shape,
+                        const std::vector<std::size_t>& _chunk_shape,
+                        const std::vector<std::size_t>& _lo,
+                        const std::vector<std::size_t>& _hi,
+                        typename pipeline_t::incoming_t* _out,
+                        int _nthreads){
+
+      typedef typename pipeline_t::incoming_t raw_t;
+
+      const chunk_table table(_shape, _chunk_shape);
+      const std::vector<std::size_t> region = table.chunks_in_region(_lo, _hi);
+
+      std::vector<std::size_t> chunks;
+      std::vector<std::vector<hsize_t> > offsets;
+      std::vector<std::size_t> chunk_bytes;
+      std::vector<std::size_t> lo, extent;
+      std::size_t total_bytes = 0;
+
+      for(std::size_t c : region){
+
+        table.chunk_box(c, lo, extent);
+        std::vector<hsize_t> offset(lo.begin(), lo.end());
+
+        unsigned filter_mask = 0;
+        haddr_t address = HADDR_UNDEF;
+        hsize_t nbytes = 0;
+
+        if(H5Dget_chunk_info_by_coord(_dataset.getId(), offset.data(), &filter_mask, &address, &nbytes) < 0){
+          std::cerr << "[sqeazy::h5_file] unable to query chunk " << c << " of " << _dataset.getObjName() << "\n";
+          return 1;
+        }
+
+        if(address == HADDR_UNDEF || !nbytes)
+          continue;
+
+        if(filter_mask)
+          return -1;
+
+        chunks.push_back(c);
+        offsets.push_back(offset);
+        chunk_bytes.push_back(nbytes);
+        total_bytes += nbytes;
+      }
+
+      if(chunks.size() != region.size()){
+
+        raw_t fill = 0;
+        H5::DSetCreatPropList plist(_dataset.getCreatePlist());
+        plist.getFillValue(hdf5_compiletime_dtype<raw_t>::instance(), &fill);
+
+        std::size_t region_size = 1;
+        for(std::size_t d = 0;d<_lo.size();++d)
+          region_size *= _hi[d] - _lo[d];
+
+        std::fill(_out, _out + region_size, fill);
+
+        if(chunks.empty())
+          return 0;
+      }
+
+      std::vector<char> storage(total_bytes);
+      std::vector<const char*> chunk_begins(chunks.size());
+
+      char* dst = storage.data();
+      for(std::size_t i = 0;i<chunks.size();++i){
+
+        std::uint32_t filters = 0;
+        if(H5Dread_chunk(_dataset.getId(), H5P_DEFAULT, offsets[i].data(), &filters, dst) < 0){
+          std::cerr << "[sqeazy::h5_file] unable to read chunk " << chunks[i] << " of " << _dataset.getObjName() << "\n";
+          return 1;
+        }
+
+        chunk_begins[i] = dst;
+        dst += chunk_bytes[i];
+      }
+
+      //decode_chunks reports the number of chunks that failed
+      const chunked_pipeline<pipeline_t> chunked(pipeline_t(), std::vector<std::size_t>(), _nthreads);
+      return chunked.decode_chunks(table, chunks, chunk_begins, chunk_bytes, _lo, _hi, _out) ? 1 : 0;
+    }
+#endif
+
   };
 
 
@@ -0,0 +1,140 @@
+#ifndef _SCRATCH_ARENA_H_
+#define _SCRATCH_ARENA_H_
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "sqeazy_common.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace sqeazy {
+
+  /**
+     \brief collection of aligned, uninitialized scratch buffers that is meant to be reused across many calls
+
+     buffers are identified by a slot number; a slot is only (re-)allocated if more bytes are requested
+     than it currently holds, i.e. encoding/decoding many stacks of the same shape allocates once.
+     The content of the buffers is not preserved by copies of the arena, each copy starts empty.
+
+     If hugepages are requested (and supported by the platform), buffers are aligned to and padded
+     to the hugepage size and marked as candidates for transparent hugepages.
+  */
+  struct scratch_arena {
+
+    static constexpr std::size_t alignment = 32;
+    static constexpr std::size_t hugepage_bytes = 2 << 20;
+
+    std::vector<unique_array<char> > buffers_;
+    std::vector<std::size_t> capacities_;
+    bool use_hugepages_;
+
+    scratch_arena(bool _use_hugepages = false):
+      buffers_(),
+      capacities_(),
+      use_hugepages_(_use_hugepages)
+    {}
+
+    scratch_arena(const scratch_arena& _rhs):
+      buffers_(),
+      capacities_(),
+      use_hugepages_(_rhs.use_hugepages_)
+    {}
+
+    scratch_arena(scratch_arena&& _rhs) = default;
+
+    scratch_arena& operator=(scratch_arena _rhs){
+
+      swap(*this, _rhs);
+      return *this;
+    }
+
+    friend void swap(scratch_arena& _lhs, scratch_arena& _rhs){
+
+      std::swap(_lhs.buffers_, _rhs.buffers_);
+      std::swap(_lhs.capacities_, _rhs.capacities_);
+      std::swap(_lhs.use_hugepages_, _rhs.use_hugepages_);
+    }
+
+    /**
+       \brief obtain a buffer of at least _nbytes bytes for slot _slot, the content is undefined
+
+       \param[in] _nbytes minimum size of the buffer in bytes
+       \param[in] _slot index of the buffer to obtain
+
+       \return pointer to the beginning of the buffer (nullptr if _nbytes is 0)
+    */
+    template <typename T>
+    T* get(std::size_t _nbytes, std::size_t _slot = 0){
+
+      if(!_nbytes)
+        return nullptr;
+
+      if(_slot >= buffers_.size()){
+        buffers_.resize(_slot+1);
+        capacities_.resize(_slot+1,0);
+      }
+
+      if(capacities_[_slot] < _nbytes){
+
+        const std::size_t align = use_hugepages_ ? hugepage_bytes : alignment;
+        const std::size_t nbytes = ((_nbytes + align - 1)/align)*align;
+
+        buffers_[_slot].reset();
+        buffers_[_slot] = make_aligned<char>(align, nbytes);
+        capacities_[_slot] = buffers_[_slot] ? nbytes : 0;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if(use_hugepages_ && buffers_[_slot])
+          madvise(buffers_[_slot].get(), nbytes, MADV_HUGEPAGE);
+#endif
+      }
+
+      return reinterpret_cast<T*>(buffers_[_slot].get());
+    }
+
+    std::size_t capacity(std::size_t _slot = 0) const {
+      return _slot < capacities_.size() ? capacities_[_slot] : 0;
+    }
+
+    /**
+       \brief buffer currently held for slot _slot (nullptr if none), does not allocate
+    */
+    const char* data(std::size_t _slot = 0) const {
+      return _slot < buffers_.size() ? buffers_[_slot].get() : nullptr;
+    }
+
+    std::size_t size_in_bytes() const {
+      return std::accumulate(capacities_.begin(), capacities_.end(), std::size_t(0));
+    }
+
+    bool use_hugepages() const {
+      return use_hugepages_;
+    }
+
+    /**
+       \brief switch hugepage backing on/off, takes effect for every buffer allocated afterwards
+    */
+    void set_use_hugepages(bool _flag){
+      if(_flag != use_hugepages_)
+        release();
+      use_hugepages_ = _flag;
+    }
+
+    /**
+       \brief free all buffers held
+    */
+    void release(){
+      buffers_.clear();
+      capacities_.clear();
+    }
+
+  };
+
+}
+
+#endif /* _SCRATCH_ARENA_H_ */
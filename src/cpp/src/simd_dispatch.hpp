@@ -0,0 +1,140 @@
+#ifndef _SIMD_DISPATCH_H_
+#define _SIMD_DISPATCH_H_
+
+#include <cstdlib>
+#include <string>
+#include <iostream>
+
+#include "compass.hpp"
+#include "sqeazy_common.hpp"
+
+namespace sqeazy {
+
+  /**
+     \brief process-wide choice of the instruction set the vectorised kernels may use
+
+     the AVX2/AVX512BW kernels are compiled through function attributes next to the baseline code, which of them
+     may run is decided once per process on first use from what compass::runtime reports for the host CPU, so that
+     one binary can be used on machines of different generations
+
+     the SSE kernels (sse_utils.hpp) need the SSE4 baseline the library is compiled with (-msse4.2),
+     bitplane_reorder_sse.hpp builds them a second time with AVX2 enabled and picks the variant from active()
+
+     the functions below are inline (not static), so every translation unit shares the same state
+
+     the path can be capped (never raised beyond what the CPU supports) with the environment variable SQY_SIMD
+     (scalar, sse4, avx2 or avx512bw) or by calling limit, e.g. to compare kernels or to work around a faulty node
+  */
+  namespace simd {
+
+    enum path {
+      scalar = 0,
+      sse4 = 1,
+      avx2 = 2,
+      avx512bw = 3
+    };
+
+    inline const char* name(path _path){
+
+      switch(_path){
+      case sse4: return "sse4";
+      case avx2: return "avx2";
+      case avx512bw: return "avx512bw";
+      default: return "scalar";
+      }
+    }
+
+    /**
+       \brief parse a path name as produced by name
+
+       \return 0 on success, 1 if _name is unknown (_path is untouched then)
+    */
+    inline int from_string(const std::string& _name, path& _path){
+
+      for(path candidate : {scalar, sse4, avx2, avx512bw}){
+        if(_name == name(candidate)){
+          _path = candidate;
+          return 0;
+        }
+      }
+
+      return 1;
+    }
+
+    /**
+       \brief best path the host CPU (and the baseline the library was compiled for) supports
+    */
+    inline path detect(){
+
+      static const path value = [](){
+
+        if(!platform::use_vectorisation::value || !compass::runtime::has(compass::feature::sse4()))
+          return scalar;
+
+        if(!compass::runtime::has(compass::feature::avx2()))
+          return sse4;
+
+        if(!compass::runtime::has(compass::feature::avx512bw()))
+          return avx2;
+
+        return avx512bw;
+      }();
+
+      return value;
+    }
+
+    namespace detail {
+
+      inline path& active_path(){
+
+        static path value = [](){
+
+          path requested = detect();
+          const char* from_env = std::getenv("SQY_SIMD");
+
+          if(from_env && from_string(from_env, requested) != 0)
+            std::cerr << "[sqeazy::simd] ignoring unknown SQY_SIMD=" << from_env
+                      << " (expected scalar, sse4, avx2 or avx512bw)\n";
+
+          return requested < detect() ? requested : detect();
+        }();
+
+        return value;
+      }
+
+    }
+
+    /**
+       \brief the path the kernels currently use
+    */
+    inline path active(){
+      return detail::active_path();
+    }
+
+    inline const char* active_name(){
+      return name(active());
+    }
+
+    /**
+       \brief true if kernels of _path may be used
+    */
+    inline bool allows(path _path){
+      return _path <= detail::active_path();
+    }
+
+    /**
+       \brief cap the path at _path (at most detect()), not meant to be called while pipelines are running
+
+       \return the path that is active afterwards
+    */
+    inline path limit(path _path){
+
+      detail::active_path() = _path < detect() ? _path : detect();
+      return active();
+    }
+
+  }
+
+}
+
+#endif /* _SIMD_DISPATCH_H_ */
@@ -1,11 +1,15 @@
 #define SQEAZY_CPP_
 
+#include <exception>
+#include <memory>
+
 #include "boost/filesystem.hpp"
 
 #include "sqeazy.h"
 
 #include "sqeazy_header.hpp"
 #include "sqeazy_pipelines.hpp"
+#include "simd_dispatch.hpp"
 
 #include "sqeazy_hdf5_impl.hpp"
 #include "hdf5_utils.hpp"
@@ -67,6 +71,24 @@ int SQY_Version_Triple(int* version){
   return 0;
 }
 
+int SQY_SIMD_Path(char* name, long* length){
+
+  if(!length)
+    return 2;
+
+  const std::string path = sqeazy::simd::active_name();
+  const long available = *length;
+  *length = path.size();
+
+  if(!name || available < long(path.size() + 1))
+    return 1;
+
+  std::copy(path.begin(), path.end(), name);
+  name[path.size()] = '\0';
+
+  return 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Pipeline interface
 int SQY_PipelineEncode_UI8(const char* pipeline,
@@ -141,6 +163,149 @@ int SQY_PipelineEncode_UI16(const char* pipeline,
   return value;
 }
 
+namespace {
+
+  /**
+     \brief run _body and turn any exception into _on_error, so that no exception leaves the C interface
+  */
+  template <typename result_t, typename function_t>
+  result_t guarded(const char* _caller, result_t _on_error, function_t _body){
+
+    try{
+      return _body();
+    }
+    catch(const std::exception& _exc){
+      std::cerr << "[sqeazy]	" << _caller << " failed: " << _exc.what() << "\n";
+    }
+    catch(...){
+      std::cerr << "[sqeazy]	" << _caller << " failed with an unknown exception\n";
+    }
+
+    return _on_error;
+  }
+
+  /**
+     \brief encode item _i of a batch with _pipe
+
+     \return status of the item as documented for SQY_PipelineEncodeBatch_*
+  */
+  template <typename raw_t>
+  int encode_batch_item(sqy::dypeline<raw_t>& _pipe,
+                        int _i,
+                        const char** _src,
+                        long** _shapes,
+                        unsigned* _shape_sizes,
+                        char** _dst,
+                        long* _dstlengths){
+
+    if(_pipe.empty())
+      return 2;
+
+    std::vector<std::size_t> shape_(_shapes[_i], _shapes[_i]+_shape_sizes[_i]);
+    const std::intmax_t size_in_byte = sizeof(raw_t)*std::accumulate(shape_.begin(), shape_.end(),
+                                                                     std::size_t(1), std::multiplies<std::size_t>());
+
+    if(_dstlengths[_i] < _pipe.max_encoded_size(size_in_byte))
+      return 1;
+
+    char* encoded_end = _pipe.encode(reinterpret_cast<const raw_t*>(_src[_i]),
+                                     _dst[_i],
+                                     shape_);
+
+    if(!encoded_end)
+      return 2;
+
+    _dstlengths[_i] = encoded_end - _dst[_i];
+    return 0;
+  }
+
+  /**
+     \brief encode _n_items independent buffers
+
+     pipelines share their stages when copied, so every thread builds its own pipeline from _pipeline; with at least
+     as many items as threads, the items are distributed over the threads dynamically and every pipeline runs
+     single-threaded, otherwise the items are encoded one after another with all threads inside the pipeline (no
+     nested parallel regions, the OpenMP settings of the caller are left untouched); an exception while building the
+     pipeline or encoding an item fails that item with status 2
+
+     \return number of items that could not be encoded (see _status for the reason)
+  */
+  template <typename raw_t>
+  int encode_batch(const char* _pipeline,
+                   int _n_items,
+                   const char** _src,
+                   long** _shapes,
+                   unsigned* _shape_sizes,
+                   char** _dst,
+                   long* _dstlengths,
+                   int* _status,
+                   int _nthreads){
+
+    if(_n_items < 1)
+      return 0;
+
+    if(!sqy::dypeline<raw_t>::can_be_built_from(_pipeline)){
+      std::fill(_status, _status + _n_items, 2);
+      return _n_items;
+    }
+
+    const omp_size_type n_items = _n_items;
+    const int n_threads = (std::max)(1,_nthreads);
+    const int outer_threads = _n_items >= n_threads ? n_threads : 1;
+    const int inner_threads = outer_threads > 1 ? 1 : n_threads;
+
+    int value = 0;
+
+#pragma omp parallel num_threads(outer_threads) shared(value)
+    {
+      auto pipe = guarded("SQY_PipelineEncodeBatch", sqy::dypeline<raw_t>(), [=](){
+          return sqy::dypeline<raw_t>::from_string(_pipeline);
+        });
+      pipe.set_n_threads(inner_threads);
+
+#pragma omp for schedule(dynamic) reduction(+:value)
+      for(omp_size_type i = 0;i<n_items;++i){
+
+        _status[i] = guarded("SQY_PipelineEncodeBatch", 2, [&](){
+            return encode_batch_item(pipe, i, _src, _shapes, _shape_sizes, _dst, _dstlengths);
+          });
+
+        if(_status[i])
+          value += 1;
+      }
+    }
+
+    return value;
+  }
+
+}
+
+int SQY_PipelineEncodeBatch_UI8(const char* pipeline,
+                                int n_items,
+                                const char** src,
+                                long** shapes,
+                                unsigned* shape_sizes,
+                                char** dst,
+                                long* dstlengths,
+                                int* status,
+                                int nthreads){
+
+  return encode_batch<std::uint8_t>(pipeline, n_items, src, shapes, shape_sizes, dst, dstlengths, status, nthreads);
+}
+
+int SQY_PipelineEncodeBatch_UI16(const char* pipeline,
+                                 int n_items,
+                                 const char** src,
+                                 long** shapes,
+                                 unsigned* shape_sizes,
+                                 char** dst,
+                                 long* dstlengths,
+                                 int* status,
+                                 int nthreads){
+
+  return encode_batch<std::uint16_t>(pipeline, n_items, src, shapes, shape_sizes, dst, dstlengths, status, nthreads);
+}
+
 int SQY_Pipeline_Max_Compressed_Length_UI8(const char* pipeline,
                                            long pipeline_length,
                                            long* length){
@@ -334,6 +499,208 @@ int SQY_Decode_UI8(const char* src, long srclength, char* dst, int nthreads){
   return value;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipeline handle interface
+
+namespace {
+
+  /**
+     \brief the pipelines a SQY_Pipeline handle keeps for one pixel type
+
+     the decoder is built from the pipeline stored in the header of the incoming buffer (like SQY_Decode_UI16 does)
+     and only rebuilt if a buffer with a different pipeline arrives
+  */
+  template <typename raw_t>
+  struct handle_pipelines {
+
+    sqy::dypeline<raw_t> encoder;
+    sqy::dypeline<raw_t> decoder;
+    std::string decoder_pipeline;
+
+    void set_n_threads(int _nthreads){
+      encoder.set_n_threads(_nthreads);
+      decoder.set_n_threads(_nthreads);
+    }
+
+    int encode(const char* _src, long* _shape, unsigned _shape_size, char* _dst, long* _dstlength){
+
+      std::vector<std::size_t> shape_(_shape, _shape+_shape_size);
+
+      char* encoded_end = encoder.encode(reinterpret_cast<const raw_t*>(_src),
+                                         _dst,
+                                         shape_);
+
+      if(!encoded_end)
+        return 1;
+
+      *_dstlength = encoded_end - _dst;
+      return 0;
+    }
+
+    /**
+       \brief decode _src into _dst
+
+       \return 0 on success, 2 if _src holds pixels of another width than raw_t (_dst is not touched then),
+       1 for any other error
+    */
+    int decode(const char* _src, long _srclength, char* _dst, int _nthreads){
+
+      sqy::header hdr(_src,_src+(_srclength));
+      if(hdr.empty()){
+        std::cerr << "[sqeazy]	 no valid header found in buffer of " << _srclength << " bytes\n";
+        return 1;
+      }
+
+      if(hdr.sizeof_header_type() != sizeof(raw_t)){
+        std::cerr << "[sqeazy]	 buffer holds pixels of " << hdr.sizeof_header_type()
+                  << " bytes, the handle was created for " << sizeof(raw_t) << " bytes\n";
+        return 2;
+      }
+
+      std::vector<std::size_t> inshape_  = {std::size_t(_srclength)};
+      std::vector<std::size_t> outshape_(hdr.shape()->begin(),hdr.shape()->end());
+
+      if(decoder.empty() || hdr.pipeline() != decoder_pipeline){
+
+        if(!sqy::dypeline<raw_t>::can_be_built_from(hdr.pipeline())){
+          std::cerr << "[sqeazy]\t" << hdr.pipeline() << " cannot be build with this version of sqeazy\n";
+          return 1;
+        }
+
+        decoder = sqy::dypeline<raw_t>::from_string(hdr.pipeline());
+        decoder.set_n_threads(_nthreads);
+        decoder_pipeline = hdr.pipeline();
+
+        if(decoder.empty()){
+          std::cerr << "[sqeazy]\t received " << decoder.name() << "pipeline of size 0, no decoding possible\n";
+          decoder_pipeline.clear();
+          return 1;
+        }
+      }
+
+      return decoder.decode(_src,
+                            reinterpret_cast<raw_t*>(_dst),
+                            inshape_,
+                            outshape_);
+    }
+
+    long max_encoded_size(long* _shape, unsigned _shape_size) const {
+
+      std::uintmax_t size_in_byte = sizeof(raw_t)*std::accumulate(_shape,_shape+_shape_size,1,std::multiplies<long>());
+      return encoder.max_encoded_size(size_in_byte);
+    }
+  };
+
+  template <typename raw_t>
+  bool build_encoder(handle_pipelines<raw_t>& _pipelines, const char* _pipeline, int _nthreads){
+
+    if(!sqy::dypeline<raw_t>::can_be_built_from(_pipeline))
+      return false;
+
+    _pipelines.encoder = sqy::dypeline<raw_t>::from_string(_pipeline);
+    if(_pipelines.encoder.empty()){
+      std::cerr << "[sqeazy]\t received " << _pipelines.encoder.name() << "pipeline of size 0, cannot create handle\n";
+      return false;
+    }
+
+    _pipelines.set_n_threads(_nthreads);
+    return true;
+  }
+
+}
+
+struct SQY_Pipeline {
+
+  int sizeofpixel;
+  int nthreads;
+
+  handle_pipelines<std::uint8_t> ui8;
+  handle_pipelines<std::uint16_t> ui16;
+
+};
+
+SQY_Pipeline* SQY_Pipeline_Create(const char* pipeline, int sizeofpixel, int nthreads){
+
+  if(!pipeline || (sizeofpixel != 1 && sizeofpixel != 2))
+    return nullptr;
+
+  return guarded("SQY_Pipeline_Create", (SQY_Pipeline*)nullptr, [=]() -> SQY_Pipeline* {
+
+      std::unique_ptr<SQY_Pipeline> value(new SQY_Pipeline());
+      value->sizeofpixel = sizeofpixel;
+      value->nthreads = nthreads;
+
+      const bool built = sizeofpixel == 2 ? build_encoder(value->ui16, pipeline, nthreads)
+        : build_encoder(value->ui8, pipeline, nthreads);
+
+      return built ? value.release() : nullptr;
+    });
+}
+
+int SQY_Pipeline_Encode(SQY_Pipeline* handle,
+                        const char* src,
+                        long* shape,
+                        unsigned shape_size,
+                        char* dst,
+                        long* dstlength){
+
+  if(!handle)
+    return 1;
+
+  return guarded("SQY_Pipeline_Encode", 1, [=](){
+      if(handle->sizeofpixel == 2)
+        return handle->ui16.encode(src, shape, shape_size, dst, dstlength);
+      else
+        return handle->ui8.encode(src, shape, shape_size, dst, dstlength);
+    });
+}
+
+int SQY_Pipeline_Decode(SQY_Pipeline* handle, const char* src, long srclength, char* dst){
+
+  if(!handle)
+    return 1;
+
+  return guarded("SQY_Pipeline_Decode", 1, [=](){
+      if(handle->sizeofpixel == 2)
+        return handle->ui16.decode(src, srclength, dst, handle->nthreads);
+      else
+        return handle->ui8.decode(src, srclength, dst, handle->nthreads);
+    });
+}
+
+int SQY_Pipeline_MaxCompressedLength(SQY_Pipeline* handle, long* shape, unsigned shape_size, long* length){
+
+  if(!handle)
+    return 1;
+
+  return guarded("SQY_Pipeline_MaxCompressedLength", 1, [=](){
+      if(handle->sizeofpixel == 2)
+        *length = handle->ui16.max_encoded_size(shape, shape_size);
+      else
+        *length = handle->ui8.max_encoded_size(shape, shape_size);
+
+      return 0;
+    });
+}
+
+int SQY_Pipeline_SetThreads(SQY_Pipeline* handle, int nthreads){
+
+  if(!handle)
+    return 1;
+
+  handle->nthreads = nthreads;
+  handle->ui8.set_n_threads(nthreads);
+  handle->ui16.set_n_threads(nthreads);
+
+  return 0;
+}
+
+int SQY_Pipeline_Destroy(SQY_Pipeline* handle){
+
+  delete handle;
+  return 0;
+}
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 // H5 interface
@@ -476,6 +843,49 @@ int SQY_h5_write_UI16(const char* fname,
   return rvalue;
 }
 
+int SQY_h5_write_parallel_UI16(const char* fname,
+                               const char* dname,
+                               const unsigned short* data,
+                               unsigned shape_size,
+                               const unsigned* shape,
+                               const char* filter,
+                               const unsigned* chunk_shape,
+                               int nthreads){
+
+  int rvalue = 1;
+  #ifndef _SQY_DEBUG_
+  H5::Exception::dontPrint();
+#endif
+
+  bfs::path src_p = fname;
+
+  sqy::h5_file loaded(src_p, bfs::exists(src_p) ? H5F_ACC_RDWR : H5F_ACC_TRUNC);
+
+  if(!loaded.ready())
+    return rvalue;
+
+  std::string in_filter = filter ? filter : "";
+  std::vector<hsize_t> chunks;
+  if(chunk_shape)
+    chunks.assign(chunk_shape, chunk_shape + shape_size);
+
+  if(in_filter.empty())
+    rvalue = loaded.write_nd_dataset(dname,
+                                     data,
+                                     shape,
+                                     shape_size);
+  else
+    rvalue = loaded.write_nd_dataset_parallel(dname,
+                                              in_filter,
+                                              data,
+                                              shape,
+                                              shape_size,
+                                              chunks,
+                                              nthreads);
+
+  return rvalue;
+}
+
 int SQY_h5_write(const char* fname,
          const char* dname,
          const char* data,
@@ -526,6 +936,63 @@ int SQY_h5_read_UI16(const char* fname,
   return rvalue;
 }
 
+int SQY_h5_read_parallel_UI16(const char* fname,
+                              const char* dname,
+                              unsigned short* data,
+                              int nthreads){
+  int rvalue = 1;
+#ifndef _SQY_DEBUG_
+  H5::Exception::dontPrint();
+#endif
+  bfs::path lpath = fname;
+  sqy::h5_file loaded(lpath);
+
+  if(!loaded.ready())
+    return rvalue;
+  if(!loaded.has_h5_item(dname))
+    return rvalue;
+  else{
+    std::vector<unsigned> shape;
+    rvalue = loaded.read_nd_dataset_parallel(dname,
+                                             data,
+                                             shape,
+                                             nthreads);
+  }
+
+  return rvalue;
+}
+
+int SQY_h5_read_region_UI16(const char* fname,
+                            const char* dname,
+                            unsigned shape_size,
+                            const unsigned* lo,
+                            const unsigned* hi,
+                            unsigned short* data,
+                            int nthreads){
+  int rvalue = 1;
+#ifndef _SQY_DEBUG_
+  H5::Exception::dontPrint();
+#endif
+  bfs::path lpath = fname;
+  sqy::h5_file loaded(lpath);
+
+  if(!loaded.ready())
+    return rvalue;
+  if(!loaded.has_h5_item(dname))
+    return rvalue;
+  else{
+    std::vector<unsigned> lo_(lo, lo + shape_size);
+    std::vector<unsigned> hi_(hi, hi + shape_size);
+    rvalue = loaded.read_nd_region(dname,
+                                   data,
+                                   lo_,
+                                   hi_,
+                                   nthreads);
+  }
+
+  return rvalue;
+}
+
 int SQY_h5_link(const char* pSrcFileName,
         const char* pSrcLinkPath,
         const char* pSrcLinkName,
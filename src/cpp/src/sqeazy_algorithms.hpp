@@ -414,6 +414,84 @@ namespace sqeazy {
     return _out + len;
   }
 
+  /**
+     \brief compute the permutation that sorts [_begin,_end) in ascending order, i.e. _begin[_out[0]] <= _begin[_out[1]] <= ...
+
+     ties are resolved by the original index, so the result is the one of a stable sort and does not depend on _nthreads;
+     the index range is split into one block per thread, every block is sorted in parallel and the blocks are merged
+     pairwise afterwards (again in parallel)
+
+     \param[in] _begin begin of the values to sort by
+     \param[in] _end end of the values to sort by
+     \param[out] _out random access iterator to a range of at least std::distance(_begin,_end) indices
+     \param[in] _nthreads number of threads to use (0 or less means all available)
+
+     \return iterator past the last index written to _out
+  */
+  template <typename iter_t, typename out_iter_t>
+  out_iter_t argsort(iter_t _begin, iter_t _end,
+                     out_iter_t _out,
+                     int _nthreads = 1){
+
+    typedef typename std::iterator_traits<out_iter_t>::value_type index_t;
+
+    if(_nthreads <= 0)
+      _nthreads = std::thread::hardware_concurrency();
+
+    const omp_size_type len = std::distance(_begin,_end);
+    const out_iter_t out_end = _out + len;
+
+    std::iota(_out, out_end, index_t(0));
+
+    auto less = [&_begin](const index_t& _lhs, const index_t& _rhs){
+      const auto& lvalue = *(_begin + _lhs);
+      const auto& rvalue = *(_begin + _rhs);
+      return lvalue < rvalue || (!(rvalue < lvalue) && _lhs < _rhs);
+    };
+
+    //small inputs are not worth the overhead
+    if(len < omp_size_type(_nthreads)*(1 << 12))
+      _nthreads = 1;
+
+    if(_nthreads == 1){
+      std::sort(_out, out_end, less);
+      return out_end;
+    }
+
+    const omp_size_type n_blocks = _nthreads;
+    std::vector<omp_size_type> bounds(n_blocks+1,0);
+    for(omp_size_type b = 0;b<=n_blocks;++b)
+      bounds[b] = (b*len)/n_blocks;
+
+    auto pbounds = bounds.data();
+
+#pragma omp parallel for                        \
+  firstprivate(pbounds)                         \
+  num_threads(_nthreads)
+    for(omp_size_type b = 0;b<n_blocks;++b){
+      std::sort(_out + pbounds[b], _out + pbounds[b+1], less);
+    }
+
+    for(omp_size_type width = 1;width<n_blocks;width *= 2){
+
+      const omp_size_type n_merges = (n_blocks + 2*width - 1)/(2*width);
+
+#pragma omp parallel for                        \
+  firstprivate(pbounds)                         \
+  num_threads(_nthreads)
+      for(omp_size_type m = 0;m<n_merges;++m){
+        const omp_size_type first = m*2*width;
+        const omp_size_type middle = (std::min)(first + width, n_blocks);
+        const omp_size_type last = (std::min)(first + 2*width, n_blocks);
+
+        if(middle < last)
+          std::inplace_merge(_out + pbounds[first], _out + pbounds[middle], _out + pbounds[last], less);
+      }
+    }
+
+    return out_end;
+  }
+
 
 };
 
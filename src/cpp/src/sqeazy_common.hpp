@@ -54,6 +54,40 @@ namespace sqeazy {
     unique_array<T> value(reinterpret_cast<T*>(boost::alignment::aligned_alloc(align,nbytes)));
     return value;
   }
+
+  /**
+     \brief allows the parallel regions opened inside the next parallel region to run on threads of their own
+     (nested OpenMP) while the object lives, the previous limit of active levels is restored on destruction
+
+     schemes that spread items over outer threads and hand the spare threads to the per-item pipelines need it,
+     otherwise OpenMP serializes the inner regions; nothing is changed if _inner_threads is 1
+  */
+  struct nested_parallelism {
+
+    int previous_levels_;
+
+    nested_parallelism(int _inner_threads):
+      previous_levels_(-1)
+    {
+#ifdef _OPENMP
+      const int required = omp_get_active_level() + 2;
+      if(_inner_threads > 1 && omp_get_max_active_levels() < required){
+        previous_levels_ = omp_get_max_active_levels();
+        omp_set_max_active_levels(required);
+      }
+#endif
+    }
+
+    ~nested_parallelism(){
+#ifdef _OPENMP
+      if(previous_levels_ >= 0)
+        omp_set_max_active_levels(previous_levels_);
+#endif
+    }
+
+    nested_parallelism(const nested_parallelism&) = delete;
+    nested_parallelism& operator=(const nested_parallelism&) = delete;
+  };
   /**
      \brief this namespace is meant for helpers related to the platform sqeazy was compiled on
 
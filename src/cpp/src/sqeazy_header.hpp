@@ -1,7 +1,9 @@
 #ifndef _SQEAZY_HEADER_H_
 #define _SQEAZY_HEADER_H_
 
+#include <atomic>
 #include <cctype>
+#include <cstdlib>
 #include <numeric>
 #include <algorithm>
 #include <vector>
@@ -49,6 +51,39 @@ namespace sqeazy {
     static std::string header_end_delim;
     static const std::string header_end_delimeter() { return header_end_delim; }
 
+    /**
+       \brief layout a header is written in, process_default follows writes_binary()
+    */
+    enum layout {
+      process_default = 0,
+      json = 1,
+      binary = 2
+    };
+
+    /**
+       \brief true if the constructors write the binary header of pack_binary, false (default) if they write the
+       JSON header of pack
+
+       JSON headers can be read by every sqeazy version and HDF5 filter plugin, binary headers only by versions
+       that know pack_binary (both are always read); the default can be changed with the environment variable
+       SQY_HEADER=binary or with write_binary, containers that older versions cannot read anyway (chunked_pipeline)
+       ask for the binary layout per header instead
+    */
+    static bool writes_binary() {
+      return binary_by_default().load(std::memory_order_relaxed);
+    }
+
+    static bool writes_binary(layout _layout) {
+      return _layout == binary || (_layout == process_default && writes_binary());
+    }
+
+    /**
+       \brief choose the header layout of all headers constructed afterwards in this process (with process_default)
+    */
+    static void write_binary(bool _flag) {
+      binary_by_default().store(_flag, std::memory_order_relaxed);
+    }
+
 
     // typedef T value_type;
 
@@ -58,6 +93,7 @@ namespace sqeazy {
     std::string pipeline_;
     std::string raw_type_name_;
     std::intmax_t compressed_size_byte_;
+    std::string side_section_;
 
     /**
        \brief swap
@@ -76,6 +112,7 @@ namespace sqeazy {
       std::swap(_lhs.pipeline_, _rhs.pipeline_);
       std::swap(_lhs.raw_type_name_, _rhs.raw_type_name_);
       std::swap(_lhs.compressed_size_byte_, _rhs.compressed_size_byte_);
+      std::swap(_lhs.side_section_, _rhs.side_section_);
     }
 
     /**
@@ -92,7 +129,8 @@ namespace sqeazy {
       raw_shape_(0),
       pipeline_(""),
       raw_type_name_(sqeazy::header_utils::represent<void>::as_string()),
-      compressed_size_byte_(0)
+      compressed_size_byte_(0),
+      side_section_()
     {
     }
 
@@ -110,7 +148,8 @@ namespace sqeazy {
       raw_shape_		(_rhs.raw_shape_              ),
       pipeline_		(_rhs.pipeline_               ),
       raw_type_name_		(_rhs.raw_type_name_          ),
-      compressed_size_byte_	(_rhs.compressed_size_byte_   )
+      compressed_size_byte_	(_rhs.compressed_size_byte_   ),
+      side_section_		(_rhs.side_section_           )
     {
     }
 
@@ -132,6 +171,7 @@ namespace sqeazy {
 
     /**
        \brief pack takes the parameters of a to-compress/compressed nD data set and packs them into a JSON compatible string, the output string needs to be aligned to raw_type
+       (the format written by the constructors unless writes_binary() is set)
 
        \param[in]  raw_type data type of the nD data set to compress
        \param[in] _dims shape of the nD data set to compress
@@ -192,18 +232,143 @@ namespace sqeazy {
       return std::string(stripped);
     }
 
+    /**
+       \brief fixed layout of the binary header (all integers little-endian), this is the format written by
+       the constructors if writes_binary() is set; NOTE: sqeazy versions and HDF5 filter plugins built before
+       this format was introduced cannot read it, which is why JSON (pack) remains the default
+
+       offset  bytes     content
+       0       4         magic "SQYB"
+       4       1         format version (1)
+       5       1         rank
+       6       2         flags (bit 0: side section present, all other bits 0)
+       8       4         size of the complete header in bytes
+       12      3         sqeazy version (major, minor, patch)
+       15      1         reserved (0)
+       16      8         encoded bytes
+       24      8*rank    shape
+       ...     1+n       raw type name (length, characters)
+       ...     4+n       pipeline (length, characters)
+       ...     1+n       sqeazy head reference (length, characters)
+       ...     4+n       side section (length, bytes), only if flags bit 0 is set
+       ...               zero padding so that the header size is a multiple of sizeof(raw_type)
+       ...     8         header_end_delim
+    */
+    static const std::string& binary_magic() {
+      static const std::string value("SQYB");
+      return value;
+    }
+
+    static const std::uint8_t binary_format_version = 1;
+    static const std::size_t binary_fixed_bytes = 24;
+    static const std::uint16_t side_section_flag = 1;
+
+    /**
+       \brief pack takes the parameters of a to-compress/compressed nD data set and packs them into a binary string
+       of fixed layout (see binary_magic), the output string is aligned to raw_type
+
+       \param[in]  raw_type data type of the nD data set to compress
+       \param[in] _dims shape of the nD data set to compress
+       \param[in] _pipename sqy pipeline used
+       \param[in] _payload_bytes size of the sqy compressed buffer in Byte
+       \param[in] _side_section binary data of the stages (e.g. decode maps) the pipeline refers to by offset
+
+       \return std::string that contains the binary header
+       \retval
+
+    */
+    template <typename raw_type,typename size_type>
+    static const std::string pack_binary(const std::vector<size_type>& _dims,
+                                         const std::string& _pipe_name = "no_pipeline",
+                                         const unsigned long& _payload_bytes = 0,
+                                         const std::string& _side_section = ""
+                                         ) {
+
+      const std::string raw_type_name = sqeazy::header_utils::represent<raw_type>::as_string();
+      const std::string headref(sqeazy_global_refhash);
+
+      if(_dims.size() > 0xff || raw_type_name.size() > 0xff || headref.size() > 0xff)
+        throw std::runtime_error("[sqeazy::header::pack_binary] rank or type name exceed the binary header limits");
+
+      std::size_t bytes = binary_fixed_bytes + 8*_dims.size()
+        + 1 + raw_type_name.size()
+        + 4 + _pipe_name.size()
+        + 1 + headref.size()
+        + (_side_section.empty() ? 0 : 4 + _side_section.size());
+
+      if(bytes + sizeof(raw_type) + header_end_delim.size() > 0xffffffffu)
+        throw std::runtime_error("[sqeazy::header::pack_binary] header exceeds 4 GB");
+
+      const std::size_t padding = (sizeof(raw_type) - ((bytes + header_end_delim.size()) % sizeof(raw_type))) % sizeof(raw_type);
+      bytes += padding + header_end_delim.size();
+
+      std::string value(bytes, '\0');
+      char* dst = &value[0];
+
+      dst = std::copy(binary_magic().begin(), binary_magic().end(), dst);
+      dst = put_le<std::uint8_t>(dst, binary_format_version);
+      dst = put_le<std::uint8_t>(dst, _dims.size());
+      dst = put_le<std::uint16_t>(dst, _side_section.empty() ? 0 : side_section_flag);
+      dst = put_le<std::uint32_t>(dst, bytes);
+      dst = put_le<std::uint8_t>(dst, sqeazy_global_version_major);
+      dst = put_le<std::uint8_t>(dst, sqeazy_global_version_minor);
+      dst = put_le<std::uint8_t>(dst, sqeazy_global_version_patch);
+      dst = put_le<std::uint8_t>(dst, 0);
+      dst = put_le<std::uint64_t>(dst, _payload_bytes);
+
+      for(const size_type& dim : _dims)
+        dst = put_le<std::uint64_t>(dst, dim);
+
+      dst = put_le<std::uint8_t>(dst, raw_type_name.size());
+      dst = std::copy(raw_type_name.begin(), raw_type_name.end(), dst);
+      dst = put_le<std::uint32_t>(dst, _pipe_name.size());
+      dst = std::copy(_pipe_name.begin(), _pipe_name.end(), dst);
+      dst = put_le<std::uint8_t>(dst, headref.size());
+      dst = std::copy(headref.begin(), headref.end(), dst);
+
+      if(!_side_section.empty()){
+        dst = put_le<std::uint32_t>(dst, _side_section.size());
+        dst = std::copy(_side_section.begin(), _side_section.end(), dst);
+      }
+
+      dst += padding;
+      std::copy(header_end_delim.begin(), header_end_delim.end(), dst);
+
+      return value;
+    }
+
+    /**
+       \brief pack with pack_binary if _binary is set, with pack otherwise (JSON headers have no side section)
+    */
+    template <typename raw_type,typename size_type>
+    static const std::string pack_as(bool _binary,
+                                     const std::vector<size_type>& _dims,
+                                     const std::string& _pipe_name,
+                                     const unsigned long& _payload_bytes,
+                                     const std::string& _side_section = "") {
+
+      if(!_binary && !_side_section.empty())
+        throw std::runtime_error("[sqeazy::header::pack_as] a side section requires the binary layout");
+
+      return _binary ?
+        pack_binary<raw_type>(_dims, _pipe_name, _payload_bytes, _side_section) :
+        pack<raw_type>(_dims, _pipe_name, _payload_bytes);
+    }
+
     template <typename value_type,
               typename size_type
               >
     header(value_type,
                  const std::vector<size_type>& _dims,
                  const std::string& _pipe_name = "no_pipeline",
-                 const unsigned long& _payload_bytes = 0):
+                 const unsigned long& _payload_bytes = 0,
+                 layout _layout = process_default):
       header_(""),
       raw_shape_(_dims.begin(), _dims.end()),
       pipeline_(_pipe_name),
       raw_type_name_(sqeazy::header_utils::represent<value_type>::as_string()),
-      compressed_size_byte_(_payload_bytes)
+      compressed_size_byte_(_payload_bytes),
+      side_section_()
     {
 
 
@@ -212,9 +377,10 @@ namespace sqeazy {
       }
 
       try{
-        header_ = pack<value_type>(raw_shape_,
-                                   pipeline_,
-                                   compressed_size_byte_);
+        header_ = pack_as<value_type>(writes_binary(_layout),
+                                      raw_shape_,
+                                      pipeline_,
+                                      compressed_size_byte_);
       }
       catch(...){
         std::cerr << "["<< __FILE__ <<":" << __LINE__ <<"]\t unable to pack pipe!\n";
@@ -226,12 +392,14 @@ namespace sqeazy {
     header(value_type,
                  unsigned long _raw_in_byte,
                  const std::string& _pipe_name = "no_pipeline",
-                 const unsigned long& _payload_bytes = 0):
+                 const unsigned long& _payload_bytes = 0,
+                 layout _layout = process_default):
       header_(""),
       raw_shape_(1, _raw_in_byte),
       pipeline_(_pipe_name),
       raw_type_name_(sqeazy::header_utils::represent<value_type>::as_string()),
-      compressed_size_byte_(_payload_bytes)
+      compressed_size_byte_(_payload_bytes),
+      side_section_()
     {
 
       if(!_payload_bytes){
@@ -239,9 +407,10 @@ namespace sqeazy {
       }
 
       try{
-        header_ = pack<value_type>(raw_shape_,
-                                   pipeline_,
-                                   compressed_size_byte_);
+        header_ = pack_as<value_type>(writes_binary(_layout),
+                                      raw_shape_,
+                                      pipeline_,
+                                      compressed_size_byte_);
       }
       catch(...){
         std::cerr << "["<< __FILE__ <<":" << __LINE__ <<"]\t unable to pack pipe!\n";
@@ -254,9 +423,12 @@ namespace sqeazy {
       compressed_size_byte_ = _new;
 
       try{
-        header_ = pack<value_type>(raw_shape_,
-                                   pipeline_,
-                                   compressed_size_byte_);
+        //keep the layout the header was written in
+        header_ = pack_as<value_type>(header_.empty() ? writes_binary() : is_binary(header_.begin(), header_.end()),
+                                      raw_shape_,
+                                      pipeline_,
+                                      compressed_size_byte_,
+                                      side_section_);
       }
       catch(...){
         std::cerr << "["<< __FILE__ <<":" << __LINE__ <<"]\t unable to pack pipe!\n";
@@ -269,9 +441,33 @@ namespace sqeazy {
       pipeline_ = _pname;
 
       try{
-        header_ = pack<value_type>(raw_shape_,
-                                   pipeline_,
-                                   compressed_size_byte_);
+        //keep the layout the header was written in
+        header_ = pack_as<value_type>(header_.empty() ? writes_binary() : is_binary(header_.begin(), header_.end()),
+                                      raw_shape_,
+                                      pipeline_,
+                                      compressed_size_byte_,
+                                      side_section_);
+      }
+      catch(...){
+        std::cerr << "["<< __FILE__ <<":" << __LINE__ <<"]\t unable to pack pipe!\n";
+      }
+    }
+
+    /**
+       \brief set the side section (binary stage data the pipeline refers to by offset), only binary headers
+       can carry it
+    */
+    template <typename value_type>
+    void set_side_section(const std::string& _section)
+    {
+      side_section_ = _section;
+
+      try{
+        header_ = pack_as<value_type>(header_.empty() ? writes_binary() : is_binary(header_.begin(), header_.end()),
+                                      raw_shape_,
+                                      pipeline_,
+                                      compressed_size_byte_,
+                                      side_section_);
       }
       catch(...){
         std::cerr << "["<< __FILE__ <<":" << __LINE__ <<"]\t unable to pack pipe!\n";
@@ -294,6 +490,9 @@ namespace sqeazy {
     template <typename iter_type>
     static const header unpack(iter_type _begin, iter_type _end) {
 
+      if(is_binary(_begin, _end))
+        return unpack_binary(&*_begin, std::distance(_begin, _end));
+
       iter_type header_end_ptr = header_end(_begin, _end);
 
       if(!valid_header(_begin,header_end_ptr)){
@@ -344,6 +543,162 @@ namespace sqeazy {
     }
 
 
+    /**
+       \brief non-owning view of a binary header (see binary_magic): parse checks the fixed fields and keeps
+       pointers into the buffer for the rest, nothing is copied or allocated, so the buffer must outlive the view;
+       this is what the per-chunk decode paths use instead of constructing a header
+    */
+    struct view {
+
+      const char* begin_ = nullptr;
+      std::size_t size_ = 0;
+      std::size_t rank_ = 0;
+      const char* shape_ = nullptr;
+      std::uint64_t compressed_size_byte_ = 0;
+      boost::string_ref raw_type_;
+      boost::string_ref pipeline_;
+      boost::string_ref side_section_;
+
+      /**
+         \brief parse the binary header at the start of _begin (_len bytes available)
+
+         \return 0 on success, 1 if _begin does not start with a binary header, 2 if it is truncated or
+         malformed (the view is empty unless 0 is returned)
+      */
+      int parse(const char* _begin, std::size_t _len) {
+
+        *this = view();
+
+        if(!is_binary(_begin, _begin + _len))
+          return 1;
+
+        if(_len < binary_fixed_bytes)
+          return 2;
+
+        const char* src = _begin + binary_magic().size();
+        const std::uint8_t format_version = get_le<std::uint8_t>(src);
+        const std::uint8_t rank = get_le<std::uint8_t>(src);
+        const std::uint16_t flags = get_le<std::uint16_t>(src);
+        const std::uint32_t bytes = get_le<std::uint32_t>(src);
+
+        if(format_version != binary_format_version || bytes > _len || bytes < binary_fixed_bytes + header_end_delim.size())
+          return 2;
+
+        const char* end = _begin + bytes;
+        if(!std::equal(header_end_delim.begin(), header_end_delim.end(), end - header_end_delim.size()))
+          return 2;
+
+        src += 4;//sqeazy version + reserved
+        const std::uint64_t encoded_bytes = get_le<std::uint64_t>(src);
+
+        auto available = [&](std::size_t _bytes){ return std::size_t(std::distance(src,end)) >= _bytes; };
+
+        if(!available(8*std::size_t(rank) + 1))
+          return 2;
+        const char* shape = src;
+        src += 8*std::size_t(rank);
+
+        const std::uint8_t type_len = get_le<std::uint8_t>(src);
+        if(!available(type_len + 4))
+          return 2;
+        const boost::string_ref raw_type(src, type_len);
+        src += type_len;
+
+        const std::uint32_t pipe_len = get_le<std::uint32_t>(src);
+        if(!available(pipe_len + 1))
+          return 2;
+        const boost::string_ref pipeline(src, pipe_len);
+        src += pipe_len;
+
+        boost::string_ref side_section;
+        if(flags & side_section_flag){
+          const std::uint8_t headref_len = get_le<std::uint8_t>(src);
+          if(!available(headref_len + 4))
+            return 2;
+          src += headref_len;
+
+          const std::uint32_t side_len = get_le<std::uint32_t>(src);
+          if(!available(side_len))
+            return 2;
+          side_section = boost::string_ref(src, side_len);
+        }
+
+        begin_ = _begin;
+        size_ = bytes;
+        rank_ = rank;
+        shape_ = shape;
+        compressed_size_byte_ = encoded_bytes;
+        raw_type_ = raw_type;
+        pipeline_ = pipeline;
+        side_section_ = side_section;
+
+        return 0;
+      }
+
+      bool empty() const { return size_ == 0; }
+
+      std::size_t size() const { return size_; }
+
+      std::size_t rank() const { return rank_; }
+
+      std::size_t dim(std::size_t _d) const { return peek_le<std::uint64_t>(shape_ + 8*_d); }
+
+      /**
+         \brief fill _dims with the shape, _dims keeps its capacity so a reused vector does not allocate
+      */
+      template <typename U>
+      void shape(std::vector<U>& _dims) const {
+        _dims.resize(rank_);
+        for(std::size_t d = 0;d<rank_;++d)
+          _dims[d] = dim(d);
+      }
+
+      boost::string_ref pipeline() const { return pipeline_; }
+
+      boost::string_ref raw_type() const { return raw_type_; }
+
+      /**
+         \brief binary stage data stored after the fixed fields (empty if the header has none), stages refer to it
+         by offset and length in their config
+      */
+      boost::string_ref side_section() const { return side_section_; }
+
+      std::intmax_t compressed_size_byte() const { return compressed_size_byte_; }
+    };
+
+    /**
+       \brief parse a binary header (see binary_magic) found at the start of _begin (_len bytes available)
+       and copy its fields into a header, paths that only need to look at the fields use view instead
+
+       \return header, throws std::runtime_error if the header is truncated or malformed
+    */
+    static const header unpack_binary(const char* _begin, std::size_t _len) {
+
+      view parsed;
+      if(parsed.parse(_begin, _len))
+        throw std::runtime_error("[sqeazy::header::unpack_binary] received truncated or malformed header");
+
+      header value;
+      value.compressed_size_byte_ = parsed.compressed_size_byte();
+      parsed.shape(value.raw_shape_);
+      value.raw_type_name_ = parsed.raw_type().to_string();
+      value.pipeline_ = parsed.pipeline().to_string();
+      value.side_section_ = parsed.side_section().to_string();
+      value.header_.assign(_begin, _begin + parsed.size());
+
+      return value;
+    }
+
+    /**
+       \brief check if _begin to _end starts with a binary header (only the magic is checked)
+    */
+    template <typename iter_type>
+    static const bool is_binary(iter_type _begin, iter_type _end) {
+
+      const std::size_t len = std::distance(_begin,_end);
+      return len >= binary_magic().size() && std::equal(binary_magic().begin(), binary_magic().end(), _begin);
+    }
+
     /**
        \brief constructor that creates the header as much as possible from a string (the header will remain at size 0 if any error occurs)
 
@@ -358,7 +713,8 @@ namespace sqeazy {
       raw_shape_(0),
       pipeline_(""),
       raw_type_name_(sqeazy::header_utils::represent<void>::as_string()),
-      compressed_size_byte_(0){
+      compressed_size_byte_(0),
+      side_section_(){
 
 
       header rhs;
@@ -381,7 +737,8 @@ namespace sqeazy {
       raw_shape_(0),
       pipeline_(""),
       raw_type_name_(sqeazy::header_utils::represent<void>::as_string()),
-      compressed_size_byte_(0){
+      compressed_size_byte_(0),
+      side_section_(){
 
 
       header rhs;
@@ -456,6 +813,10 @@ namespace sqeazy {
 
     }
 
+    const std::string& side_section() const {
+      return side_section_;
+    }
+
 
     std::string raw_type() const {
       return raw_type_name_;
@@ -506,6 +867,13 @@ namespace sqeazy {
     template <typename Iter>
     static const bool valid_header(Iter _begin, Iter _end){
 
+      if(is_binary(_begin,_end)){
+        const std::size_t len = std::distance(_begin,_end);
+        return len >= binary_fixed_bytes + header_end_delimeter().size() &&
+          peek_le<std::uint32_t>(&*_begin + 8) == len &&
+          ends_with(_begin,_end,header_end_delimeter());
+      }
+
       bool value = std::count(_begin,_end, '}');
       value = value && std::count(_begin,_end, '}') ==  std::count(_begin,_end, '{');
       value = value && std::count(_begin,_end, ':')>1;
@@ -526,6 +894,13 @@ namespace sqeazy {
     static const iter_type header_end(iter_type _begin, iter_type _end){
 
       const std::size_t len = std::distance(_begin,_end);
+
+      //the binary header stores its size, no need to search for the delimiter
+      if(is_binary(_begin,_end) && len >= binary_fixed_bytes){
+        const std::size_t bytes = peek_le<std::uint32_t>(&*_begin + 8);
+        return bytes <= len ? _begin + bytes : _end;
+      }
+
       boost::string_ref buffer(&*_begin,len);
       iter_type value = _end;
       auto fpos = buffer.find(header_end_delimeter());
@@ -568,6 +943,28 @@ namespace sqeazy {
       return unpacked.raw_type_name_;
     }
 
+    template <typename T>
+    static char* put_le(char* _dst, std::uint64_t _value){
+      for(std::size_t i = 0;i<sizeof(T);++i)
+        *_dst++ = static_cast<char>((_value >> (8*i)) & 0xff);
+      return _dst;
+    }
+
+    template <typename T>
+    static T peek_le(const char* _src){
+      std::uint64_t value = 0;
+      for(std::size_t i = 0;i<sizeof(T);++i)
+        value |= std::uint64_t(static_cast<unsigned char>(_src[i])) << (8*i);
+      return static_cast<T>(value);
+    }
+
+    template <typename T>
+    static T get_le(const char*& _src){
+      T value = peek_le<T>(_src);
+      _src += sizeof(T);
+      return value;
+    }
+
     friend inline bool operator==(const header& _left, const header& _right)
     {
       bool value = true;
@@ -576,10 +973,22 @@ namespace sqeazy {
       value = value && _left.pipeline_ ==  _right.pipeline_;
       value = value && _left.raw_type_name_ ==  _right.raw_type_name_;
       value = value && _left.compressed_size_byte_ ==  _right.compressed_size_byte_;
+      value = value && _left.side_section_ ==  _right.side_section_;
       return value;
     }
 
     friend inline bool operator!=(const header& lhs, const header& rhs){return !(lhs == rhs);}
+
+  private:
+
+    //in-class definition, i.e. inline: one flag per process, not per translation unit; atomic as
+    //write_binary may be called while other threads construct headers
+    static std::atomic<bool>& binary_by_default() {
+
+      static std::atomic<bool> value(std::getenv("SQY_HEADER") && std::string(std::getenv("SQY_HEADER")) == "binary");
+
+      return value;
+    }
   };
 
 
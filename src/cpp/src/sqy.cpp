@@ -14,6 +14,7 @@
 
 #include "verbs/detail.hpp"
 #include "sqeazy_pipelines.hpp"
+#include "simd_dispatch.hpp"
 #include "string_shapers.hpp"
 
 namespace po = boost::program_options;
@@ -234,6 +235,8 @@ int main(int argc, char *argv[])
     ("dataset_name,d", po::value<std::string>()->default_value("sqy_stack"), "name of the HDF5 dataset to appear inside any of .h5 encoded files (ignored for native .sqy compression)")
     ("output_name,o", po::value<std::string>(), "file location to write output to (if only 1 is given)")
     ("output_suffix,e", po::value<std::string>()->default_value(".sqy"), "file extension to be used (must include period)")
+    ("chunk_shape,k", po::value<std::string>(), "compress .sqy output into independently decodable chunks of this shape given in the order of the stack dimensions, e.g. 16x256x256 (enables reading sub-volumes without decompressing the entire stack); for .h5 output it sets the hdf5 chunk shape and the chunks are compressed in parallel")
+    ("jobs,j", po::value<int>()->default_value(1), "number of files to compress concurrently if several files are given, each with --nthreads threads (for more than 1, loading, compressing and writing of consecutive files overlap)")
     ;
 
   descriptions["bench"].add(general_po).add_options()
@@ -336,7 +339,8 @@ int main(int argc, char *argv[])
       //FIXME: introduce versioing infrastructure
       std::cout << "sqy "
                 << sqeazy_global_version << " ("
-                << sqeazy_global_refhash <<")\n";
+                << sqeazy_global_refhash <<")\n"
+                << "simd: " << sqeazy::simd::active_name() << "\n";
       return 1;
     }
 
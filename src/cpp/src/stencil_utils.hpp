@@ -0,0 +1,336 @@
+#ifndef _STENCIL_UTILS_H_
+#define _STENCIL_UTILS_H_
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <limits>
+
+#include "sqeazy_common.hpp"
+#include "traits.hpp"
+#include "neighborhood_utils.hpp"
+
+namespace sqeazy {
+
+  /**
+     \brief box filter engine for the neighborhood based schemes (diff_scheme, flatten_to_neighborhood_scheme)
+
+     for every pixel whose Neighborhood lies completely inside the volume (the non-halo region), the sum of
+     _transform(value) over the Neighborhood is handed to a visitor; the sums are not computed pixel by pixel,
+     but with separable running sums: a z-window accumulator per block that slides along z, a column
+     accumulator that slides along y and a scalar that slides along x; the volume is cut into z/y/x blocks
+     whose accumulator fits into L2 and the blocks are distributed among threads
+  */
+  namespace stencil {
+
+    //half of a typical L2, the other half is left for the input rows streaming through
+    static const std::size_t l2_budget_bytes = 128 << 10;
+    static const std::size_t max_block_width = 4096;
+
+    /**
+       \brief which pixels are visited: only those whose Neighborhood lies completely inside the volume
+       (skip_halo) or all of them with the Neighborhood clipped to the volume (clip_to_volume)
+    */
+    enum border_policy { skip_halo = 0, clip_to_volume };
+
+    /**
+       \brief region of a volume of given shape (z,y,x) that is visited for a Neighborhood, shapes of less than 3
+       dimensions are padded with leading 1s
+
+       if the Neighborhood does not extend in y and z, the volume is treated as one line of pixels (as
+       compute_offsets_in_x did), i.e. the x window crosses row and plane boundaries
+    */
+    template <typename Neighborhood>
+    struct region {
+
+      std::array<std::size_t,3> shape;
+      std::array<int,3> window_begin;
+      std::array<int,3> window_end;
+      std::array<std::size_t,3> first;
+      std::array<std::size_t,3> last;
+
+      region(const std::vector<std::size_t>& _shape, border_policy _border = skip_halo):
+        shape(),
+        window_begin(),
+        window_end(),
+        first(),
+        last()
+      {
+        shape.fill(1);
+        const std::size_t n_dims = (std::min)(_shape.size(),shape.size());
+        std::copy(_shape.end() - n_dims, _shape.end(), shape.end() - n_dims);
+
+        window_begin[row_major::x] = Neighborhood::x_offset_begin;
+        window_begin[row_major::y] = Neighborhood::y_offset_begin;
+        window_begin[row_major::z] = Neighborhood::z_offset_begin;
+        window_end[row_major::x] = Neighborhood::x_offset_end;
+        window_end[row_major::y] = Neighborhood::y_offset_end;
+        window_end[row_major::z] = Neighborhood::z_offset_end;
+
+        const bool line_only = Neighborhood::y_offset_begin >= 0 && Neighborhood::y_offset_end <= 1 &&
+          Neighborhood::z_offset_begin >= 0 && Neighborhood::z_offset_end <= 1;
+
+        if(line_only){
+          const std::size_t length = std::accumulate(_shape.begin(), _shape.end(), std::size_t(1),
+                                                     std::multiplies<std::size_t>());
+          shape.fill(1);
+          shape[row_major::x] = length;
+          window_begin[row_major::y] = window_begin[row_major::z] = 0;
+          window_end[row_major::y] = window_end[row_major::z] = 1;
+        }
+
+        for(int d = 0;d<3;++d){
+
+          if(_border == clip_to_volume){
+            first[d] = 0;
+            last[d] = shape[d];
+            continue;
+          }
+
+          const std::ptrdiff_t begin = window_begin[d] < 0 ? -window_begin[d] : 0;
+          const std::ptrdiff_t end = window_end[d] > 0 ? std::ptrdiff_t(shape[d]) - window_end[d] + 1 : std::ptrdiff_t(shape[d]);
+          first[d] = begin;
+          last[d] = end > begin ? end : begin;
+        }
+      }
+
+      std::size_t extent(int _dim) const {
+        return last[_dim] - first[_dim];
+      }
+
+      std::size_t window_size(int _dim) const {
+        return window_end[_dim] - window_begin[_dim];
+      }
+
+      bool empty() const {
+        return extent(0) == 0 || extent(1) == 0 || extent(2) == 0;
+      }
+
+      std::size_t index(std::size_t _z, std::size_t _y, std::size_t _x) const {
+        return (_z*shape[row_major::y] + _y)*shape[row_major::x] + _x;
+      }
+
+      //number of pixels of the window around _pos on axis _dim that are inside the volume
+      std::size_t clipped_window_size(int _dim, std::size_t _pos) const {
+        const std::ptrdiff_t begin = (std::max)(std::ptrdiff_t(_pos) + window_begin[_dim], std::ptrdiff_t(0));
+        const std::ptrdiff_t end = (std::min)(std::ptrdiff_t(_pos) + window_end[_dim], std::ptrdiff_t(shape[_dim]));
+        return end > begin ? end - begin : 0;
+      }
+    };
+
+    /**
+       \brief visit the pixels of the region with planes in [_z_first,_z_last) by calling
+       _visit(index, sum, n_pixels) where sum is the sum of _transform(value) over the n_pixels pixels of the
+       Neighborhood that are inside the volume
+
+       _visit may write to the pixels it is called for, but not to any pixel read through other Neighborhoods,
+       blocks are processed by _nthreads threads in parallel
+
+       \param[in] _input volume of shape _shape (z,y,x)
+       \param[in] _transform maps a pixel value to the value that is summed (of type sum_t)
+       \param[in] _visit called once per visited pixel
+    */
+    template <typename Neighborhood, typename sum_t, typename value_t, typename transform_t, typename visit_t>
+    static void for_each_box_sum(const value_t* _input,
+                                 const std::vector<std::size_t>& _shape,
+                                 transform_t _transform,
+                                 visit_t _visit,
+                                 int _nthreads = 1,
+                                 border_policy _border = skip_halo,
+                                 std::size_t _z_first = 0,
+                                 std::size_t _z_last = std::numeric_limits<std::size_t>::max()) {
+
+      const region<Neighborhood> geometry(_shape, _border);
+
+      const std::size_t z_first = (std::max)(_z_first, geometry.first[row_major::z]);
+      const std::size_t z_last = (std::min)(_z_last, geometry.last[row_major::z]);
+      if(geometry.empty() || z_first >= z_last)
+        return;
+
+      const std::size_t width = geometry.shape[row_major::x];
+      const std::size_t height = geometry.shape[row_major::y];
+      const std::size_t depth = geometry.shape[row_major::z];
+
+      const std::size_t nx = geometry.window_size(row_major::x);
+      const std::size_t ny = geometry.window_size(row_major::y);
+
+      const std::size_t extent_x = geometry.extent(row_major::x);
+      const std::size_t extent_y = geometry.extent(row_major::y);
+      const std::size_t extent_z = z_last - z_first;
+
+      const std::size_t block_x = (std::min)(extent_x, max_block_width);
+      const std::size_t rows_in_budget = l2_budget_bytes/(sizeof(sum_t)*(block_x + nx - 1));
+      const std::size_t block_y = (std::min)(extent_y, rows_in_budget > ny ? rows_in_budget - ny + 1 : std::size_t(1));
+
+      const std::size_t n_blocks_x = (extent_x + block_x - 1)/block_x;
+      const std::size_t n_blocks_y = (extent_y + block_y - 1)/block_y;
+
+      //cut z into slabs only as far as needed to keep all threads busy, every slab pays for the initial z window
+      const std::size_t nthreads = _nthreads > 1 ? _nthreads : 1;
+      const std::size_t blocks_wanted = nthreads > 1 ? 4*nthreads : 1;
+      const std::size_t n_slabs = (std::min)(extent_z, (blocks_wanted + n_blocks_x*n_blocks_y - 1)/(n_blocks_x*n_blocks_y));
+      const std::size_t block_z = (extent_z + n_slabs - 1)/n_slabs;
+      const std::size_t n_blocks_z = (extent_z + block_z - 1)/block_z;
+
+      const omp_size_type n_blocks = n_blocks_x*n_blocks_y*n_blocks_z;
+
+#pragma omp parallel                            \
+  num_threads(nthreads)
+      {
+        std::vector<sum_t> window;
+        std::vector<sum_t> columns;
+
+#pragma omp for schedule(dynamic)
+        for(omp_size_type b = 0;b<n_blocks;++b){
+
+          const std::size_t bx = b % n_blocks_x;
+          const std::size_t by = (b / n_blocks_x) % n_blocks_y;
+          const std::size_t bz = b / (n_blocks_x*n_blocks_y);
+
+          const std::size_t x0 = geometry.first[row_major::x] + bx*block_x;
+          const std::size_t x1 = (std::min)(x0 + block_x, geometry.last[row_major::x]);
+          const std::size_t y0 = geometry.first[row_major::y] + by*block_y;
+          const std::size_t y1 = (std::min)(y0 + block_y, geometry.last[row_major::y]);
+          const std::size_t z0 = z_first + bz*block_z;
+          const std::size_t z1 = (std::min)(z0 + block_z, z_last);
+
+          //the block including its halo, parts of it outside the volume stay 0
+          const std::size_t padded_x = x1 - x0 + nx - 1;
+          const std::size_t padded_y = y1 - y0 + ny - 1;
+          const std::ptrdiff_t padded_x0 = std::ptrdiff_t(x0) + geometry.window_begin[row_major::x];
+          const std::ptrdiff_t padded_y0 = std::ptrdiff_t(y0) + geometry.window_begin[row_major::y];
+
+          const std::size_t c_begin = padded_x0 < 0 ? -padded_x0 : 0;
+          const std::size_t c_end = (std::min)(padded_x, std::size_t(std::ptrdiff_t(width) - padded_x0));
+          const std::size_t n_columns = c_end - c_begin;
+
+          window.assign(padded_x*padded_y, sum_t(0));
+          columns.resize(padded_x);
+
+          auto update_plane = [&](std::ptrdiff_t _z, bool _add){
+
+            if(_z < 0 || _z >= std::ptrdiff_t(depth))
+              return;
+
+            for(std::size_t r = 0;r<padded_y;++r){
+
+              const std::ptrdiff_t y = padded_y0 + std::ptrdiff_t(r);
+              if(y < 0 || y >= std::ptrdiff_t(height))
+                continue;
+
+              const value_t* src = _input + geometry.index(_z, y, padded_x0 + std::ptrdiff_t(c_begin));
+              sum_t* dst = window.data() + r*padded_x + c_begin;
+
+              if(_add)
+                for(std::size_t c = 0;c<n_columns;++c)
+                  dst[c] += _transform(src[c]);
+              else
+                for(std::size_t c = 0;c<n_columns;++c)
+                  dst[c] -= _transform(src[c]);
+            }
+          };
+
+          for(int dz = geometry.window_begin[row_major::z];dz<geometry.window_end[row_major::z];++dz)
+            update_plane(std::ptrdiff_t(z0) + dz, true);
+
+          for(std::size_t z = z0;z<z1;++z){
+
+            std::fill(columns.begin(), columns.end(), sum_t(0));
+            for(std::size_t r = 0;r<ny;++r){
+              const sum_t* row = window.data() + r*padded_x;
+              for(std::size_t c = 0;c<padded_x;++c)
+                columns[c] += row[c];
+            }
+
+            const std::size_t n_z = geometry.clipped_window_size(row_major::z, z);
+
+            for(std::size_t y = y0;y<y1;++y){
+
+              const std::size_t n_zy = n_z*geometry.clipped_window_size(row_major::y, y);
+              sum_t running = std::accumulate(columns.begin(), columns.begin() + nx, sum_t(0));
+              std::size_t pixel = geometry.index(z, y, x0);
+
+              for(std::size_t x = x0;;++x){
+                _visit(pixel++, running, n_zy*geometry.clipped_window_size(row_major::x, x));
+                if(x + 1 >= x1)
+                  break;
+                running += columns[x - x0 + nx];
+                running -= columns[x - x0];
+              }
+
+              if(y + 1 < y1){
+                const sum_t* leaving = window.data() + (y - y0)*padded_x;
+                const sum_t* entering = leaving + ny*padded_x;
+                for(std::size_t c = 0;c<padded_x;++c){
+                  columns[c] += entering[c];
+                  columns[c] -= leaving[c];
+                }
+              }
+            }
+
+            if(z + 1 < z1){
+              update_plane(std::ptrdiff_t(z) + geometry.window_end[row_major::z], true);
+              update_plane(std::ptrdiff_t(z) + geometry.window_begin[row_major::z], false);
+            }
+          }
+        }
+      }
+
+    }
+
+    /**
+       \brief visit the pixels of the region one by one in memory order computing every sum from scratch, so
+       that _visit may write to pixels that later Neighborhoods read (causal decoding); this is the slow
+       reference for for_each_box_sum
+    */
+    template <typename Neighborhood, typename sum_t, typename value_t, typename transform_t, typename visit_t>
+    static void for_each_box_sum_in_order(const value_t* _input,
+                                          const std::vector<std::size_t>& _shape,
+                                          transform_t _transform,
+                                          visit_t _visit,
+                                          border_policy _border = skip_halo) {
+
+      const region<Neighborhood> geometry(_shape, _border);
+      if(geometry.empty())
+        return;
+
+      std::array<std::ptrdiff_t,3> at;
+      std::array<std::ptrdiff_t,3> begin;
+      std::array<std::ptrdiff_t,3> end;
+
+      for(std::size_t z = geometry.first[row_major::z];z<geometry.last[row_major::z];++z){
+        for(std::size_t y = geometry.first[row_major::y];y<geometry.last[row_major::y];++y){
+          for(std::size_t x = geometry.first[row_major::x];x<geometry.last[row_major::x];++x){
+
+            at[row_major::z] = z;
+            at[row_major::y] = y;
+            at[row_major::x] = x;
+
+            for(int d = 0;d<3;++d){
+              begin[d] = (std::max)(at[d] + geometry.window_begin[d], std::ptrdiff_t(0));
+              end[d] = (std::min)(at[d] + geometry.window_end[d], std::ptrdiff_t(geometry.shape[d]));
+            }
+
+            sum_t sum = 0;
+            for(std::ptrdiff_t nz = begin[row_major::z];nz<end[row_major::z];++nz)
+              for(std::ptrdiff_t ny = begin[row_major::y];ny<end[row_major::y];++ny)
+                for(std::ptrdiff_t nx = begin[row_major::x];nx<end[row_major::x];++nx)
+                  sum += _transform(_input[geometry.index(nz, ny, nx)]);
+
+            std::size_t n_pixels = 1;
+            for(int d = 0;d<3;++d)
+              n_pixels *= geometry.clipped_window_size(d, at[d]);
+
+            _visit(geometry.index(z, y, x), sum, n_pixels);
+          }
+        }
+      }
+    }
+
+  }
+
+}
+
+#endif /* _STENCIL_UTILS_H_ */
@@ -585,6 +585,13 @@ namespace sqeazy {
       return buffer_.data();
     }
 
+    /**
+       \brief free the memory of the loaded pixels, the shape and the open file are kept
+    */
+    void release(){
+      std::vector<char>().swap(buffer_);
+    }
+
   };
 
 }
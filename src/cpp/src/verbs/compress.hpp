@@ -6,6 +6,9 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
 
 #include "boost/filesystem.hpp"
 #include "boost/program_options.hpp"
@@ -14,6 +17,9 @@
 //#include "deprecated/static_pipeline_select.hpp"
 #include "sqeazy_algorithms.hpp"
 #include "sqeazy_pipelines.hpp"
+#include "dynamic_pipeline_chunked.hpp"
+#include "simd_dispatch.hpp"
+#include "bounded_queue.hpp"
 
 #include "yuv_utils.hpp"
 #include "image_stack.hpp"
@@ -25,11 +31,18 @@ namespace po = boost::program_options;
 namespace bfs = boost::filesystem;
 namespace sqy = sqeazy;
 
+/**
+   \brief compress _input with _pipeline into _output (resized as needed),
+   if _chunk_shape is not empty, a chunked container (see dynamic_pipeline_chunked.hpp) is produced
+
+   \return number of bytes of _output that hold the compressed stack, 0 on failure
+*/
 template <typename pipe_t>
-size_t native_compress_write(const sqeazy::tiff_facet& _input,
-              pipe_t& _pipeline,
-              bfs::path& _output_file,
-              bool _verbose = false){
+size_t native_compress(const sqeazy::tiff_facet& _input,
+                       pipe_t& _pipeline,
+                       std::vector<char>& _output,
+                       bool _verbose = false,
+                       const std::vector<size_t>& _chunk_shape = std::vector<size_t>()){
 
   typedef typename pipe_t::incoming_t raw_t;
 
@@ -40,32 +53,47 @@ size_t native_compress_write(const sqeazy::tiff_facet& _input,
     }
 
   std::vector<size_t>	input_shape;
-  std::vector<char>	output;
-  size_t		expected_size_byte = _pipeline.max_encoded_size(_input.size_in_byte());
-  size_t                output_file_size = bfs::exists(_output_file) ? bfs::file_size(_output_file) : 0;
-  size_t		bytes_written =0;
-
-  //create clean output buffer
-  if(expected_size_byte!=output.size())
-    output.resize(expected_size_byte);
-
-  std::fill(output.begin(), output.end(),0);
 
   //retrieve the size of the loaded buffer
   _input.dimensions(input_shape);
 
+  sqy::chunked_pipeline<pipe_t> chunked(_pipeline, _chunk_shape, _pipeline.n_threads());
+  size_t		expected_size_byte = _chunk_shape.empty() ? _pipeline.max_encoded_size(_input.size_in_byte()) : chunked.max_encoded_size(input_shape);
+
+  //create clean output buffer
+  if(expected_size_byte!=_output.size())
+    _output.resize(expected_size_byte);
+
+  std::fill(_output.begin(), _output.end(),0);
+
   //compress
-  char* enc_end = _pipeline.encode(reinterpret_cast<const raw_t*>(_input.data()),
-                   output.data(),
-                   input_shape);
+  char* enc_end = nullptr;
+  if(_chunk_shape.empty())
+    enc_end = _pipeline.encode(reinterpret_cast<const raw_t*>(_input.data()),
+                               _output.data(),
+                               input_shape);
+  else
+    enc_end = chunked.encode(reinterpret_cast<const raw_t*>(_input.data()),
+                             _output.data(),
+                             input_shape);
 
-  if(enc_end == nullptr && _verbose) {
-    std::cerr << "[SQY]\tnative compression failed! Nothing to write to disk...\n";
-    return 1;
+  if(enc_end == nullptr) {
+    if(_verbose)
+      std::cerr << "[SQY]\tnative compression failed! Nothing to write to disk...\n";
+    return 0;
   }
 
-  ////////////////////////OUTPUT I/O///////////////////////////////
-  const size_t compressed_length_byte = enc_end - output.data();
+  return enc_end - _output.data();
+}
+
+/**
+   \brief write the first _size bytes of _buffer to _output_file (replacing it)
+
+   \return size of _output_file after writing, 0 on failure
+*/
+static size_t native_write(const char* _buffer,
+                           size_t _size,
+                           const bfs::path& _output_file){
 
   std::fstream sqyfile;
   sqyfile.open(_output_file.generic_string(), std::ios_base::binary | std::ios_base::out );
@@ -76,16 +104,31 @@ size_t native_compress_write(const sqeazy::tiff_facet& _input,
       return 0;
     }
 
-
-  sqyfile.write(output.data(),compressed_length_byte);
+  sqyfile.write(_buffer,_size);
   sqyfile.close();
 
-  bytes_written = bfs::file_size(_output_file) - output_file_size;
+  return bfs::file_size(_output_file);
+}
 
-  if(bfs::file_size(_output_file)==output_file_size)
-    return output_file_size;
-  else
-    return bytes_written;
+/**
+   \brief compress _input with _pipeline and write the result to _output_file,
+   if _chunk_shape is not empty, a chunked container (see dynamic_pipeline_chunked.hpp) is written
+*/
+template <typename pipe_t>
+size_t native_compress_write(const sqeazy::tiff_facet& _input,
+              pipe_t& _pipeline,
+              bfs::path& _output_file,
+              bool _verbose = false,
+              const std::vector<size_t>& _chunk_shape = std::vector<size_t>()){
+
+  std::vector<char>	output;
+  const size_t compressed_length_byte = native_compress(_input, _pipeline, output, _verbose, _chunk_shape);
+
+  if(!compressed_length_byte)
+    return 0;
+
+  ////////////////////////OUTPUT I/O///////////////////////////////
+  return native_write(output.data(), compressed_length_byte, _output_file);
 }
 
 template <typename pipe_t>
@@ -152,12 +195,19 @@ size_t tiff_compress_write(const sqeazy::tiff_facet& _input,
   return bytes_written;
 }
 
+/**
+   \brief compress _input into the dataset _dname of the hdf5 file _output_file
+
+   if _chunk_shape is given or the pipeline runs on more than one thread, the hdf5 chunks are
+   compressed concurrently and stored pre-compressed (see h5_file::write_nd_dataset_parallel)
+*/
 template <typename pipe_t>
 size_t h5_compress_write(const sqeazy::tiff_facet& _input,
               pipe_t& _pipeline,
               bfs::path& _output_file,
              const std::string& _dname,
-              bool _verbose = false){
+              bool _verbose = false,
+              const std::vector<size_t>& _chunk_shape = std::vector<size_t>()){
 
   typedef typename pipe_t::incoming_t raw_t;
 
@@ -181,6 +231,14 @@ size_t h5_compress_write(const sqeazy::tiff_facet& _input,
       std::cerr << "[SQY]\toverwriting existing " << _output_file.generic_string() << ":" << _dname << " not supported!\n";
       rvalue = 1;
     }
+    else if(_chunk_shape.size() || _pipeline.n_threads() > 1)
+      rvalue = loaded.write_nd_dataset_parallel(_dname,
+                                                _pipeline.name(),
+                                                reinterpret_cast<const raw_t*>(_input.data()),
+                                                input_shape.data(),
+                                                input_shape.size(),
+                                                std::vector<hsize_t>(_chunk_shape.begin(), _chunk_shape.end()),
+                                                _pipeline.n_threads());
     else
       rvalue = loaded.write_nd_dataset(_dname,
                        reinterpret_cast<const raw_t*>(_input.data()),
@@ -201,130 +259,269 @@ size_t h5_compress_write(const sqeazy::tiff_facet& _input,
     return bytes_written;
 }
 
-int compress_files(const std::vector<std::string>& _files,
-                   const po::variables_map& _config) {
+/**
+   \brief path of the file that the compressed version of _input_file is written to
+*/
+static bfs::path compress_target(bfs::path _input_file,
+                                 const po::variables_map& _config,
+                                 std::size_t _n_files){
 
-  int value = 1;
+  bfs::path output_file = _input_file.replace_extension(".sqy");
 
-  bfs::path			current_file;
-  bfs::path			output_file;
-  std::fstream			sqyfile;
-  std::vector<size_t>		input_shape;
-  sqeazy::tiff_facet		input;
+  ////////////////////////PRODUCE TARGET FILE NAME///////////////////////////////
+  if(_config.count("output_suffix")){
+    auto new_suffix = _config["output_suffix"].as<std::string>();
 
-  sqy::dypeline<std::uint16_t>	pipe16;
-  sqy::dypeline_from_uint8	pipe8;
+    if(new_suffix.front() == '.')
+      output_file = _input_file.replace_extension(new_suffix);
+    else{
+      output_file = _input_file.stem();
+      output_file += new_suffix;
+    }
+  }
+
+  if(_config.count("output_name") && _n_files==1)
+    output_file = _config["output_name"].as<std::string>();
+
+  return output_file;
+}
 
-  std::vector<char>		output;
+/**
+   \brief compress the loaded _input with the pipeline matching its bit depth and write it to _output_file,
+   the container is chosen by the extension of _output_file (.sqy, .tif or .h5)
+
+   \return number of bytes written, 0 on failure
+*/
+template <typename pipe16_t, typename pipe8_t>
+size_t compress_write(const sqeazy::tiff_facet& _input,
+                      bfs::path _output_file,
+                      pipe16_t& _pipe16,
+                      pipe8_t& _pipe8,
+                      const po::variables_map& _config,
+                      const std::vector<size_t>& _chunk_shape){
+
+  const bool verbose = _config.count("verbose");
+  const bool is_16bit = _input.bits_per_sample()==16;
+
+  ////////////////////////COMPRESS & WRITE///////////////////////////////
+  if(_output_file.extension()==".sqy")
+    return is_16bit ?
+      native_compress_write(_input, _pipe16, _output_file, verbose, _chunk_shape) :
+      native_compress_write(_input, _pipe8, _output_file, verbose, _chunk_shape);
+
+  if(_output_file.extension()==".tif")
+    return is_16bit ?
+      tiff_compress_write(_input, _pipe16, _output_file, verbose) :
+      tiff_compress_write(_input, _pipe8, _output_file, verbose);
+
+  if(_output_file.extension()==".h5")
+    return is_16bit ?
+      h5_compress_write(_input, _pipe16, _output_file, _config["dataset_name"].as<std::string>(), verbose, _chunk_shape) :
+      h5_compress_write(_input, _pipe8, _output_file, _config["dataset_name"].as<std::string>(), verbose, _chunk_shape);
+
+  return 0;
+}
 
+/**
+   \brief one input file travelling through the stages of compress_files_batch
+*/
+struct compress_job {
+
+  std::string		source;
+  bfs::path		target;
+  sqeazy::tiff_facet	input;
+  std::vector<char>	encoded;
+  size_t		encoded_bytes;
+  size_t		bytes_written;
+  bool			done;
+
+  compress_job(const std::string& _source = ""):
+    source(_source),
+    target(),
+    input(),
+    encoded(),
+    encoded_bytes(0),
+    bytes_written(0),
+    done(false)
+  {}
+};
+
+/**
+   \brief compress _files with 3 stages connected by bounded queues: one thread loads the input files, _jobs threads
+   encode them (each with its own pipelines running _nthreads threads), the calling thread writes the results
+
+   .sqy output is encoded by the workers and written by the writer, .tif output is encoded and written by the workers
+   (one file per worker), .h5 output is encoded and written by the writer as the HDF5 library is not thread-safe;
+   at most 2*(_jobs+1) + _jobs stacks are in memory at any time
+
+   \return 0 if at least one file was written, 1 otherwise
+*/
+static int compress_files_batch(const std::vector<std::string>& _files,
+                                const po::variables_map& _config,
+                                const std::vector<size_t>& _chunk_shape,
+                                int _jobs,
+                                int _nthreads){
+
+  typedef std::unique_ptr<compress_job> job_ptr;
 
   const std::string pipeline_string = _config["pipeline"].as<std::string>();
+  const bool verbose = _config.count("verbose");
 
-  if(!sqy::dypeline<std::uint16_t>::can_be_built_from(pipeline_string)){
-    std::cerr << "[SQY]\tunable to build pipeline from " << pipeline_string << "\nDoing nothing.\n";
-    return value;
-  }
+  sqy::bounded_queue<job_ptr> loaded(_jobs + 1);
+  sqy::bounded_queue<job_ptr> encoded(_jobs + 1);
 
-  pipe16 = sqy::dypeline<std::uint16_t>::from_string(pipeline_string);
-  pipe8 = sqy::dypeline_from_uint8::from_string(pipeline_string);
+  ////////////////////////INPUT I/O///////////////////////////////
+  std::thread reader([&](){
 
-  int nthreads_to_use = sqy::clean_number_of_threads(_config["nthreads"].as<int>());
-  pipe16.set_n_threads(nthreads_to_use);
-  pipe8.set_n_threads(nthreads_to_use);
+      for(const std::string& _file : _files) {
 
+        if(!bfs::exists(_file)){
+          std::cerr << "[SQY]\tunable to open " << _file << "\t skipping it\n";
+          continue;
+        }
 
-  size_t bytes_written = 0;
+        job_ptr job(new compress_job(_file));
+        job->input.load(_file);
+        job->target = compress_target(_file, _config, _files.size());
 
-  if(_files.size()>1)
-    std::cout << "[SQY]\tmultiple input files detected, ignoring --output_name flag\n";
+        if(!loaded.push(std::move(job)))
+          break;
+      }
 
-  for(const std::string& _file : _files) {
+      loaded.close();
+    });
 
+  ////////////////////////COMPRESS///////////////////////////////
+  std::atomic<int> workers_running(_jobs);
+  std::vector<std::thread> workers;
 
-    current_file = _file;
-    if(!bfs::exists(current_file)){
-      std::cerr << "[SQY]\tunable to open " << _file << "\t skipping it\n";
-      continue;
-    }
+  for(int w = 0;w<_jobs;++w){
+    workers.emplace_back([&](){
 
-    ////////////////////////INPUT I/O///////////////////////////////
-    //load tiff & extract the dimensions
-    input.load(_file);
+        sqy::dypeline<std::uint16_t> pipe16 = sqy::dypeline<std::uint16_t>::from_string(pipeline_string);
+        sqy::dypeline_from_uint8 pipe8 = sqy::dypeline_from_uint8::from_string(pipeline_string);
+        pipe16.set_n_threads(_nthreads);
+        pipe8.set_n_threads(_nthreads);
 
-    bytes_written = 0;
-    output_file = current_file.replace_extension(".sqy");
+        job_ptr job;
+        while(loaded.pop(job)){
 
-    ////////////////////////PRODUCE TARGET FILE NAME///////////////////////////////
-    if(_config.count("output_suffix")){
-      auto new_suffix = _config["output_suffix"].as<std::string>();
+          if(job->target.extension()==".sqy"){
+            job->encoded_bytes = job->input.bits_per_sample()==16 ?
+              native_compress(job->input, pipe16, job->encoded, verbose, _chunk_shape) :
+              native_compress(job->input, pipe8, job->encoded, verbose, _chunk_shape);
+            job->done = !job->encoded_bytes;
+          }
 
-      if(new_suffix.front() == '.')
-        output_file = current_file.replace_extension(_config["output_suffix"].as<std::string>());
-      else{
-        output_file = current_file.stem();
-        output_file += new_suffix;
-      }
+          if(job->target.extension()==".tif"){
+            job->bytes_written = compress_write(job->input, job->target, pipe16, pipe8, _config, _chunk_shape);
+            job->done = true;
+          }
 
+          //the pixels are not needed anymore for jobs that are encoded already (the tiff handle is closed with the job)
+          if(job->target.extension()==".sqy" || job->done)
+            job->input.release();
+
+          encoded.push(std::move(job));
+        }
+
+        if(--workers_running == 0)
+          encoded.close();
+      });
+  }
 
+  ////////////////////////OUTPUT I/O///////////////////////////////
+  int value = 1;
+  sqy::dypeline<std::uint16_t> pipe16 = sqy::dypeline<std::uint16_t>::from_string(pipeline_string);
+  sqy::dypeline_from_uint8 pipe8 = sqy::dypeline_from_uint8::from_string(pipeline_string);
+  pipe16.set_n_threads(_nthreads);
+  pipe8.set_n_threads(_nthreads);
+
+  job_ptr job;
+  while(encoded.pop(job)){
+
+    if(!job->done){
+      if(job->encoded_bytes)
+        job->bytes_written = native_write(job->encoded.data(), job->encoded_bytes, job->target);
+      else
+        job->bytes_written = compress_write(job->input, job->target, pipe16, pipe8, _config, _chunk_shape);
     }
 
-    if(_config.count("output_name") && _files.size()==1)
-      output_file = _config["output_name"].as<std::string>();
+    if(!job->bytes_written){
+      std::cerr << "[SQY]\terrors occurred while processing " << job->source << "\n";
+    } else {
+      value = 0;
+      if(verbose)
+        std::cout << "[SQY]\t" << job->source << " -> " << job->target.generic_string()
+                  << " (" << job->bytes_written << " B)\n";
+    }
+  }
 
+  reader.join();
+  for(std::thread& worker : workers)
+    worker.join();
 
-    ////////////////////////COMPRESS & WRITE///////////////////////////////
-    if(output_file.extension()==".sqy"){
-      if(input.bits_per_sample()==16){
-        bytes_written = native_compress_write(input,
-                                              pipe16,
-                                              output_file,
-                                              _config.count("verbose"));
-      }
-      else{
-        bytes_written = native_compress_write(input,
-                                              pipe8,
-                                              output_file,
-                                              _config.count("verbose"));
+  return value;
+}
 
-      }
-    }
+int compress_files(const std::vector<std::string>& _files,
+                   const po::variables_map& _config) {
 
-    if(output_file.extension()==".tif"){
-      if(input.bits_per_sample()==16){
-        bytes_written = tiff_compress_write(input,
-                                            pipe16,
-                                            output_file,
-                                            _config.count("verbose"));
-      }
-      else{
-        bytes_written = tiff_compress_write(input,
-                                            pipe8,
-                                            output_file,
-                                            _config.count("verbose"));
+  int value = 1;
 
-      }
-    }
+  const std::string pipeline_string = _config["pipeline"].as<std::string>();
+
+  if(!sqy::dypeline<std::uint16_t>::can_be_built_from(pipeline_string)){
+    std::cerr << "[SQY]\tunable to build pipeline from " << pipeline_string << "\nDoing nothing.\n";
+    return value;
+  }
 
+  int nthreads_to_use = sqy::clean_number_of_threads(_config["nthreads"].as<int>());
+  int jobs = _config.count("jobs") ? (std::max)(1,_config["jobs"].as<int>()) : 1;
+  jobs = (std::min)(jobs, int(_files.size()));
+
+  if(_config.count("verbose"))
+    std::cout << "[SQY]\tusing " << sqeazy::simd::active_name() << " kernels (host supports "
+              << sqeazy::simd::name(sqeazy::simd::detect()) << "), "
+              << jobs << " file(s) at a time with " << nthreads_to_use << " thread(s) each\n";
+
+  std::vector<size_t> chunk_shape;
+  if(_config.count("chunk_shape")){
+    for(const std::string& extent : sqy::split_string_by(_config["chunk_shape"].as<std::string>(),"x"))
+      chunk_shape.push_back(std::stoul(extent));
+  }
 
-    if(output_file.extension()==".h5"){
+  if(_files.size()>1)
+    std::cout << "[SQY]\tmultiple input files detected, ignoring --output_name flag\n";
 
-      if(input.bits_per_sample()==16){
-        bytes_written = h5_compress_write(input,
-                                          pipe16,
-                                          output_file,
-                                          _config["dataset_name"].as<std::string>(),
-                                          _config.count("verbose"));
-      }
-      else{
-        bytes_written = h5_compress_write(input,
-                                          pipe8,
-                                          output_file,
-                                          _config["dataset_name"].as<std::string>(),
-                                          _config.count("verbose"));
+  //overlap loading, encoding and writing of consecutive files if more than one file is compressed at a time
+  if(_files.size()>1 && jobs>1)
+    return compress_files_batch(_files, _config, chunk_shape, jobs, nthreads_to_use);
 
-      }
+  sqy::dypeline<std::uint16_t>	pipe16 = sqy::dypeline<std::uint16_t>::from_string(pipeline_string);
+  sqy::dypeline_from_uint8	pipe8 = sqy::dypeline_from_uint8::from_string(pipeline_string);
+  pipe16.set_n_threads(nthreads_to_use);
+  pipe8.set_n_threads(nthreads_to_use);
+
+  sqeazy::tiff_facet		input;
+
+  for(const std::string& _file : _files) {
+
+    if(!bfs::exists(_file)){
+      std::cerr << "[SQY]\tunable to open " << _file << "\t skipping it\n";
+      continue;
     }
 
+    ////////////////////////INPUT I/O///////////////////////////////
+    //load tiff & extract the dimensions
+    input.load(_file);
+
+    const size_t bytes_written = compress_write(input,
+                                                compress_target(_file, _config, _files.size()),
+                                                pipe16, pipe8,
+                                                _config,
+                                                chunk_shape);
+
     if(!bytes_written){
       std::cerr << "[SQY]\terrors occurred while processing " << _file << "\n";
     } else
@@ -251,8 +251,7 @@ int forward_conversion(const bfs::path& _src,
 
     auto pipe16 = sqy::dypeline<std::uint16_t>::from_string(quantiser_definition);
 
-    auto scratchpad= std::async(sqeazy::make_aligned<std::uint16_t>,32,
-                                converted_stack.num_elements()*sizeof(std::uint8_t));
+    auto scratchpad = sqeazy::make_aligned<std::uint16_t>(32, converted_stack.num_elements()*sizeof(std::uint16_t));
 
 
     if(_config["chroma_sampling"].as<std::string>() == sqeazy::yuv420formatter::y4m_code()){
@@ -263,7 +262,7 @@ int forward_conversion(const bfs::path& _src,
                           (char*)converted_stack.data(),
                           c_storage_order_shape,
                            converted_stack.num_elements()*sizeof(std::uint8_t),
-                           scratchpad);
+                           scratchpad.get());
 
     }
 
@@ -15,16 +15,52 @@
 
 #include "sqeazy_pipelines.hpp"
 #include "sqeazy_algorithms.hpp"
+#include "dynamic_pipeline_chunked.hpp"
+#include "dynamic_pipeline_stream.hpp"
 
 #include "yuv_utils.hpp"
 #include "image_stack.hpp"
 #include "encoders/quantiser_scheme_impl.hpp"
+#include "hdf5_utils.hpp"
 
 
 namespace po = boost::program_options;
 namespace bfs = boost::filesystem;
 namespace sqy = sqeazy;
 
+/**
+   \brief decode the stream (see sqeazy::stream_format) of _n_planes z-planes from _in into _out,
+   _shape receives the shape of the stack
+
+   \return 0 on success, 1 otherwise
+*/
+template <typename pipeline_t>
+int decompress_stream(std::istream& _in,
+	std::uint64_t _n_planes,
+	std::vector<char>& _out,
+	std::vector<size_t>& _shape,
+	int _nthreads) {
+
+	typedef typename pipeline_t::incoming_t raw_t;
+
+	sqy::decode_stream<pipeline_t> stream(_nthreads);
+	if (stream.begin(_in))
+		return 1;
+
+	_shape.assign(1, _n_planes);
+	_shape.insert(_shape.end(), stream.plane_shape().begin(), stream.plane_shape().end());
+
+	const size_t expected_size_byte = std::accumulate(_shape.begin(), _shape.end(),
+		sizeof(raw_t),
+		std::multiplies<size_t>());
+	if (_out.size() < expected_size_byte)
+		_out.resize(expected_size_byte);
+
+	const std::size_t pulled = stream.pull_planes(reinterpret_cast<raw_t*>(_out.data()), _n_planes);
+
+	return (stream.finish() == 0 && pulled == _n_planes) ? 0 : 1;
+}
+
 
 int decompress_files(const std::vector<std::string>& _files,
 	const po::variables_map& _config) {
@@ -78,73 +114,167 @@ int decompress_files(const std::vector<std::string>& _files,
 
 
 
-			////////////////////////EXTRACT HEADER///////////////////////////////
 			const char* file_ptr = &file_content_buffer[0];
 
-			sqeazy::header sqy_header(file_ptr,
-				file_ptr + file_size_byte
-			);
-			file_shape.resize(sqy_header.shape()->size(), 1);
-			file_shape[sqy::row_major::x] = file_size_byte;
-
-			std::string found_pipeline = sqy_header.pipeline();
-			found_num_bits = sqy_header.sizeof_header_type()*CHAR_BIT;
-			if (!(found_num_bits == 16 || found_num_bits == 8))
-			{
-				std::cerr << "[SQY]\tonly 8 or 16-bit encoding support yet, skipping " << _file << "\n";
-				continue;
-			}
-
-			//prepare for tiff output
-			expected_size_byte = sqy_header.raw_size_byte();
+			////////////////////////CHUNKED CONTAINER///////////////////////////////
+			if (sqy::chunked_format::contained(file_ptr, file_ptr + file_size_byte)) {
+				sqyfile.close();
 
+				sqy::chunk_table table;
+				if (table.read(file_ptr, file_ptr + file_size_byte) || table.offsets_.front() >= file_size_byte) {
+					std::cerr << "[SQY]\tunable to read chunk table of " << _file << ", skipping it\n";
+					continue;
+				}
 
-			if (intermediate_buffer.size() < expected_size_byte)
-				intermediate_buffer.resize(expected_size_byte);
-			////////////////////////DECODE///////////////////////////////
-			shape.clear();
-			shape.resize(sqy_header.shape()->size());
-			std::copy(sqy_header.shape()->begin(), sqy_header.shape()->end(), shape.begin());
-			/*shape = *sqy_header.shape();*/
-
-			int dec_ret = 1;
-			if (found_num_bits == 16) {
-				if (!sqy::dypeline<std::uint16_t>::can_be_built_from(sqy_header.pipeline())) {
-					std::cerr << "[SQY]\tunable to build pipeline from " << sqy_header.pipeline() << "\nDoing nothing on " << _file << ".\n";
+				//all chunks share the raw type, the first one tells
+				sqeazy::header chunk_header(file_ptr + table.offsets_.front(),
+					file_ptr + file_size_byte);
+				found_num_bits = chunk_header.sizeof_header_type()*CHAR_BIT;
+				if (!(found_num_bits == 16 || found_num_bits == 8))
+				{
+					std::cerr << "[SQY]\tonly 8 or 16-bit encoding support yet, skipping " << _file << "\n";
 					continue;
 				}
 
-				pipe16 = sqy::dypeline<std::uint16_t>::from_string(sqy_header.pipeline());
-				pipe16.set_n_threads(nthreads_to_use);
+				shape = table.shape_;
+				expected_size_byte = std::accumulate(shape.begin(), shape.end(),
+					found_num_bits / CHAR_BIT,
+					std::multiplies<size_t>());
 
-				dec_ret = pipe16.decode(file_ptr,
-					reinterpret_cast<std::uint16_t*>(intermediate_buffer.data()),
-					file_shape,
-					*sqy_header.shape());
+				if (intermediate_buffer.size() < expected_size_byte)
+					intermediate_buffer.resize(expected_size_byte);
+
+				int dec_ret = 1;
+				if (found_num_bits == 16) {
+					sqy::chunked_pipeline<sqy::dypeline<std::uint16_t> > chunked(pipe16, std::vector<size_t>(), nthreads_to_use);
+					dec_ret = chunked.decode(file_ptr,
+						reinterpret_cast<std::uint16_t*>(intermediate_buffer.data()),
+						file_size_byte);
+				}
+				else {
+					sqy::chunked_pipeline<sqy::dypeline_from_uint8> chunked(pipe8, std::vector<size_t>(), nthreads_to_use);
+					dec_ret = chunked.decode(file_ptr,
+						reinterpret_cast<std::uint8_t*>(intermediate_buffer.data()),
+						file_size_byte);
+				}
+
+				if (dec_ret) {
+					std::cerr << "[SQY]\tdecompressing " << _file << " failed! Nothing to write to disk...\n";
+					continue;
+				}
 			}
+			////////////////////////STREAM///////////////////////////////
+			else if (sqy::stream_format::contained(file_ptr, file_ptr + file_size_byte)) {
+
+				std::uint64_t n_planes = 0, n_slabs = 0;
+				const std::size_t first_slab = sqy::stream_format::magic().size() + sizeof(std::uint64_t);
+				if (!sqy::stream_format::read_trailer(file_ptr, file_ptr + file_size_byte, n_planes, n_slabs) ||
+					!n_slabs || file_size_byte <= first_slab) {
+					sqyfile.close();
+					std::cerr << "[SQY]\t" << _file << " is not a complete sqy stream, skipping it\n";
+					continue;
+				}
 
-			if (found_num_bits == 8) {
-				if (!sqy::dypeline_from_uint8::can_be_built_from(sqy_header.pipeline())) {
-					std::cerr << "[SQY]\tunable to build pipeline from " << sqy_header.pipeline() << "\nDoing nothing on " << _file << ".\n";
+				//all slabs share the raw type, the first one tells
+				sqeazy::header slab_header(file_ptr + first_slab,
+					file_ptr + file_size_byte);
+				found_num_bits = slab_header.sizeof_header_type()*CHAR_BIT;
+				if (!(found_num_bits == 16 || found_num_bits == 8))
+				{
+					sqyfile.close();
+					std::cerr << "[SQY]\tonly 8 or 16-bit encoding support yet, skipping " << _file << "\n";
 					continue;
 				}
 
-				pipe8 = sqy::dypeline_from_uint8::from_string(sqy_header.pipeline());
-				pipe8.set_n_threads(nthreads_to_use);
-				dec_ret = pipe8.decode(file_ptr,
-					reinterpret_cast<std::uint8_t*>(intermediate_buffer.data()),
-					file_shape,
-					*sqy_header.shape());
-			}
+				//slabs are decoded one at a time from the file
+				sqyfile.clear();
+				sqyfile.seekg(0);
 
+				int dec_ret = 1;
+				if (found_num_bits == 16)
+					dec_ret = decompress_stream<sqy::dypeline<std::uint16_t> >(sqyfile, n_planes, intermediate_buffer, shape, nthreads_to_use);
+				else
+					dec_ret = decompress_stream<sqy::dypeline_from_uint8>(sqyfile, n_planes, intermediate_buffer, shape, nthreads_to_use);
 
+				sqyfile.close();
 
-			if (dec_ret) {
-				std::cerr << "[SQY]\tdecompressing " << _file << " failed! Nothing to write to disk...\n";
-				continue;
+				expected_size_byte = std::accumulate(shape.begin(), shape.end(),
+					found_num_bits / CHAR_BIT,
+					std::multiplies<size_t>());
+
+				if (dec_ret) {
+					std::cerr << "[SQY]\tdecompressing " << _file << " failed! Nothing to write to disk...\n";
+					continue;
+				}
 			}
+			else {
+
+				////////////////////////EXTRACT HEADER///////////////////////////////
+				sqeazy::header sqy_header(file_ptr,
+					file_ptr + file_size_byte
+				);
+				file_shape.resize(sqy_header.shape()->size(), 1);
+				file_shape[sqy::row_major::x] = file_size_byte;
+
+				std::string found_pipeline = sqy_header.pipeline();
+				found_num_bits = sqy_header.sizeof_header_type()*CHAR_BIT;
+				if (!(found_num_bits == 16 || found_num_bits == 8))
+				{
+					std::cerr << "[SQY]\tonly 8 or 16-bit encoding support yet, skipping " << _file << "\n";
+					continue;
+				}
+
+				//prepare for tiff output
+				expected_size_byte = sqy_header.raw_size_byte();
+
+
+				if (intermediate_buffer.size() < expected_size_byte)
+					intermediate_buffer.resize(expected_size_byte);
+				////////////////////////DECODE///////////////////////////////
+				shape.clear();
+				shape.resize(sqy_header.shape()->size());
+				std::copy(sqy_header.shape()->begin(), sqy_header.shape()->end(), shape.begin());
+				/*shape = *sqy_header.shape();*/
 
-			sqyfile.close();
+				int dec_ret = 1;
+				if (found_num_bits == 16) {
+					if (!sqy::dypeline<std::uint16_t>::can_be_built_from(sqy_header.pipeline())) {
+						std::cerr << "[SQY]\tunable to build pipeline from " << sqy_header.pipeline() << "\nDoing nothing on " << _file << ".\n";
+						continue;
+					}
+
+					pipe16 = sqy::dypeline<std::uint16_t>::from_string(sqy_header.pipeline());
+					pipe16.set_n_threads(nthreads_to_use);
+
+					dec_ret = pipe16.decode(file_ptr,
+						reinterpret_cast<std::uint16_t*>(intermediate_buffer.data()),
+						file_shape,
+						*sqy_header.shape());
+				}
+
+				if (found_num_bits == 8) {
+					if (!sqy::dypeline_from_uint8::can_be_built_from(sqy_header.pipeline())) {
+						std::cerr << "[SQY]\tunable to build pipeline from " << sqy_header.pipeline() << "\nDoing nothing on " << _file << ".\n";
+						continue;
+					}
+
+					pipe8 = sqy::dypeline_from_uint8::from_string(sqy_header.pipeline());
+					pipe8.set_n_threads(nthreads_to_use);
+					dec_ret = pipe8.decode(file_ptr,
+						reinterpret_cast<std::uint8_t*>(intermediate_buffer.data()),
+						file_shape,
+						*sqy_header.shape());
+				}
+
+
+
+				if (dec_ret) {
+					std::cerr << "[SQY]\tdecompressing " << _file << " failed! Nothing to write to disk...\n";
+					continue;
+				}
+
+				sqyfile.close();
+			}
 
 		}
 		else {
@@ -178,13 +308,15 @@ int decompress_files(const std::vector<std::string>& _files,
 			int rvalue = 1;
 
 			if (found_num_bits == 8)
-				rvalue = loaded.read_nd_dataset(dname,
+				rvalue = loaded.read_nd_dataset_parallel(dname,
 					intermediate_buffer.data(),
-					shape);
+					shape,
+					nthreads_to_use);
 			else if (found_num_bits == 16) {
-				rvalue = loaded.read_nd_dataset(dname,
+				rvalue = loaded.read_nd_dataset_parallel(dname,
 					reinterpret_cast<std::uint16_t*>(intermediate_buffer.data()),
-					shape);
+					shape,
+					nthreads_to_use);
 			}
 
 
@@ -104,4 +104,85 @@ BOOST_AUTO_TEST_CASE( sse_deprecated ){
 }
 
 
+BOOST_AUTO_TEST_CASE( avx2_version ){
+
+  if(!sqeazy::detail::avx2_bitplane_reorder_available<unsigned short>())
+    return;
+
+  int ret = 0;
+
+  std::chrono::duration<double> time;
+  std::chrono::duration<double> decode_time;
+  std::vector<unsigned short> decoded(input.size(),0);
+
+  for(int i = 0;i<20;++i){
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ret = sqeazy::detail::avx2_bitplane_reorder_encode(&input[0],
+							 &output[0],
+							 input.size());
+    auto end = std::chrono::high_resolution_clock::now();
+    BOOST_CHECK(ret==0);
+    time += end-start;
+
+    start = std::chrono::high_resolution_clock::now();
+    ret = sqeazy::detail::avx2_bitplane_reorder_decode(&output[0],
+							 &decoded[0],
+							 input.size());
+    end = std::chrono::high_resolution_clock::now();
+    BOOST_CHECK(ret==0);
+    decode_time += end-start;
+
+    std::fill(output.begin(), output.end(),0);
+  }
+
+  BOOST_CHECK(time.count()>0);
+  std::cout << "avx2 version:   " << time.count()/20 << " s\n";
+  std::cout << "\t\t" << input.size()*sizeof(input[0])/(1024.*1024.) << " MB, "
+	    << input.size()*sizeof(input[0])/(1024.*1024.)/(time.count()/20.)<<" MB/s\n";
+  std::cout << "\t\tdecode " << input.size()*sizeof(input[0])/(1024.*1024.)/(decode_time.count()/20.)<<" MB/s\n";
+
+}
+
+BOOST_AUTO_TEST_CASE( avx512_version ){
+
+  if(!sqeazy::detail::avx512_bitplane_reorder_available<unsigned short>())
+    return;
+
+  int ret = 0;
+
+  std::chrono::duration<double> time;
+  std::chrono::duration<double> decode_time;
+  std::vector<unsigned short> decoded(input.size(),0);
+
+  for(int i = 0;i<20;++i){
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ret = sqeazy::detail::avx512_bitplane_reorder_encode(&input[0],
+							 &output[0],
+							 input.size());
+    auto end = std::chrono::high_resolution_clock::now();
+    BOOST_CHECK(ret==0);
+    time += end-start;
+
+    start = std::chrono::high_resolution_clock::now();
+    ret = sqeazy::detail::avx512_bitplane_reorder_decode(&output[0],
+							 &decoded[0],
+							 input.size());
+    end = std::chrono::high_resolution_clock::now();
+    BOOST_CHECK(ret==0);
+    decode_time += end-start;
+
+    std::fill(output.begin(), output.end(),0);
+  }
+
+  BOOST_CHECK(time.count()>0);
+  std::cout << "avx512 version: " << time.count()/20 << " s\n";
+  std::cout << "\t\t" << input.size()*sizeof(input[0])/(1024.*1024.) << " MB, "
+	    << input.size()*sizeof(input[0])/(1024.*1024.)/(time.count()/20.)<<" MB/s\n";
+  std::cout << "\t\tdecode " << input.size()*sizeof(input[0])/(1024.*1024.)/(decode_time.count()/20.)<<" MB/s\n";
+
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
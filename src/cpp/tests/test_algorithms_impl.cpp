@@ -77,3 +77,53 @@ BOOST_AUTO_TEST_CASE( in_parallel_with_functor ){
     BOOST_CHECK_MESSAGE(psum[i] == psum[i-1]+2, i << "] prefix sum doesn't match [i]: " << psum[i] << " with previous one [i-1]: " << psum[i-1]+2);
 }
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( argsort )
+
+BOOST_AUTO_TEST_CASE( sorts_indices ){
+
+  std::vector<float> src = {3.f, 1.f, 2.f, 0.f};
+  std::vector<std::size_t> idx(src.size(), 42);
+
+  auto resitr = sqeazy::argsort(src.begin(), src.end(), idx.begin());
+
+  BOOST_CHECK(resitr == idx.end());
+  std::vector<std::size_t> expected = {3, 1, 2, 0};
+  BOOST_CHECK_EQUAL_COLLECTIONS(idx.begin(), idx.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( ties_keep_original_order ){
+
+  std::vector<std::uint16_t> src = {2, 1, 2, 1, 0, 2};
+  std::vector<std::size_t> idx(src.size(), 0);
+
+  sqeazy::argsort(src.begin(), src.end(), idx.begin());
+
+  std::vector<std::size_t> expected = {4, 1, 3, 0, 2, 5};
+  BOOST_CHECK_EQUAL_COLLECTIONS(idx.begin(), idx.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( in_parallel_matches_serial ){
+
+  //many duplicates, large enough to be split across threads
+  std::vector<std::uint16_t> src(1 << 16, 0);
+  for(std::size_t i = 0;i<src.size();++i)
+    src[i] = (i*7919) % 61;
+
+  std::vector<std::size_t> serial(src.size(), 0);
+  sqeazy::argsort(src.begin(), src.end(), serial.begin(), 1);
+
+  for(int nthreads : {2, 3, 4}){
+    std::vector<std::size_t> parallel(src.size(), 0);
+    sqeazy::argsort(src.begin(), src.end(), parallel.begin(), nthreads);
+    BOOST_REQUIRE(parallel == serial);
+  }
+
+  for(std::size_t i = 1;i<serial.size();++i){
+    BOOST_REQUIRE(src[serial[i-1]] <= src[serial[i]]);
+    if(src[serial[i-1]] == src[serial[i]])
+      BOOST_REQUIRE(serial[i-1] < serial[i]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
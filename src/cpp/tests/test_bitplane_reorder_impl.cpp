@@ -6,6 +6,9 @@
 #include <iostream>
 #include <algorithm> // for copy
 #include <iterator> // for ostream_iterator
+#include <random>
+#include <limits>
+#include <boost/mpl/list.hpp>
 
 #include "encoders/bitswap_scheme_impl.hpp"
 #include "sse_test_utils.hpp"
@@ -289,3 +292,89 @@ BOOST_AUTO_TEST_CASE(produces_same_output_as_scalar){
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+template <typename T>
+struct random_fixture {
+
+  //not a multiple of the AVX blocks to exercise the scalar remainder
+  static const std::size_t size = (1 << 14) + 3*sizeof(T)*CHAR_BIT;
+
+  std::vector<T> input;
+  std::vector<T> output;
+  std::vector<T> reference;
+  std::vector<T> decoded;
+
+  random_fixture():
+    input(size,0),
+    output(size,0),
+    reference(size,0),
+    decoded(size,0){
+
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<int> dist(std::numeric_limits<T>::min(),std::numeric_limits<T>::max());
+    for( T& el : input )
+      el = static_cast<T>(dist(engine));
+
+    sqeazy::detail::scalar_bitplane_reorder_encode<1>(input.data(), reference.data(), input.size());
+  }
+};
+
+typedef boost::mpl::list<std::uint8_t, std::uint16_t, std::int16_t> avx_types;
+
+BOOST_AUTO_TEST_SUITE( avx_bitplane_reorder )
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( scalar_sweeps_match_scalar, T, avx_types ){
+
+  random_fixture<T> data;
+  const std::size_t segment_length = data.size/(sizeof(T)*CHAR_BIT);
+
+  sqeazy::detail::scalar_bitplane_reorder_encode_sweeps<1>(data.input.data(), data.output.data(), segment_length, 0, segment_length/2);
+  sqeazy::detail::scalar_bitplane_reorder_encode_sweeps<1>(data.input.data(), data.output.data(), segment_length, segment_length/2, segment_length);
+  BOOST_CHECK(data.output == data.reference);
+
+  sqeazy::detail::scalar_bitplane_reorder_decode_sweeps<1>(data.output.data(), data.decoded.data(), segment_length, 0, segment_length);
+  BOOST_CHECK(data.decoded == data.input);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( avx2_matches_scalar, T, avx_types ){
+
+  if(!sqeazy::detail::avx2_bitplane_reorder_available<T>()){
+    BOOST_TEST_MESSAGE("avx2 not available, skipping");
+    return;
+  }
+
+  random_fixture<T> data;
+
+  BOOST_REQUIRE_EQUAL(sqeazy::detail::avx2_bitplane_reorder_encode(data.input.data(), data.output.data(), data.input.size()), sqeazy::SUCCESS);
+  BOOST_CHECK(data.output == data.reference);
+
+  BOOST_REQUIRE_EQUAL(sqeazy::detail::avx2_bitplane_reorder_decode(data.output.data(), data.decoded.data(), data.input.size()), sqeazy::SUCCESS);
+  BOOST_CHECK(data.decoded == data.input);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( avx512_matches_scalar, T, avx_types ){
+
+  if(!sqeazy::detail::avx512_bitplane_reorder_available<T>()){
+    BOOST_TEST_MESSAGE("avx512bw not available, skipping");
+    return;
+  }
+
+  random_fixture<T> data;
+
+  BOOST_REQUIRE_EQUAL(sqeazy::detail::avx512_bitplane_reorder_encode(data.input.data(), data.output.data(), data.input.size()), sqeazy::SUCCESS);
+  BOOST_CHECK(data.output == data.reference);
+
+  BOOST_REQUIRE_EQUAL(sqeazy::detail::avx512_bitplane_reorder_decode(data.output.data(), data.decoded.data(), data.input.size()), sqeazy::SUCCESS);
+  BOOST_CHECK(data.decoded == data.input);
+}
+
+BOOST_AUTO_TEST_CASE( unsupported_type_is_rejected ){
+
+  std::vector<std::uint32_t> input(64,1);
+  std::vector<std::uint32_t> output(64,0);
+
+  BOOST_CHECK_EQUAL(sqeazy::detail::avx2_bitplane_reorder_encode(input.data(), output.data(), input.size()), sqeazy::FAILURE);
+  BOOST_CHECK_EQUAL(sqeazy::detail::avx512_bitplane_reorder_decode(input.data(), output.data(), input.size()), sqeazy::FAILURE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
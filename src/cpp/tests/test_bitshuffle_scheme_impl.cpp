@@ -205,6 +205,40 @@ BOOST_AUTO_TEST_CASE( roundtrip_prime_two_threads )
 
 }
 
+BOOST_AUTO_TEST_CASE( partial_block_and_tail_any_threads )
+{
+
+  //5 full blocks of 64 items, a partial block of 40 items and 5 trailing items bitshuffle leaves untouched
+  std::vector<std::size_t> shape(3,1);
+  shape.front() = 5*64 + 40 + 5;
+
+  constant_cube.resize(shape.front());
+  for(std::size_t i = 0;i<constant_cube.size();++i)
+    constant_cube[i] = (i*40503) & 0xffff;
+  to_play_with.resize(constant_cube.size());
+
+  sqeazy::bitshuffle_scheme<std::uint16_t> shuffle("block_size=64");
+  auto end = shuffle.encode(&constant_cube[0], &to_play_with[0],shape);
+  BOOST_REQUIRE(end != nullptr);
+
+  auto serial = constant_cube;
+  std::fill(serial.begin(), serial.end(),0);
+  BOOST_REQUIRE_EQUAL(shuffle.decode(to_play_with.data(), serial.data(),shape), 0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(constant_cube.begin(),constant_cube.end(),
+                                  serial.begin(),serial.end());
+
+  for(int nthreads : {2,3,4,7}){
+    shuffle.set_n_threads(nthreads);
+
+    auto decoded = constant_cube;
+    std::fill(decoded.begin(), decoded.end(),0);
+    BOOST_CHECK_EQUAL(shuffle.decode(to_play_with.data(), decoded.data(),shape), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(serial.begin(),serial.end(),
+                                  decoded.begin(),decoded.end());
+  }
+
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_FIXTURE_TEST_SUITE( encode_decode_loop_8bit, uint8_cube_of_8 )
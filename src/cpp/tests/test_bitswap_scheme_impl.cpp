@@ -7,6 +7,8 @@
 #include <iostream>
 #include <bitset>
 #include <map>
+#include <random>
+#include <boost/mpl/list.hpp>
 #include "array_fixtures.hpp"
 #include "encoders/bitswap_scheme_impl.hpp"
 
@@ -442,3 +444,119 @@ BOOST_AUTO_TEST_CASE( roundtrip_ramp_8 )
   BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), expected.begin(), expected.end());
 }
 
+
+typedef boost::mpl::list<bswap1_scheme_uint8, bswap1_scheme, bswap2_scheme, bswap4_scheme> threaded_schemes;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( layout_independent_of_n_threads, scheme_t, threaded_schemes )
+{
+  typedef typename scheme_t::raw_type value_t;
+
+  //odd length to include items that do not fill a sweep
+  std::vector<value_t> input((1 << 15) + 5);
+  std::mt19937 engine(1307);
+  std::uniform_int_distribution<int> dist(0, std::numeric_limits<value_t>::max());
+  for( value_t& el : input )
+    el = static_cast<value_t>(dist(engine));
+
+  scheme_t serial;
+  std::vector<value_t> reference(input.size(),0);
+  BOOST_REQUIRE(serial.encode(input.data(), reference.data(), input.size()) != nullptr);
+
+  for(int nthreads : {2, 3, 4}){
+
+    scheme_t threaded;
+    threaded.set_n_threads(nthreads);
+
+    std::vector<value_t> encoded(input.size(),0);
+    BOOST_REQUIRE(threaded.encode(input.data(), encoded.data(), input.size()) != nullptr);
+    BOOST_CHECK_MESSAGE(encoded == reference, threaded.name() << " with " << nthreads << " threads differs from 1 thread");
+
+    std::vector<value_t> decoded(input.size(),0);
+    BOOST_CHECK_EQUAL(threaded.decode(encoded.data(), decoded.data(), encoded.size()), 0);
+    BOOST_CHECK_MESSAGE(decoded == input, threaded.name() << " with " << nthreads << " threads does not roundtrip");
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( simd_paths )
+
+BOOST_AUTO_TEST_CASE( names_roundtrip ){
+
+  for(auto path : {sqeazy::simd::scalar, sqeazy::simd::sse4, sqeazy::simd::avx2, sqeazy::simd::avx512bw}){
+    sqeazy::simd::path parsed = sqeazy::simd::scalar;
+    BOOST_CHECK_EQUAL(sqeazy::simd::from_string(sqeazy::simd::name(path), parsed), 0);
+    BOOST_CHECK_EQUAL(parsed, path);
+  }
+
+  sqeazy::simd::path untouched = sqeazy::simd::avx2;
+  BOOST_CHECK_NE(sqeazy::simd::from_string("neon", untouched), 0);
+  BOOST_CHECK_EQUAL(untouched, sqeazy::simd::avx2);
+}
+
+BOOST_AUTO_TEST_CASE( every_path_yields_the_same_planes ){
+
+  const sqeazy::simd::path initial = sqeazy::simd::active();
+  BOOST_TEST_MESSAGE("active simd path: " << std::string(sqeazy::simd::active_name()));
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0,(1 << 16) - 1);
+  std::vector<std::uint16_t> input(1 << 14);
+  for(std::uint16_t& item : input)
+    item = dist(gen);
+
+  std::vector<std::uint16_t> expected(input.size(),0);
+  BOOST_CHECK_EQUAL(sqeazy::simd::limit(sqeazy::simd::scalar), sqeazy::simd::scalar);
+  bswap1_scheme reference;
+  reference.encode(input.data(), expected.data(), input.size());
+
+  for(auto path : {sqeazy::simd::sse4, sqeazy::simd::avx2, sqeazy::simd::avx512bw}){
+
+    //never above what the host supports
+    BOOST_CHECK_LE(sqeazy::simd::limit(path), sqeazy::simd::detect());
+
+    bswap1_scheme scheme;
+    std::vector<std::uint16_t> encoded(input.size(),0);
+    std::vector<std::uint16_t> decoded(input.size(),0);
+
+    scheme.encode(input.data(), encoded.data(), input.size());
+    BOOST_CHECK_EQUAL_COLLECTIONS(encoded.begin(), encoded.end(), expected.begin(), expected.end());
+
+    BOOST_CHECK_EQUAL(scheme.decode(encoded.data(), decoded.data(), input.size()), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), input.begin(), input.end());
+  }
+
+  sqeazy::simd::limit(initial);
+  BOOST_CHECK_EQUAL(sqeazy::simd::active(), initial);
+}
+
+typedef boost::mpl::list<std::uint16_t, std::uint32_t> sse_kernel_types;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( sse_kernel_variants_agree, value_t, sse_kernel_types ){
+
+  const sqeazy::simd::path initial = sqeazy::simd::active();
+  if(sqeazy::simd::detect() < sqeazy::simd::sse4)
+    return;
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<std::uint32_t> dist;
+  sqeazy::vec_32algn_t<value_t> input(1 << 13);
+  for(value_t& item : input)
+    item = static_cast<value_t>(dist(gen));
+
+  std::vector<value_t> expected(input.size(),0);
+  sqeazy::detail::scalar_bitplane_reorder_encode<1>(input.data(), expected.data(), input.size());
+
+  //sse4 runs the baseline build, avx2 and above the AVX2 build of the same kernel
+  for(auto path : {sqeazy::simd::sse4, sqeazy::simd::avx2, sqeazy::simd::avx512bw}){
+
+    if(sqeazy::simd::limit(path) != path)
+      break;
+
+    std::vector<value_t> encoded(input.size(),0);
+    BOOST_CHECK_EQUAL(sqeazy::detail::sse_bitplane_reorder_encode<1>(input.data(), encoded.data(), input.size(), 2), sqeazy::SUCCESS);
+    BOOST_CHECK_MESSAGE(encoded == expected, "sse kernel differs on the " << sqeazy::simd::active_name() << " path");
+  }
+
+  sqeazy::simd::limit(initial);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
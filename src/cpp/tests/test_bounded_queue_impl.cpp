@@ -0,0 +1,80 @@
+#define BOOST_TEST_MODULE TEST_BOUNDED_QUEUE
+#define BOOST_TEST_MAIN
+#include "boost/test/included/unit_test.hpp"
+
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+BOOST_AUTO_TEST_SUITE( bounded_queue )
+
+BOOST_AUTO_TEST_CASE( fifo_and_close ){
+
+  sqeazy::bounded_queue<std::unique_ptr<int> > queue(4);
+
+  for(int i = 0;i<3;++i)
+    BOOST_CHECK(queue.push(std::unique_ptr<int>(new int(i))));
+
+  BOOST_CHECK_EQUAL(queue.size(), 3u);
+  queue.close();
+  BOOST_CHECK(!queue.push(std::unique_ptr<int>(new int(42))));
+
+  std::unique_ptr<int> item;
+  for(int i = 0;i<3;++i){
+    BOOST_REQUIRE(queue.pop(item));
+    BOOST_CHECK_EQUAL(*item, i);
+  }
+
+  BOOST_CHECK(!queue.pop(item));
+}
+
+BOOST_AUTO_TEST_CASE( producers_and_consumers ){
+
+  const int n_items = 2000;
+  const int n_producers = 3;
+  const int n_consumers = 4;
+
+  sqeazy::bounded_queue<int> queue(2);
+  std::atomic<long> sum(0);
+  std::atomic<int> count(0);
+  std::atomic<int> producers_running(n_producers);
+  std::atomic<std::size_t> max_size(0);
+
+  std::vector<std::thread> threads;
+  for(int p = 0;p<n_producers;++p){
+    threads.emplace_back([&,p](){
+        for(int i = p;i<n_items;i += n_producers)
+          queue.push(i);
+
+        if(--producers_running == 0)
+          queue.close();
+      });
+  }
+
+  for(int c = 0;c<n_consumers;++c){
+    threads.emplace_back([&](){
+        int item = 0;
+        while(queue.pop(item)){
+          //Boost.Test assertions are not thread-safe
+          const std::size_t size = queue.size();
+          if(size > max_size)
+            max_size = size;
+          sum += item;
+          ++count;
+        }
+      });
+  }
+
+  for(std::thread& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(count.load(), n_items);
+  BOOST_CHECK_LE(max_size.load(), queue.capacity());
+  BOOST_CHECK_EQUAL(sum.load(), long(n_items)*(n_items-1)/2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
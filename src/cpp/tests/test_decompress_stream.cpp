@@ -0,0 +1,106 @@
+#define BOOST_TEST_MODULE TEST_DECOMPRESS_STREAM
+#define BOOST_TEST_MAIN
+#include "boost/test/included/unit_test.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem.hpp"
+#include "boost/program_options.hpp"
+
+#include "verbs/decompress.hpp"
+
+namespace po = boost::program_options;
+namespace bfs = boost::filesystem;
+
+typedef sqeazy::dypeline<std::uint16_t> pipeline_t;
+
+/**
+   \brief writes a stack of 11 z-planes as a stream (slabs of 4 planes) to stream_roundtrip.sqy
+*/
+struct stream_file_fixture {
+
+  std::vector<std::size_t> plane_shape;
+  std::size_t n_planes;
+  std::vector<std::uint16_t> stack;
+
+  bfs::path sqy_path;
+  bfs::path tif_path;
+
+  stream_file_fixture():
+    plane_shape({24,40}),
+    n_planes(11),
+    stack(n_planes*24*40),
+    sqy_path("stream_roundtrip.sqy"),
+    tif_path("stream_roundtrip.tif"){
+
+    for(std::size_t i = 0;i<stack.size();++i)
+      stack[i] = static_cast<std::uint16_t>((i*7) % 4096);
+
+    sqeazy::encode_stream<pipeline_t> encoder(pipeline_t::from_string("bitswap1->lz4"), plane_shape, 4);
+
+    std::ofstream out(sqy_path.string(), std::ios_base::binary);
+    encoder.begin(out);
+    encoder.push_planes(stack.data(), n_planes);
+    encoder.finish();
+  }
+
+  ~stream_file_fixture(){
+    for(const bfs::path& p : {sqy_path, tif_path})
+      if(bfs::exists(p))
+        bfs::remove(p);
+  }
+
+  po::variables_map decompress_config(const std::vector<std::string>& _args) const {
+
+    po::options_description options;
+    options.add_options()
+      ("nthreads,n", po::value<int>()->default_value(1), "")
+      ("dataset_name,d", po::value<std::string>()->default_value("sqy_stack"), "")
+      ("output_name,o", po::value<std::string>(), "")
+      ;
+
+    po::variables_map value;
+    po::store(po::command_line_parser(_args).options(options).run(), value);
+    po::notify(value);
+    return value;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( decompress_verb, stream_file_fixture )
+
+BOOST_AUTO_TEST_CASE( stream_roundtrip ){
+
+  BOOST_REQUIRE(bfs::exists(sqy_path));
+
+  for(int nthreads : {1,2}){
+
+    if(bfs::exists(tif_path))
+      bfs::remove(tif_path);
+
+    const po::variables_map config = decompress_config({"-n", std::to_string(nthreads),
+                                                        "-o", tif_path.string()});
+    BOOST_CHECK_EQUAL(decompress_files({sqy_path.string()}, config), 0);
+    BOOST_REQUIRE(bfs::exists(tif_path));
+
+    sqeazy::tiff_facet decoded(tif_path.string());
+    BOOST_REQUIRE_EQUAL(decoded.bits_per_sample(), 16);
+    BOOST_REQUIRE_EQUAL(decoded.buffer_.size(), stack.size()*sizeof(std::uint16_t));
+
+    const std::uint16_t* pixels = reinterpret_cast<const std::uint16_t*>(decoded.buffer_.data());
+    BOOST_CHECK(std::equal(stack.begin(), stack.end(), pixels));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( truncated_stream_is_skipped ){
+
+  const std::uintmax_t full_size = bfs::file_size(sqy_path);
+  bfs::resize_file(sqy_path, full_size - 8);
+
+  const po::variables_map config = decompress_config({"-o", tif_path.string()});
+  decompress_files({sqy_path.string()}, config);
+  BOOST_CHECK(!bfs::exists(tif_path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
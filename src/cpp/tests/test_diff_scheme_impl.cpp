@@ -160,3 +160,63 @@ BOOST_AUTO_TEST_CASE( unsigned_new_api )
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( versions )
+
+//input and output of the diff3x3x1 encoding as implemented before the version tag existed (version 1)
+static std::vector<unsigned short> version_1_input(){
+
+  std::vector<unsigned short> value(4*5*6);
+  for(std::size_t i = 0;i<value.size();++i)
+    value[i] = (i*7919u + (i%3)*40000u) % 65536u;
+
+  return value;
+}
+
+static const unsigned short version_1_encoded[] = {
+    0, 47919, 30302, 23757, 6140, 54059, 47514, 29897, 12280, 5735, 53654, 36037, 29492, 11875, 59794, 
+    53249, 35632, 18015, 11470, 59389, 41772, 35227, 17610, 65529, 58984, 41367, 23750, 17205, 65124, 
+    47507, 40962, 23345, 5728, 64719, 47102, 29485, 22940, 4554, 51835, 46697, 29080, 11463, 4918, 
+    48244, 29990, 28675, 11058, 58977, 52432, 33681, 15426, 10653, 58572, 40955, 34410, 16793, 64712, 
+    58167, 40550, 22933, 16388, 64307, 46690, 40145, 22528, 4911, 63902, 40962, 22708, 22123, 4506, 
+    52425, 45880, 26399, 8145, 4101, 52020, 34403, 27858, 4554, 51835, 51615, 33998, 16381, 9836, 
+    57755, 40138, 33593, 15976, 63895, 57350, 39733, 22116, 15571, 63490, 45873, 39328, 19117, 863, 
+    63085, 45468, 27851, 21306, 62808, 44554, 45063, 27446, 9829, 3284, 48244, 29990, 27041, 9424, 
+    57343, 50798, 33181, 15564, 9019, 56938, 39321
+};
+
+BOOST_AUTO_TEST_CASE( decodes_version_1_stream )
+{
+  const std::vector<std::size_t> shape = {4,5,6};
+  const std::vector<unsigned short> expected = version_1_input();
+  BOOST_REQUIRE_EQUAL(sizeof(version_1_encoded)/sizeof(unsigned short), expected.size());
+
+  //streams of version 1 carry no config
+  local_diff_scheme diff("");
+  BOOST_CHECK_EQUAL(diff.config(), "");
+
+  std::vector<unsigned short> decoded(expected.size());
+  BOOST_CHECK_EQUAL(diff.decode(version_1_encoded, decoded.data(), shape), sqeazy::SUCCESS);
+  BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( encode_writes_current_version )
+{
+  const std::vector<std::size_t> shape = {4,5,6};
+  const std::vector<unsigned short> input = version_1_input();
+
+  local_diff_scheme encoder;
+  std::vector<unsigned short> encoded(input.size());
+  encoder.encode(input.data(), encoded.data(), shape);
+  BOOST_CHECK_EQUAL(encoder.config(), "v=2");
+
+  //the arithmetic changed, so the tag is needed to tell the streams apart
+  BOOST_CHECK(!std::equal(encoded.begin(), encoded.end(), version_1_encoded));
+
+  local_diff_scheme decoder(encoder.config());
+  std::vector<unsigned short> decoded(input.size());
+  BOOST_CHECK_EQUAL(decoder.decode(encoded.data(), decoded.data(), shape), sqeazy::SUCCESS);
+  BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), input.begin(), input.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
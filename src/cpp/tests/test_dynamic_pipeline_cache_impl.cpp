@@ -0,0 +1,230 @@
+#define BOOST_TEST_MODULE TEST_DYNAMIC_PIPELINE_CACHE_IMPL
+#define BOOST_TEST_MAIN
+#include "boost/test/included/unit_test.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sqeazy_pipelines.hpp"
+#include "dynamic_pipeline_cache.hpp"
+
+typedef sqeazy::dypeline<std::uint16_t> pipeline_t;
+typedef sqeazy::pipeline_cache<pipeline_t> cache_t;
+
+BOOST_AUTO_TEST_SUITE( pipeline_cache )
+
+BOOST_AUTO_TEST_CASE( reuses_released_pipelines ){
+
+  cache_t cache;
+  const pipeline_t* first = nullptr;
+
+  {
+    auto pipe = cache.acquire("bitswap1->lz4");
+    BOOST_REQUIRE(pipe);
+    BOOST_CHECK_EQUAL(pipe->name(), pipeline_t::from_string("bitswap1->lz4").name());
+    first = pipe.get();
+  }
+
+  BOOST_CHECK_EQUAL(cache.idle(),1u);
+
+  auto again = cache.acquire("bitswap1->lz4");
+  BOOST_CHECK(again.get() == first);
+  BOOST_CHECK_EQUAL(cache.built(),1u);
+  BOOST_CHECK_EQUAL(cache.idle(),0u);
+}
+
+BOOST_AUTO_TEST_CASE( concurrent_leases_get_own_pipelines ){
+
+  cache_t cache;
+
+  auto lhs = cache.acquire("lz4");
+  auto rhs = cache.acquire("lz4");
+  BOOST_REQUIRE(lhs && rhs);
+  BOOST_CHECK(lhs.get() != rhs.get());
+  BOOST_CHECK_EQUAL(cache.built(),2u);
+}
+
+BOOST_AUTO_TEST_CASE( unknown_pipeline_gives_empty_lease ){
+
+  cache_t cache;
+
+  auto pipe = cache.acquire("does_not_exist->lz4");
+  BOOST_CHECK(!pipe);
+  BOOST_CHECK_EQUAL(cache.built(),0u);
+}
+
+BOOST_AUTO_TEST_CASE( least_recently_used_is_evicted ){
+
+  cache_t cache(2);
+
+  cache.acquire("lz4");
+  cache.acquire("bitswap1->lz4");
+  BOOST_CHECK_EQUAL(cache.idle(),2u);
+
+  cache.acquire("rmestbkrd->lz4");
+  BOOST_CHECK_EQUAL(cache.idle(),2u);
+
+  //lz4 was dropped, the others are still there
+  cache.acquire("bitswap1->lz4");
+  BOOST_CHECK_EQUAL(cache.built(),3u);
+  cache.acquire("lz4");
+  BOOST_CHECK_EQUAL(cache.built(),4u);
+}
+
+BOOST_AUTO_TEST_CASE( pipelines_with_decode_maps_are_not_kept ){
+
+  std::vector<std::uint16_t> input(32*32*32);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = i % 4096;
+  std::vector<std::size_t> shape(3,32);
+
+  auto encoder = pipeline_t::from_string("tile_shuffle->lz4");
+  std::vector<char> encoded(encoder.max_encoded_size(input.size()*sizeof(std::uint16_t)));
+  BOOST_REQUIRE(encoder.encode(input.data(), encoded.data(), shape) != nullptr);
+
+  const std::string with_map = encoder.name();
+  BOOST_REQUIRE(with_map.find("reorder_map=") != std::string::npos);
+  BOOST_CHECK(!cache_t::cacheable(with_map));
+  BOOST_CHECK(cache_t::cacheable("tile_shuffle->lz4"));
+  BOOST_CHECK(cache_t::cacheable("tile_shuffle(tile_size=8,reorder_map=)->lz4"));
+
+  cache_t cache;
+
+  {
+    auto pipe = cache.acquire(with_map);
+    BOOST_REQUIRE(pipe);
+    BOOST_CHECK_EQUAL(pipe->name(), with_map);
+  }
+
+  BOOST_CHECK_EQUAL(cache.idle(),0u);
+
+  {
+    auto pipe = cache.acquire("tile_shuffle->lz4");
+    BOOST_REQUIRE(pipe);
+  }
+
+  BOOST_CHECK_EQUAL(cache.idle(),1u);
+  BOOST_CHECK_EQUAL(cache.built(),2u);
+}
+
+BOOST_AUTO_TEST_CASE( decode_maps_in_the_side_section_are_kept ){
+
+  std::vector<std::uint16_t> input(32*32*32);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = (i*7919) % 4096;
+  std::vector<std::size_t> shape(3,32);
+
+  auto encoder = pipeline_t::from_string("tile_shuffle(tile_size=8)->lz4");
+  encoder.set_header_layout(sqeazy::header::binary);
+  std::vector<char> encoded(encoder.max_encoded_size(input.size()*sizeof(std::uint16_t)));
+  char* encoded_end = reinterpret_cast<char*>(encoder.encode(input.data(), encoded.data(), shape));
+  BOOST_REQUIRE(encoded_end != nullptr);
+
+  //the map is referred to by offset and length, the bytes are in the header
+  sqeazy::header::view in_place;
+  BOOST_REQUIRE_EQUAL(in_place.parse(encoded.data(), encoded.size()), 0);
+  const std::string with_map = in_place.pipeline().to_string();
+  BOOST_CHECK(with_map.find("reorder_map_at=0") != std::string::npos);
+  BOOST_CHECK(with_map.find("reorder_map=") == std::string::npos);
+  BOOST_CHECK(!in_place.side_section().empty());
+  BOOST_CHECK(cache_t::cacheable(with_map));
+
+  cache_t cache;
+  for(int round = 0;round<2;++round){
+    auto pipe = cache.acquire(with_map);
+    BOOST_REQUIRE(pipe);
+
+    std::vector<std::uint16_t> decoded(input.size(),0);
+    BOOST_REQUIRE_EQUAL(pipe->decode(encoded.data(), decoded.data(), std::distance(encoded.data(), encoded_end)), 0);
+    BOOST_CHECK(decoded == input);
+  }
+  BOOST_CHECK_EQUAL(cache.built(),1u);
+
+  //a JSON header cannot carry the side section, the map travels in the config
+  encoder.set_header_layout(sqeazy::header::json);
+  encoded.resize(encoder.max_encoded_size(input.size()*sizeof(std::uint16_t)));
+  encoded_end = reinterpret_cast<char*>(encoder.encode(input.data(), encoded.data(), shape));
+  BOOST_REQUIRE(encoded_end != nullptr);
+  BOOST_CHECK(encoder.name().find("reorder_map_at=") == std::string::npos);
+
+  auto decoder = pipeline_t::from_string(sqeazy::header(encoded.data(), encoded_end).pipeline());
+  std::vector<std::uint16_t> decoded(input.size(),0);
+  BOOST_REQUIRE_EQUAL(decoder.decode(encoded.data(), decoded.data(), std::distance(encoded.data(), encoded_end)), 0);
+  BOOST_CHECK(decoded == input);
+
+  //a side block that is not there
+  const std::string dangling = "tile_shuffle(tile_size=8,reorder_map_at=0,reorder_map_bytes=64)->lz4";
+  auto lost = pipeline_t::from_string(dangling);
+  BOOST_CHECK_NE(lost.decode(encoded.data(), decoded.data(), std::distance(encoded.data(), encoded_end)), 0);
+}
+
+BOOST_AUTO_TEST_CASE( idle_pipelines_release_large_scratch ){
+
+  const std::vector<std::size_t> shape = {4,32,32};
+  std::vector<std::uint16_t> input(4*32*32,42);
+
+  for(std::size_t limit : {std::size_t(0), std::size_t(64) << 20}){
+
+    cache_t cache(16, limit);
+
+    {
+      auto pipe = cache.acquire("bitswap1->lz4");
+      BOOST_REQUIRE(pipe);
+      std::vector<char> encoded(pipe->max_encoded_size(input.size()*sizeof(std::uint16_t)));
+      BOOST_REQUIRE(pipe->encode(input.data(), encoded.data(), shape) != nullptr);
+      BOOST_REQUIRE_GT(pipe->scratch().size_in_bytes(),0u);
+    }
+
+    auto again = cache.acquire("bitswap1->lz4");
+    BOOST_REQUIRE(again);
+    if(limit)
+      BOOST_CHECK_GT(again->scratch().size_in_bytes(),0u);
+    else
+      BOOST_CHECK_EQUAL(again->scratch().size_in_bytes(),0u);
+  }
+
+  cache_t cache;
+  {
+    auto pipe = cache.acquire("bitswap1->lz4");
+    std::vector<char> encoded(pipe->max_encoded_size(input.size()*sizeof(std::uint16_t)));
+    pipe->encode(input.data(), encoded.data(), shape);
+  }
+  cache.trim();
+  auto trimmed = cache.acquire("bitswap1->lz4");
+  BOOST_CHECK_EQUAL(trimmed->scratch().size_in_bytes(),0u);
+}
+
+BOOST_AUTO_TEST_CASE( roundtrip_from_many_threads ){
+
+  cache_t cache;
+  const std::vector<std::size_t> shape = {4,32,32};
+  std::vector<std::uint16_t> input(4*32*32);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = static_cast<std::uint16_t>(i % 1024);
+
+  int failures = 0;
+
+#pragma omp parallel for num_threads(4) reduction(+:failures)
+  for(int i = 0;i<32;++i){
+
+    auto pipe = cache.acquire("bitswap1->lz4");
+    if(!pipe){
+      failures += 1;
+      continue;
+    }
+
+    std::vector<char> encoded(pipe->max_encoded_size(input.size()*sizeof(std::uint16_t)));
+    char* end = pipe->encode(input.data(), encoded.data(), shape);
+
+    std::vector<std::uint16_t> decoded(input.size(),0);
+    int err = pipe->decode(encoded.data(), decoded.data(), std::distance(encoded.data(), end));
+
+    failures += (err || decoded != input) ? 1 : 0;
+  }
+
+  BOOST_CHECK_EQUAL(failures,0);
+  BOOST_CHECK_LE(cache.built(),4u);
+  BOOST_CHECK_EQUAL(cache.idle(),cache.built());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
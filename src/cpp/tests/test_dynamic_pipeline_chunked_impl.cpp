@@ -0,0 +1,244 @@
+#define BOOST_TEST_MODULE TEST_DYNAMIC_PIPELINE_CHUNKED_IMPL
+#define BOOST_TEST_MAIN
+#include "boost/test/included/unit_test.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sqeazy_pipelines.hpp"
+#include "dynamic_pipeline_chunked.hpp"
+
+typedef sqeazy::dypeline<std::uint16_t> pipeline_t;
+typedef sqeazy::chunked_pipeline<pipeline_t> chunked_t;
+
+struct stack_fixture {
+
+  std::vector<std::size_t> shape;
+  std::vector<std::uint16_t> stack;
+
+  stack_fixture():
+    shape({13,37,50}),
+    stack(13*37*50){
+
+    for(std::size_t i = 0;i<stack.size();++i)
+      stack[i] = static_cast<std::uint16_t>((i*7) % 4096);
+  }
+
+  std::vector<char> encode(const std::string& _pipeline,
+                           const std::vector<std::size_t>& _chunk_shape) const {
+
+    chunked_t chunked(pipeline_t::from_string(_pipeline), _chunk_shape);
+
+    std::vector<char> value(chunked.max_encoded_size(shape));
+    char* end = chunked.encode(stack.data(), value.data(), shape);
+    BOOST_REQUIRE(end != nullptr);
+
+    value.resize(std::distance(value.data(), end));
+    return value;
+  }
+
+  std::vector<std::uint16_t> expected(const std::vector<std::size_t>& _lo,
+                                      const std::vector<std::size_t>& _hi) const {
+
+    std::vector<std::uint16_t> value;
+    for(std::size_t z = _lo[0];z<_hi[0];++z)
+      for(std::size_t y = _lo[1];y<_hi[1];++y)
+        for(std::size_t x = _lo[2];x<_hi[2];++x)
+          value.push_back(stack[(z*shape[1] + y)*shape[2] + x]);
+
+    return value;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( chunked_container, stack_fixture )
+
+BOOST_AUTO_TEST_CASE( chunk_table_geometry ){
+
+  sqeazy::chunk_table table(shape, {4,16,64});
+
+  BOOST_CHECK_EQUAL(table.n_chunks(),4u*3u*1u);
+  BOOST_CHECK_EQUAL(table.chunk_shape_[2],50u);
+
+  std::vector<std::size_t> lo, extent;
+  table.chunk_box(table.n_chunks()-1, lo, extent);
+  BOOST_CHECK_EQUAL(lo[0],12u);
+  BOOST_CHECK_EQUAL(lo[1],32u);
+  BOOST_CHECK_EQUAL(extent[0],1u);
+  BOOST_CHECK_EQUAL(extent[1],5u);
+  BOOST_CHECK_EQUAL(extent[2],50u);
+
+  //one z plane spanning all y chunks
+  std::vector<std::size_t> chunks = table.chunks_in_region({5,0,0},{6,37,50});
+  BOOST_REQUIRE_EQUAL(chunks.size(),3u);
+  BOOST_CHECK_EQUAL(chunks[0],3u);
+  BOOST_CHECK_EQUAL(chunks[2],5u);
+
+  BOOST_CHECK(table.chunks_in_region({5,0,0},{5,37,50}).empty());
+  BOOST_CHECK(table.chunks_in_region({5,0,0},{6,38,50}).empty());
+}
+
+BOOST_AUTO_TEST_CASE( full_roundtrip ){
+
+  const std::vector<char> encoded = encode("bitswap1->lz4", {4,16,16});
+  BOOST_CHECK(sqeazy::chunked_format::contained(encoded.data(), encoded.data() + encoded.size()));
+  BOOST_CHECK(chunked_t::decoded_shape(encoded.data(), encoded.data() + encoded.size()) == shape);
+
+  for(int n_threads : {1,3}){
+    chunked_t chunked(pipeline_t(), {}, n_threads);
+
+    std::vector<std::uint16_t> decoded(stack.size(),0);
+    BOOST_CHECK_EQUAL(chunked.decode(encoded.data(), decoded.data(), encoded.size()),0);
+    BOOST_CHECK(decoded == stack);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( shuffled_chunks_roundtrip ){
+
+  //every chunk keeps its decode map in the side section of its header
+  const std::vector<char> encoded = encode("tile_shuffle(tile_size=4)->lz4", {4,16,16});
+
+  for(int n_threads : {1,3}){
+    chunked_t chunked(pipeline_t(), {}, n_threads);
+
+    std::vector<std::uint16_t> decoded(stack.size(),0);
+    BOOST_CHECK_EQUAL(chunked.decode(encoded.data(), decoded.data(), encoded.size()),0);
+    BOOST_CHECK(decoded == stack);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( region_from_buffer ){
+
+  const std::vector<char> encoded = encode("lz4", {4,16,16});
+  chunked_t chunked;
+
+  const std::vector<std::vector<std::size_t> > boxes = {
+    {7,0,0, 8,37,50},  //one plane
+    {3,10,17, 9,33,49}, //ROI across chunk borders
+    {12,36,49, 13,37,50}, //last voxel
+  };
+
+  for(const auto& b : boxes){
+    std::vector<std::size_t> lo(b.begin(), b.begin() + 3), hi(b.begin() + 3, b.end());
+    const std::vector<std::uint16_t> reference = expected(lo,hi);
+
+    std::vector<std::uint16_t> decoded(reference.size(),0);
+    BOOST_CHECK_EQUAL(chunked.decode_region(encoded.data(), encoded.data() + encoded.size(), lo, hi, decoded.data()),0);
+    BOOST_CHECK(decoded == reference);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( region_from_stream ){
+
+  const std::vector<char> encoded = encode("bitswap1->lz4", {2,37,25});
+
+  //the container does not need to start at the beginning of the stream
+  std::string file(5,'x');
+  file.append(encoded.begin(), encoded.end());
+  std::istringstream in(file);
+  in.seekg(5);
+
+  std::vector<std::size_t> lo = {10,4,20}, hi = {12,30,40};
+  const std::vector<std::uint16_t> reference = expected(lo,hi);
+  std::vector<std::uint16_t> decoded(reference.size(),0);
+
+  chunked_t chunked(pipeline_t(), {}, 2);
+  BOOST_CHECK_EQUAL(chunked.decode_region(in, lo, hi, decoded.data()),0);
+  BOOST_CHECK(decoded == reference);
+}
+
+BOOST_AUTO_TEST_CASE( chunks_are_sqy_buffers ){
+
+  const std::vector<char> encoded = encode("lz4", {4,37,50});
+
+  sqeazy::chunk_table table;
+  BOOST_REQUIRE_EQUAL(table.read(encoded.data(), encoded.data() + encoded.size()),0);
+  BOOST_REQUIRE_EQUAL(table.n_chunks(),4u);
+  BOOST_CHECK_EQUAL(table.offsets_.back(),encoded.size());
+
+  const char* chunk = encoded.data() + table.offsets_[1];
+  const std::size_t chunk_bytes = table.offsets_[2] - table.offsets_[1];
+
+  auto pipe = pipeline_t::from_string("lz4");
+  std::vector<std::uint16_t> decoded(4*37*50,0);
+  BOOST_CHECK_EQUAL(pipe.decode(chunk, decoded.data(), chunk_bytes),0);
+  BOOST_CHECK(std::equal(decoded.begin(), decoded.end(), stack.begin() + 4*37*50));
+}
+
+BOOST_AUTO_TEST_CASE( rejects_bad_input ){
+
+  const std::vector<char> encoded = encode("lz4", {4,16,16});
+  chunked_t chunked;
+  std::vector<std::uint16_t> decoded(stack.size(),0);
+
+  //truncated
+  BOOST_CHECK_EQUAL(chunked.decode(encoded.data(), decoded.data(), encoded.size()/2),1);
+
+  //plain sqy buffer
+  auto pipe = pipeline_t::from_string("lz4");
+  std::vector<char> plain(pipe.max_encoded_size(stack.size()*sizeof(std::uint16_t)));
+  char* plain_end = pipe.encode(stack.data(), plain.data(), shape);
+  BOOST_CHECK_EQUAL(chunked.decode(plain.data(), decoded.data(), std::distance(plain.data(), plain_end)),1);
+
+  //region outside of the stack
+  BOOST_CHECK_EQUAL(chunked.decode_region(encoded.data(), encoded.data() + encoded.size(),
+                                          {0,0,0}, {14,37,50}, decoded.data()),1);
+}
+
+BOOST_AUTO_TEST_CASE( corrupt_chunk_is_reported ){
+
+  std::vector<char> encoded = encode("bitswap1->lz4", {4,37,50});
+
+  sqeazy::chunk_table table;
+  BOOST_REQUIRE_EQUAL(table.read(encoded.data(), encoded.data() + encoded.size()),0);
+  BOOST_REQUIRE_EQUAL(table.n_chunks(),4u);
+
+  //destroy the sqy header of the third chunk
+  std::fill(encoded.begin() + table.offsets_[2], encoded.begin() + table.offsets_[2] + 16, '#');
+
+  //give the second chunk a stage config that throws when its pipeline is built
+  const std::string option = "num_bits_per_plane=1";
+  auto found = std::search(encoded.begin() + table.offsets_[1], encoded.begin() + table.offsets_[2],
+                           option.begin(), option.end());
+  BOOST_REQUIRE(found != encoded.begin() + table.offsets_[2]);
+  *(found + option.size() - 1) = 'x';
+
+  for(int n_threads : {1,3}){
+    chunked_t chunked(pipeline_t(), {}, n_threads);
+
+    std::vector<std::uint16_t> decoded(stack.size(),0);
+    BOOST_CHECK_EQUAL(chunked.decode(encoded.data(), decoded.data(), encoded.size()),1);
+
+    //the intact chunks are decoded nonetheless
+    BOOST_CHECK(std::equal(decoded.begin(), decoded.begin() + 4*37*50, stack.begin()));
+    BOOST_CHECK(std::equal(decoded.begin() + 12*37*50, decoded.end(), stack.begin() + 12*37*50));
+  }
+}
+
+#ifdef _OPENMP
+BOOST_AUTO_TEST_CASE( inner_regions_get_their_threads ){
+
+  const int levels_before = omp_get_max_active_levels();
+  int inner_threads = 0;
+
+  {
+    const sqeazy::nested_parallelism nesting(2);
+
+#pragma omp parallel num_threads(2)
+    {
+#pragma omp parallel num_threads(2)
+      {
+#pragma omp critical
+        inner_threads = (std::max)(inner_threads, omp_get_num_threads());
+      }
+    }
+  }
+
+  BOOST_CHECK_EQUAL(inner_threads, 2);
+  BOOST_CHECK_EQUAL(omp_get_max_active_levels(), levels_before);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -294,6 +294,119 @@ BOOST_AUTO_TEST_CASE (decode_with_filters) {
     BOOST_CHECK_EQUAL(output[i],input[i]);
 }
 
+BOOST_AUTO_TEST_CASE (roundtrip_with_three_filters) {
+
+  std::vector<int> input(10);
+  std::iota(input.begin(), input.end(),0);
+  std::vector<int> output(input.size(),0);
+
+  auto filters_pipe = sqeazy_testing::dynamic_pipeline<int>::from_string("add_one->square->add_one");
+
+  std::size_t max_encoded_size_byte = filters_pipe.max_encoded_size(input.size()*sizeof(int));
+  std::vector<char> intermediate(max_encoded_size_byte);
+
+  auto encoded_end = filters_pipe.encode(input.data(),
+                     intermediate.data(),
+                     input.size());
+  BOOST_REQUIRE(encoded_end!=nullptr);
+
+  std::size_t encoded_size = encoded_end - intermediate.data();
+  const int* encoded_back = reinterpret_cast<const int*>(encoded_end) - 1;
+  BOOST_CHECK_EQUAL(*encoded_back,101);
+
+  int err_code = filters_pipe.decode(intermediate.data(),
+                     output.data(),
+                     encoded_size);
+  BOOST_CHECK_EQUAL(err_code,0);
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                input.begin(), input.end());
+}
+
+BOOST_AUTO_TEST_CASE (decode_uses_at_most_one_scratch_buffer) {
+
+  std::vector<int> input(1 << 10);
+  std::iota(input.begin(), input.end(),0);
+  const std::size_t output_bytes = input.size()*sizeof(int);
+
+  for(const std::string pipe_str : {"add_one", "add_one->square", "add_one->square->add_one", "add_one->add_one->add_one->add_one"}){
+
+    auto encode_pipe = sqeazy_testing::dynamic_pipeline<int>::from_string(pipe_str);
+    std::vector<char> intermediate(encode_pipe.max_encoded_size(output_bytes));
+
+    auto encoded_end = encode_pipe.encode(input.data(),
+                                          intermediate.data(),
+                                          input.size());
+    BOOST_REQUIRE(encoded_end!=nullptr);
+
+    auto decode_pipe = sqeazy_testing::dynamic_pipeline<int>::from_string(pipe_str);
+    std::vector<int> output(input.size(),0);
+    int err_code = decode_pipe.decode(intermediate.data(),
+                                      output.data(),
+                                      encoded_end - intermediate.data());
+    BOOST_CHECK_EQUAL(err_code,0);
+    BOOST_CHECK_LE(decode_pipe.scratch().size_in_bytes(),output_bytes + sqeazy::scratch_arena::alignment);
+    BOOST_CHECK_EQUAL(decode_pipe.scratch().capacity(1),0u);
+    BOOST_CHECK_MESSAGE(std::equal(output.begin(), output.end(), input.begin()), pipe_str << " does not roundtrip");
+  }
+}
+
+BOOST_AUTO_TEST_CASE (scratch_is_retained_across_calls) {
+
+  std::vector<int> input(1 << 10,4);
+  std::vector<int> output(input.size(),0);
+
+  auto filters_pipe = sqeazy_testing::dynamic_pipeline<int>::from_string("add_one->square");
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().size_in_bytes(),0u);
+
+  std::size_t max_encoded_size_byte = filters_pipe.max_encoded_size(input.size()*sizeof(int));
+  std::vector<char> intermediate(max_encoded_size_byte);
+
+  auto encoded_end = filters_pipe.encode(input.data(),
+                     intermediate.data(),
+                     input.size());
+  BOOST_REQUIRE(encoded_end!=nullptr);
+
+  const std::size_t scratch_bytes = filters_pipe.scratch().size_in_bytes();
+  const char* scratch_ptr = filters_pipe.scratch().data(0);
+  BOOST_CHECK_GT(scratch_bytes,0u);
+
+  for(int i = 0;i < 3;++i){
+    encoded_end = filters_pipe.encode(input.data(),
+                                      intermediate.data(),
+                                      input.size());
+    BOOST_REQUIRE(encoded_end!=nullptr);
+
+    int err_code = filters_pipe.decode(intermediate.data(),
+                                       output.data(),
+                                       encoded_end - intermediate.data());
+    BOOST_CHECK_EQUAL(err_code,0);
+  }
+
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().data(0),scratch_ptr);
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().capacity(0),scratch_bytes);
+  BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(),
+                                input.begin(), input.end());
+
+  auto copied = filters_pipe;
+  BOOST_CHECK_EQUAL(copied.scratch().size_in_bytes(),0u);
+
+  BOOST_CHECK(!filters_pipe.shrink_scratch(scratch_bytes));
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().data(0),scratch_ptr);
+  BOOST_CHECK(filters_pipe.shrink_scratch(0));
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().size_in_bytes(),0u);
+
+  filters_pipe.set_use_hugepages(true);
+  BOOST_CHECK(filters_pipe.use_hugepages());
+  encoded_end = filters_pipe.encode(input.data(),
+                                    intermediate.data(),
+                                    input.size());
+  BOOST_REQUIRE(encoded_end!=nullptr);
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().capacity(0) % sqeazy::scratch_arena::hugepage_bytes,0u);
+
+  filters_pipe.release_scratch();
+  BOOST_CHECK_EQUAL(filters_pipe.scratch().size_in_bytes(),0u);
+}
+
 BOOST_AUTO_TEST_CASE (encode_with_sink) {
 
   std::vector<int> input(10);
@@ -0,0 +1,138 @@
+#define BOOST_TEST_MODULE TEST_DYNAMIC_PIPELINE_STREAM_IMPL
+#define BOOST_TEST_MAIN
+#include "boost/test/included/unit_test.hpp"
+#include <cstdint>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sqeazy_pipelines.hpp"
+#include "dynamic_pipeline_stream.hpp"
+
+typedef sqeazy::dypeline<std::uint16_t> pipeline_t;
+
+struct planes_fixture {
+
+  std::vector<std::size_t> plane_shape;
+  std::size_t plane_size;
+  std::size_t n_planes;
+  std::vector<std::uint16_t> stack;
+
+  planes_fixture():
+    plane_shape({24,40}),
+    plane_size(24*40),
+    n_planes(11),
+    stack(n_planes*plane_size){
+
+    for(std::size_t i = 0;i<stack.size();++i)
+      stack[i] = static_cast<std::uint16_t>((i*7) % 4096);
+  }
+
+  std::string encode(const std::string& _pipeline, std::size_t _planes_per_slab, bool _overlap) const {
+
+    auto pipe = pipeline_t::from_string(_pipeline);
+    sqeazy::encode_stream<pipeline_t> encoder(pipe, plane_shape, _planes_per_slab, _overlap);
+
+    std::ostringstream out;
+    BOOST_REQUIRE_EQUAL(encoder.begin(out),0);
+
+    //planes arrive one by one as from a camera
+    for(std::size_t z = 0;z<n_planes;++z)
+      BOOST_REQUIRE_EQUAL(encoder.push_planes(stack.data() + z*plane_size, 1),0);
+
+    BOOST_REQUIRE_EQUAL(encoder.finish(),0);
+    BOOST_CHECK_EQUAL(encoder.planes_pushed(),n_planes);
+    BOOST_CHECK_EQUAL(encoder.slabs_written(),(n_planes + _planes_per_slab - 1)/_planes_per_slab);
+    BOOST_CHECK_EQUAL(encoder.bytes_written(),out.str().size());
+
+    return out.str();
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( stream_roundtrip, planes_fixture )
+
+BOOST_AUTO_TEST_CASE( planewise_roundtrip ){
+
+  for(bool overlap : {true, false}){
+
+    const std::string encoded = encode("bitswap1->lz4", 4, overlap);
+
+    std::istringstream in(encoded);
+    sqeazy::decode_stream<pipeline_t> decoder;
+    BOOST_REQUIRE_EQUAL(decoder.begin(in),0);
+    BOOST_CHECK(decoder.plane_shape() == plane_shape);
+
+    std::vector<std::uint16_t> decoded(stack.size(),0);
+    std::size_t pulled = 0;
+    std::size_t n = 0;
+    while((n = decoder.pull_planes(decoded.data() + pulled*plane_size, 1)))
+      pulled += n;
+
+    BOOST_CHECK_EQUAL(pulled,n_planes);
+    BOOST_CHECK_EQUAL(decoder.finish(),0);
+    BOOST_CHECK(decoded == stack);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( pull_more_planes_than_a_slab ){
+
+  const std::string encoded = encode("lz4", 3, true);
+
+  std::istringstream in(encoded);
+  sqeazy::decode_stream<pipeline_t> decoder(2);
+  BOOST_REQUIRE_EQUAL(decoder.begin(in),0);
+
+  std::vector<std::uint16_t> decoded(stack.size(),0);
+  BOOST_CHECK_EQUAL(decoder.pull_planes(decoded.data(), 7),7u);
+  BOOST_CHECK_EQUAL(decoder.pull_planes(decoded.data() + 7*plane_size, 100),n_planes-7);
+  BOOST_CHECK_EQUAL(decoder.pull_planes(decoded.data(), 1),0u);
+
+  BOOST_CHECK_EQUAL(decoder.slabs_read(),4u);
+  BOOST_CHECK_EQUAL(decoder.finish(),0);
+  BOOST_CHECK(decoded == stack);
+}
+
+BOOST_AUTO_TEST_CASE( slabs_are_sqy_buffers ){
+
+  const std::string encoded = encode("bitswap1->lz4", 8, false);
+
+  std::istringstream in(encoded);
+  in.seekg(sqeazy::stream_format::magic().size());
+
+  std::uint64_t slab_bytes = 0;
+  BOOST_REQUIRE(sqeazy::stream_format::read_u64(in, slab_bytes));
+  std::vector<char> slab(slab_bytes);
+  in.read(slab.data(), slab_bytes);
+
+  auto pipe = pipeline_t::from_string("bitswap1->lz4");
+  std::vector<std::size_t> shape = pipe.decoded_shape(slab.data(), slab.data() + slab.size());
+  BOOST_REQUIRE_EQUAL(shape.size(),3u);
+  BOOST_CHECK_EQUAL(shape[0],8u);
+
+  std::vector<std::uint16_t> decoded(8*plane_size,0);
+  BOOST_CHECK_EQUAL(pipe.decode(slab.data(), decoded.data(), slab.size()),0);
+  BOOST_CHECK(std::equal(decoded.begin(), decoded.end(), stack.begin()));
+}
+
+BOOST_AUTO_TEST_CASE( truncated_stream_is_reported ){
+
+  const std::string encoded = encode("lz4", 4, true);
+
+  std::istringstream in(encoded.substr(0, encoded.size() - 3*sizeof(std::uint64_t)));
+  sqeazy::decode_stream<pipeline_t> decoder;
+  BOOST_REQUIRE_EQUAL(decoder.begin(in),0);
+
+  std::vector<std::uint16_t> decoded(stack.size(),0);
+  BOOST_CHECK_EQUAL(decoder.pull_planes(decoded.data(), n_planes),n_planes);
+  BOOST_CHECK_EQUAL(decoder.finish(),1);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_foreign_input ){
+
+  std::istringstream in("not a stream at all");
+  sqeazy::decode_stream<pipeline_t> decoder;
+  BOOST_CHECK_EQUAL(decoder.begin(in),1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
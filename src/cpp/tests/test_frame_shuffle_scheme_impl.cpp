@@ -397,7 +397,7 @@ BOOST_AUTO_TEST_CASE( simple )
                shape);
   
   BOOST_REQUIRE(rem == (to_play_with.data()+to_play_with.size()));
-  BOOST_CHECK_NE(scheme.serialized_reorder_map.empty(), true);
+  BOOST_CHECK_NE(scheme.stored_map.packed.empty(), true);
 
 }
 
@@ -459,4 +459,32 @@ BOOST_AUTO_TEST_CASE( rt_with_alien_config )
 }
 
 
+BOOST_AUTO_TEST_CASE( rt_with_legacy_config )
+{
+
+  label_stack_by_frame_reverse(incrementing_cube.begin(),dims,4);
+  auto expected = incrementing_cube;
+
+  sqy::detail::frame_shuffle frames_of(4);
+  std::vector<std::size_t> shape(dims.begin(), dims.end());
+  frames_of.encode(incrementing_cube.cbegin(), incrementing_cube.cend(),
+                   to_play_with.begin(),
+                   shape);
+
+  //maps used to be stored as plain std::size_t arrays
+  std::string config = "frame_chunk_size=4,reorder_map=";
+  config += sqy::parsing::range_to_verbatim(frames_of.decode_map.begin(), frames_of.decode_map.end());
+  sqy::frame_shuffle_scheme<std::uint16_t> legacy(config);
+
+  auto dec_rem = legacy.decode(to_play_with.data(),
+                               incrementing_cube.data(),
+                               shape);
+
+  BOOST_REQUIRE_EQUAL(dec_rem, sqy::SUCCESS);
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(),
+                  incrementing_cube.begin(), incrementing_cube.end());
+
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -563,5 +563,159 @@ BOOST_AUTO_TEST_CASE( roundtrip_bswap1_lz4_as_reference ){
 
 }
 
+BOOST_AUTO_TEST_CASE( parallel_write_reads_through_filter ){
+
+  //chunks are cut at the upper borders of dimension 0 and 1
+  const std::vector<hsize_t> chunk_shape = {4, 48, 9};
+
+  for(int nthreads : {1,3}){
+
+    sqeazy::h5_file testme(test_output_name, H5F_ACC_TRUNC);
+    int rvalue = testme.write_nd_dataset_parallel(dname,
+                                                  pipe16.name(),
+                                                  retrieved.data(),
+                                                  dims.data(),
+                                                  dims.size(),
+                                                  chunk_shape,
+                                                  nthreads);
+    BOOST_REQUIRE_EQUAL(rvalue, 0);
+
+    H5::DataSet ds = testme.load_h5_dataset(dname);
+    H5::DSetCreatPropList plist(ds.getCreatePlist());
+    std::vector<hsize_t> stored_chunk_shape(dims.size(),0);
+    BOOST_REQUIRE_EQUAL(plist.getChunk(stored_chunk_shape.size(), stored_chunk_shape.data()), int(dims.size()));
+    BOOST_CHECK_EQUAL_COLLECTIONS(stored_chunk_shape.begin(), stored_chunk_shape.end(),
+                                  chunk_shape.begin(), chunk_shape.end());
+
+    std::vector<std::uint16_t> written;
+    std::vector<unsigned int> written_shape;
+    rvalue = testme.read_nd_dataset(dname,
+                                    written,
+                                    written_shape);
+    BOOST_REQUIRE_EQUAL(rvalue, 0);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(written_shape.begin(),written_shape.end(),dims.begin(),dims.end());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(written.begin(),written.end(),retrieved.begin(),retrieved.end());
+  }
+
+}
+
+BOOST_AUTO_TEST_CASE( parallel_write_default_chunks ){
+
+  const std::vector<hsize_t> h5_dims(dims.begin(), dims.end());
+  const std::vector<hsize_t> chunks = sqeazy::h5_file::default_parallel_chunk_shape<std::uint16_t>(h5_dims, 4);
+  BOOST_CHECK_EQUAL(chunks[0], 2u);
+  BOOST_CHECK_EQUAL(chunks[1], dims[1]);
+  BOOST_CHECK_EQUAL(chunks[2], dims[2]);
+
+  std::vector<std::uint8_t> input(retrieved.size());
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = retrieved[i] % 251;
+
+  sqeazy::h5_file testme(test_output_name, H5F_ACC_TRUNC);
+  int rvalue = testme.write_nd_dataset_parallel(dname,
+                                                pipe8.name(),
+                                                input.data(),
+                                                dims.data(),
+                                                dims.size(),
+                                                std::vector<hsize_t>(),
+                                                4);
+  BOOST_REQUIRE_EQUAL(rvalue, 0);
+
+  std::vector<std::uint8_t> written;
+  std::vector<unsigned int> written_shape;
+  rvalue = testme.read_nd_dataset(dname,
+                                  written,
+                                  written_shape);
+  BOOST_REQUIRE_EQUAL(rvalue, 0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(written.begin(),written.end(),input.begin(),input.end());
+
+}
+
+
+BOOST_AUTO_TEST_CASE( parallel_read_matches_filter_read ){
+
+  const std::vector<hsize_t> chunk_shape = {4, 48, 9};
+
+  for(int nthreads : {1,3}){
+
+    sqeazy::h5_file testme(test_output_name, H5F_ACC_TRUNC);
+    int rvalue = testme.write_nd_dataset_parallel(dname,
+                                                  pipe16.name(),
+                                                  retrieved.data(),
+                                                  dims.data(),
+                                                  dims.size(),
+                                                  chunk_shape,
+                                                  2);
+    BOOST_REQUIRE_EQUAL(rvalue, 0);
+
+    //chunks written through the hdf5 filter
+    rvalue = testme.write_nd_dataset("/filtered",
+                                     retrieved,
+                                     dims,
+                                     pipe16);
+    BOOST_REQUIRE_EQUAL(rvalue, 0);
+
+    for(const std::string& name : {dname, std::string("/filtered")}){
+
+      std::vector<std::uint16_t> written(retrieved.size(),0);
+      std::vector<unsigned int> written_shape;
+      rvalue = testme.read_nd_dataset_parallel(name,
+                                               written.data(),
+                                               written_shape,
+                                               nthreads);
+      BOOST_REQUIRE_EQUAL(rvalue, 0);
+      BOOST_REQUIRE_EQUAL_COLLECTIONS(written_shape.begin(),written_shape.end(),dims.begin(),dims.end());
+      BOOST_REQUIRE_EQUAL_COLLECTIONS(written.begin(),written.end(),retrieved.begin(),retrieved.end());
+    }
+  }
+
+}
+
+BOOST_AUTO_TEST_CASE( region_read ){
+
+  const std::vector<hsize_t> chunk_shape = {4, 48, 9};
+  const std::vector<unsigned> lo = {1, 40, 2};
+  const std::vector<unsigned> hi = {6, 100, 7};
+
+  std::vector<std::uint16_t> expected;
+  for(unsigned z = lo[0];z<hi[0];++z)
+    for(unsigned y = lo[1];y<hi[1];++y)
+      for(unsigned x = lo[2];x<hi[2];++x)
+        expected.push_back(retrieved[(z*dims[1] + y)*dims[2] + x]);
+
+  sqeazy::h5_file testme(test_output_name, H5F_ACC_TRUNC);
+  int rvalue = testme.write_nd_dataset_parallel(dname,
+                                                pipe16.name(),
+                                                retrieved.data(),
+                                                dims.data(),
+                                                dims.size(),
+                                                chunk_shape,
+                                                2);
+  BOOST_REQUIRE_EQUAL(rvalue, 0);
+
+  //not compressed, read as hyperslab
+  rvalue = testme.write_nd_dataset("/raw",
+                                   retrieved.data(),
+                                   dims.data(),
+                                   dims.size());
+  BOOST_REQUIRE_EQUAL(rvalue, 0);
+
+  for(const std::string& name : {dname, std::string("/raw")}){
+    for(int nthreads : {1,3}){
+
+      std::vector<std::uint16_t> region(expected.size(),0);
+      rvalue = testme.read_nd_region(name, region.data(), lo, hi, nthreads);
+      BOOST_REQUIRE_EQUAL(rvalue, 0);
+      BOOST_REQUIRE_EQUAL_COLLECTIONS(region.begin(),region.end(),expected.begin(),expected.end());
+    }
+  }
+
+  std::vector<unsigned> too_far(hi);
+  too_far[1] = dims[1] + 1;
+  std::vector<std::uint16_t> region(expected.size(),0);
+  BOOST_CHECK_NE(testme.read_nd_region(dname, region.data(), lo, too_far, 2), 0);
+
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -294,6 +294,106 @@ BOOST_AUTO_TEST_CASE( roundtrip_filter ){
 
 
 
+}
+
+BOOST_AUTO_TEST_CASE( roundtrip_parallel_filter ){
+
+
+  uint16_cube_of_8 data;
+  std::vector<unsigned> chunk_shape = {3,8,8};
+
+  int rvalue = SQY_h5_write_parallel_UI16(test_output_name.c_str(),
+                                          dname.c_str(),
+                                          &data.constant_cube[0],
+                                          data.dims.size(),
+                                          &data.dims[0],
+                                          default_filter_name.c_str(),
+                                          &chunk_shape[0],
+                                          2);
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+  BOOST_REQUIRE(bfs::exists(test_output_path));
+
+  data.to_play_with.clear();
+  data.to_play_with.resize(data.constant_cube.size());
+
+  rvalue = SQY_h5_read_UI16(test_output_name.c_str(),
+                            dname.c_str(),
+                            &data.to_play_with[0]);
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(data.to_play_with.begin(), data.to_play_with.end(),
+                                  data.constant_cube.begin(), data.constant_cube.end());
+
+  std::fill(data.to_play_with.begin(), data.to_play_with.end(), 0);
+  rvalue = SQY_h5_read_parallel_UI16(test_output_name.c_str(),
+                                     dname.c_str(),
+                                     &data.to_play_with[0],
+                                     2);
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(data.to_play_with.begin(), data.to_play_with.end(),
+                                  data.constant_cube.begin(), data.constant_cube.end());
+
+  //one plane
+  std::vector<unsigned> lo = {5,0,0};
+  std::vector<unsigned> hi = {6,data.dims[1],data.dims[2]};
+  std::vector<unsigned short> plane(data.dims[1]*data.dims[2],0);
+  rvalue = SQY_h5_read_region_UI16(test_output_name.c_str(),
+                                   dname.c_str(),
+                                   data.dims.size(),
+                                   &lo[0],
+                                   &hi[0],
+                                   &plane[0],
+                                   2);
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(plane.begin(), plane.end(),
+                                  data.constant_cube.begin() + 5*plane.size(),
+                                  data.constant_cube.begin() + 6*plane.size());
+
+}
+
+BOOST_AUTO_TEST_CASE( parallel_read_of_single_chunk ){
+
+  //datasets written without a chunk shape hold one chunk covering the whole stack
+  uint16_cube_of_8 data;
+
+  int rvalue = SQY_h5_write_UI16(test_output_name.c_str(),
+                                 dname.c_str(),
+                                 &data.constant_cube[0],
+                                 data.dims.size(),
+                                 &data.dims[0],
+                                 default_filter_name.c_str());
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+
+  data.to_play_with.clear();
+  data.to_play_with.resize(data.constant_cube.size(),0);
+  rvalue = SQY_h5_read_parallel_UI16(test_output_name.c_str(),
+                                     dname.c_str(),
+                                     &data.to_play_with[0],
+                                     2);
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(data.to_play_with.begin(), data.to_play_with.end(),
+                                  data.constant_cube.begin(), data.constant_cube.end());
+
+  std::vector<unsigned> lo = {2,0,0};
+  std::vector<unsigned> hi = {3,data.dims[1],data.dims[2]};
+  std::vector<unsigned short> plane(data.dims[1]*data.dims[2],0);
+  rvalue = SQY_h5_read_region_UI16(test_output_name.c_str(),
+                                   dname.c_str(),
+                                   data.dims.size(),
+                                   &lo[0],
+                                   &hi[0],
+                                   &plane[0],
+                                   2);
+
+  BOOST_REQUIRE_EQUAL(rvalue,0);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(plane.begin(), plane.end(),
+                                  data.constant_cube.begin() + 2*plane.size(),
+                                  data.constant_cube.begin() + 3*plane.size());
 }
 
 BOOST_AUTO_TEST_CASE( write_compressed_data ){
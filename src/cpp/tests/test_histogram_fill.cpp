@@ -87,3 +87,91 @@ BOOST_AUTO_TEST_CASE( ramp_with_2_threads ){
   BOOST_CHECK_EQUAL( serial_sum, parallel_sum);
 }
 BOOST_AUTO_TEST_SUITE_END()
+
+namespace {
+
+  //long runs of equal values (like background) and a wide tail
+  std::vector<std::uint16_t> runs_and_tail(std::size_t _size){
+
+    std::vector<std::uint16_t> value(_size,0);
+    for(std::size_t i = 0;i<_size;++i)
+      value[i] = (i % 1024) < 512 ? 100 : (i*2654435761u) >> 16;
+
+    return value;
+  }
+
+  template <typename T>
+  std::vector<std::uint32_t> reference_histogram(const std::vector<T>& _data, std::size_t _stride = 1){
+
+    std::vector<std::uint32_t> value(sqeazy::detail::dense_histo<T>::size,0);
+    for(std::size_t i = 0;i<_data.size();i += _stride)
+      value[_data[i]]++;
+
+    return value;
+  }
+
+}
+
+BOOST_AUTO_TEST_SUITE( banked_and_sampled_fill )
+
+BOOST_AUTO_TEST_CASE( banked_matches_reference ){
+
+  const auto data = runs_and_tail(1 << 19);
+  const auto expected = reference_histogram(data);
+
+  auto serial_histo = sqeazy::detail::serial::create_histogram(data.data(), data.data() + data.size());
+  BOOST_CHECK( serial_histo == expected );
+
+  for(int nthreads : {2,3}){
+    auto parallel_histo = sqeazy::detail::parallel::create_histogram(data.begin(), data.end(), nthreads);
+    BOOST_CHECK( parallel_histo == expected );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( banked_matches_reference_uint8 ){
+
+  std::vector<std::uint8_t> data(4099,0);
+  for(std::size_t i = 0;i<data.size();++i)
+    data[i] = i % 7 ? 3 : i;
+
+  std::vector<std::uint32_t> histo(256,0);
+  sqeazy::detail::parallel::fill_histogram(data.data(), data.data() + data.size(), histo.data(), 2);
+
+  BOOST_CHECK( histo == reference_histogram(data) );
+}
+
+BOOST_AUTO_TEST_CASE( parallel_fill_adds_to_existing_bins ){
+
+  const auto data = runs_and_tail(1 << 19);
+  auto expected = reference_histogram(data);
+
+  std::vector<std::uint32_t> histo(expected.size(),1);
+  sqeazy::detail::parallel::fill_histogram(data.begin(), data.end(), histo.begin(), 3);
+
+  for(auto& bin : expected)
+    bin += 1;
+
+  BOOST_CHECK( histo == expected );
+}
+
+BOOST_AUTO_TEST_CASE( sampled ){
+
+  const auto data = runs_and_tail((1 << 20) + 5);
+
+  for(std::size_t stride : {1,7,64}){
+
+    const auto expected = reference_histogram(data, stride);
+
+    std::vector<std::uint32_t> serial_histo(expected.size(),0);
+    std::size_t n_samples = sqeazy::detail::serial::sample_histogram(data.begin(), data.end(), serial_histo.begin(), stride);
+    BOOST_CHECK_EQUAL(n_samples, (data.size() + stride - 1)/stride);
+    BOOST_CHECK( serial_histo == expected );
+
+    std::vector<std::uint32_t> parallel_histo(expected.size(),0);
+    n_samples = sqeazy::detail::parallel::sample_histogram(data.data(), data.data() + data.size(), parallel_histo.data(), stride, 4);
+    BOOST_CHECK_EQUAL(n_samples, (data.size() + stride - 1)/stride);
+    BOOST_CHECK( parallel_histo == expected );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
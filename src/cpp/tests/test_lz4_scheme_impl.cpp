@@ -716,3 +716,89 @@ BOOST_AUTO_TEST_CASE( four_chunks_roundtrip )
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+
+BOOST_FIXTURE_TEST_SUITE( sixteen_bit_parallel_decode, uint16_cube_of_8 )
+
+BOOST_AUTO_TEST_CASE( frames_are_indexed )
+{
+  const auto len = 4 << 19;// want a 4MB test image
+  incrementing_cube.resize(len);
+  std::vector<std::size_t> shape(dims.begin(), dims.end());
+  shape.back() = (len) / frame;
+
+  sqeazy::lz4_scheme<value_type> local("n_chunks_of_input=8");
+  local.set_n_threads(4);
+  std::vector<char> encoded(local.max_encoded_size(len*sizeof(value_type)));
+
+  auto res = local.encode(incrementing_cube.data(),
+                          encoded.data(),
+                          shape);
+  BOOST_REQUIRE_NE(res,(char*)nullptr);
+
+  sqeazy::lz4::frame_index index;
+  auto frames_begin = index.read((const char*)encoded.data(),(const char*)res);
+
+  BOOST_REQUIRE_EQUAL(index.size(),8u);
+  BOOST_CHECK_EQUAL(std::distance((const char*)encoded.data(),frames_begin),sqeazy::lz4::frame_index::size_in_bytes(8));
+  BOOST_CHECK_EQUAL(index.offsets.front(),0u);
+  BOOST_CHECK_EQUAL(std::accumulate(index.decoded_bytes.begin(), index.decoded_bytes.end(),std::uint64_t(0)),len*sizeof(value_type));
+
+}
+
+BOOST_AUTO_TEST_CASE( roundtrip_with_n_threads )
+{
+  const auto len = 4 << 19;// want a 4MB test image
+  incrementing_cube.resize(len);
+  std::vector<std::size_t> shape(dims.begin(), dims.end());
+  shape.back() = (len) / frame;
+
+  sqeazy::lz4_scheme<value_type> encoder("n_chunks_of_input=17");
+  encoder.set_n_threads(4);
+  std::vector<char> encoded(encoder.max_encoded_size(len*sizeof(value_type)));
+
+  auto res = encoder.encode(incrementing_cube.data(),
+                            encoded.data(),
+                            shape);
+  BOOST_REQUIRE_NE(res,(char*)nullptr);
+  const std::size_t encoded_size = std::distance(encoded.data(),res);
+
+  for(int nthreads : {1,2,4,8}){
+
+    sqeazy::lz4_scheme<value_type> decoder("n_chunks_of_input=17");
+    decoder.set_n_threads(nthreads);
+
+    to_play_with.clear();
+    to_play_with.resize(len,0);
+
+    auto rcode = decoder.decode(encoded.data(),
+                                to_play_with.data(),
+                                encoded_size,
+                                len);
+
+    BOOST_REQUIRE_EQUAL(rcode,0);
+    BOOST_REQUIRE_MESSAGE(std::equal(incrementing_cube.begin(), incrementing_cube.end(), to_play_with.begin()),
+                          "parallel decode with " << nthreads << " threads differs from input");
+  }
+}
+
+BOOST_AUTO_TEST_CASE( serial_payload_has_no_index )
+{
+  std::vector<std::size_t> shape(dims.begin(), dims.end());
+
+  sqeazy::lz4_scheme<value_type> local("n_chunks_of_input=4");
+  std::vector<char> encoded(local.max_encoded_size(size_in_byte));
+
+  auto res = local.encode(&incrementing_cube[0],
+                          encoded.data(),
+                          shape);
+  BOOST_REQUIRE_NE(res,(char*)nullptr);
+
+  sqeazy::lz4::frame_index index;
+  auto frames_begin = index.read((const char*)encoded.data(),(const char*)res);
+
+  BOOST_CHECK(index.empty());
+  BOOST_CHECK_EQUAL(frames_begin,(const char*)encoded.data());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
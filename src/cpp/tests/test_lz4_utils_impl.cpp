@@ -241,3 +241,32 @@ BOOST_AUTO_TEST_CASE( four_blocks )
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( frame_index )
+
+BOOST_AUTO_TEST_CASE( write_read_roundtrip )
+{
+
+  sqeazy::lz4::frame_index index;
+  index.offsets = {0, 42, 1 << 20, std::uint64_t(1) << 33};
+  index.decoded_bytes = {256 << 10, 256 << 10, 256 << 10, 17};
+
+  std::vector<char> buffer(index.size_in_bytes() + 8,0);
+  auto end = index.write(buffer.data());
+  BOOST_REQUIRE_EQUAL(std::distance(buffer.data(),end),index.size_in_bytes());
+
+  sqeazy::lz4::frame_index loaded;
+  auto frames_begin = loaded.read((const char*)buffer.data(),(const char*)buffer.data()+buffer.size());
+
+  BOOST_CHECK_EQUAL(frames_begin,(const char*)end);
+  BOOST_CHECK_EQUAL_COLLECTIONS(index.offsets.begin(), index.offsets.end(),
+                                loaded.offsets.begin(), loaded.offsets.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(index.decoded_bytes.begin(), index.decoded_bytes.end(),
+                                loaded.decoded_bytes.begin(), loaded.decoded_bytes.end());
+
+  //truncated input yields no index
+  loaded.read((const char*)buffer.data(),(const char*)buffer.data()+index.size_in_bytes()-1);
+  BOOST_CHECK(loaded.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,12 +2,17 @@
 #define BOOST_TEST_MAIN
 
 #include "boost/test/included/unit_test.hpp"
+#include <algorithm>
 #include <numeric>
 #include <vector>
 #include <iostream>
 #include <string>
 #include <array>
 
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
 #include "boost/filesystem.hpp"
 #include "array_fixtures.hpp"
 
@@ -59,6 +64,20 @@ BOOST_AUTO_TEST_CASE( this_doesnt_validate_uint8 ){
   BOOST_CHECK_EQUAL(answer, false);
 
 }
+
+BOOST_AUTO_TEST_CASE( simd_path ){
+
+  long length = 0;
+  BOOST_CHECK_EQUAL(SQY_SIMD_Path(nullptr, &length), 1);
+  BOOST_REQUIRE_GT(length, 0);
+
+  std::string name(length + 1, 'x');
+  length = name.size();
+  BOOST_CHECK_EQUAL(SQY_SIMD_Path(&name[0], &length), 0);
+  BOOST_CHECK_EQUAL(std::string(name.c_str()).size(), std::size_t(length));
+
+  BOOST_CHECK_EQUAL(SQY_SIMD_Path(&name[0], nullptr), 2);
+}
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_FIXTURE_TEST_SUITE( pipeline_interface, uint8_cube_of_8 )
@@ -416,6 +435,265 @@ BOOST_AUTO_TEST_CASE( roundtrip ){
 }
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_FIXTURE_TEST_SUITE( pipeline_handles, uint16_cube_of_8 )
+
+BOOST_AUTO_TEST_CASE( create_rejects_unknown ){
+
+  BOOST_CHECK(SQY_Pipeline_Create("", 2, 1) == nullptr);
+  BOOST_CHECK(SQY_Pipeline_Create(deprecated_filter_name.c_str(), 2, 1) == nullptr);
+  BOOST_CHECK(SQY_Pipeline_Create(default_filter_name.c_str(), 4, 1) == nullptr);
+
+  BOOST_CHECK_EQUAL(SQY_Pipeline_Encode(nullptr, nullptr, nullptr, 0, nullptr, nullptr), 1);
+  BOOST_CHECK_EQUAL(SQY_Pipeline_Destroy(nullptr), 0);
+}
+
+BOOST_AUTO_TEST_CASE( matches_stateless_calls ){
+
+  SQY_Pipeline* handle = SQY_Pipeline_Create(default_filter_name.c_str(), 2, 1);
+  BOOST_REQUIRE(handle != nullptr);
+
+  std::vector<long> ldims(dims.begin(), dims.end());
+  long max_length = 0;
+  BOOST_CHECK_EQUAL(SQY_Pipeline_MaxCompressedLength(handle, &ldims[0], dims.size(), &max_length), 0);
+
+  long expected_length = default_filter_name.size();
+  SQY_Pipeline_Max_Compressed_Length_3D_UI16(default_filter_name.c_str(),
+                                             &ldims[0],
+                                             dims.size(),
+                                             &expected_length);
+  BOOST_CHECK_EQUAL(max_length, expected_length);
+
+  std::vector<char> expected(max_length,0);
+  SQY_PipelineEncode_UI16(default_filter_name.c_str(),
+                          (const char*)&incrementing_cube[0],
+                          &ldims[0],
+                          dims.size(),
+                          &expected[0],
+                          &expected_length,1);
+
+  //repeated calls reuse the pipeline and its buffers
+  for(int nthreads : {1,2,1}){
+
+    BOOST_CHECK_EQUAL(SQY_Pipeline_SetThreads(handle, nthreads), 0);
+
+    std::vector<char> compressed(max_length,0);
+    long length = 0;
+    int rvalue = SQY_Pipeline_Encode(handle,
+                                     (const char*)&incrementing_cube[0],
+                                     &ldims[0],
+                                     dims.size(),
+                                     &compressed[0],
+                                     &length);
+    BOOST_CHECK_EQUAL(rvalue, 0);
+    BOOST_REQUIRE_EQUAL(length, expected_length);
+    BOOST_CHECK(std::equal(compressed.begin(), compressed.begin() + length, expected.begin()));
+
+    std::vector<std::uint16_t> decoded(incrementing_cube.size(),0);
+    rvalue = SQY_Pipeline_Decode(handle, &compressed[0], length, (char*)&decoded[0]);
+    BOOST_CHECK_EQUAL(rvalue, 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(),
+                                  incrementing_cube.begin(), incrementing_cube.end());
+  }
+
+  BOOST_CHECK_EQUAL(SQY_Pipeline_Destroy(handle), 0);
+}
+
+BOOST_AUTO_TEST_CASE( decodes_other_pipelines ){
+
+  SQY_Pipeline* handle = SQY_Pipeline_Create(default_filter_name.c_str(), 2, 1);
+  BOOST_REQUIRE(handle != nullptr);
+
+  std::vector<long> ldims(dims.begin(), dims.end());
+
+  for(const std::string& pipeline : {std::string("lz4"), default_filter_name, std::string("quantiser->lz4")}){
+
+    long length = pipeline.size();
+    SQY_Pipeline_Max_Compressed_Length_3D_UI16(pipeline.c_str(),
+                                               &ldims[0],
+                                               dims.size(),
+                                               &length);
+    std::vector<char> compressed(length,0);
+    BOOST_REQUIRE_EQUAL(SQY_PipelineEncode_UI16(pipeline.c_str(),
+                                                (const char*)&constant_cube[0],
+                                                &ldims[0],
+                                                dims.size(),
+                                                &compressed[0],
+                                                &length,1), 0);
+
+    std::vector<std::uint16_t> decoded(constant_cube.size(),0);
+    BOOST_CHECK_EQUAL(SQY_Pipeline_Decode(handle, &compressed[0], length, (char*)&decoded[0]), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(),
+                                  constant_cube.begin(), constant_cube.end());
+  }
+
+  SQY_Pipeline_Destroy(handle);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_other_pixel_width ){
+
+  SQY_Pipeline* handle = SQY_Pipeline_Create("lz4", 1, 1);
+  BOOST_REQUIRE(handle != nullptr);
+
+  std::vector<long> ldims(dims.begin(), dims.end());
+  long length = default_filter_name.size();
+  SQY_Pipeline_Max_Compressed_Length_3D_UI16(default_filter_name.c_str(),
+                                             &ldims[0],
+                                             dims.size(),
+                                             &length);
+  std::vector<char> compressed(length,0);
+  BOOST_REQUIRE_EQUAL(SQY_PipelineEncode_UI16(default_filter_name.c_str(),
+                                              (const char*)&constant_cube[0],
+                                              &ldims[0],
+                                              dims.size(),
+                                              &compressed[0],
+                                              &length,1), 0);
+
+  //a 16-bit stream would write twice the bytes the 8-bit handle expects
+  std::vector<std::uint8_t> decoded(constant_cube.size(),42);
+  BOOST_CHECK_EQUAL(SQY_Pipeline_Decode(handle, &compressed[0], length, (char*)&decoded[0]), 2);
+  BOOST_CHECK(std::all_of(decoded.begin(), decoded.end(), [](std::uint8_t _item){ return _item == 42; }));
+
+  //no header at all
+  std::vector<char> garbage(64,0);
+  BOOST_CHECK_NE(SQY_Pipeline_Decode(handle, &garbage[0], garbage.size(), (char*)&decoded[0]), 0);
+
+  SQY_Pipeline_Destroy(handle);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( batch_encode )
+
+BOOST_AUTO_TEST_CASE( frames_roundtrip ){
+
+  const int n_items = 7;
+  std::vector<std::vector<std::uint16_t> > frames(n_items);
+  std::vector<std::vector<long> > shapes(n_items);
+  std::vector<std::vector<char> > encoded(n_items);
+
+  std::vector<const char*> src(n_items);
+  std::vector<long*> shape_ptrs(n_items);
+  std::vector<unsigned> shape_sizes(n_items, 2);
+  std::vector<char*> dst(n_items);
+  std::vector<long> dstlengths(n_items);
+  std::vector<int> status(n_items, -1);
+
+  for(int i = 0;i<n_items;++i){
+
+    shapes[i] = {long(32 + i), long(64 + 3*i)};
+    frames[i].resize(shapes[i][0]*shapes[i][1]);
+    for(std::size_t p = 0;p<frames[i].size();++p)
+      frames[i][p] = (p*(i+1)) % 512;
+
+    long length = default_filter_name.size();
+    SQY_Pipeline_Max_Compressed_Length_3D_UI16(default_filter_name.c_str(),
+                                               shapes[i].data(),
+                                               2,
+                                               &length);
+    encoded[i].resize(length);
+
+    src[i] = reinterpret_cast<const char*>(frames[i].data());
+    shape_ptrs[i] = shapes[i].data();
+    dst[i] = encoded[i].data();
+    dstlengths[i] = length;
+  }
+
+  //item 5 cannot hold the compressed frame
+  dstlengths[5] = 16;
+
+  int rvalue = SQY_PipelineEncodeBatch_UI16(default_filter_name.c_str(),
+                                            n_items,
+                                            src.data(),
+                                            shape_ptrs.data(),
+                                            shape_sizes.data(),
+                                            dst.data(),
+                                            dstlengths.data(),
+                                            status.data(),
+                                            3);
+  BOOST_CHECK_EQUAL(rvalue, 1);
+  BOOST_CHECK_EQUAL(status[5], 1);
+
+  for(int i = 0;i<n_items;++i){
+
+    if(i == 5)
+      continue;
+
+    BOOST_CHECK_EQUAL(status[i], 0);
+
+    std::vector<char> expected(encoded[i].size(),0);
+    long expected_length = expected.size();
+    SQY_PipelineEncode_UI16(default_filter_name.c_str(),
+                            src[i],
+                            shapes[i].data(),
+                            2,
+                            expected.data(),
+                            &expected_length,1);
+    BOOST_REQUIRE_EQUAL(dstlengths[i], expected_length);
+    BOOST_CHECK(std::equal(expected.begin(), expected.begin() + expected_length, encoded[i].begin()));
+
+    std::vector<std::uint16_t> decoded(frames[i].size(),0);
+    BOOST_CHECK_EQUAL(SQY_Decode_UI16(encoded[i].data(), dstlengths[i], (char*)decoded.data(), 1), 0);
+    BOOST_CHECK(decoded == frames[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( fewer_items_than_threads ){
+
+#ifdef _OPENMP
+  const int levels_before = omp_get_max_active_levels();
+#endif
+
+  std::vector<std::uint16_t> frame(48*64);
+  for(std::size_t p = 0;p<frame.size();++p)
+    frame[p] = (p*7) % 1024;
+
+  long shape[2] = {48,64};
+  long length = default_filter_name.size();
+  SQY_Pipeline_Max_Compressed_Length_3D_UI16(default_filter_name.c_str(), shape, 2, &length);
+
+  std::vector<char> encoded(length);
+  const char* src = reinterpret_cast<const char*>(frame.data());
+  long* shape_ptr = shape;
+  unsigned shape_size = 2;
+  char* dst = encoded.data();
+  long dstlength = length;
+  int status = -1;
+
+  BOOST_CHECK_EQUAL(SQY_PipelineEncodeBatch_UI16(default_filter_name.c_str(), 1,
+                                                 &src, &shape_ptr, &shape_size, &dst, &dstlength, &status, 4), 0);
+  BOOST_CHECK_EQUAL(status, 0);
+
+#ifdef _OPENMP
+  BOOST_CHECK_EQUAL(omp_get_max_active_levels(), levels_before);
+#endif
+
+  std::vector<std::uint16_t> decoded(frame.size(),0);
+  BOOST_CHECK_EQUAL(SQY_Decode_UI16(encoded.data(), dstlength, (char*)decoded.data(), 1), 0);
+  BOOST_CHECK(decoded == frame);
+}
+
+BOOST_AUTO_TEST_CASE( unknown_pipeline ){
+
+  std::vector<std::uint8_t> frame(64,1);
+  long shape[2] = {8,8};
+  const char* src = reinterpret_cast<const char*>(frame.data());
+  long* shape_ptr = shape;
+  unsigned shape_size = 2;
+  std::vector<char> encoded(1024);
+  char* dst = encoded.data();
+  long dstlength = encoded.size();
+  int status = -1;
+
+  BOOST_CHECK_EQUAL(SQY_PipelineEncodeBatch_UI8(deprecated_filter_name.c_str(), 1,
+                                                &src, &shape_ptr, &shape_size, &dst, &dstlength, &status, 2), 1);
+  BOOST_CHECK_EQUAL(status, 2);
+
+  BOOST_CHECK_EQUAL(SQY_PipelineEncodeBatch_UI8(default_filter_name.c_str(), 0,
+                                                &src, &shape_ptr, &shape_size, &dst, &dstlength, &status, 2), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 static const std::string tricky_filter_name = "quantiser->h264";
 
 #ifdef SQY_WITH_FFMPEG
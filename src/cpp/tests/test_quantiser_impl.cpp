@@ -7,7 +7,9 @@
 #include <bitset>
 #include <map>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <fstream>
 #include <random>
 
 #include "boost/filesystem.hpp"
@@ -855,6 +857,152 @@ BOOST_AUTO_TEST_CASE( reloading_decode_lut_scheme_api ){
 }
 
 
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE( lut_reuse, sqeazy::quantise_fixture<uint16_t> )
+
+BOOST_AUTO_TEST_CASE( level_drift ){
+
+  sqeazy::quantiser<uint16_t,uint8_t> shrinker;
+  BOOST_CHECK_EQUAL(shrinker.level_drift(&realistic_[0], &realistic_[0] + realistic_.size()), 1.f);
+
+  shrinker.setup_com(&realistic_[0], &realistic_[0] + realistic_.size());
+  shrinker.compute_reference_levels();
+
+  BOOST_CHECK_SMALL(shrinker.level_drift(&realistic_[0], &realistic_[0] + realistic_.size()), 1e-4f);
+  BOOST_CHECK_GT(shrinker.level_drift(&shifted_[0], &shifted_[0] + shifted_.size()), .5f);
+}
+
+BOOST_AUTO_TEST_CASE( repeated_encode_does_not_accumulate ){
+
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> reused;
+  std::vector<uint8_t> first(realistic_.size(),0);
+  std::vector<uint8_t> second(realistic_.size(),0);
+
+  reused.encode(&shifted_[0],&first[0],shifted_.size());
+  reused.encode(&realistic_[0],&second[0],realistic_.size());
+
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> fresh;
+  fresh.encode(&realistic_[0],&first[0],realistic_.size());
+
+  BOOST_CHECK_EQUAL(reused.n_lut_builds, 2u);
+  BOOST_CHECK_EQUAL_COLLECTIONS(first.begin(), first.end(), second.begin(), second.end());
+}
+
+BOOST_AUTO_TEST_CASE( reuse_while_histogram_is_stable ){
+
+  //same histogram, different pixels
+  aligned_vector next_stack(realistic_.rbegin(), realistic_.rend());
+
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> shrinker("lut_drift=0.05");
+  std::vector<uint8_t> encoded(realistic_.size(),0);
+  std::vector<uint8_t> next_encoded(realistic_.size(),0);
+
+  shrinker.encode(&realistic_[0],&encoded[0],realistic_.size());
+  auto end_ptr = shrinker.encode(&next_stack[0],&next_encoded[0],next_stack.size());
+
+  BOOST_CHECK(end_ptr == &next_encoded[0] + next_encoded.size());
+  BOOST_CHECK_EQUAL(shrinker.n_lut_builds, 1u);
+  BOOST_CHECK(std::equal(encoded.rbegin(), encoded.rend(), next_encoded.begin()));
+
+  //the LUT travels with every stack
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> reloaded(shrinker.config());
+  std::vector<uint16_t> reconstructed(next_stack.size(),0);
+  BOOST_CHECK_EQUAL(reloaded.decode(&next_encoded[0],&reconstructed[0],next_encoded.size()),0);
+
+  double mse = sqeazy::mse(reconstructed.begin(), reconstructed.end(), next_stack.begin());
+  size_t dyn_range = sqeazy::dyn_range(next_stack.begin(), next_stack.end());
+  BOOST_CHECK_LT(mse, (dyn_range/256.f)*(dyn_range/256.f));
+
+  //a different histogram triggers a rebuild
+  shrinker.encode(&shifted_[0],&encoded[0],shifted_.size());
+  BOOST_CHECK_EQUAL(shrinker.n_lut_builds, 2u);
+}
+
+BOOST_AUTO_TEST_CASE( lut_shared_through_file ){
+
+  std::stringstream lut_file;
+  lut_file << "lut_reuse_"
+           << boost::unit_test::framework::current_test_case().p_name
+           << ".lut";
+
+  bfs::path tgt = lut_file.str();
+  if(bfs::exists(tgt))
+    bfs::remove(tgt);
+
+  const std::string config = "encode_lut_path=" + tgt.string();
+  std::vector<uint8_t> encoded(realistic_.size(),0);
+  std::vector<uint8_t> shared_encoded(realistic_.size(),0);
+
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> first_file(config);
+  first_file.encode(&realistic_[0],&encoded[0],realistic_.size());
+  BOOST_CHECK_EQUAL(first_file.n_lut_builds, 1u);
+  BOOST_REQUIRE(bfs::exists(tgt));
+
+  //a file with a different histogram is still encoded with the shared LUT
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> second_file(config);
+  second_file.encode(&shifted_wide_[0],&shared_encoded[0],shifted_wide_.size());
+  BOOST_CHECK_EQUAL(second_file.n_lut_builds, 0u);
+  BOOST_CHECK(*second_file.shrinker.get_encode_lut() == *first_file.shrinker.get_encode_lut());
+  BOOST_CHECK(*second_file.shrinker.get_decode_lut() == *first_file.shrinker.get_decode_lut());
+
+  second_file.encode(&realistic_[0],&shared_encoded[0],realistic_.size());
+  BOOST_CHECK_EQUAL_COLLECTIONS(encoded.begin(), encoded.end(), shared_encoded.begin(), shared_encoded.end());
+
+  //unless a drift limit asks for a rebuild
+  sqeazy::quantiser_scheme<uint16_t,uint8_t> third_file(config + ",lut_drift=0.1");
+  third_file.encode(&shifted_wide_[0],&shared_encoded[0],shifted_wide_.size());
+  BOOST_CHECK_EQUAL(third_file.n_lut_builds, 1u);
+
+  if(bfs::exists(tgt))
+    bfs::remove(tgt);
+}
+
+BOOST_AUTO_TEST_CASE( lut_file_is_replaced_and_checked ){
+
+  bfs::path tgt = "lut_reuse_lut_file_is_replaced_and_checked.lut";
+
+  sqeazy::quantiser<uint16_t,uint8_t> shrinker;
+  shrinker.setup_com(&realistic_[0], &realistic_[0] + realistic_.size());
+  shrinker.compute_reference_levels();
+
+  BOOST_REQUIRE_EQUAL(shrinker.lut_state_to_file(tgt.string()), 0);
+  BOOST_REQUIRE_EQUAL(shrinker.lut_state_to_file(tgt.string()), 0);
+
+  //the LUT is written next to the target and moved over it, nothing else is left behind
+  std::size_t n_files = 0;
+  for(bfs::directory_iterator itr(bfs::current_path());itr!=bfs::directory_iterator();++itr)
+    if(itr->path().filename().string().find(tgt.filename().string()) == 0)
+      ++n_files;
+  BOOST_CHECK_EQUAL(n_files, 1u);
+
+  sqeazy::quantiser<uint16_t,uint8_t> loaded;
+  BOOST_CHECK_EQUAL(loaded.lut_state_from_file(tgt.string()), 0);
+  BOOST_CHECK(*loaded.get_encode_lut() == *shrinker.get_encode_lut());
+
+  //a run table that does not start at raw value 0 is rejected
+  std::string content;
+  {
+    std::ifstream in(tgt.string());
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  const std::string runs_tag = "encode_runs ";
+  std::size_t first_run = content.find('\n', content.find(runs_tag)) + 1;
+  BOOST_REQUIRE_EQUAL(content.substr(first_run, 2), "0 ");
+  content.replace(first_run, 1, "1");
+  {
+    std::ofstream out(tgt.string(), std::ios::trunc);
+    out << content;
+  }
+
+  sqeazy::quantiser<uint16_t,uint8_t> rejected;
+  BOOST_CHECK_EQUAL(rejected.lut_state_from_file(tgt.string()), 1);
+
+  if(bfs::exists(tgt))
+    bfs::remove(tgt);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE( ramps)
@@ -1595,3 +1743,223 @@ BOOST_AUTO_TEST_CASE( offset_power_capped_ramp_compare_weights ){
 
 }
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( lut_kernels )
+
+BOOST_AUTO_TEST_CASE( encode_matches_scalar ){
+
+  std::mt19937 gen(1307);
+  std::uniform_int_distribution<int> dist(0,(1 << 16) - 1);
+
+  std::vector<std::uint8_t> lut(1 << 16);
+  for(std::uint8_t& item : lut)
+    item = dist(gen) & 0xff;
+
+  //odd length to hit the scalar tail, the largest raw values to hit the end of the table
+  std::vector<std::uint16_t> input(4099);
+  for(std::uint16_t& item : input)
+    item = dist(gen);
+  std::fill(input.end() - 40, input.end(), std::uint16_t(0xffff));
+  input[7] = 0xfffe;
+  input[8] = 0xfffd;
+  input[9] = 0xfffc;
+
+  std::vector<std::uint8_t> expected(input.size(),0);
+  sqeazy::detail::scalar_apply_lut(input.data(), input.size(), expected.data(), lut.data());
+
+  for(int nthreads : {1,3}){
+    std::vector<std::uint8_t> received(input.size(),0);
+    sqeazy::detail::apply_lut(input.data(), input.size(), received.data(), lut, nthreads);
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(), expected.begin(), expected.end());
+  }
+
+  const std::string kernel = sqeazy::detail::apply_lut_kernel_name<std::uint16_t, std::uint8_t>();
+  BOOST_TEST_MESSAGE("uint16 -> uint8 kernel: " + kernel);
+}
+
+BOOST_AUTO_TEST_CASE( decode_matches_scalar ){
+
+  std::mt19937 gen(1307);
+  std::uniform_int_distribution<int> dist(0,(1 << 16) - 1);
+
+  std::vector<std::uint16_t> lut(256);
+  for(std::uint16_t& item : lut)
+    item = dist(gen);
+
+  std::vector<std::uint8_t> input(4131);
+  for(std::uint8_t& item : input)
+    item = dist(gen) & 0xff;
+  input[5] = 0xff;
+  input[6] = 0xfe;
+
+  //first blocks only use 16 levels
+  for(std::size_t i = 0;i<256;++i)
+    input[100+i] = i % 16;
+  std::fill(input.end() - 37, input.end(), std::uint8_t(0xff));
+
+  std::vector<std::uint16_t> expected(input.size(),0);
+  sqeazy::detail::scalar_apply_lut(input.data(), input.size(), expected.data(), lut.data());
+
+  for(int nthreads : {1,4}){
+    std::vector<std::uint16_t> received(input.size(),0);
+    sqeazy::detail::apply_lut(input.data(), input.size(), received.data(), lut, nthreads);
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( scheme_roundtrip_with_few_levels ){
+
+  std::vector<std::uint16_t> input(1 << 14);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = 100*(i % 11);
+
+  for(int nthreads : {1,2}){
+    sqeazy::quantiser_scheme<std::uint16_t, std::uint8_t> scheme;
+    scheme.set_n_threads(nthreads);
+
+    std::vector<std::uint8_t> encoded(input.size(),0);
+    std::vector<std::uint16_t> decoded(input.size(),0);
+
+    auto end = scheme.encode(input.data(), encoded.data(), input.size());
+    BOOST_CHECK(end == encoded.data() + encoded.size());
+    BOOST_CHECK_LT(*std::max_element(encoded.begin(), encoded.end()), 16);
+
+    BOOST_CHECK_EQUAL(scheme.decode(encoded.data(), decoded.data(), input.size()), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), input.begin(), input.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( char_scheme_roundtrip_with_many_levels ){
+
+  //the pipelines use the default output type char, levels from 128 on are negative as char
+  std::vector<std::uint16_t> input(1 << 14);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = 50*(i % 200);
+
+  BOOST_CHECK_EQUAL(std::string(sqeazy::detail::apply_lut_kernel_name<char, std::uint16_t>()),
+                    std::string(sqeazy::detail::apply_lut_kernel_name<std::uint8_t, std::uint16_t>()));
+
+  for(int nthreads : {1,2}){
+    sqeazy::quantiser_scheme<std::uint16_t> scheme;
+    scheme.set_n_threads(nthreads);
+
+    std::vector<char> encoded(input.size(),0);
+    std::vector<std::uint16_t> decoded(input.size(),0);
+
+    auto end = scheme.encode(input.data(), encoded.data(), input.size());
+    BOOST_CHECK(end == encoded.data() + encoded.size());
+
+    std::size_t max_level = 0;
+    for(char level : encoded)
+      max_level = (std::max)(max_level, std::size_t(static_cast<unsigned char>(level)));
+    BOOST_CHECK_GE(max_level, 128u);
+
+    BOOST_CHECK_EQUAL(scheme.decode(encoded.data(), decoded.data(), input.size()), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), input.begin(), input.end());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( sub_byte_levels )
+
+BOOST_AUTO_TEST_CASE( pack_unpack_roundtrip ){
+
+  std::mt19937 gen(42);
+
+  for(int n_bits = 1;n_bits<=8;++n_bits){
+
+    std::uniform_int_distribution<int> dist(0,(1 << n_bits) - 1);
+    std::vector<std::uint8_t> levels(1021);
+    for(std::uint8_t& item : levels)
+      item = dist(gen);
+
+    std::vector<std::uint8_t> packed((levels.size()*n_bits + 7)/8 + 1, 0xab);
+    auto end = sqeazy::detail::pack_levels(levels.data(), levels.size(), n_bits, packed.data());
+    BOOST_CHECK_EQUAL(std::size_t(end - packed.data()), packed.size() - 1);
+    BOOST_CHECK_EQUAL(packed.back(), 0xab);
+
+    std::vector<std::uint8_t> unpacked(levels.size(),0);
+    sqeazy::detail::unpack_levels(packed.data(), unpacked.size(), n_bits, unpacked.data());
+    BOOST_CHECK_EQUAL_COLLECTIONS(unpacked.begin(), unpacked.end(), levels.begin(), levels.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( lut_honours_level_count ){
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0,1 << 12);
+  std::vector<std::uint16_t> input(1 << 16);
+  for(std::uint16_t& item : input)
+    item = dist(gen);
+
+  for(int n_bits : {4,5,6}){
+    sqeazy::quantiser<std::uint16_t, std::uint8_t> shrinker;
+    shrinker.set_n_bits(n_bits);
+    BOOST_CHECK_EQUAL(shrinker.n_levels(), std::size_t(1) << n_bits);
+
+    shrinker.setup_com(input.data(), input.data() + input.size());
+    const auto& lut = *shrinker.get_encode_lut();
+    BOOST_CHECK_EQUAL(*std::max_element(lut.begin(), lut.end()), (1 << n_bits) - 1);
+
+    shrinker.reset();
+    shrinker.setup(input.data(), input.data() + input.size());
+    BOOST_CHECK_LT(*std::max_element(lut.begin(), lut.end()), 1 << n_bits);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( scheme_packs_output ){
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0,1 << 12);
+  std::vector<std::uint16_t> input((1 << 14) + 5);
+  for(std::uint16_t& item : input)
+    item = dist(gen);
+
+  sqeazy::quantiser_scheme<std::uint16_t, std::uint8_t> reference("n_bits=5");
+  std::vector<std::uint8_t> expected(input.size(),0);
+  reference.encode(input.data(), expected.data(), input.size());
+
+  for(int nthreads : {1,3}){
+    sqeazy::quantiser_scheme<std::uint16_t, std::uint8_t> scheme("n_bits=5");
+    scheme.set_n_threads(nthreads);
+
+    std::vector<std::uint8_t> encoded(input.size(),0);
+    auto end = scheme.encode(input.data(), encoded.data(), input.size());
+    BOOST_REQUIRE_EQUAL(std::size_t(end - encoded.data()), sizeof(std::uint64_t) + (input.size()*5 + 7)/8);
+
+    //the packed items are preceded by their number
+    std::uint64_t n_items = 0;
+    std::memcpy(&n_items, encoded.data(), sizeof(n_items));
+    BOOST_CHECK_EQUAL(n_items, input.size());
+
+    //every packed item decodes to the level the encode LUT assigned
+    std::vector<std::uint8_t> levels(input.size(),0);
+    sqeazy::detail::unpack_levels(encoded.data() + sizeof(std::uint64_t), levels.size(), 5, levels.data());
+    for(std::size_t i = 0;i<input.size();++i)
+      BOOST_REQUIRE_EQUAL(int(levels[i]), int((*scheme.shrinker.get_encode_lut())[input[i]]));
+
+    sqeazy::quantiser_scheme<std::uint16_t, std::uint8_t> decoder(scheme.config());
+    decoder.set_n_threads(nthreads);
+    std::vector<std::uint16_t> decoded(input.size(),0);
+    BOOST_CHECK_EQUAL(decoder.decode(encoded.data(), decoded.data(), end - encoded.data(), input.size()), 0);
+
+    for(std::size_t i = 0;i<input.size();++i)
+      BOOST_REQUIRE_EQUAL(decoded[i], (*scheme.shrinker.get_decode_lut())[levels[i]]);
+
+    //without the expected length, exactly the stored number of items is decoded (the padding bits of the last
+    //byte would fit another 5-bit item)
+    std::vector<std::uint16_t> decoded_without_length(input.size() + 8,0);
+    BOOST_CHECK_EQUAL(decoder.decode(encoded.data(), decoded_without_length.data(), end - encoded.data()), 0);
+    BOOST_CHECK(std::equal(decoded.begin(), decoded.end(), decoded_without_length.begin()));
+    BOOST_CHECK_EQUAL(decoded_without_length[input.size()], 0);
+
+    //a different expected length is rejected
+    BOOST_CHECK_NE(decoder.decode(encoded.data(), decoded.data(), end - encoded.data(), input.size() - 1), 0);
+
+    //too little input
+    BOOST_CHECK_NE(decoder.decode(encoded.data(), decoded.data(), 16, input.size()), 0);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -198,6 +198,159 @@ BOOST_AUTO_TEST_CASE( pack_and_reload )
 
 }
 
+/**
+   \brief writes binary headers while in scope
+*/
+struct binary_headers {
+  binary_headers(){ sqeazy::header::write_binary(true); }
+  ~binary_headers(){ sqeazy::header::write_binary(false); }
+};
+
+BOOST_AUTO_TEST_CASE( json_is_the_default )
+{
+  BOOST_REQUIRE(!sqeazy::header::writes_binary());
+
+  sqeazy::header hdr(value_type(),dims,"bitswap1->lz4",1024);
+  BOOST_CHECK(!sqeazy::header::is_binary(hdr.begin(), hdr.end()));
+  BOOST_CHECK_EQUAL(hdr.str(), sqeazy::header::pack<value_type>(dims,"bitswap1->lz4",1024));
+
+  //the setters keep the layout
+  hdr.set_compressed_size_byte<value_type>(1 << 30);
+  BOOST_CHECK(!sqeazy::header::is_binary(hdr.begin(), hdr.end()));
+  BOOST_CHECK_EQUAL(sqeazy::header(hdr.str()).compressed_size_byte(), 1 << 30);
+}
+
+BOOST_AUTO_TEST_CASE( legacy_json_is_read )
+{
+  binary_headers scope;
+  sqeazy::header binary(value_type(),dims,"bitswap1->lz4",1024);
+  std::string json = sqeazy::header::pack<value_type>(dims,"bitswap1->lz4",1024);
+
+  BOOST_REQUIRE(!sqeazy::header::is_binary(json.begin(), json.end()));
+  BOOST_CHECK(sqeazy::header::valid_header(json));
+  BOOST_CHECK(sqeazy::header::contained(json.begin(), json.end()));
+
+  sqeazy::header reloaded(json.begin(), json.end());
+  BOOST_CHECK_EQUAL(reloaded.size(), json.size());
+  BOOST_CHECK_EQUAL(reloaded.pipeline(), binary.pipeline());
+  BOOST_CHECK_EQUAL(reloaded.raw_type(), binary.raw_type());
+  BOOST_CHECK_EQUAL(reloaded.compressed_size_byte(), binary.compressed_size_byte());
+  BOOST_CHECK_EQUAL_COLLECTIONS(reloaded.shape()->begin(), reloaded.shape()->end(),
+                                binary.shape()->begin(), binary.shape()->end());
+}
+
+BOOST_AUTO_TEST_CASE( binary_layout )
+{
+  binary_headers scope;
+  sqeazy::header hdr(value_type(),dims,"bitswap1->lz4",1024);
+  std::string bytes = hdr.str();
+
+  BOOST_CHECK(sqeazy::header::is_binary(bytes.begin(), bytes.end()));
+  BOOST_CHECK(sqeazy::header::valid_header(bytes));
+  BOOST_CHECK(sqeazy::ends_with(bytes.begin(), bytes.end(), sqeazy::header::header_end_delimeter()));
+  BOOST_CHECK_LT(hdr.size(), sqeazy::header::pack<value_type>(dims,"bitswap1->lz4",1024).size());
+
+  //the header end is found from the stored size, trailing payload is ignored
+  std::string with_payload = bytes + std::string(64,'x');
+  BOOST_CHECK(sqeazy::header::header_end(with_payload.begin(), with_payload.end()) == with_payload.begin() + bytes.size());
+  BOOST_CHECK(sqeazy::header::contained(with_payload.begin(), with_payload.end()));
+
+  sqeazy::header reloaded(with_payload.begin(), with_payload.end());
+  BOOST_CHECK(reloaded == hdr);
+
+  //setters keep the size of the binary header
+  hdr.set_compressed_size_byte<value_type>(1 << 30);
+  BOOST_CHECK_EQUAL(hdr.size(), bytes.size());
+  BOOST_CHECK_EQUAL(sqeazy::header(hdr.str()).compressed_size_byte(), 1 << 30);
+}
+
+BOOST_AUTO_TEST_CASE( binary_rejects_truncation )
+{
+  binary_headers scope;
+  sqeazy::header hdr(value_type(),dims,"bitswap1->lz4",1024);
+  std::string bytes = hdr.str();
+
+  BOOST_CHECK(!sqeazy::header::valid_header(bytes.begin(), bytes.end()-1));
+  BOOST_CHECK(!sqeazy::header::contained(bytes.begin(), bytes.end()-4));
+  BOOST_CHECK_THROW(sqeazy::header::unpack(bytes.begin(), bytes.end()-4), std::runtime_error);
+  BOOST_CHECK_THROW(sqeazy::header::unpack(bytes.begin(), bytes.begin()+12), std::runtime_error);
+
+  sqeazy::header broken(bytes.begin(), bytes.end()-4);
+  BOOST_CHECK(broken.empty());
+}
+
+BOOST_AUTO_TEST_CASE( layout_per_header )
+{
+  BOOST_REQUIRE(!sqeazy::header::writes_binary());
+
+  sqeazy::header binary(value_type(),dims,"bitswap1->lz4",1024,sqeazy::header::binary);
+  BOOST_CHECK(sqeazy::header::is_binary(binary.begin(), binary.end()));
+
+  binary_headers scope;
+  sqeazy::header json(value_type(),dims,"bitswap1->lz4",1024,sqeazy::header::json);
+  BOOST_CHECK(!sqeazy::header::is_binary(json.begin(), json.end()));
+}
+
+BOOST_AUTO_TEST_CASE( view_reads_in_place )
+{
+  sqeazy::header hdr(value_type(),dims,"bitswap1->lz4",1024,sqeazy::header::binary);
+  const std::string bytes = hdr.str() + std::string(64,'x');
+
+  sqeazy::header::view in_place;
+  BOOST_REQUIRE_EQUAL(in_place.parse(bytes.data(), bytes.size()), 0);
+  BOOST_CHECK_EQUAL(in_place.size(), hdr.size());
+  BOOST_CHECK_EQUAL(in_place.compressed_size_byte(), hdr.compressed_size_byte());
+  BOOST_CHECK_EQUAL(in_place.pipeline(), "bitswap1->lz4");
+  BOOST_CHECK_EQUAL(in_place.raw_type(), hdr.raw_type());
+
+  //the strings point into the buffer
+  BOOST_CHECK(in_place.pipeline().data() > bytes.data());
+  BOOST_CHECK(in_place.pipeline().data() < bytes.data() + in_place.size());
+
+  std::vector<std::size_t> shape;
+  in_place.shape(shape);
+  BOOST_CHECK_EQUAL_COLLECTIONS(shape.begin(), shape.end(), dims.begin(), dims.end());
+
+  BOOST_CHECK_EQUAL(in_place.parse(bytes.data(), hdr.size()-4), 2);
+  BOOST_CHECK(in_place.empty());
+
+  const std::string json = sqeazy::header::pack<value_type>(dims,"bitswap1->lz4",1024);
+  BOOST_CHECK_EQUAL(in_place.parse(json.data(), json.size()), 1);
+}
+
+BOOST_AUTO_TEST_CASE( side_section_is_kept )
+{
+  sqeazy::header hdr(value_type(),dims,"bitswap1->lz4",1024,sqeazy::header::binary);
+  const std::size_t without = hdr.size();
+
+  std::string side(300,'\0');
+  for(std::size_t i = 0;i<side.size();++i)
+    side[i] = static_cast<char>(i*31);
+
+  hdr.set_side_section<value_type>(side);
+  BOOST_CHECK_GT(hdr.size(), without + side.size());
+  BOOST_CHECK_EQUAL(hdr.size() % sizeof(value_type), 0u);
+
+  //the setters keep it
+  hdr.set_pipeline<value_type>("lz4");
+  hdr.set_compressed_size_byte<value_type>(42);
+
+  sqeazy::header::view in_place;
+  BOOST_REQUIRE_EQUAL(in_place.parse(hdr.str().data(), hdr.size()), 0);
+  BOOST_CHECK_EQUAL(in_place.pipeline(), "lz4");
+  BOOST_CHECK_EQUAL(in_place.compressed_size_byte(), 42);
+  BOOST_CHECK_EQUAL(in_place.side_section(), side);
+
+  const sqeazy::header unpacked = sqeazy::header::unpack(hdr.str());
+  BOOST_CHECK(unpacked == hdr);
+
+  //JSON headers have no side section
+  sqeazy::header json(value_type(),dims,"bitswap1->lz4",1024,sqeazy::header::json);
+  const std::string before = json.str();
+  json.set_side_section<value_type>(side);
+  BOOST_CHECK_EQUAL(json.str(), before);
+}
+
 BOOST_AUTO_TEST_CASE( type_name )
 {
   sqeazy::header expected(value_type(),dims,"no_pipeline",1024);
@@ -450,6 +450,40 @@ BOOST_AUTO_TEST_CASE( roundtrip_quantiser2file ){
 
 }
 
+BOOST_AUTO_TEST_CASE( roundtrip_4bit_quantiser ){
+
+  std::vector<size_t> shape = {17,64,63};
+
+  const size_t len = std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<size_t>());
+  const size_t data_bytes = len*sizeof(std::uint16_t);
+
+  //11 distinct values fit into 16 levels, so the roundtrip is exact
+  std::vector<std::uint16_t> inputdata(len,0);
+  size_t count = 0;
+  for( std::uint16_t& n : inputdata )
+    n = 100*((count++*7) % 11);
+
+  const std::vector<std::string> configs = {"quantiser(n_bits=4)", "quantiser(n_bits=4)->lz4"};
+  for(const std::string& config : configs){
+
+    auto pipe = sqeazy::dypeline<std::uint16_t>::from_string(config);
+    BOOST_REQUIRE(pipe.size() > 0);
+
+    std::vector<char> intermediate(pipe.max_encoded_size(data_bytes),0);
+    char* encoded_end = pipe.encode(inputdata.data(), intermediate.data(), shape);
+    BOOST_REQUIRE(encoded_end!=nullptr);
+
+    const size_t length = encoded_end - intermediate.data();
+    if(config.find("lz4")==std::string::npos)
+      BOOST_CHECK_LT(length, len/2 + 4096);
+
+    std::vector<std::uint16_t> outputdata(len,0);
+    BOOST_CHECK_EQUAL(pipe.decode(intermediate.data(), outputdata.data(), length), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(inputdata.begin(), inputdata.end(),
+                                  outputdata.begin(), outputdata.end());
+  }
+}
+
 #ifdef SQY_WITH_FFMPEG
 BOOST_AUTO_TEST_CASE( roundtrip_quantiser_h264 ){
 
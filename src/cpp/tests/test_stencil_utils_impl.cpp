@@ -0,0 +1,206 @@
+#define BOOST_TEST_MODULE TEST_STENCIL_UTILS
+#define BOOST_TEST_MAIN
+#include "boost/test/included/unit_test.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <random>
+
+#include "stencil_utils.hpp"
+#include "encoders/diff_scheme_impl.hpp"
+#include "encoders/flatten_to_neighborhood_scheme_impl.hpp"
+
+namespace {
+
+  template <typename T>
+  std::vector<T> random_volume(const std::vector<std::size_t>& _shape, int _max, unsigned _seed = 42){
+
+    std::mt19937 gen(_seed);
+    std::uniform_int_distribution<int> dist(0,_max);
+
+    std::vector<T> value(std::accumulate(_shape.begin(), _shape.end(), std::size_t(1), std::multiplies<std::size_t>()));
+    for(T& item : value)
+      item = dist(gen);
+
+    return value;
+  }
+
+  /**
+     \brief run the blocked engine and the pixel by pixel reference and count the pixels where they disagree
+  */
+  template <typename Neighborhood>
+  std::size_t mismatches(const std::vector<std::uint16_t>& _input,
+                         const std::vector<std::size_t>& _shape,
+                         int _nthreads,
+                         sqeazy::stencil::border_policy _border){
+
+    std::vector<std::uint64_t> expected(_input.size(), 0);
+    std::vector<std::uint64_t> received(_input.size(), 0);
+    std::vector<std::size_t> expected_n(_input.size(), 0);
+    std::vector<std::size_t> received_n(_input.size(), 0);
+
+    auto as_sum = [](std::uint16_t _value){ return std::uint64_t(_value); };
+
+    sqeazy::stencil::for_each_box_sum_in_order<Neighborhood, std::uint64_t>(_input.data(), _shape, as_sum,
+                                                                           [&](std::size_t _index, std::uint64_t _sum, std::size_t _n){
+                                                                             expected[_index] = _sum + 1;
+                                                                             expected_n[_index] = _n;
+                                                                           },
+                                                                           _border);
+
+    sqeazy::stencil::for_each_box_sum<Neighborhood, std::uint64_t>(_input.data(), _shape, as_sum,
+                                                                  [&](std::size_t _index, std::uint64_t _sum, std::size_t _n){
+                                                                    received[_index] = _sum + 1;
+                                                                    received_n[_index] = _n;
+                                                                  },
+                                                                  _nthreads,
+                                                                  _border);
+
+    std::size_t value = 0;
+    for(std::size_t i = 0;i<_input.size();++i)
+      value += (expected[i] != received[i]) || (expected_n[i] != received_n[i]);
+
+    return value;
+  }
+
+}
+
+BOOST_AUTO_TEST_SUITE( box_sums )
+
+BOOST_AUTO_TEST_CASE( region_of_cube_neighborhood ){
+
+  const std::vector<std::size_t> shape = {7,11,13};
+  sqeazy::stencil::region<sqeazy::cube_neighborhood<5> > geometry(shape);
+
+  BOOST_CHECK_EQUAL(geometry.first[sqeazy::row_major::z], 2u);
+  BOOST_CHECK_EQUAL(geometry.last[sqeazy::row_major::z], 5u);
+  BOOST_CHECK_EQUAL(geometry.first[sqeazy::row_major::x], 2u);
+  BOOST_CHECK_EQUAL(geometry.last[sqeazy::row_major::x], 11u);
+  BOOST_CHECK_EQUAL(geometry.clipped_window_size(sqeazy::row_major::x, 0), 3u);
+  BOOST_CHECK_EQUAL(geometry.clipped_window_size(sqeazy::row_major::x, 6), 5u);
+
+  sqeazy::stencil::region<sqeazy::last_pixels_on_line_neighborhood<> > line(shape);
+  BOOST_CHECK_EQUAL(line.shape[sqeazy::row_major::x], 7u*11u*13u);
+  BOOST_CHECK_EQUAL(line.first[sqeazy::row_major::x], 8u);
+}
+
+BOOST_AUTO_TEST_CASE( matches_reference_on_odd_shape ){
+
+  const std::vector<std::size_t> shape = {9,17,23};
+  const auto input = random_volume<std::uint16_t>(shape, 1 << 12);
+
+  for(int nthreads : {1,3}){
+    for(auto border : {sqeazy::stencil::skip_halo, sqeazy::stencil::clip_to_volume}){
+      BOOST_CHECK_EQUAL(mismatches<sqeazy::cube_neighborhood<5> >(input, shape, nthreads, border), 0u);
+      BOOST_CHECK_EQUAL(mismatches<sqeazy::cube_neighborhood<4> >(input, shape, nthreads, border), 0u);
+      BOOST_CHECK_EQUAL(mismatches<sqeazy::last_plane_neighborhood<3> >(input, shape, nthreads, border), 0u);
+      BOOST_CHECK_EQUAL(mismatches<sqeazy::last_pixels_in_cube_neighborhood<3> >(input, shape, nthreads, border), 0u);
+      BOOST_CHECK_EQUAL(mismatches<sqeazy::last_pixels_on_line_neighborhood<> >(input, shape, nthreads, border), 0u);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( matches_reference_across_blocks ){
+
+  //rows wider than a block and more rows than fit into the L2 budget
+  const std::vector<std::size_t> shape = {4,40,sqeazy::stencil::max_block_width + 97};
+  const auto input = random_volume<std::uint16_t>(shape, 1 << 15);
+
+  for(int nthreads : {1,4}){
+    BOOST_CHECK_EQUAL(mismatches<sqeazy::cube_neighborhood<3> >(input, shape, nthreads, sqeazy::stencil::skip_halo), 0u);
+    BOOST_CHECK_EQUAL(mismatches<sqeazy::cube_neighborhood<3> >(input, shape, nthreads, sqeazy::stencil::clip_to_volume), 0u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( lower_dimensional_shapes ){
+
+  const std::vector<std::size_t> shape = {31,19};
+  const auto input = random_volume<std::uint16_t>(shape, 255);
+
+  BOOST_CHECK_EQUAL(mismatches<sqeazy::cube_neighborhood<3> >(input, shape, 2, sqeazy::stencil::clip_to_volume), 0u);
+
+  std::size_t visited = 0;
+  sqeazy::stencil::for_each_box_sum<sqeazy::cube_neighborhood<3>, std::uint32_t>(input.data(), shape,
+                                                                                [](std::uint16_t _v){ return std::uint32_t(_v); },
+                                                                                [&](std::size_t, std::uint32_t, std::size_t){ ++visited; });
+  //no plane has its full z neighborhood
+  BOOST_CHECK_EQUAL(visited, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( ported_schemes )
+
+BOOST_AUTO_TEST_CASE( diff_roundtrip_non_cubic ){
+
+  const std::vector<std::size_t> shape = {6,21,35};
+  const auto input = random_volume<std::uint16_t>(shape, (1 << 16) - 1);
+
+  for(int nthreads : {1,3}){
+    sqeazy::diff_scheme<std::uint16_t> diff;
+    diff.set_n_threads(nthreads);
+
+    std::vector<std::uint16_t> encoded(input.size(), 0);
+    std::vector<std::uint16_t> decoded(input.size(), 0);
+
+    auto end = diff.encode(input.data(), encoded.data(), shape);
+    BOOST_CHECK(end == encoded.data() + encoded.size());
+
+    //pixel (1,1,1) stores its difference to the mean of the 3x3 pixels in the plane before
+    const std::size_t frame = shape[1]*shape[2];
+    std::uint32_t sum = 0;
+    for(std::size_t y = 0;y<3;++y)
+      for(std::size_t x = 0;x<3;++x)
+        sum += input[y*shape[2] + x];
+    const std::size_t pixel = frame + shape[2] + 1;
+    BOOST_CHECK_EQUAL(std::int16_t(encoded[pixel]), std::int16_t(input[pixel] - sum/9));
+
+    BOOST_CHECK_EQUAL(diff.decode(encoded.data(), decoded.data(), shape), 0);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), input.begin(), input.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( diff_roundtrip_uint8_in_order ){
+
+  const std::vector<std::size_t> shape = {5,8,9};
+  const auto input = random_volume<std::uint8_t>(shape, 255);
+
+  sqeazy::diff_scheme<std::uint8_t, sqeazy::last_pixels_on_line_neighborhood<> > diff;
+  std::vector<std::uint8_t> encoded(input.size(), 0);
+  std::vector<std::uint8_t> decoded(input.size(), 0);
+
+  diff.encode(input.data(), encoded.data(), shape);
+  BOOST_CHECK_EQUAL(diff.decode(encoded.data(), decoded.data(), shape), 0);
+  BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), input.begin(), input.end());
+}
+
+BOOST_AUTO_TEST_CASE( flatten_matches_definition ){
+
+  const std::vector<std::size_t> shape = {7,12,15};
+  auto input = random_volume<std::uint16_t>(shape, 20);
+  const std::uint16_t threshold = 12;
+  const float fraction = .5f;
+
+  std::vector<std::uint16_t> expected(input);
+  sqeazy::stencil::for_each_box_sum_in_order<sqeazy::cube_neighborhood<5>, std::uint32_t>(input.data(), shape,
+                                                                                         [=](std::uint16_t _v){ return std::uint32_t(_v < threshold); },
+                                                                                         [&](std::size_t _index, std::uint32_t _below, std::size_t _n){
+                                                                                           if(input[_index] >= threshold && _below > fraction*(_n-1))
+                                                                                             expected[_index] = 0;
+                                                                                         },
+                                                                                         sqeazy::stencil::clip_to_volume);
+
+  BOOST_REQUIRE(expected != input);
+
+  for(int nthreads : {1,2}){
+    sqeazy::flatten_to_neighborhood_scheme<std::uint16_t> flatten(threshold, fraction);
+    flatten.set_n_threads(nthreads);
+
+    std::vector<std::uint16_t> received(input.size(), 1);
+    flatten.encode(input.data(), received.data(), shape);
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(), expected.begin(), expected.end());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include <bitset>
 #include <map>
 #include <string>
+#include <random>
 
 #include "array_fixtures.hpp"
 
@@ -527,7 +528,7 @@ BOOST_AUTO_TEST_CASE( simple )
                shape);
 
   BOOST_REQUIRE(rem == (to_play_with.data()+to_play_with.size()));
-  BOOST_CHECK_NE(scheme.serialized_reorder_map.empty(), true);
+  BOOST_CHECK_NE(scheme.stored_map.packed.empty(), true);
 
 }
 
@@ -589,4 +590,153 @@ BOOST_AUTO_TEST_CASE( scheme_rt_with_alien_config )
 }
 
 
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( duplicate_metrics )
+
+BOOST_AUTO_TEST_CASE( full_tiles_roundtrip )
+{
+  //512 tiles that only carry 3 distinct intensities
+  const std::vector<std::size_t> shape = {32,32,32};
+  std::vector<std::uint16_t> input(32*32*32,0);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = ((i % 32)/4 + (i/(32*32*4))) % 3;
+
+  for(int nthreads : {1,4}){
+    sqyd::tile_shuffle in_tiles_of(4);
+    std::vector<std::uint16_t> encoded(input.size(),0);
+    std::vector<std::uint16_t> decoded(input.size(),0);
+
+    auto rem = in_tiles_of.encode(input.cbegin(), input.cend(), encoded.begin(), shape, nthreads);
+    BOOST_REQUIRE(rem == encoded.end());
+
+    //every tile is written exactly once, equal tiles keep their order
+    std::vector<std::size_t> sorted_map = in_tiles_of.decode_map;
+    std::sort(sorted_map.begin(), sorted_map.end());
+    for(std::size_t i = 0;i<sorted_map.size();++i)
+      BOOST_REQUIRE_EQUAL(sorted_map[i],i);
+
+    BOOST_CHECK(std::is_sorted(encoded.begin(), encoded.end()));
+
+    in_tiles_of.decode(encoded.cbegin(), encoded.cend(), decoded.begin(), shape, nthreads);
+    BOOST_CHECK(decoded == input);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( remainder_tiles_roundtrip )
+{
+  const std::vector<std::size_t> shape = {30,30,30};
+  std::vector<std::uint16_t> input(30*30*30,0);
+  for(std::size_t i = 0;i<input.size();++i)
+    input[i] = ((i % 30)/4 + (i/(30*30*4))) % 3;
+
+  for(int nthreads : {1,4}){
+    sqyd::tile_shuffle in_tiles_of(4);
+    std::vector<std::uint16_t> encoded(input.size(),0);
+    std::vector<std::uint16_t> decoded(input.size(),0);
+
+    auto rem = in_tiles_of.encode(input.cbegin(), input.cend(), encoded.begin(), shape, nthreads);
+    BOOST_REQUIRE(rem == encoded.end());
+
+    std::vector<std::size_t> sorted_map = in_tiles_of.decode_map;
+    std::sort(sorted_map.begin(), sorted_map.end());
+    for(std::size_t i = 0;i<sorted_map.size();++i)
+      BOOST_REQUIRE_EQUAL(sorted_map[i],i);
+
+    in_tiles_of.decode(encoded.cbegin(), encoded.cend(), decoded.begin(), shape, nthreads);
+    BOOST_CHECK(decoded == input);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( reorder_map_format )
+
+BOOST_AUTO_TEST_CASE( roundtrip )
+{
+  std::mt19937 gen(42);
+
+  std::vector<std::vector<std::size_t> > maps;
+  maps.push_back({});
+  maps.push_back({0});
+
+  std::vector<std::size_t> identity(100000);
+  std::iota(identity.begin(), identity.end(), 0);
+  maps.push_back(identity);
+
+  std::vector<std::size_t> shuffled = identity;
+  std::shuffle(shuffled.begin(), shuffled.end(), gen);
+  maps.push_back(shuffled);
+
+  std::vector<std::size_t> reversed(identity.rbegin(), identity.rend());
+  maps.push_back(reversed);
+
+  for(const auto& map : maps){
+    for(bool allow_lz4 : {true, false}){
+      const std::string packed = sqy::reorder_map::pack(map.begin(), map.end(), allow_lz4);
+      std::vector<std::size_t> unpacked;
+      BOOST_REQUIRE_EQUAL(sqy::reorder_map::unpack(packed.data(), packed.data() + packed.size(), unpacked),0);
+      BOOST_REQUIRE(unpacked == map);
+    }
+
+    std::vector<std::size_t> from_config;
+    BOOST_REQUIRE_EQUAL(sqy::reorder_map::from_verbatim(sqy::reorder_map::to_verbatim(map), from_config),0);
+    BOOST_CHECK(from_config == map);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( smaller_than_plain_array )
+{
+  std::vector<std::size_t> map(1 << 16);
+  std::iota(map.begin(), map.end(), 0);
+  std::shuffle(map.begin() + 1000, map.end(), std::mt19937(7));
+
+  const std::string packed = sqy::reorder_map::to_verbatim(map);
+  const std::string plain = sqy::parsing::range_to_verbatim(map.begin(), map.end());
+
+  //random deltas need about 17 bits per item, the plain array needs 64
+  BOOST_CHECK_LT(packed.size(), plain.size()/3);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_corrupt_maps )
+{
+  std::vector<std::size_t> map(1000);
+  std::iota(map.begin(), map.end(), 0);
+  std::shuffle(map.begin(), map.end(), std::mt19937(1));
+
+  const std::string packed = sqy::reorder_map::pack(map.begin(), map.end(), false);
+  std::vector<std::size_t> unpacked;
+
+  BOOST_CHECK_EQUAL(sqy::reorder_map::unpack(packed.data(), packed.data() + packed.size()/2, unpacked),1);
+
+  //claim more items than the payload can hold
+  std::string too_long = packed;
+  too_long[6 + 3] = 1;
+  BOOST_CHECK_EQUAL(sqy::reorder_map::unpack(too_long.data(), too_long.data() + too_long.size(), unpacked),1);
+
+  //entries larger than the map
+  std::vector<std::size_t> out_of_range = {0, 5, 1};
+  const std::string bad = sqy::reorder_map::pack(out_of_range.begin(), out_of_range.end(), false);
+  BOOST_CHECK_EQUAL(sqy::reorder_map::unpack(bad.data(), bad.data() + bad.size(), unpacked),1);
+}
+
+BOOST_FIXTURE_TEST_CASE( legacy_config_is_read, uint16_cube_of_8 )
+{
+  label_stack_by_tile_reverse(incrementing_cube.begin(),dims,4);
+  auto expected = incrementing_cube;
+
+  sqyd::tile_shuffle tiles_of(4);
+  std::vector<std::size_t> shape(dims.begin(), dims.end());
+  tiles_of.encode(incrementing_cube.cbegin(), incrementing_cube.cend(), to_play_with.begin(), shape);
+
+  //maps used to be stored as plain std::size_t arrays
+  std::string config = "tile_size=4,reorder_map=";
+  config += sqy::parsing::range_to_verbatim(tiles_of.decode_map.begin(), tiles_of.decode_map.end());
+  sqy::tile_shuffle_scheme<std::uint16_t> legacy(config);
+
+  BOOST_REQUIRE_EQUAL(legacy.decode(to_play_with.data(), incrementing_cube.data(), shape), sqy::SUCCESS);
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(),
+                                incrementing_cube.begin(), incrementing_cube.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@ package sqeazy.bindings;
 import org.bridj.BridJ;
 import org.bridj.CRuntime;
 import org.bridj.Pointer;
+import org.bridj.TypedPointer;
 import org.bridj.ann.Library;
 import org.bridj.ann.Ptr;
 import org.bridj.ann.Runtime;
@@ -24,7 +25,7 @@ public class SqeazyLibrary {
 	 * length					: length in bytes of header in compressed buffer<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Header_Size(const char*, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:22</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:26</i>
 	 */
 	public static int SQY_Header_Size(Pointer<Byte > src, Pointer<org.bridj.CLong > length) {
 		return SQY_Header_Size(Pointer.getPeer(src), Pointer.getPeer(length));
@@ -38,7 +39,7 @@ public class SqeazyLibrary {
 	 * (out) scalar that tells the number of dimensions of the data described by src<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Decompressed_NDims(const char*, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:37</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:41</i>
 	 */
 	public static int SQY_Decompressed_NDims(Pointer<Byte > src, Pointer<org.bridj.CLong > num) {
 		return SQY_Decompressed_NDims(Pointer.getPeer(src), Pointer.getPeer(num));
@@ -53,7 +54,7 @@ public class SqeazyLibrary {
 	 * (out) array holding the shape of the decoded volume in units of pixel/voxel<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Decompressed_Shape(const char*, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:52</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:56</i>
 	 */
 	public static int SQY_Decompressed_Shape(Pointer<Byte > src, Pointer<org.bridj.CLong > shape) {
 		return SQY_Decompressed_Shape(Pointer.getPeer(src), Pointer.getPeer(shape));
@@ -67,7 +68,7 @@ public class SqeazyLibrary {
 	 * (out) pointer to long which returns the number of bytes per pixel<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Decompressed_Sizeof(const char*, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:66</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:70</i>
 	 */
 	public static int SQY_Decompressed_Sizeof(Pointer<Byte > src, Pointer<org.bridj.CLong > Sizeof) {
 		return SQY_Decompressed_Sizeof(Pointer.getPeer(src), Pointer.getPeer(Sizeof));
@@ -78,7 +79,7 @@ public class SqeazyLibrary {
 	 * version					: 3 element int array that holds the sqeazy version<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Version_Triple(int*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:77</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:81</i>
 	 */
 	public static int SQY_Version_Triple(Pointer<Integer > version) {
 		return SQY_Version_Triple(Pointer.getPeer(version));
@@ -102,7 +103,7 @@ public class SqeazyLibrary {
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * error 1 -  destination buffer is not large enough<br>
 	 * Original signature : <code>int SQY_PipelineEncode_UI8(const char*, const char*, long*, unsigned, char*, long*, int)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:105</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:123</i>
 	 */
 	public static int SQY_PipelineEncode_UI8(Pointer<Byte > pipeline, Pointer<Byte > src, Pointer<org.bridj.CLong > shape, int shape_size, Pointer<Byte > dst, Pointer<org.bridj.CLong > dstlength, int nthreads) {
 		return SQY_PipelineEncode_UI8(Pointer.getPeer(pipeline), Pointer.getPeer(src), Pointer.getPeer(shape), shape_size, Pointer.getPeer(dst), Pointer.getPeer(dstlength), nthreads);
@@ -126,7 +127,7 @@ public class SqeazyLibrary {
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * error 1 -  destination buffer is not large enough<br>
 	 * Original signature : <code>int SQY_PipelineEncode_UI16(const char*, const char*, long*, unsigned, char*, long*, int)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:136</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:154</i>
 	 */
 	public static int SQY_PipelineEncode_UI16(Pointer<Byte > pipeline, Pointer<Byte > src, Pointer<org.bridj.CLong > shape, int shape_size, Pointer<Byte > dst, Pointer<org.bridj.CLong > dstlength, int nthreads) {
 		return SQY_PipelineEncode_UI16(Pointer.getPeer(pipeline), Pointer.getPeer(src), Pointer.getPeer(shape), shape_size, Pointer.getPeer(dst), Pointer.getPeer(dstlength), nthreads);
@@ -140,7 +141,7 @@ public class SqeazyLibrary {
 	 * (out) maximum length of compressed buffer in bytes<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Pipeline_Max_Compressed_Length_UI8(const char*, long, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:155</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:222</i>
 	 */
 	public static int SQY_Pipeline_Max_Compressed_Length_UI8(Pointer<Byte > pipeline, @org.bridj.ann.CLong long pipeline_length, Pointer<org.bridj.CLong > length) {
 		return SQY_Pipeline_Max_Compressed_Length_UI8(Pointer.getPeer(pipeline), pipeline_length, Pointer.getPeer(length));
@@ -156,7 +157,7 @@ public class SqeazyLibrary {
 	 * (out) maximum length in bytes of compressed buffer<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Pipeline_Max_Compressed_Length_3D_UI8(const char*, long*, unsigned, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:171</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:238</i>
 	 */
 	public static int SQY_Pipeline_Max_Compressed_Length_3D_UI8(Pointer<Byte > pipeline, Pointer<org.bridj.CLong > shape, int shape_size, Pointer<org.bridj.CLong > length) {
 		return SQY_Pipeline_Max_Compressed_Length_3D_UI8(Pointer.getPeer(pipeline), Pointer.getPeer(shape), shape_size, Pointer.getPeer(length));
@@ -170,7 +171,7 @@ public class SqeazyLibrary {
 	 * (out) maximum length of compressed buffer in bytes<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Pipeline_Max_Compressed_Length_UI16(const char*, long, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:186</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:253</i>
 	 */
 	public static int SQY_Pipeline_Max_Compressed_Length_UI16(Pointer<Byte > pipeline, @org.bridj.ann.CLong long pipeline_length, Pointer<org.bridj.CLong > length) {
 		return SQY_Pipeline_Max_Compressed_Length_UI16(Pointer.getPeer(pipeline), pipeline_length, Pointer.getPeer(length));
@@ -186,7 +187,7 @@ public class SqeazyLibrary {
 	 * (out) maximum length in bytes of compressed buffer<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Pipeline_Max_Compressed_Length_3D_UI16(const char*, long*, unsigned, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:200</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:267</i>
 	 */
 	public static int SQY_Pipeline_Max_Compressed_Length_3D_UI16(Pointer<Byte > pipeline, Pointer<org.bridj.CLong > shape, int shape_size, Pointer<org.bridj.CLong > length) {
 		return SQY_Pipeline_Max_Compressed_Length_3D_UI16(Pointer.getPeer(pipeline), Pointer.getPeer(shape), shape_size, Pointer.getPeer(length));
@@ -197,7 +198,7 @@ public class SqeazyLibrary {
 	 * pipeline_string				: string that describes the pipeline ('->' delimited)<br>
 	 * Returns true if success, false if not!<br>
 	 * Original signature : <code>bool SQY_Pipeline_Possible_UI16(const char*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:215</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:282</i>
 	 */
 	public static boolean SQY_Pipeline_Possible_UI16(Pointer<Byte > pipeline_string) {
 		return SQY_Pipeline_Possible_UI16(Pointer.getPeer(pipeline_string));
@@ -208,7 +209,7 @@ public class SqeazyLibrary {
 	 * pipeline_string				: string that describes the pipeline ('->' delimited)<br>
 	 * Returns true if success, false if not!<br>
 	 * Original signature : <code>bool SQY_Pipeline_Possible_UI8(const char*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:225</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:292</i>
 	 */
 	public static boolean SQY_Pipeline_Possible_UI8(Pointer<Byte > pipeline_string) {
 		return SQY_Pipeline_Possible_UI8(Pointer.getPeer(pipeline_string));
@@ -221,7 +222,7 @@ public class SqeazyLibrary {
 	 * sizeofpixel                 : sizeof pixel type, e.g. grayscale 16-bit = 2 bytes, grayscale 8-bit = 1 byte<br>
 	 * Returns true if success, false if not!<br>
 	 * Original signature : <code>bool SQY_Pipeline_Possible(const char*, int)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:239</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:306</i>
 	 */
 	public static boolean SQY_Pipeline_Possible(Pointer<Byte > pipeline_string, int sizeofpixel) {
 		return SQY_Pipeline_Possible(Pointer.getPeer(pipeline_string), sizeofpixel);
@@ -234,7 +235,7 @@ public class SqeazyLibrary {
 	 * (out) number of bytes of decompressed buffer to be output by SQY_Decode_UI16 called on data; any sizeof of the decompressed volume is already taken into account<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Decompressed_Length(const char*, long*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:251</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:318</i>
 	 */
 	public static int SQY_Decompressed_Length(Pointer<Byte > data, Pointer<org.bridj.CLong > length) {
 		return SQY_Decompressed_Length(Pointer.getPeer(data), Pointer.getPeer(length));
@@ -253,7 +254,7 @@ public class SqeazyLibrary {
 	 * nthreads                : set the number of threads allowed for the entire pipeline.<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Decode_UI16(const char*, long, char*, int)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:270</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:337</i>
 	 */
 	public static int SQY_Decode_UI16(Pointer<Byte > src, @org.bridj.ann.CLong long srclength, Pointer<Byte > dst, int nthreads) {
 		return SQY_Decode_UI16(Pointer.getPeer(src), srclength, Pointer.getPeer(dst), nthreads);
@@ -272,12 +273,94 @@ public class SqeazyLibrary {
 	 * nthreads                : set the number of threads allowed for the entire pipeline.<br>
 	 * Returns 0 if success, another code if there was an error (error codes provided below)<br>
 	 * Original signature : <code>int SQY_Decode_UI8(const char*, long, char*, int)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:292</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:359</i>
 	 */
 	public static int SQY_Decode_UI8(Pointer<Byte > src, @org.bridj.ann.CLong long srclength, Pointer<Byte > dst, int nthreads) {
 		return SQY_Decode_UI8(Pointer.getPeer(src), srclength, Pointer.getPeer(dst), nthreads);
 	}
 	protected native static int SQY_Decode_UI8(@Ptr long src, @org.bridj.ann.CLong long srclength, @Ptr long dst, int nthreads);
+	/**
+	 * SQY_Pipeline_Create - build a pipeline once for repeated encode/decode calls<br>
+	 * pipeline				: pipeline name (null-terminated, '->' delimited)<br>
+	 * sizeofpixel				: sizeof pixel type, grayscale 16-bit = 2 bytes, grayscale 8-bit = 1 byte<br>
+	 * nthreads                : number of threads allowed for the entire pipeline<br>
+	 * Returns a handle to be released with SQY_Pipeline_Destroy, null if the pipeline cannot be built<br>
+	 * Original signature : <code>SQY_Pipeline* SQY_Pipeline_Create(const char*, int, int)</code><br>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:383</i>
+	 */
+	public static SqeazyLibrary.SQY_Pipeline SQY_Pipeline_Create(Pointer<Byte > pipeline, int sizeofpixel, int nthreads) {
+		final long peer = SQY_Pipeline_Create(Pointer.getPeer(pipeline), sizeofpixel, nthreads);
+		return peer == 0 ? null : new SqeazyLibrary.SQY_Pipeline(peer);
+	}
+	@Ptr 
+	protected native static long SQY_Pipeline_Create(@Ptr long pipeline, int sizeofpixel, int nthreads);
+	/**
+	 * SQY_Pipeline_Encode - Compress using the pipeline of handle, see SQY_PipelineEncode_UI16 for the arguments<br>
+	 * handle					: pipeline handle obtained from SQY_Pipeline_Create<br>
+	 * src 					: contiguous array of voxels of the sizeofpixel given to SQY_Pipeline_Create<br>
+	 * shape     				: shape of the nD construct given as src (in units of pixels)<br>
+	 * shape_size     				: number of items in shape<br>
+	 * dst 					: Pipeline compressed buffer (already allocated, see SQY_Pipeline_MaxCompressedLength)<br>
+	 * dstlength 				: out: effective compressed buffer length in bytes<br>
+	 * Returns 0 if success, 1 if there was an error<br>
+	 * Original signature : <code>int SQY_Pipeline_Encode(SQY_Pipeline*, const char*, long*, unsigned, char*, long*)</code><br>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:400</i>
+	 */
+	public static int SQY_Pipeline_Encode(SqeazyLibrary.SQY_Pipeline handle, Pointer<Byte > src, Pointer<org.bridj.CLong > shape, int shape_size, Pointer<Byte > dst, Pointer<org.bridj.CLong > dstlength) {
+		return SQY_Pipeline_Encode(Pointer.getPeer(handle), Pointer.getPeer(src), Pointer.getPeer(shape), shape_size, Pointer.getPeer(dst), Pointer.getPeer(dstlength));
+	}
+	protected native static int SQY_Pipeline_Encode(@Ptr long handle, @Ptr long src, @Ptr long shape, int shape_size, @Ptr long dst, @Ptr long dstlength);
+	/**
+	 * SQY_Pipeline_Decode - Decompress a buffer as output by SQY_Pipeline_Encode or SQY_PipelineEncode_*<br>
+	 * The pipeline described in the header of src is used, the stages are only rebuilt if it differs<br>
+	 * from the one of the previous call with handle.<br>
+	 * handle					: pipeline handle obtained from SQY_Pipeline_Create<br>
+	 * src 					: Pipeline compressed buffer (externally allocated)<br>
+	 * srclength 				: length in bytes of compressed buffer<br>
+	 * dst 					: contiguous array of voxels of the sizeofpixel given to SQY_Pipeline_Create<br>
+	 * (externally allocated, length from SQY_Decompressed_Length)<br>
+	 * Returns 0 if success, another code if there was an error<br>
+	 * Original signature : <code>int SQY_Pipeline_Decode(SQY_Pipeline*, const char*, long, char*)</code><br>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:423</i>
+	 */
+	public static int SQY_Pipeline_Decode(SqeazyLibrary.SQY_Pipeline handle, Pointer<Byte > src, @org.bridj.ann.CLong long srclength, Pointer<Byte > dst) {
+		return SQY_Pipeline_Decode(Pointer.getPeer(handle), Pointer.getPeer(src), srclength, Pointer.getPeer(dst));
+	}
+	protected native static int SQY_Pipeline_Decode(@Ptr long handle, @Ptr long src, @org.bridj.ann.CLong long srclength, @Ptr long dst);
+	/**
+	 * SQY_Pipeline_MaxCompressedLength - maximum size of the output buffer of SQY_Pipeline_Encode<br>
+	 * handle					: pipeline handle obtained from SQY_Pipeline_Create<br>
+	 * shape					: (in) shape of the incoming nD dataset<br>
+	 * shape_size				: (in) number of items in shape<br>
+	 * length 					: (out) maximum length in bytes of compressed buffer<br>
+	 * Returns 0 if success, another code if there was an error<br>
+	 * Original signature : <code>int SQY_Pipeline_MaxCompressedLength(SQY_Pipeline*, long*, unsigned, long*)</code><br>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:438</i>
+	 */
+	public static int SQY_Pipeline_MaxCompressedLength(SqeazyLibrary.SQY_Pipeline handle, Pointer<org.bridj.CLong > shape, int shape_size, Pointer<org.bridj.CLong > length) {
+		return SQY_Pipeline_MaxCompressedLength(Pointer.getPeer(handle), Pointer.getPeer(shape), shape_size, Pointer.getPeer(length));
+	}
+	protected native static int SQY_Pipeline_MaxCompressedLength(@Ptr long handle, @Ptr long shape, int shape_size, @Ptr long length);
+	/**
+	 * SQY_Pipeline_SetThreads - change the number of threads the pipeline of handle may use<br>
+	 * Returns 0 if success, 1 if handle is null<br>
+	 * Original signature : <code>int SQY_Pipeline_SetThreads(SQY_Pipeline*, int)</code><br>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:448</i>
+	 */
+	public static int SQY_Pipeline_SetThreads(SqeazyLibrary.SQY_Pipeline handle, int nthreads) {
+		return SQY_Pipeline_SetThreads(Pointer.getPeer(handle), nthreads);
+	}
+	protected native static int SQY_Pipeline_SetThreads(@Ptr long handle, int nthreads);
+	/**
+	 * SQY_Pipeline_Destroy - release handle and all buffers it holds, handle must not be used afterwards<br>
+	 * Returns 0 (destroying a null handle is a no-op)<br>
+	 * Original signature : <code>int SQY_Pipeline_Destroy(SQY_Pipeline*)</code><br>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:456</i>
+	 */
+	public static int SQY_Pipeline_Destroy(SqeazyLibrary.SQY_Pipeline handle) {
+		return SQY_Pipeline_Destroy(Pointer.getPeer(handle));
+	}
+	protected native static int SQY_Pipeline_Destroy(@Ptr long handle);
 	/**
 	 * SQY_h5_query_sizeof - query the size of the datatype stored in an hdf5 file (in byte)<br>
 	 * fname 					: hdf5 file to store data in<br>
@@ -286,7 +369,7 @@ public class SqeazyLibrary {
 	 * (filled with 0 if dataset is not found)<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_query_sizeof(const char*, const char*, unsigned*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:325</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:486</i>
 	 */
 	public static int SQY_h5_query_sizeof(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Integer > _sizeof) {
 		return SQY_h5_query_sizeof(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(_sizeof));
@@ -302,7 +385,7 @@ public class SqeazyLibrary {
 	 * dtype = 2			: unsigned integer<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_query_dtype(const char*, const char*, unsigned*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:342</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:503</i>
 	 */
 	public static int SQY_h5_query_dtype(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Integer > dtype) {
 		return SQY_h5_query_dtype(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(dtype));
@@ -315,7 +398,7 @@ public class SqeazyLibrary {
 	 * dtype					: rank of the stored data<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_query_ndims(const char*, const char*, unsigned*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:356</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:517</i>
 	 */
 	public static int SQY_h5_query_ndims(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Integer > rank) {
 		return SQY_h5_query_ndims(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(rank));
@@ -328,7 +411,7 @@ public class SqeazyLibrary {
 	 * shape					: shape of the stored data (in row-wise ordering a la C), externally allocated<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_query_shape(const char*, const char*, unsigned*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:370</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:531</i>
 	 */
 	public static int SQY_h5_query_shape(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Integer > shape) {
 		return SQY_h5_query_shape(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(shape));
@@ -342,12 +425,44 @@ public class SqeazyLibrary {
 	 * TODO: add multi-threading support for the pipeline only<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_read_UI16(const char*, const char*, unsigned short*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:385</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:546</i>
 	 */
 	public static int SQY_h5_read_UI16(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Short > data) {
 		return SQY_h5_read_UI16(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(data));
 	}
 	protected native static int SQY_h5_read_UI16(@Ptr long fname, @Ptr long dname, @Ptr long data);
+	/**
+	 * SQY_h5_read_parallel_UI16 - load contents of hdf5 file into data, if the dataset is compressed by sqeazy<br>
+	 * only, the compressed chunks are fetched from the file and decoded by nthreads threads concurrently<br>
+	 * fname 					: hdf5 file to load data from<br>
+	 * dname 					: dataset name inside hdf5 file<br>
+	 * data					: data buffer (externally allocated)<br>
+	 * nthreads				: number of threads decoding chunks<br>
+	 * Returns 0 if success, another code if there was an error<br>
+	 * Original signature : <code>int SQY_h5_read_parallel_UI16(const char*, const char*, unsigned short*, int)</code><br>
+	 */
+	public static int SQY_h5_read_parallel_UI16(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Short > data, int nthreads) {
+		return SQY_h5_read_parallel_UI16(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(data), nthreads);
+	}
+	protected native static int SQY_h5_read_parallel_UI16(@Ptr long fname, @Ptr long dname, @Ptr long data, int nthreads);
+	/**
+	 * SQY_h5_read_region_UI16 - load the box [lo,hi) of a dataset in an hdf5 file into data, if the dataset<br>
+	 * is compressed by sqeazy only, just the chunks intersecting the box are fetched and decoded by nthreads<br>
+	 * threads concurrently<br>
+	 * fname 					: hdf5 file to load data from<br>
+	 * dname 					: dataset name inside hdf5 file<br>
+	 * shape_size				: number of dimensions of the dataset<br>
+	 * lo					: first index of the box in every dimension (shape_size items)<br>
+	 * hi					: one past the last index of the box in every dimension (shape_size items)<br>
+	 * data					: data buffer of shape hi - lo (externally allocated)<br>
+	 * nthreads				: number of threads decoding chunks<br>
+	 * Returns 0 if success, another code if there was an error (e.g. the box exceeds the dataset)<br>
+	 * Original signature : <code>int SQY_h5_read_region_UI16(const char*, const char*, unsigned, const unsigned*, const unsigned*, unsigned short*, int)</code><br>
+	 */
+	public static int SQY_h5_read_region_UI16(Pointer<Byte > fname, Pointer<Byte > dname, int shape_size, Pointer<Integer > lo, Pointer<Integer > hi, Pointer<Short > data, int nthreads) {
+		return SQY_h5_read_region_UI16(Pointer.getPeer(fname), Pointer.getPeer(dname), shape_size, Pointer.getPeer(lo), Pointer.getPeer(hi), Pointer.getPeer(data), nthreads);
+	}
+	protected native static int SQY_h5_read_region_UI16(@Ptr long fname, @Ptr long dname, int shape_size, @Ptr long lo, @Ptr long hi, @Ptr long data, int nthreads);
 	/**
 	 * SQY_h5_write_UI16 - store unsigned 16-bit int buffer in hdf5 file (no compression is applied).<br>
 	 * fname 					: hdf5 file to store data in<br>
@@ -359,7 +474,7 @@ public class SqeazyLibrary {
 	 * TODO: add multi-threading support for the pipeline only<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_write_UI16(const char*, const char*, const unsigned short*, unsigned, const unsigned*, const char*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:403</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:605</i>
 	 */
 	public static int SQY_h5_write_UI16(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Short > data, int shape_size, Pointer<Integer > shape, Pointer<Byte > filter) {
 		return SQY_h5_write_UI16(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(data), shape_size, Pointer.getPeer(shape), Pointer.getPeer(filter));
@@ -374,7 +489,7 @@ public class SqeazyLibrary {
 	 * TODO: add multi-threading support for the pipeline only<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_write(const char*, const char*, const char*, unsigned long)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:423</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:652</i>
 	 */
 	public static int SQY_h5_write(Pointer<Byte > fname, Pointer<Byte > dname, Pointer<Byte > data, @org.bridj.ann.CLong long data_size) {
 		return SQY_h5_write(Pointer.getPeer(fname), Pointer.getPeer(dname), Pointer.getPeer(data), data_size);
@@ -390,10 +505,19 @@ public class SqeazyLibrary {
 	 * pDestDatasetName			: name of dataset inside pDestFileName<br>
 	 * Returns 0 if success, another code if there was an error<br>
 	 * Original signature : <code>int SQY_h5_link(const char*, const char*, const char*, const char*, const char*, const char*)</code><br>
-	 * <i>native declaration : src/cpp/inc/sqeazy.h:442</i>
+	 * <i>native declaration : src/cpp/inc/sqeazy.h:671</i>
 	 */
 	public static int SQY_h5_link(Pointer<Byte > pSrcFileName, Pointer<Byte > pSrcLinkPath, Pointer<Byte > pSrcLinkName, Pointer<Byte > pTargetFile, Pointer<Byte > pTargetDatasetPath, Pointer<Byte > pTargetDatasetName) {
 		return SQY_h5_link(Pointer.getPeer(pSrcFileName), Pointer.getPeer(pSrcLinkPath), Pointer.getPeer(pSrcLinkName), Pointer.getPeer(pTargetFile), Pointer.getPeer(pTargetDatasetPath), Pointer.getPeer(pTargetDatasetName));
 	}
 	protected native static int SQY_h5_link(@Ptr long pSrcFileName, @Ptr long pSrcLinkPath, @Ptr long pSrcLinkName, @Ptr long pTargetFile, @Ptr long pTargetDatasetPath, @Ptr long pTargetDatasetName);
+	/** Pointer to unknown (opaque) type */
+	public static class SQY_Pipeline extends TypedPointer {
+		public SQY_Pipeline(long address) {
+			super(address);
+		}
+		public SQY_Pipeline(Pointer address) {
+			super(address);
+		}
+	};
 }
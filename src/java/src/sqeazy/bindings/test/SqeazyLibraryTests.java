@@ -225,4 +225,65 @@ public class SqeazyLibraryTests
 															   1)
 				);
 		}
+
+    @Test
+    public void testpipeline_handle_RoundTRIP() throws IOException
+		{
+			final String lPipeline = "bitswap1->lz4";
+			final Pointer<Byte> bPipelineName = Pointer.pointerToCString(lPipeline);
+
+			final int lWidth  = 128;
+			final int lHeight = 128;
+			final int lDepth  = 64;
+
+			final int lBufferLengthInShorts = lWidth * lHeight * lDepth;
+			final long lBufferLengthInByte = lBufferLengthInShorts*2;
+
+			final Pointer<Short> lSourceShort = Pointer.allocateShorts(lBufferLengthInShorts);
+			final Pointer<Short> lDestShort = Pointer.allocateShorts(lBufferLengthInShorts);
+			for (int i = 0; i < lBufferLengthInShorts; i++)
+			{
+				lSourceShort.set(i, (short) (1 << (i % 8)));
+			}
+
+			final Pointer<CLong> lSourceShape = Pointer.pointerToCLongs(lDepth,
+																		lHeight,
+																		lWidth);
+
+			final SqeazyLibrary.SQY_Pipeline lHandle = SqeazyLibrary.SQY_Pipeline_Create(bPipelineName,2,1);
+			assertTrue(lHandle != null);
+
+			final Pointer<CLong> lMaxEncodedBytes = Pointer.allocateCLong();
+			assertEquals(0,SqeazyLibrary.SQY_Pipeline_MaxCompressedLength(lHandle,lSourceShape,3,lMaxEncodedBytes));
+			assertTrue(lMaxEncodedBytes.getCLong()>lBufferLengthInByte);
+
+			final Pointer<Byte> bCompressedData = Pointer.allocateBytes(lMaxEncodedBytes.getCLong());
+			final Pointer<CLong> lEncodedBytes = Pointer.allocateCLong();
+
+			//the handle is reused for every frame
+			for (int lFrame = 0; lFrame < 4; lFrame++)
+			{
+				assertEquals(0,SqeazyLibrary.SQY_Pipeline_SetThreads(lHandle,1 + (lFrame % 2)));
+
+				assertEquals(0,
+							 SqeazyLibrary.SQY_Pipeline_Encode(lHandle,
+															   lSourceShort.as(Byte.class),
+															   lSourceShape,
+															   3,
+															   bCompressedData,
+															   lEncodedBytes)
+					);
+				assertTrue(lEncodedBytes.getCLong()<lBufferLengthInByte);
+
+				assertEquals(0,
+							 SqeazyLibrary.SQY_Pipeline_Decode(lHandle,
+															   bCompressedData,
+															   lEncodedBytes.getCLong(),
+															   lDestShort.as(Byte.class))
+					);
+				assertArrayEquals(lSourceShort.getShorts(),lDestShort.getShorts());
+			}
+
+			assertEquals(0,SqeazyLibrary.SQY_Pipeline_Destroy(lHandle));
+		}
 }